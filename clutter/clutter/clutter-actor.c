@@ -635,6 +635,7 @@
 #include "clutter-interval.h"
 #include "clutter-main.h"
 #include "clutter-marshal.h"
+#include "clutter-mutter.h"
 #include "clutter-paint-nodes.h"
 #include "clutter-paint-node-private.h"
 #include "clutter-paint-volume-private.h"
@@ -725,8 +726,6 @@ struct _ClutterActorPrivate
 
   gchar *name; /* a non-unique name, used for debugging */
 
-  gint32 pick_id; /* per-stage unique id, used for picking */
-
   /* a back-pointer to the Pango context that we can use
    * to create pre-configured PangoLayout
    */
@@ -1494,8 +1493,7 @@ clutter_actor_update_map_state (ClutterActor  *self,
 static void
 clutter_actor_real_map (ClutterActor *self)
 {
-  ClutterActorPrivate *priv = self->priv;
-  ClutterActor *stage, *iter;
+  ClutterActor *iter;
 
   g_assert (!CLUTTER_ACTOR_IS_MAPPED (self));
 
@@ -1504,13 +1502,6 @@ clutter_actor_real_map (ClutterActor *self)
 
   CLUTTER_ACTOR_SET_FLAGS (self, CLUTTER_ACTOR_MAPPED);
 
-  stage = _clutter_actor_get_stage_internal (self);
-  priv->pick_id = _clutter_stage_acquire_pick_id (CLUTTER_STAGE (stage), self);
-
-  CLUTTER_NOTE (ACTOR, "Pick id '%d' for actor '%s'",
-                priv->pick_id,
-                _clutter_actor_get_debug_name (self));
-
   /* notify on parent mapped before potentially mapping
    * children, so apps see a top-down notification.
    */
@@ -1613,11 +1604,6 @@ clutter_actor_real_unmap (ClutterActor *self)
 
       stage = CLUTTER_STAGE (_clutter_actor_get_stage_internal (self));
 
-      if (stage != NULL)
-        _clutter_stage_release_pick_id (stage, priv->pick_id);
-
-      priv->pick_id = -1;
-
       if (stage != NULL &&
           clutter_stage_get_key_focus (stage) == self)
         {
@@ -2215,11 +2201,10 @@ _clutter_actor_rerealize (ClutterActor    *self,
 }
 
 static void
-clutter_actor_real_pick (ClutterActor       *self,
-			 const ClutterColor *color)
+clutter_actor_real_pick (ClutterActor *self)
 {
-  /* the default implementation is just to paint a rectangle
-   * with the same size of the actor using the passed color
+  /* the default implementation is just to log a rectangle
+   * with the same size of the actor
    */
   if (clutter_actor_should_pick_paint (self))
     {
@@ -2231,12 +2216,12 @@ clutter_actor_real_pick (ClutterActor       *self,
       width = box.x2 - box.x1;
       height = box.y2 - box.y1;
 
-      cogl_set_source_color4ub (color->red,
-                                color->green,
-                                color->blue,
-                                color->alpha);
+      box.x1 = 0.f;
+      box.y1 = 0.f;
+      box.x2 = width;
+      box.y2 = height;
 
-      cogl_rectangle (0, 0, width, height);
+      clutter_actor_pick_box (self, &box);
     }
 
   /* XXX - this thoroughly sucks, but we need to maintain compatibility
@@ -2257,6 +2242,100 @@ clutter_actor_real_pick (ClutterActor       *self,
     }
 }
 
+static void
+clutter_actor_project_box_for_pick (ClutterActor          *self,
+                                    ClutterStage          *stage,
+                                    const ClutterActorBox *box,
+                                    ClutterPoint          *vertices)
+{
+  CoglMatrix modelview, projection;
+  ClutterVertex box_vertices[4];
+  ClutterVertex transformed[4];
+  float viewport[4];
+  int i;
+
+  box_vertices[0].x = box->x1;
+  box_vertices[0].y = box->y1;
+  box_vertices[0].z = 0.f;
+  box_vertices[1].x = box->x2;
+  box_vertices[1].y = box->y1;
+  box_vertices[1].z = 0.f;
+  box_vertices[2].x = box->x2;
+  box_vertices[2].y = box->y2;
+  box_vertices[2].z = 0.f;
+  box_vertices[3].x = box->x1;
+  box_vertices[3].y = box->y2;
+  box_vertices[3].z = 0.f;
+
+  /* The pick pass walks the scene graph exactly like a paint, so the
+   * current modelview already contains the transformation of every
+   * ancestor (and of any clone the actor is being painted through).
+   */
+  cogl_get_modelview_matrix (&modelview);
+  _clutter_stage_get_projection_matrix (stage, &projection);
+  _clutter_stage_get_viewport (stage,
+                               &viewport[0],
+                               &viewport[1],
+                               &viewport[2],
+                               &viewport[3]);
+
+  _clutter_util_fully_transform_vertices (&modelview,
+                                          &projection,
+                                          viewport,
+                                          box_vertices,
+                                          transformed,
+                                          4);
+
+  for (i = 0; i < 4; i++)
+    clutter_point_init (&vertices[i], transformed[i].x, transformed[i].y);
+}
+
+/**
+ * clutter_actor_pick_box:
+ * @self: The #ClutterActor being "pick" painted.
+ * @box: A rectangle in the actor's own local coordinates.
+ *
+ * Logs (does a virtual paint of) a rectangle for picking. Note that @box is
+ * in the actor's own local coordinates, so is usually {0,0,width,height}
+ * to include the whole actor. That is unless the actor has a shaped input
+ * region in which case you may wish to log the (multiple) smaller rectangles
+ * that make up the input region.
+ *
+ * This function should only be called from the implementation of the
+ * #ClutterActorClass.pick virtual function.
+ */
+void
+clutter_actor_pick_box (ClutterActor          *self,
+                        const ClutterActorBox *box)
+{
+  ClutterStage *stage;
+  ClutterPoint vertices[4];
+
+  g_return_if_fail (CLUTTER_IS_ACTOR (self));
+  g_return_if_fail (box != NULL);
+
+  if (box->x1 >= box->x2 || box->y1 >= box->y2)
+    return;
+
+  stage = (ClutterStage *) _clutter_actor_get_stage_internal (self);
+  if (stage == NULL)
+    return;
+
+  clutter_actor_project_box_for_pick (self, stage, box, vertices);
+  _clutter_stage_log_pick (stage, vertices, self);
+}
+
+static void
+clutter_actor_push_pick_clip (ClutterActor          *self,
+                              ClutterStage          *stage,
+                              const ClutterActorBox *clip)
+{
+  ClutterPoint vertices[4];
+
+  clutter_actor_project_box_for_pick (self, stage, clip, vertices);
+  _clutter_stage_push_pick_clip (stage, vertices);
+}
+
 /**
  * clutter_actor_should_pick_paint:
  * @self: A #ClutterActor
@@ -3518,15 +3597,6 @@ actor_has_shader_data (ClutterActor *self)
   return g_object_get_qdata (G_OBJECT (self), quark_shader_data) != NULL;
 }
 
-guint32
-_clutter_actor_get_pick_id (ClutterActor *self)
-{
-  if (self->priv->pick_id < 0)
-    return 0;
-
-  return self->priv->pick_id;
-}
-
 /* This is the same as clutter_actor_add_effect except that it doesn't
    queue a redraw and it doesn't notify on the effect property */
 static void
@@ -3848,25 +3918,41 @@ clutter_actor_paint (ClutterActor *self)
       cogl_set_modelview_matrix (&matrix);
     }
 
-  if (priv->has_clip)
-    {
-      CoglFramebuffer *fb = _clutter_stage_get_active_framebuffer (stage);
-      cogl_framebuffer_push_rectangle_clip (fb,
-                                            priv->clip.origin.x,
-                                            priv->clip.origin.y,
-                                            priv->clip.origin.x + priv->clip.size.width,
-                                            priv->clip.origin.y + priv->clip.size.height);
-      clip_set = TRUE;
-    }
-  else if (priv->clip_to_allocation)
+  if (priv->has_clip || priv->clip_to_allocation)
     {
-      CoglFramebuffer *fb = _clutter_stage_get_active_framebuffer (stage);
-      gfloat width, height;
+      ClutterActorBox clip_box;
 
-      width  = priv->allocation.x2 - priv->allocation.x1;
-      height = priv->allocation.y2 - priv->allocation.y1;
+      if (priv->has_clip)
+        {
+          clip_box.x1 = priv->clip.origin.x;
+          clip_box.y1 = priv->clip.origin.y;
+          clip_box.x2 = priv->clip.origin.x + priv->clip.size.width;
+          clip_box.y2 = priv->clip.origin.y + priv->clip.size.height;
+        }
+      else
+        {
+          clip_box.x1 = 0.f;
+          clip_box.y1 = 0.f;
+          clip_box.x2 = priv->allocation.x2 - priv->allocation.x1;
+          clip_box.y2 = priv->allocation.y2 - priv->allocation.y1;
+        }
+
+      /* Picking never touches the GPU, so clips are tracked by the
+       * stage alongside the logged pick rectangles instead.
+       */
+      if (pick_mode == CLUTTER_PICK_NONE)
+        {
+          CoglFramebuffer *fb = _clutter_stage_get_active_framebuffer (stage);
+
+          cogl_framebuffer_push_rectangle_clip (fb,
+                                                clip_box.x1,
+                                                clip_box.y1,
+                                                clip_box.x2,
+                                                clip_box.y2);
+        }
+      else
+        clutter_actor_push_pick_clip (self, stage, &clip_box);
 
-      cogl_framebuffer_push_rectangle_clip (fb, 0, 0, width, height);
       clip_set = TRUE;
     }
 
@@ -3960,9 +4046,14 @@ done:
 
   if (clip_set)
     {
-      CoglFramebuffer *fb = _clutter_stage_get_active_framebuffer (stage);
+      if (pick_mode == CLUTTER_PICK_NONE)
+        {
+          CoglFramebuffer *fb = _clutter_stage_get_active_framebuffer (stage);
 
-      cogl_framebuffer_pop_clip (fb);
+          cogl_framebuffer_pop_clip (fb);
+        }
+      else
+        _clutter_stage_pop_pick_clip (stage);
     }
 
   cogl_pop_matrix ();
@@ -4031,21 +4122,17 @@ clutter_actor_continue_paint (ClutterActor *self)
         }
       else
         {
-          ClutterColor col = { 0, };
-
-          _clutter_id_to_color (_clutter_actor_get_pick_id (self), &col);
-
-          /* Actor will then paint silhouette of itself in supplied
-           * color.  See clutter_stage_get_actor_at_pos() for where
+          /* Actor will then log the silhouette of itself on the stage
+           * pick stack. See clutter_stage_get_actor_at_pos() for where
            * picking is enabled.
            *
            * XXX:2.0 - Call the pick() virtual directly
            */
           if (g_signal_has_handler_pending (self, actor_signals[PICK],
                                             0, TRUE))
-            g_signal_emit (self, actor_signals[PICK], 0, &col);
+            g_signal_emit (self, actor_signals[PICK], 0);
           else
-            CLUTTER_ACTOR_GET_CLASS (self)->pick (self, &col);
+            CLUTTER_ACTOR_GET_CLASS (self)->pick (self);
         }
     }
   else
@@ -8382,12 +8469,11 @@ clutter_actor_class_init (ClutterActorClass *klass)
   /**
    * ClutterActor::pick:
    * @actor: the #ClutterActor that received the signal
-   * @color: the #ClutterColor to be used when picking
    *
    * The ::pick signal is emitted each time an actor is being painted
    * in "pick mode". The pick mode is used to identify the actor during
    * the event handling phase, or by clutter_stage_get_actor_at_pos().
-   * The actor should paint its shape using the passed @pick_color.
+   * The actor should log its shape using clutter_actor_pick_box().
    *
    * Subclasses of #ClutterActor should override the class signal handler
    * and paint themselves in that function.
@@ -8405,9 +8491,8 @@ clutter_actor_class_init (ClutterActorClass *klass)
                   G_SIGNAL_RUN_LAST | G_SIGNAL_DEPRECATED,
                   G_STRUCT_OFFSET (ClutterActorClass, pick),
                   NULL, NULL,
-                  _clutter_marshal_VOID__BOXED,
-                  G_TYPE_NONE, 1,
-                  CLUTTER_TYPE_COLOR | G_SIGNAL_TYPE_STATIC_SCOPE);
+                  _clutter_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
 
   /**
    * ClutterActor::allocation-changed:
@@ -8510,8 +8595,6 @@ clutter_actor_init (ClutterActor *self)
 
   self->priv = priv = clutter_actor_get_instance_private (self);
 
-  priv->pick_id = -1;
-
   priv->opacity = 0xff;
   priv->show_on_set_parent = TRUE;
 
@@ -13956,6 +14039,17 @@ clutter_actor_set_reactive (ClutterActor *actor,
   else
     CLUTTER_ACTOR_UNSET_FLAGS (actor, CLUTTER_ACTOR_REACTIVE);
 
+  /* the cached pick geometry only covers reactive actors when picking
+   * in CLUTTER_PICK_REACTIVE mode, so it is stale now
+   */
+  if (CLUTTER_ACTOR_IS_MAPPED (actor))
+    {
+      ClutterActor *stage = _clutter_actor_get_stage_internal (actor);
+
+      if (stage != NULL)
+        clutter_stage_clear_pick_stack (CLUTTER_STAGE (stage));
+    }
+
   g_object_notify_by_pspec (G_OBJECT (actor), obj_props[PROP_REACTIVE]);
 }
 
@@ -182,8 +182,8 @@ struct _ClutterActor
  * @parent_set: signal class handler for the #ClutterActor::parent-set
  * @destroy: signal class handler for #ClutterActor::destroy. It must
  *   chain up to the parent's implementation
- * @pick: virtual function, used to draw an outline of the actor with
- *   the given color
+ * @pick: virtual function, used to log the outline of the actor on the
+ *   stage pick stack using clutter_actor_pick_box()
  * @queue_redraw: class handler for #ClutterActor::queue-redraw
  * @event: class handler for #ClutterActor::event
  * @button_press_event: class handler for #ClutterActor::button-press-event
@@ -233,8 +233,7 @@ struct _ClutterActorClass
                                  ClutterActor          *old_parent);
 
   void (* destroy)              (ClutterActor          *self);
-  void (* pick)                 (ClutterActor          *actor,
-                                 const ClutterColor    *color);
+  void (* pick)                 (ClutterActor          *actor);
 
   void (* queue_redraw)         (ClutterActor          *actor,
                                  ClutterActor          *leaf_that_queued);
@@ -578,6 +577,9 @@ CLUTTER_AVAILABLE_IN_1_8
 ClutterOffscreenRedirect        clutter_actor_get_offscreen_redirect            (ClutterActor               *self);
 CLUTTER_AVAILABLE_IN_ALL
 gboolean                        clutter_actor_should_pick_paint                 (ClutterActor               *self);
+CLUTTER_AVAILABLE_IN_MUTTER
+void                            clutter_actor_pick_box                          (ClutterActor               *self,
+                                                                                 const ClutterActorBox      *box);
 CLUTTER_AVAILABLE_IN_ALL
 gboolean                        clutter_actor_is_in_clone_paint                 (ClutterActor               *self);
 CLUTTER_AVAILABLE_IN_ALL
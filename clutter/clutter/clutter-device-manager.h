@@ -104,14 +104,11 @@ struct _ClutterDeviceManagerClass
                                                ClutterStage       *stage);
   ClutterVirtualInputDevice *(* create_virtual_device) (ClutterDeviceManager  *device_manager,
                                                         ClutterInputDeviceType device_type);
-  void                (* compress_motion) (ClutterDeviceManager *device_manger,
-                                           ClutterEvent         *event,
-                                           const ClutterEvent   *to_discard);
   /* Keyboard accessbility */
   void                (* apply_kbd_a11y_settings) (ClutterDeviceManager   *device_manger,
                                                    ClutterKbdA11ySettings *settings);
   /* padding */
-  gpointer _padding[6];
+  gpointer _padding[7];
 };
 
 CLUTTER_AVAILABLE_IN_1_2
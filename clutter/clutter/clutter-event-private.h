@@ -31,6 +31,9 @@ void            _clutter_event_set_state_full           (ClutterEvent        *ev
 void            _clutter_event_push                     (const ClutterEvent *event,
                                                          gboolean            do_copy);
 
+void            _clutter_event_push_motion_history      (ClutterEvent       *event,
+                                                         ClutterEvent       *discarded);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_EVENT_PRIVATE_H__ */
@@ -34,6 +34,7 @@
 #include "clutter-private.h"
 
 #include <math.h>
+#include <string.h>
 
 /**
  * SECTION:clutter-event
@@ -58,12 +59,18 @@ typedef struct _ClutterEventPrivate {
 
   gpointer platform_data;
 
+  /* motion events coalesced into this one, oldest first */
+  GPtrArray *motion_history;
+
   ClutterModifierType button_state;
   ClutterModifierType base_state;
   ClutterModifierType latched_state;
   ClutterModifierType locked_state;
 
   guint is_pointer_emulated : 1;
+  guint is_allocated        : 1;
+
+  struct _ClutterEventPrivate *next_free;
 } ClutterEventPrivate;
 
 typedef struct _ClutterEventFilter {
@@ -75,7 +82,21 @@ typedef struct _ClutterEventFilter {
   gpointer user_data;
 } ClutterEventFilter;
 
-static GHashTable *all_events = NULL;
+/*
+ * Events are allocated from a pool of fixed size chunks and recycled
+ * through a free list, so that high frequency input doesn't go through
+ * the allocator for every single event. Whether an event comes from
+ * clutter_event_new() is checked by looking up the chunk it lives in.
+ */
+#define EVENT_POOL_CHUNK_SIZE 256
+
+typedef struct _ClutterEventPool
+{
+  GPtrArray *chunks;
+  ClutterEventPrivate *free_list;
+} ClutterEventPool;
+
+static ClutterEventPool event_pool;
 
 G_DEFINE_BOXED_TYPE (ClutterEvent, clutter_event,
                      clutter_event_copy,
@@ -98,13 +119,69 @@ G_DEFINE_BOXED_TYPE (ClutterEventSequence, clutter_event_sequence,
                      clutter_event_sequence_copy,
                      clutter_event_sequence_free);
 
+static void
+event_pool_grow (void)
+{
+  ClutterEventPrivate *chunk;
+  int i;
+
+  if (G_UNLIKELY (event_pool.chunks == NULL))
+    event_pool.chunks = g_ptr_array_new ();
+
+  chunk = g_new0 (ClutterEventPrivate, EVENT_POOL_CHUNK_SIZE);
+  g_ptr_array_add (event_pool.chunks, chunk);
+
+  for (i = EVENT_POOL_CHUNK_SIZE - 1; i >= 0; i--)
+    {
+      chunk[i].next_free = event_pool.free_list;
+      event_pool.free_list = &chunk[i];
+    }
+}
+
+static ClutterEventPrivate *
+event_pool_alloc (void)
+{
+  ClutterEventPrivate *priv;
+
+  if (G_UNLIKELY (event_pool.free_list == NULL))
+    event_pool_grow ();
+
+  priv = event_pool.free_list;
+  event_pool.free_list = priv->next_free;
+
+  memset (priv, 0, sizeof (ClutterEventPrivate));
+  priv->is_allocated = TRUE;
+
+  return priv;
+}
+
+static void
+event_pool_free (ClutterEventPrivate *priv)
+{
+  priv->is_allocated = FALSE;
+  priv->next_free = event_pool.free_list;
+  event_pool.free_list = priv;
+}
+
 static gboolean
 is_event_allocated (const ClutterEvent *event)
 {
-  if (all_events == NULL)
+  guintptr address = (guintptr) event;
+  guint i;
+
+  if (event_pool.chunks == NULL)
     return FALSE;
 
-  return g_hash_table_lookup (all_events, event) != NULL;
+  for (i = 0; i < event_pool.chunks->len; i++)
+    {
+      guintptr chunk = (guintptr) g_ptr_array_index (event_pool.chunks, i);
+
+      if (address >= chunk &&
+          address < chunk + EVENT_POOL_CHUNK_SIZE * sizeof (ClutterEventPrivate))
+        return ((const ClutterEventPrivate *) event)->is_allocated;
+    }
+
+  return FALSE;
 }
 
 /*
@@ -155,6 +232,48 @@ _clutter_event_set_pointer_emulated (ClutterEvent *event,
   ((ClutterEventPrivate *) event)->is_pointer_emulated = !!is_emulated;
 }
 
+/*
+ * _clutter_event_push_motion_history:
+ * @event: a motion #ClutterEvent
+ * @discarded: (transfer full): an older motion event of the same device
+ *
+ * Coalesces @discarded into @event: @discarded, and any history it
+ * carried itself, is appended to the motion history of @event, which
+ * takes ownership of it.
+ */
+void
+_clutter_event_push_motion_history (ClutterEvent *event,
+                                    ClutterEvent *discarded)
+{
+  ClutterEventPrivate *real_event = (ClutterEventPrivate *) event;
+  ClutterEventPrivate *real_discarded = (ClutterEventPrivate *) discarded;
+
+  if (!is_event_allocated (event) || !is_event_allocated (discarded))
+    {
+      clutter_event_free (discarded);
+      return;
+    }
+
+  if (real_event->motion_history == NULL)
+    real_event->motion_history =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) clutter_event_free);
+
+  if (real_discarded->motion_history != NULL)
+    {
+      guint i;
+
+      for (i = 0; i < real_discarded->motion_history->len; i++)
+        g_ptr_array_add (real_event->motion_history,
+                         g_ptr_array_index (real_discarded->motion_history, i));
+
+      g_ptr_array_set_free_func (real_discarded->motion_history, NULL);
+      g_ptr_array_free (real_discarded->motion_history, TRUE);
+      real_discarded->motion_history = NULL;
+    }
+
+  g_ptr_array_add (real_event->motion_history, discarded);
+}
+
 /**
  * clutter_event_type:
  * @event: a #ClutterEvent
@@ -1324,16 +1443,11 @@ clutter_event_new (ClutterEventType type)
   ClutterEvent *new_event;
   ClutterEventPrivate *priv;
 
-  priv = g_slice_new0 (ClutterEventPrivate);
+  priv = event_pool_alloc ();
 
   new_event = (ClutterEvent *) priv;
   new_event->type = new_event->any.type = type;
 
-  if (G_UNLIKELY (all_events == NULL))
-    all_events = g_hash_table_new (NULL, NULL);
-
-  g_hash_table_replace (all_events, priv, GUINT_TO_POINTER (1));
-
   return new_event;
 }
 
@@ -1374,6 +1488,24 @@ clutter_event_copy (const ClutterEvent *event)
       new_real_event->latched_state = real_event->latched_state;
       new_real_event->locked_state = real_event->locked_state;
       new_real_event->tool = real_event->tool;
+
+      if (real_event->motion_history != NULL)
+        {
+          guint i;
+
+          new_real_event->motion_history =
+            g_ptr_array_new_full (real_event->motion_history->len,
+                                  (GDestroyNotify) clutter_event_free);
+
+          for (i = 0; i < real_event->motion_history->len; i++)
+            {
+              ClutterEvent *entry =
+                g_ptr_array_index (real_event->motion_history, i);
+
+              g_ptr_array_add (new_real_event->motion_history,
+                               clutter_event_copy (entry));
+            }
+        }
     }
 
   device = clutter_event_get_device (event);
@@ -1461,8 +1593,15 @@ clutter_event_free (ClutterEvent *event)
           break;
         }
 
-      g_hash_table_remove (all_events, event);
-      g_slice_free (ClutterEventPrivate, (ClutterEventPrivate *) event);
+      if (is_event_allocated (event))
+        {
+          ClutterEventPrivate *real_event = (ClutterEventPrivate *) event;
+
+          if (real_event->motion_history != NULL)
+            g_ptr_array_free (real_event->motion_history, TRUE);
+        }
+
+      event_pool_free ((ClutterEventPrivate *) event);
     }
 }
 
@@ -1892,6 +2031,39 @@ clutter_event_is_pointer_emulated (const ClutterEvent *event)
   return ((ClutterEventPrivate *) event)->is_pointer_emulated;
 }
 
+/**
+ * clutter_event_get_motion_history:
+ * @event: a #ClutterEvent of type %CLUTTER_MOTION
+ * @n_events: (out): return location for the number of events
+ *
+ * Retrieves the motion events of the same device that were coalesced
+ * into @event by the stage because they arrived within the same frame,
+ * oldest first. Each of them carries its own position, time and, where
+ * the backend provides them, relative deltas; @event itself only
+ * describes the latest sample.
+ *
+ * Return value: (array length=n_events) (transfer none): the coalesced
+ *   events, or %NULL if none
+ */
+ClutterEvent **
+clutter_event_get_motion_history (const ClutterEvent *event,
+                                  guint              *n_events)
+{
+  ClutterEventPrivate *real_event = (ClutterEventPrivate *) event;
+
+  g_return_val_if_fail (event != NULL, NULL);
+  g_return_val_if_fail (n_events != NULL, NULL);
+
+  if (!is_event_allocated (event) || real_event->motion_history == NULL)
+    {
+      *n_events = 0;
+      return NULL;
+    }
+
+  *n_events = real_event->motion_history->len;
+  return (ClutterEvent **) real_event->motion_history->pdata;
+}
+
 gboolean
 _clutter_event_process_filters (ClutterEvent *event)
 {
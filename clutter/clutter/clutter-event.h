@@ -784,6 +784,10 @@ gboolean                 clutter_event_get_pad_event_details         (const Clut
                                                                       guint                  *mode,
                                                                       gdouble                *value);
 
+CLUTTER_AVAILABLE_IN_MUTTER
+ClutterEvent **          clutter_event_get_motion_history            (const ClutterEvent     *event,
+                                                                      guint                  *n_events);
+
 
 G_END_DECLS
 
@@ -1052,8 +1052,13 @@ _clutter_input_device_update (ClutterInputDevice   *device,
   clutter_input_device_get_coords (device, sequence, &point);
 
   old_cursor_actor = _clutter_input_device_get_actor (device, sequence);
-  new_cursor_actor =
-    _clutter_stage_do_pick (stage, point.x, point.y, CLUTTER_PICK_REACTIVE);
+  if (sequence == NULL)
+    new_cursor_actor = _clutter_stage_do_pick_for_device (stage, device,
+                                                          point.x, point.y,
+                                                          CLUTTER_PICK_REACTIVE);
+  else
+    new_cursor_actor = _clutter_stage_do_pick (stage, point.x, point.y,
+                                               CLUTTER_PICK_REACTIVE);
 
   /* if the pick could not find an actor then we do not update the
    * input device, to avoid ghost enter/leave events; the pick should
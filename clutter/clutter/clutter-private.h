@@ -35,7 +35,6 @@
 #include "clutter-effect.h"
 #include "clutter-event.h"
 #include "clutter-feature.h"
-#include "clutter-id-pool.h"
 #include "clutter-layout-manager.h"
 #include "clutter-master-clock.h"
 #include "clutter-settings.h"
@@ -143,14 +142,6 @@ struct _ClutterMainContext
   /* stack of actors with shaders during paint */
   GSList *shaders;
 
-  /* fb bit masks for col<->id mapping in picking */
-  gint fb_r_mask;
-  gint fb_g_mask;
-  gint fb_b_mask;
-  gint fb_r_mask_used;
-  gint fb_g_mask_used;
-  gint fb_b_mask_used;
-
   CoglPangoFontMap *font_map;   /* Global font map */
 
   /* stack of #ClutterEvent */
@@ -204,11 +195,6 @@ gboolean      _clutter_feature_init (GError **error);
 gboolean        _clutter_diagnostic_enabled     (void);
 void            _clutter_diagnostic_message     (const char *fmt, ...);
 
-/* Picking code */
-guint           _clutter_pixel_to_id            (guchar        pixel[4]);
-void            _clutter_id_to_color            (guint         id,
-                                                 ClutterColor *col);
-
 void            _clutter_set_sync_to_vblank     (gboolean      sync_to_vblank);
 
 /* use this function as the accumulator if you have a signal with
@@ -39,6 +39,12 @@ ClutterStageWindow *_clutter_stage_get_default_window    (void);
 void                _clutter_stage_paint_view            (ClutterStage                *stage,
                                                           ClutterStageView            *view,
                                                           const cairo_rectangle_int_t *clip);
+void                _clutter_stage_emit_after_paint      (ClutterStage                *stage);
+void                _clutter_stage_emit_view_painted     (ClutterStage                *stage,
+                                                          ClutterStageView            *view,
+                                                          const cairo_region_t        *redraw_clip);
+void                _clutter_stage_process_pending_captures (ClutterStage     *stage,
+                                                             ClutterStageView *view);
 
 void                _clutter_stage_set_window            (ClutterStage          *stage,
                                                           ClutterStageWindow    *stage_window);
@@ -78,6 +84,11 @@ ClutterActor *_clutter_stage_do_pick (ClutterStage    *stage,
                                       gint             x,
                                       gint             y,
                                       ClutterPickMode  mode);
+ClutterActor *_clutter_stage_do_pick_for_device (ClutterStage       *stage,
+                                                 ClutterInputDevice *device,
+                                                 gint                x,
+                                                 gint                y,
+                                                 ClutterPickMode     mode);
 
 ClutterPaintVolume *_clutter_stage_paint_volume_stack_allocate (ClutterStage *stage);
 void                _clutter_stage_paint_volume_stack_free_all (ClutterStage *stage);
@@ -92,12 +103,12 @@ void                          _clutter_stage_queue_redraw_entry_invalidate (Clut
 
 CoglFramebuffer *_clutter_stage_get_active_framebuffer (ClutterStage *stage);
 
-gint32          _clutter_stage_acquire_pick_id          (ClutterStage *stage,
-                                                         ClutterActor *actor);
-void            _clutter_stage_release_pick_id          (ClutterStage *stage,
-                                                         gint32        pick_id);
-ClutterActor *  _clutter_stage_get_actor_by_pick_id     (ClutterStage *stage,
-                                                         gint32        pick_id);
+void            _clutter_stage_log_pick                 (ClutterStage       *stage,
+                                                         const ClutterPoint *vertices,
+                                                         ClutterActor       *actor);
+void            _clutter_stage_push_pick_clip           (ClutterStage       *stage,
+                                                         const ClutterPoint *vertices);
+void            _clutter_stage_pop_pick_clip            (ClutterStage       *stage);
 
 void            _clutter_stage_add_pointer_drag_actor    (ClutterStage       *stage,
                                                           ClutterInputDevice *device,
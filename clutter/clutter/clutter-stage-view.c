@@ -47,6 +47,7 @@ typedef struct _ClutterStageViewPrivate
 
   guint dirty_viewport   : 1;
   guint dirty_projection : 1;
+  guint has_next_scanout : 1;
 } ClutterStageViewPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (ClutterStageView, clutter_stage_view, G_TYPE_OBJECT)
@@ -191,6 +192,45 @@ clutter_stage_view_set_dirty_projection (ClutterStageView *view,
   priv->dirty_projection = dirty;
 }
 
+/**
+ * clutter_stage_view_assign_next_scanout: (skip)
+ * @view: a #ClutterStageView
+ *
+ * Tells the stage that the content of @view for the next frame will be
+ * scanned out directly from a buffer that the windowing system has
+ * already set up, so the stage should not paint the view but only
+ * present it.
+ */
+void
+clutter_stage_view_assign_next_scanout (ClutterStageView *view)
+{
+  ClutterStageViewPrivate *priv =
+    clutter_stage_view_get_instance_private (view);
+
+  priv->has_next_scanout = TRUE;
+}
+
+/**
+ * clutter_stage_view_take_next_scanout: (skip)
+ * @view: a #ClutterStageView
+ *
+ * Clears a scanout assigned with clutter_stage_view_assign_next_scanout().
+ *
+ * Returns: whether a scanout was assigned
+ */
+gboolean
+clutter_stage_view_take_next_scanout (ClutterStageView *view)
+{
+  ClutterStageViewPrivate *priv =
+    clutter_stage_view_get_instance_private (view);
+  gboolean has_next_scanout;
+
+  has_next_scanout = priv->has_next_scanout;
+  priv->has_next_scanout = FALSE;
+
+  return has_next_scanout;
+}
+
 void
 clutter_stage_view_get_offscreen_transformation_matrix (ClutterStageView *view,
                                                         CoglMatrix       *matrix)
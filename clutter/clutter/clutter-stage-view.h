@@ -73,6 +73,12 @@ gboolean clutter_stage_view_is_dirty_projection (ClutterStageView *view);
 void clutter_stage_view_set_dirty_projection (ClutterStageView *view,
                                               gboolean          dirty);
 
+CLUTTER_AVAILABLE_IN_MUTTER
+void clutter_stage_view_assign_next_scanout (ClutterStageView *view);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+gboolean clutter_stage_view_take_next_scanout (ClutterStageView *view);
+
 CLUTTER_AVAILABLE_IN_MUTTER
 void clutter_stage_view_get_offscreen_transformation_matrix (ClutterStageView *view,
                                                              CoglMatrix       *matrix);
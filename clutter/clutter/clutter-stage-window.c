@@ -272,23 +272,6 @@ _clutter_stage_window_redraw (ClutterStageWindow *window)
 }
 
 
-void
-_clutter_stage_window_get_dirty_pixel (ClutterStageWindow *window,
-                                       ClutterStageView   *view,
-                                       int *x, int *y)
-{
-  ClutterStageWindowIface *iface;
-
-  *x = 0;
-  *y = 0;
-
-  g_return_if_fail (CLUTTER_IS_STAGE_WINDOW (window));
-
-  iface = CLUTTER_STAGE_WINDOW_GET_IFACE (window);
-  if (iface->get_dirty_pixel)
-    iface->get_dirty_pixel (window, view, x, y);
-}
-
 gboolean
 _clutter_stage_window_can_clip_redraws (ClutterStageWindow *window)
 {
@@ -320,6 +303,22 @@ _clutter_stage_window_finish_frame (ClutterStageWindow *window)
     iface->finish_frame (window);
 }
 
+/*
+ * Returns whether parts of the last redraw were held back, e.g. because
+ * some views weren't ready for a new frame yet, and another redraw is
+ * needed to paint them.
+ */
+gboolean
+_clutter_stage_window_has_deferred_redraws (ClutterStageWindow *window)
+{
+  ClutterStageWindowIface *iface = CLUTTER_STAGE_WINDOW_GET_IFACE (window);
+
+  if (iface->has_deferred_redraws)
+    return iface->has_deferred_redraws (window);
+
+  return FALSE;
+}
+
 int64_t
 _clutter_stage_window_get_frame_counter (ClutterStageWindow *window)
 {
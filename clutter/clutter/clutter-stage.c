@@ -46,7 +46,9 @@
 #include "clutter-build-config.h"
 #endif
 
+#include <float.h>
 #include <math.h>
+#include <string.h>
 #include <cairo.h>
 
 #define CLUTTER_DISABLE_DEPRECATION_WARNINGS
@@ -65,7 +67,6 @@
 #include "clutter-device-manager-private.h"
 #include "clutter-enum-types.h"
 #include "clutter-event-private.h"
-#include "clutter-id-pool.h"
 #include "clutter-main.h"
 #include "clutter-marshal.h"
 #include "clutter-master-clock.h"
@@ -105,6 +106,53 @@ struct _ClutterStageQueueRedrawEntry
   ClutterPaintVolume clip;
 };
 
+/* A pick record is the screen space quadrilateral an actor logged
+ * through clutter_actor_pick_box() while walking the scene graph in
+ * pick mode, along with the innermost clip that was active at the
+ * time. Clips are chained through PickClipRecord.prev.
+ */
+typedef struct _PickRecord
+{
+  ClutterPoint vertex[4];
+  ClutterActor *actor;
+  int clip_stack_top;
+} PickRecord;
+
+typedef struct _PickClipRecord
+{
+  int prev;
+  ClutterPoint vertex[4];
+} PickClipRecord;
+
+/* The last pick of a pointer device: the pick record that was hit, and
+ * the records stacked above it whose bounds overlap it. As long as what
+ * the pick stack logs didn't change in between, a point that is inside the
+ * hit record and none of the overlapping ones picks the same actor, without
+ * searching the rest of the stack.
+ */
+typedef struct _PointerPickCache
+{
+  guint generation;
+  ClutterPickMode mode;
+  ClutterStageView *view;
+  int record;
+  GArray *occluders;
+} PointerPickCache;
+
+/* Queued events are kept in a ring buffer, so queuing an event doesn't
+ * allocate anything. The ring only grows if more than its capacity worth
+ * of events is queued between two frames; events are never dropped.
+ */
+#define EVENT_RING_INITIAL_CAPACITY 256
+
+typedef struct _EventRing
+{
+  ClutterEvent **events;
+  guint capacity;
+  guint head;
+  guint length;
+} EventRing;
+
 struct _ClutterStagePrivate
 {
   /* the stage implementation */
@@ -121,7 +169,8 @@ struct _ClutterStagePrivate
   gchar *title;
   ClutterActor *key_focused_actor;
 
-  GQueue *event_queue;
+  EventRing *event_queue;
+  EventRing *spare_event_queue;
 
   ClutterStageHint stage_hints;
 
@@ -131,6 +180,8 @@ struct _ClutterStagePrivate
 
   GList *pending_queue_redraws;
 
+  GList *pending_captures;
+
   CoglFramebuffer *active_framebuffer;
 
   gint sync_delay;
@@ -138,7 +189,18 @@ struct _ClutterStagePrivate
   GTimer *fps_timer;
   gint32 timer_n_frames;
 
-  ClutterIDPool *pick_id_pool;
+  GArray *pick_stack;
+  GArray *pick_clip_stack;
+  int pick_clip_stack_top;
+  ClutterPickMode cached_pick_mode;
+  /* The stack discarded by a redraw, kept until the next pick to find out
+   * whether rebuilding it changed anything */
+  GArray *stale_pick_stack;
+  GArray *stale_pick_clip_stack;
+  ClutterPickMode stale_pick_mode;
+  /* Bumped whenever what the pick stack logs changes */
+  guint pick_scene_generation;
+  GHashTable *pointer_pick_caches;
 
 #ifdef CLUTTER_ENABLE_DEBUG
   gulong redraw_count;
@@ -162,6 +224,7 @@ struct _ClutterStagePrivate
   guint motion_events_enabled  : 1;
   guint has_custom_perspective : 1;
   guint stage_was_relayout     : 1;
+  guint pick_stack_building    : 1;
 };
 
 enum
@@ -191,6 +254,7 @@ enum
   DEACTIVATE,
   DELETE_EVENT,
   AFTER_PAINT,
+  VIEW_PAINTED,
   PRESENTED,
 
   LAST_SIGNAL
@@ -202,6 +266,7 @@ static const ClutterColor default_stage_color = { 255, 255, 255, 255 };
 
 static void clutter_stage_maybe_finish_queue_redraws (ClutterStage *stage);
 static void free_queue_redraw_entry (ClutterStageQueueRedrawEntry *entry);
+static void cancel_pending_captures (ClutterStage *stage);
 
 static void clutter_container_iface_init (ClutterContainerIface *iface);
 
@@ -671,6 +736,10 @@ clutter_stage_do_paint_view (ClutterStage                *stage,
 
 /* This provides a common point of entry for painting the scenegraph
  * for picking or painting...
+ *
+ * A view may be painted in several clipped passes within one frame, so
+ * the stage window is responsible for calling
+ * _clutter_stage_emit_after_paint() once the view is complete.
  */
 void
 _clutter_stage_paint_view (ClutterStage                *stage,
@@ -683,9 +752,22 @@ _clutter_stage_paint_view (ClutterStage                *stage,
     return;
 
   clutter_stage_do_paint_view (stage, view, clip);
+}
+
+void
+_clutter_stage_emit_after_paint (ClutterStage *stage)
+{
   g_signal_emit (stage, stage_signals[AFTER_PAINT], 0);
 }
 
+void
+_clutter_stage_emit_view_painted (ClutterStage         *stage,
+                                  ClutterStageView     *view,
+                                  const cairo_region_t *redraw_clip)
+{
+  g_signal_emit (stage, stage_signals[VIEW_PAINTED], 0, view, redraw_clip);
+}
+
 /* If we don't implement this here, we get the paint function
  * from the deprecated clutter-group class, which doesn't
  * respect the Z order as it uses our empty sort_depth_order.
@@ -702,15 +784,14 @@ clutter_stage_paint (ClutterActor *self)
 }
 
 static void
-clutter_stage_pick (ClutterActor       *self,
-		    const ClutterColor *color)
+clutter_stage_pick (ClutterActor *self)
 {
   ClutterActorIter iter;
   ClutterActor *child;
 
   /* Note: we don't chain up to our parent as we don't want any geometry
-   * emitted for the stage itself. The stage's pick id is effectively handled
-   * by the call to cogl_clear done in clutter-main.c:_clutter_do_pick_async()
+   * logged for the stage itself. The stage is what _clutter_stage_do_pick()
+   * returns when no logged pick record contains the point.
    */
   clutter_actor_iter_init (&iter, self);
   while (clutter_actor_iter_next (&iter, &child))
@@ -872,6 +953,60 @@ clutter_stage_real_fullscreen (ClutterStage *stage)
                           CLUTTER_ALLOCATION_NONE);
 }
 
+static EventRing *
+event_ring_new (void)
+{
+  EventRing *ring;
+
+  ring = g_new0 (EventRing, 1);
+  ring->capacity = EVENT_RING_INITIAL_CAPACITY;
+  ring->events = g_new (ClutterEvent *, ring->capacity);
+
+  return ring;
+}
+
+static void
+event_ring_free (EventRing *ring)
+{
+  guint i;
+
+  for (i = 0; i < ring->length; i++)
+    clutter_event_free (ring->events[(ring->head + i) & (ring->capacity - 1)]);
+
+  g_free (ring->events);
+  g_free (ring);
+}
+
+static inline ClutterEvent *
+event_ring_get (EventRing *ring,
+                guint      index)
+{
+  return ring->events[(ring->head + index) & (ring->capacity - 1)];
+}
+
+static void
+event_ring_push (EventRing    *ring,
+                 ClutterEvent *event)
+{
+  if (G_UNLIKELY (ring->length == ring->capacity))
+    {
+      ClutterEvent **events;
+      guint i;
+
+      events = g_new (ClutterEvent *, ring->capacity * 2);
+      for (i = 0; i < ring->length; i++)
+        events[i] = event_ring_get (ring, i);
+
+      g_free (ring->events);
+      ring->events = events;
+      ring->capacity *= 2;
+      ring->head = 0;
+    }
+
+  ring->events[(ring->head + ring->length) & (ring->capacity - 1)] = event;
+  ring->length++;
+}
+
 void
 _clutter_stage_queue_event (ClutterStage *stage,
                             ClutterEvent *event,
@@ -890,7 +1025,7 @@ _clutter_stage_queue_event (ClutterStage *stage,
   if (copy_event)
     event = clutter_event_copy (event);
 
-  g_queue_push_tail (priv->event_queue, event);
+  event_ring_push (priv->event_queue, event);
 
   if (first_event)
     {
@@ -937,7 +1072,8 @@ void
 _clutter_stage_process_queued_events (ClutterStage *stage)
 {
   ClutterStagePrivate *priv;
-  GList *events, *l;
+  EventRing *events;
+  guint i;
 
   g_return_if_fail (CLUTTER_IS_STAGE (stage));
 
@@ -950,13 +1086,15 @@ _clutter_stage_process_queued_events (ClutterStage *stage)
   g_object_ref (stage);
 
   /* Steal events before starting processing to avoid reentrancy
-   * issues */
-  events = priv->event_queue->head;
-  priv->event_queue->head =  NULL;
-  priv->event_queue->tail = NULL;
-  priv->event_queue->length = 0;
+   * issues; the spare ring is only missing when called recursively */
+  events = priv->event_queue;
+  if (priv->spare_event_queue)
+    priv->event_queue = priv->spare_event_queue;
+  else
+    priv->event_queue = event_ring_new ();
+  priv->spare_event_queue = NULL;
 
-  for (l = events; l != NULL; l = l->next)
+  for (i = 0; i < events->length; i++)
     {
       ClutterEvent *event;
       ClutterEvent *next_event;
@@ -965,8 +1103,8 @@ _clutter_stage_process_queued_events (ClutterStage *stage)
       ClutterInputDeviceType device_type;
       gboolean check_device = FALSE;
 
-      event = l->data;
-      next_event = l->next ? l->next->data : NULL;
+      event = event_ring_get (events, i);
+      next_event = i + 1 < events->length ? event_ring_get (events, i + 1) : NULL;
 
       device = clutter_event_get_device (event);
 
@@ -999,13 +1137,12 @@ _clutter_stage_process_queued_events (ClutterStage *stage)
                             (int) event->motion.x,
                             (int) event->motion.y);
 
+              /* Keep the sample around, so that consumers wanting every
+               * motion of the device can still get to it */
               if (next_event->type == CLUTTER_MOTION)
                 {
-                  ClutterDeviceManager *device_manager =
-                    clutter_device_manager_get_default ();
-
-                  _clutter_device_manager_compress_motion (device_manager,
-                                                           next_event, event);
+                  _clutter_event_push_motion_history (next_event, event);
+                  continue;
                 }
 
               goto next_event;
@@ -1029,7 +1166,12 @@ _clutter_stage_process_queued_events (ClutterStage *stage)
       clutter_event_free (event);
     }
 
-  g_list_free (events);
+  events->head = 0;
+  events->length = 0;
+  if (priv->spare_event_queue == NULL)
+    priv->spare_event_queue = events;
+  else
+    event_ring_free (events);
 
   g_object_unref (stage);
 }
@@ -1068,6 +1210,8 @@ _clutter_stage_maybe_relayout (ClutterActor *actor)
   /* avoid reentrancy */
   if (!CLUTTER_ACTOR_IN_RELAYOUT (stage))
     {
+      COGL_TRACE_BEGIN_SCOPED (ClutterStageRelayout, "Layout");
+
       priv->relayout_pending = FALSE;
       priv->stage_was_relayout = TRUE;
 
@@ -1093,6 +1237,9 @@ _clutter_stage_maybe_relayout (ClutterActor *actor)
                               &box, CLUTTER_ALLOCATION_NONE);
 
       CLUTTER_UNSET_PRIVATE_FLAGS (stage, CLUTTER_IN_RELAYOUT);
+
+      /* Allocations, and with them the stacking order, may have changed */
+      clutter_stage_clear_pick_stack (stage);
     }
 }
 
@@ -1101,6 +1248,7 @@ clutter_stage_do_redraw (ClutterStage *stage)
 {
   ClutterActor *actor = CLUTTER_ACTOR (stage);
   ClutterStagePrivate *priv = stage->priv;
+  COGL_TRACE_BEGIN_SCOPED (ClutterStageRedraw, "Redraw");
 
   if (CLUTTER_ACTOR_IN_DESTRUCTION (stage))
     return;
@@ -1206,6 +1354,7 @@ _clutter_stage_do_update (ClutterStage *stage)
   ClutterStagePrivate *priv = stage->priv;
   gboolean stage_was_relayout = priv->stage_was_relayout;
   GSList *pointers = NULL;
+  COGL_TRACE_BEGIN_SCOPED (ClutterStageUpdate, "Stage update");
 
   priv->stage_was_relayout = FALSE;
 
@@ -1238,6 +1387,10 @@ _clutter_stage_do_update (ClutterStage *stage)
   /* reset the guard, so that new redraws are possible */
   priv->redraw_pending = FALSE;
 
+  /* views that weren't ready to be painted still need a redraw */
+  if (_clutter_stage_window_has_deferred_redraws (priv->impl))
+    priv->redraw_pending = TRUE;
+
 #ifdef CLUTTER_ENABLE_DEBUG
   if (priv->redraw_count > 0)
     {
@@ -1392,36 +1545,461 @@ clutter_stage_get_redraw_clip_bounds (ClutterStage          *stage,
 }
 
 static void
-read_pixels_to_file (char *filename_stem,
-                     int   x,
-                     int   y,
-                     int   width,
-                     int   height)
+remove_pick_stack_weak_refs (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  int i;
+
+  for (i = 0; i < priv->pick_stack->len; i++)
+    {
+      PickRecord *rec = &g_array_index (priv->pick_stack, PickRecord, i);
+
+      if (rec->actor != NULL)
+        g_object_remove_weak_pointer (G_OBJECT (rec->actor),
+                                      (gpointer) &rec->actor);
+    }
+}
+
+static void
+add_pick_stack_weak_refs (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  int i;
+
+  /* The pick stack is not grown anymore once it has been built, so it
+   * is safe to keep pointers to its elements until it gets cleared.
+   */
+  for (i = 0; i < priv->pick_stack->len; i++)
+    {
+      PickRecord *rec = &g_array_index (priv->pick_stack, PickRecord, i);
+
+      if (rec->actor != NULL)
+        g_object_add_weak_pointer (G_OBJECT (rec->actor),
+                                   (gpointer) &rec->actor);
+    }
+}
+
+static void
+clear_stale_pick_stack (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+
+  g_array_set_size (priv->stale_pick_stack, 0);
+  g_array_set_size (priv->stale_pick_clip_stack, 0);
+  priv->stale_pick_mode = CLUTTER_PICK_NONE;
+}
+
+/**
+ * clutter_stage_clear_pick_stack: (skip)
+ * @stage: a #ClutterStage
+ *
+ * Invalidates the geometry logged by the last pick pass. The next pick
+ * will walk the scene graph again. Relayouts and reactivity changes do this
+ * implicitly; this is for changes that only affect picking, like input
+ * regions.
+ */
+void
+clutter_stage_clear_pick_stack (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+
+  priv->cached_pick_mode = CLUTTER_PICK_NONE;
+  priv->pick_scene_generation++;
+
+  /* If the scene changes while the stack is being built, the result
+   * is still used for the pick in progress but not cached.
+   */
+  if (priv->pick_stack_building)
+    return;
+
+  remove_pick_stack_weak_refs (stage);
+  g_array_set_size (priv->pick_stack, 0);
+  g_array_set_size (priv->pick_clip_stack, 0);
+  priv->pick_clip_stack_top = -1;
+
+  clear_stale_pick_stack (stage);
+}
+
+/*
+ * For redraws that may or may not have changed what a pick pass logs, e.g.
+ * transform changes. The stack is rebuilt by the next pick, but it is kept
+ * around until then, and pointer picks only become invalid if the rebuilt
+ * one turns out to be different.
+ */
+static void
+invalidate_pick_stack (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  GArray *pick_stack;
+  GArray *pick_clip_stack;
+
+  if (priv->pick_stack_building)
+    {
+      clutter_stage_clear_pick_stack (stage);
+      return;
+    }
+
+  /* Already discarded, and the stale stack is still the last one built */
+  if (priv->cached_pick_mode == CLUTTER_PICK_NONE)
+    return;
+
+  /* The actors of the stale stack are only compared, never used */
+  remove_pick_stack_weak_refs (stage);
+
+  pick_stack = priv->stale_pick_stack;
+  pick_clip_stack = priv->stale_pick_clip_stack;
+  priv->stale_pick_stack = priv->pick_stack;
+  priv->stale_pick_clip_stack = priv->pick_clip_stack;
+  priv->stale_pick_mode = priv->cached_pick_mode;
+
+  priv->pick_stack = pick_stack;
+  priv->pick_clip_stack = pick_clip_stack;
+  g_array_set_size (priv->pick_stack, 0);
+  g_array_set_size (priv->pick_clip_stack, 0);
+  priv->pick_clip_stack_top = -1;
+  priv->cached_pick_mode = CLUTTER_PICK_NONE;
+}
+
+static gboolean
+pick_vertices_equal (const ClutterPoint *a,
+                     const ClutterPoint *b)
 {
-  guint8 *data;
-  cairo_surface_t *surface;
-  static int read_count = 0;
-  char *filename = g_strdup_printf ("%s-%05d.png",
-                                    filename_stem,
-                                    read_count);
+  int i;
 
-  data = g_malloc (4 * width * height);
-  cogl_read_pixels (x, y, width, height,
-                    COGL_READ_PIXELS_COLOR_BUFFER,
-                    CLUTTER_CAIRO_FORMAT_ARGB32,
-                    data);
+  for (i = 0; i < 4; i++)
+    {
+      if (a[i].x != b[i].x || a[i].y != b[i].y)
+        return FALSE;
+    }
 
-  surface = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_RGB24,
-                                                 width, height,
-                                                 width * 4);
+  return TRUE;
+}
 
-  cairo_surface_write_to_png (surface, filename);
-  cairo_surface_destroy (surface);
+static gboolean
+pick_stack_equals_stale (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  int i;
+
+  if (priv->pick_stack->len != priv->stale_pick_stack->len ||
+      priv->pick_clip_stack->len != priv->stale_pick_clip_stack->len)
+    return FALSE;
+
+  for (i = 0; i < priv->pick_stack->len; i++)
+    {
+      const PickRecord *rec =
+        &g_array_index (priv->pick_stack, PickRecord, i);
+      const PickRecord *stale_rec =
+        &g_array_index (priv->stale_pick_stack, PickRecord, i);
+
+      if (rec->actor != stale_rec->actor ||
+          rec->clip_stack_top != stale_rec->clip_stack_top ||
+          !pick_vertices_equal (rec->vertex, stale_rec->vertex))
+        return FALSE;
+    }
 
-  g_free (data);
-  g_free (filename);
+  for (i = 0; i < priv->pick_clip_stack->len; i++)
+    {
+      const PickClipRecord *clip =
+        &g_array_index (priv->pick_clip_stack, PickClipRecord, i);
+      const PickClipRecord *stale_clip =
+        &g_array_index (priv->stale_pick_clip_stack, PickClipRecord, i);
+
+      if (clip->prev != stale_clip->prev ||
+          !pick_vertices_equal (clip->vertex, stale_clip->vertex))
+        return FALSE;
+    }
 
-  read_count++;
+  return TRUE;
+}
+
+void
+_clutter_stage_log_pick (ClutterStage       *stage,
+                         const ClutterPoint *vertices,
+                         ClutterActor       *actor)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  PickRecord rec;
+
+  g_return_if_fail (actor != NULL);
+
+  if (!priv->pick_stack_building)
+    return;
+
+  memcpy (rec.vertex, vertices, 4 * sizeof (ClutterPoint));
+  rec.actor = actor;
+  rec.clip_stack_top = priv->pick_clip_stack_top;
+
+  g_array_append_val (priv->pick_stack, rec);
+}
+
+void
+_clutter_stage_push_pick_clip (ClutterStage       *stage,
+                               const ClutterPoint *vertices)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  PickClipRecord clip;
+
+  if (!priv->pick_stack_building)
+    return;
+
+  clip.prev = priv->pick_clip_stack_top;
+  memcpy (clip.vertex, vertices, 4 * sizeof (ClutterPoint));
+
+  g_array_append_val (priv->pick_clip_stack, clip);
+  priv->pick_clip_stack_top = priv->pick_clip_stack->len - 1;
+}
+
+void
+_clutter_stage_pop_pick_clip (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  const PickClipRecord *top;
+
+  if (!priv->pick_stack_building)
+    return;
+
+  g_return_if_fail (priv->pick_clip_stack_top >= 0);
+
+  /* Individual elements of pick_clip_stack are not freed. This is so they
+   * can be shared as part of a tree of different stacks used by different
+   * actors in the pick_stack. The whole pick_clip_stack does however get
+   * freed later in clutter_stage_clear_pick_stack.
+   */
+  top = &g_array_index (priv->pick_clip_stack,
+                        PickClipRecord,
+                        priv->pick_clip_stack_top);
+
+  priv->pick_clip_stack_top = top->prev;
+}
+
+static gboolean
+is_quadrilateral_axis_aligned_rectangle (const ClutterPoint *vertices)
+{
+  int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      const ClutterPoint *v1 = &vertices[i];
+      const ClutterPoint *v2 = &vertices[(i + 1) % 4];
+
+      if (fabsf (v1->x - v2->x) > FLT_EPSILON &&
+          fabsf (v1->y - v2->y) > FLT_EPSILON)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+get_quadrilateral_bounds (const ClutterPoint *vertices,
+                          float              *min_x,
+                          float              *min_y,
+                          float              *max_x,
+                          float              *max_y)
+{
+  int i;
+
+  *min_x = *max_x = vertices[0].x;
+  *min_y = *max_y = vertices[0].y;
+
+  for (i = 1; i < 4; i++)
+    {
+      *min_x = MIN (*min_x, vertices[i].x);
+      *max_x = MAX (*max_x, vertices[i].x);
+      *min_y = MIN (*min_y, vertices[i].y);
+      *max_y = MAX (*max_y, vertices[i].y);
+    }
+}
+
+static gboolean
+is_inside_axis_aligned_rectangle (const ClutterPoint *point,
+                                  const ClutterPoint *vertices)
+{
+  float min_x, min_y, max_x, max_y;
+
+  get_quadrilateral_bounds (vertices, &min_x, &min_y, &max_x, &max_y);
+
+  return point->x >= min_x &&
+         point->y >= min_y &&
+         point->x < max_x &&
+         point->y < max_y;
+}
+
+/* Transformed actor boxes are convex quadrilaterals, so a point is
+ * inside if it lies on the same side of all four edges, whatever the
+ * winding of the projected vertices is.
+ */
+static gboolean
+is_inside_unaligned_rectangle (const ClutterPoint *point,
+                               const ClutterPoint *vertices)
+{
+  gboolean seen_positive = FALSE;
+  gboolean seen_negative = FALSE;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      const ClutterPoint *a = &vertices[i];
+      const ClutterPoint *b = &vertices[(i + 1) % 4];
+      float cross;
+
+      cross = (b->x - a->x) * (point->y - a->y) -
+              (b->y - a->y) * (point->x - a->x);
+
+      if (cross > 0.f)
+        seen_positive = TRUE;
+      else if (cross < 0.f)
+        seen_negative = TRUE;
+
+      if (seen_positive && seen_negative)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+is_inside_input_region (const ClutterPoint *point,
+                        const ClutterPoint *vertices)
+{
+  if (is_quadrilateral_axis_aligned_rectangle (vertices))
+    return is_inside_axis_aligned_rectangle (point, vertices);
+  else
+    return is_inside_unaligned_rectangle (point, vertices);
+}
+
+static gboolean
+pick_record_contains_point (ClutterStage       *stage,
+                            const PickRecord   *rec,
+                            const ClutterPoint *point)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  int clip_index;
+
+  if (!is_inside_input_region (point, rec->vertex))
+    return FALSE;
+
+  clip_index = rec->clip_stack_top;
+  while (clip_index >= 0)
+    {
+      const PickClipRecord *clip = &g_array_index (priv->pick_clip_stack,
+                                                   PickClipRecord,
+                                                   clip_index);
+
+      if (!is_inside_input_region (point, clip->vertex))
+        return FALSE;
+
+      clip_index = clip->prev;
+    }
+
+  return TRUE;
+}
+
+static PointerPickCache *
+pointer_pick_cache_new (void)
+{
+  PointerPickCache *cache;
+
+  cache = g_new0 (PointerPickCache, 1);
+  cache->record = -1;
+  cache->occluders = g_array_new (FALSE, FALSE, sizeof (int));
+
+  return cache;
+}
+
+static void
+pointer_pick_cache_free (PointerPickCache *cache)
+{
+  g_array_free (cache->occluders, TRUE);
+  g_free (cache);
+}
+
+static void
+on_device_removed (ClutterDeviceManager *device_manager,
+                   ClutterInputDevice   *device,
+                   ClutterStage         *stage)
+{
+  g_hash_table_remove (stage->priv->pointer_pick_caches, device);
+}
+
+static ClutterActor *
+pointer_pick_cache_lookup (ClutterStage       *stage,
+                           PointerPickCache   *cache,
+                           ClutterStageView   *view,
+                           ClutterPickMode     mode,
+                           const ClutterPoint *point)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  const PickRecord *rec;
+  guint i;
+
+  if (cache->record < 0 ||
+      cache->generation != priv->pick_scene_generation ||
+      cache->mode != mode ||
+      cache->view != view)
+    return NULL;
+
+  rec = &g_array_index (priv->pick_stack, PickRecord, cache->record);
+  if (rec->actor == NULL || !pick_record_contains_point (stage, rec, point))
+    return NULL;
+
+  /* Records of destroyed actors are still checked here; hitting one just
+   * means falling back to a full search, which skips them.
+   */
+  for (i = 0; i < cache->occluders->len; i++)
+    {
+      int index = g_array_index (cache->occluders, int, i);
+      const PickRecord *occluder = &g_array_index (priv->pick_stack,
+                                                   PickRecord,
+                                                   index);
+
+      if (pick_record_contains_point (stage, occluder, point))
+        return NULL;
+    }
+
+  return rec->actor;
+}
+
+static void
+pointer_pick_cache_update (ClutterStage     *stage,
+                           PointerPickCache *cache,
+                           ClutterStageView *view,
+                           ClutterPickMode   mode,
+                           int               record)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  const PickRecord *rec;
+  float min_x, min_y, max_x, max_y;
+  int i;
+
+  cache->generation = priv->pick_scene_generation;
+  cache->mode = mode;
+  cache->view = view;
+  cache->record = record;
+  g_array_set_size (cache->occluders, 0);
+
+  if (record < 0)
+    return;
+
+  rec = &g_array_index (priv->pick_stack, PickRecord, record);
+  get_quadrilateral_bounds (rec->vertex, &min_x, &min_y, &max_x, &max_y);
+
+  for (i = record + 1; i < priv->pick_stack->len; i++)
+    {
+      const PickRecord *above = &g_array_index (priv->pick_stack,
+                                                PickRecord, i);
+      float above_min_x, above_min_y, above_max_x, above_max_y;
+
+      get_quadrilateral_bounds (above->vertex,
+                                &above_min_x, &above_min_y,
+                                &above_max_x, &above_max_y);
+
+      /* unaligned records include their edges, so touching counts */
+      if (above_min_x <= max_x && above_max_x >= min_x &&
+          above_min_y <= max_y && above_max_y >= min_y)
+        g_array_append_val (cache->occluders, i);
+    }
 }
 
 static ClutterActor *
@@ -1429,141 +2007,96 @@ _clutter_stage_do_pick_on_view (ClutterStage     *stage,
                                 gint              x,
                                 gint              y,
                                 ClutterPickMode   mode,
-                                ClutterStageView *view)
+                                ClutterStageView *view,
+                                PointerPickCache *cache)
 {
-  ClutterActor *actor = CLUTTER_ACTOR (stage);
   ClutterStagePrivate *priv = stage->priv;
-  CoglFramebuffer *fb = clutter_stage_view_get_framebuffer (view);
-  cairo_rectangle_int_t view_layout;
-  ClutterMainContext *context;
-  guchar pixel[4] = { 0xff, 0xff, 0xff, 0xff };
-  CoglColor stage_pick_id;
-  gboolean dither_enabled_save;
-  ClutterActor *retval;
-  gint dirty_x;
-  gint dirty_y;
-  gint read_x;
-  gint read_y;
-  float fb_width, fb_height;
-  float fb_scale;
-  float viewport_offset_x;
-  float viewport_offset_y;
+  ClutterActor *actor;
+  ClutterPoint point;
+  int i;
 
-  priv = stage->priv;
+  if (mode != priv->cached_pick_mode)
+    {
+      CoglFramebuffer *fb = clutter_stage_view_get_framebuffer (view);
+      ClutterMainContext *context = _clutter_context_get_default ();
+      gboolean rebuilding_stale;
 
-  context = _clutter_context_get_default ();
-  fb_scale = clutter_stage_view_get_scale (view);
-  clutter_stage_view_get_layout (view, &view_layout);
+      CLUTTER_NOTE (PICK, "Building the pick stack for mode %d", mode);
 
-  fb_width = view_layout.width * fb_scale;
-  fb_height = view_layout.height * fb_scale;
-  cogl_push_framebuffer (fb);
+      rebuilding_stale = (priv->cached_pick_mode == CLUTTER_PICK_NONE &&
+                          priv->stale_pick_mode == mode);
+      if (!rebuilding_stale)
+        clutter_stage_clear_pick_stack (stage);
 
-  /* needed for when a context switch happens */
-  _clutter_stage_maybe_setup_viewport (stage, view);
+      /* Walk the entire scene in pick mode; nothing is drawn, actors only
+       * log their transformed silhouettes on the pick stack. The framebuffer
+       * is only needed for its matrix stack.
+       */
+      cogl_push_framebuffer (fb);
+      _clutter_stage_maybe_setup_viewport (stage, view);
 
-  /* FIXME: For some reason leaving the cogl clip stack empty causes the
-   * picking to not work at all, so setting it the whole framebuffer content
-   * for now. */
-  cogl_framebuffer_push_scissor_clip (fb, 0, 0,
-                                      view_layout.width * fb_scale,
-                                      view_layout.height * fb_scale);
+      priv->pick_stack_building = TRUE;
+      priv->cached_pick_mode = mode;
 
-  _clutter_stage_window_get_dirty_pixel (priv->impl, view, &dirty_x, &dirty_y);
+      context->pick_mode = mode;
+      clutter_stage_do_paint_view (stage, view, NULL);
+      context->pick_mode = CLUTTER_PICK_NONE;
 
-  if (G_LIKELY (!(clutter_pick_debug_flags & CLUTTER_DEBUG_DUMP_PICK_BUFFERS)))
-    {
-      CLUTTER_NOTE (PICK, "Pushing pick scissor clip x: %d, y: %d, 1x1",
-                    (int) dirty_x * fb_scale,
-                    (int) dirty_y * fb_scale);
-      cogl_framebuffer_push_scissor_clip (fb, dirty_x * fb_scale, dirty_y * fb_scale, 1, 1);
-    }
+      priv->pick_stack_building = FALSE;
 
-  viewport_offset_x = x * fb_scale - dirty_x * fb_scale;
-  viewport_offset_y = y * fb_scale - dirty_y * fb_scale;
-  CLUTTER_NOTE (PICK, "Setting viewport to %f, %f, %f, %f",
-                priv->viewport[0] * fb_scale - viewport_offset_x,
-                priv->viewport[1] * fb_scale - viewport_offset_y,
-                priv->viewport[2] * fb_scale,
-                priv->viewport[3] * fb_scale);
-  cogl_framebuffer_set_viewport (fb,
-                                 priv->viewport[0] * fb_scale - viewport_offset_x,
-                                 priv->viewport[1] * fb_scale - viewport_offset_y,
-                                 priv->viewport[2] * fb_scale,
-                                 priv->viewport[3] * fb_scale);
-
-  read_x = dirty_x * fb_scale;
-  read_y = dirty_y * fb_scale;
-
-  CLUTTER_NOTE (PICK, "Performing pick at %i,%i on view %dx%d+%d+%d s: %d",
-                x, y,
-                view_layout.width, view_layout.height,
-                view_layout.x, view_layout.y, fb_scale);
-
-  cogl_color_init_from_4ub (&stage_pick_id, 255, 255, 255, 255);
-  cogl_clear (&stage_pick_id, COGL_BUFFER_BIT_COLOR | COGL_BUFFER_BIT_DEPTH);
-
-  /* Disable dithering (if any) when doing the painting in pick mode */
-  dither_enabled_save = cogl_framebuffer_get_dither_enabled (fb);
-  cogl_framebuffer_set_dither_enabled (fb, FALSE);
-
-  /* Render the entire scence in pick mode - just single colored silhouette's
-   * are drawn offscreen (as we never swap buffers)
-  */
-  context->pick_mode = mode;
-  _clutter_stage_paint_view (stage, view, NULL);
-  context->pick_mode = CLUTTER_PICK_NONE;
-
-  /* Read the color of the screen co-ords pixel. RGBA_8888_PRE is used
-     even though we don't care about the alpha component because under
-     GLES this is the only format that is guaranteed to work so Cogl
-     will end up having to do a conversion if any other format is
-     used. The format is requested as pre-multiplied because Cogl
-     assumes that all pixels in the framebuffer are premultiplied so
-     it avoids a conversion. */
-  cogl_framebuffer_read_pixels (fb,
-                                read_x, read_y, 1, 1,
-                                COGL_PIXEL_FORMAT_RGBA_8888_PRE,
-                                pixel);
-
-  if (G_UNLIKELY (clutter_pick_debug_flags & CLUTTER_DEBUG_DUMP_PICK_BUFFERS))
-    {
-      char *file_name =
-        g_strdup_printf ("pick-buffer-%s-view-x-%d",
-                         _clutter_actor_get_debug_name (actor),
-                         view_layout.x);
+      cogl_pop_framebuffer ();
+
+      add_pick_stack_weak_refs (stage);
 
-      read_pixels_to_file (file_name, 0, 0, fb_width, fb_height);
+      if (rebuilding_stale)
+        {
+          if (!pick_stack_equals_stale (stage))
+            priv->pick_scene_generation++;
 
-      g_free (file_name);
+          clear_stale_pick_stack (stage);
+        }
     }
 
-  /* Restore whether GL_DITHER was enabled */
-  cogl_framebuffer_set_dither_enabled (fb, dither_enabled_save);
+  clutter_point_init (&point, x, y);
 
-  if (G_LIKELY (!(clutter_pick_debug_flags & CLUTTER_DEBUG_DUMP_PICK_BUFFERS)))
-    cogl_framebuffer_pop_clip (fb);
+  if (cache != NULL)
+    {
+      actor = pointer_pick_cache_lookup (stage, cache, view, mode, &point);
+      if (actor != NULL)
+        {
+          CLUTTER_NOTE (PICK, "Picking cached actor %s at %d,%d on view %p",
+                        _clutter_actor_get_debug_name (actor),
+                        x, y, view);
+          return actor;
+        }
+    }
 
-  cogl_framebuffer_pop_clip (fb);
+  /* Search all "painted" pickable actors from front to back. A linear
+   * search is required, and also performs fine since there are typically
+   * only on the order of dozens of actors on screen at a time.
+   */
+  for (i = priv->pick_stack->len - 1; i >= 0; i--)
+    {
+      const PickRecord *rec = &g_array_index (priv->pick_stack, PickRecord, i);
 
-  _clutter_stage_dirty_viewport (stage);
+      if (rec->actor != NULL &&
+          pick_record_contains_point (stage, rec, &point))
+        {
+          CLUTTER_NOTE (PICK, "Picking actor %s at %d,%d on view %p",
+                        _clutter_actor_get_debug_name (rec->actor),
+                        x, y, view);
 
-  if (pixel[0] == 0xff && pixel[1] == 0xff && pixel[2] == 0xff)
-    retval = actor;
-  else
-    {
-      guint32 id_ = _clutter_pixel_to_id (pixel);
+          if (cache != NULL)
+            pointer_pick_cache_update (stage, cache, view, mode, i);
 
-      retval = _clutter_stage_get_actor_by_pick_id (stage, id_);
-      CLUTTER_NOTE (PICK, "Picking actor %s with id %u (pixel: 0x%x%x%x%x",
-                    G_OBJECT_TYPE_NAME (retval),
-                    id_,
-                    pixel[0], pixel[1], pixel[2], pixel[3]);
+          return rec->actor;
+        }
     }
 
-  cogl_pop_framebuffer ();
+  if (cache != NULL)
+    pointer_pick_cache_update (stage, cache, view, mode, -1);
 
-  return retval;
+  return CLUTTER_ACTOR (stage);
 }
 
 static ClutterStageView *
@@ -1590,18 +2123,18 @@ get_view_at (ClutterStage *stage,
   return NULL;
 }
 
-ClutterActor *
-_clutter_stage_do_pick (ClutterStage   *stage,
-                        gint            x,
-                        gint            y,
-                        ClutterPickMode mode)
+static ClutterActor *
+clutter_stage_pick_internal (ClutterStage       *stage,
+                             ClutterInputDevice *device,
+                             gint                x,
+                             gint                y,
+                             ClutterPickMode     mode)
 {
   ClutterActor *actor = CLUTTER_ACTOR (stage);
   ClutterStagePrivate *priv = stage->priv;
   float stage_width, stage_height;
   ClutterStageView *view = NULL;
-
-  priv = stage->priv;
+  PointerPickCache *cache = NULL;
 
   if (CLUTTER_ACTOR_IN_DESTRUCTION (stage))
     return actor;
@@ -1617,10 +2150,46 @@ _clutter_stage_do_pick (ClutterStage   *stage,
     return actor;
 
   view = get_view_at (stage, x, y);
-  if (view)
-    return _clutter_stage_do_pick_on_view (stage, x, y, mode, view);
+  if (view == NULL)
+    return actor;
+
+  if (device != NULL)
+    {
+      cache = g_hash_table_lookup (priv->pointer_pick_caches, device);
+      if (cache == NULL)
+        {
+          cache = pointer_pick_cache_new ();
+          g_hash_table_insert (priv->pointer_pick_caches, device, cache);
+        }
+    }
+
+  return _clutter_stage_do_pick_on_view (stage, x, y, mode, view, cache);
+}
+
+ClutterActor *
+_clutter_stage_do_pick (ClutterStage   *stage,
+                        gint            x,
+                        gint            y,
+                        ClutterPickMode mode)
+{
+  return clutter_stage_pick_internal (stage, NULL, x, y, mode);
+}
 
-  return actor;
+/*
+ * _clutter_stage_do_pick_for_device:
+ *
+ * Like _clutter_stage_do_pick(), but remembers what was picked for
+ * @device, so that consecutive picks of a pointer moving within the
+ * same actor don't need to search the whole pick stack.
+ */
+ClutterActor *
+_clutter_stage_do_pick_for_device (ClutterStage       *stage,
+                                   ClutterInputDevice *device,
+                                   gint                x,
+                                   gint                y,
+                                   ClutterPickMode     mode)
+{
+  return clutter_stage_pick_internal (stage, device, x, y, mode);
 }
 
 static gboolean
@@ -1856,6 +2425,8 @@ clutter_stage_dispose (GObject *object)
                     (GDestroyNotify) free_queue_redraw_entry);
   priv->pending_queue_redraws = NULL;
 
+  cancel_pending_captures (stage);
+
   /* this will release the reference on the stage */
   stage_manager = clutter_stage_manager_get_default ();
   _clutter_stage_manager_remove_stage (stage_manager, stage);
@@ -1869,14 +2440,20 @@ clutter_stage_finalize (GObject *object)
   ClutterStage *stage = CLUTTER_STAGE (object);
   ClutterStagePrivate *priv = stage->priv;
 
-  g_queue_foreach (priv->event_queue, (GFunc) clutter_event_free, NULL);
-  g_queue_free (priv->event_queue);
+  event_ring_free (priv->event_queue);
+  if (priv->spare_event_queue)
+    event_ring_free (priv->spare_event_queue);
 
   g_free (priv->title);
 
   g_array_free (priv->paint_volume_stack, TRUE);
 
-  _clutter_id_pool_free (priv->pick_id_pool);
+  clutter_stage_clear_pick_stack (stage);
+  g_array_free (priv->pick_clip_stack, TRUE);
+  g_array_free (priv->pick_stack, TRUE);
+  g_array_free (priv->stale_pick_clip_stack, TRUE);
+  g_array_free (priv->stale_pick_stack, TRUE);
+  g_hash_table_destroy (priv->pointer_pick_caches);
 
   if (priv->fps_timer != NULL)
     g_timer_destroy (priv->fps_timer);
@@ -2243,6 +2820,27 @@ clutter_stage_class_init (ClutterStageClass *klass)
                   NULL, NULL, NULL,
                   G_TYPE_NONE, 0);
 
+  /**
+   * ClutterStage::view-painted: (skip)
+   * @stage: the stage that received the event
+   * @view: the #ClutterStageView that was painted
+   * @redraw_clip: (nullable): the painted part of the stage, or %NULL if
+   *   all of @view was painted
+   *
+   * The ::view-painted signal is emitted after the stage is painted into
+   * @view, before ::after-paint. With views being painted at their own
+   * pace, this is the only point at which the contents of @view are known
+   * to be up to date.
+   */
+  stage_signals[VIEW_PAINTED] =
+    g_signal_new (I_("view-painted"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  _clutter_marshal_VOID__OBJECT_POINTER,
+                  G_TYPE_NONE, 2,
+                  CLUTTER_TYPE_STAGE_VIEW, G_TYPE_POINTER);
+
   /**
    * ClutterStage::presented: (skip)
    * @stage: the stage that received the event
@@ -2276,6 +2874,7 @@ clutter_stage_init (ClutterStage *self)
   cairo_rectangle_int_t geom = { 0, };
   ClutterStagePrivate *priv;
   ClutterStageWindow *impl;
+  ClutterDeviceManager *device_manager;
   ClutterBackend *backend;
   GError *error;
 
@@ -2307,7 +2906,8 @@ clutter_stage_init (ClutterStage *self)
         g_critical ("Unable to create a new stage implementation.");
     }
 
-  priv->event_queue = g_queue_new ();
+  priv->event_queue = event_ring_new ();
+  priv->spare_event_queue = event_ring_new ();
 
   priv->is_fullscreen = FALSE;
   priv->is_user_resizable = FALSE;
@@ -2374,7 +2974,24 @@ clutter_stage_init (ClutterStage *self)
   priv->paint_volume_stack =
     g_array_new (FALSE, FALSE, sizeof (ClutterPaintVolume));
 
-  priv->pick_id_pool = _clutter_id_pool_new (256);
+  priv->pick_stack = g_array_new (FALSE, FALSE, sizeof (PickRecord));
+  priv->pick_clip_stack = g_array_new (FALSE, FALSE, sizeof (PickClipRecord));
+  priv->pick_clip_stack_top = -1;
+  priv->cached_pick_mode = CLUTTER_PICK_NONE;
+  priv->stale_pick_stack = g_array_new (FALSE, FALSE, sizeof (PickRecord));
+  priv->stale_pick_clip_stack = g_array_new (FALSE, FALSE,
+                                             sizeof (PickClipRecord));
+  priv->stale_pick_mode = CLUTTER_PICK_NONE;
+  /* keyed by device, which is not referenced; entries are dropped when
+   * the device goes away */
+  priv->pointer_pick_caches =
+    g_hash_table_new_full (NULL, NULL,
+                           NULL, (GDestroyNotify) pointer_pick_cache_free);
+
+  device_manager = clutter_device_manager_get_default ();
+  if (device_manager != NULL)
+    g_signal_connect_object (device_manager, "device-removed",
+                             G_CALLBACK (on_device_removed), self, 0);
 }
 
 /**
@@ -4149,6 +4766,14 @@ _clutter_stage_queue_actor_redraw (ClutterStage *stage,
   CLUTTER_NOTE (CLIPPING, "stage_queue_actor_redraw (actor=%s, clip=%p): ",
                 _clutter_actor_get_debug_name (actor), clip);
 
+  /* A redraw without a clip may come from anything, e.g. a transform
+   * change, so what was logged by the last pick pass may not be what is on
+   * screen anymore. A clipped redraw only damages the contents of the
+   * actor, which doesn't affect picking.
+   */
+  if (clip == NULL)
+    invalidate_pick_stack (stage);
+
   if (!priv->redraw_pending)
     {
       ClutterMasterClock *master_clock;
@@ -4409,39 +5034,6 @@ _clutter_stage_get_active_framebuffer (ClutterStage *stage)
   return stage->priv->active_framebuffer;
 }
 
-gint32
-_clutter_stage_acquire_pick_id (ClutterStage *stage,
-                                ClutterActor *actor)
-{
-  ClutterStagePrivate *priv = stage->priv;
-
-  g_assert (priv->pick_id_pool != NULL);
-
-  return _clutter_id_pool_add (priv->pick_id_pool, actor);
-}
-
-void
-_clutter_stage_release_pick_id (ClutterStage *stage,
-                                gint32        pick_id)
-{
-  ClutterStagePrivate *priv = stage->priv;
-
-  g_assert (priv->pick_id_pool != NULL);
-
-  _clutter_id_pool_remove (priv->pick_id_pool, pick_id);
-}
-
-ClutterActor *
-_clutter_stage_get_actor_by_pick_id (ClutterStage *stage,
-                                     gint32        pick_id)
-{
-  ClutterStagePrivate *priv = stage->priv;
-
-  g_assert (priv->pick_id_pool != NULL);
-
-  return _clutter_id_pool_lookup (priv->pick_id_pool, pick_id);
-}
-
 void
 _clutter_stage_add_pointer_drag_actor (ClutterStage       *stage,
                                        ClutterInputDevice *device,
@@ -4903,3 +5495,400 @@ clutter_stage_capture_into (ClutterStage          *stage,
   view = get_view_at_rect (stage, rect);
   capture_view_into (stage, paint, view, rect, data, rect->width * bpp);
 }
+
+typedef struct _ClutterAsyncCapture ClutterAsyncCapture;
+
+typedef struct _ClutterViewReadback
+{
+  ClutterAsyncCapture *capture;
+  ClutterStageView *view;
+  cairo_rectangle_int_t rect;
+
+  CoglPixelBuffer *buffer;
+  CoglPixelFormat format;
+  gboolean flip;
+  CoglFenceClosure *fence;
+  CoglFramebuffer *framebuffer;
+  gboolean started;
+  gboolean done;
+} ClutterViewReadback;
+
+struct _ClutterAsyncCapture
+{
+  ClutterStage *stage;
+
+  ClutterViewReadback *readbacks;
+  ClutterCapture *captures;
+  int n_readbacks;
+
+  guint complete_idle_id;
+
+  ClutterCaptureCallback callback;
+  gpointer user_data;
+};
+
+static gboolean
+async_capture_is_done (ClutterAsyncCapture *capture)
+{
+  int i;
+
+  for (i = 0; i < capture->n_readbacks; i++)
+    {
+      if (!capture->readbacks[i].done)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+async_capture_free (ClutterAsyncCapture *capture)
+{
+  int i;
+
+  for (i = 0; i < capture->n_readbacks; i++)
+    {
+      ClutterViewReadback *readback = &capture->readbacks[i];
+
+      if (readback->fence)
+        cogl_framebuffer_cancel_fence_callback (readback->framebuffer,
+                                                readback->fence);
+      g_clear_pointer (&readback->buffer, cogl_object_unref);
+      g_clear_pointer (&readback->framebuffer, cogl_object_unref);
+      g_clear_object (&readback->view);
+
+      if (capture->captures && capture->captures[i].image)
+        cairo_surface_destroy (capture->captures[i].image);
+    }
+
+  if (capture->complete_idle_id)
+    g_source_remove (capture->complete_idle_id);
+
+  g_free (capture->readbacks);
+  g_free (capture->captures);
+  g_free (capture);
+}
+
+static void
+async_capture_complete (ClutterAsyncCapture *capture)
+{
+  ClutterStagePrivate *priv = capture->stage->priv;
+  ClutterCapture *captures;
+
+  priv->pending_captures = g_list_remove (priv->pending_captures, capture);
+
+  /* The images are handed over to the callback */
+  captures = g_steal_pointer (&capture->captures);
+  capture->callback (capture->stage, captures, capture->n_readbacks,
+                     capture->user_data);
+
+  async_capture_free (capture);
+}
+
+static gboolean
+async_capture_complete_idle (gpointer user_data)
+{
+  ClutterAsyncCapture *capture = user_data;
+
+  capture->complete_idle_id = 0;
+  async_capture_complete (capture);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+maybe_complete_async_capture (ClutterAsyncCapture *capture)
+{
+  /* Always call out from the main loop, never from within a paint */
+  if (async_capture_is_done (capture) && !capture->complete_idle_id)
+    capture->complete_idle_id = g_idle_add (async_capture_complete_idle,
+                                            capture);
+}
+
+static void
+convert_rgba_row_to_argb32 (const uint8_t *src,
+                            uint8_t       *dst,
+                            int            width)
+{
+  uint32_t *dst_pixels = (uint32_t *) dst;
+  int x;
+
+  for (x = 0; x < width; x++)
+    {
+      const uint8_t *pixel = src + x * 4;
+
+      dst_pixels[x] = (((uint32_t) pixel[3] << 24) |
+                       ((uint32_t) pixel[0] << 16) |
+                       ((uint32_t) pixel[1] << 8) |
+                       (uint32_t) pixel[2]);
+    }
+}
+
+static void
+on_readback_fence (CoglFence *fence,
+                   void      *user_data)
+{
+  ClutterViewReadback *readback = user_data;
+  ClutterAsyncCapture *capture = readback->capture;
+  ClutterCapture *view_capture;
+  uint8_t *src_data;
+  uint8_t *dst_data;
+  int stride;
+  int width;
+  int height;
+  int y;
+
+  readback->fence = NULL;
+  readback->done = TRUE;
+
+  view_capture = &capture->captures[readback - capture->readbacks];
+  stride = cairo_image_surface_get_stride (view_capture->image);
+  width = cairo_image_surface_get_width (view_capture->image);
+  height = cairo_image_surface_get_height (view_capture->image);
+
+  /* The fence has passed, so mapping the buffer won't stall */
+  src_data = cogl_buffer_map (COGL_BUFFER (readback->buffer),
+                              COGL_BUFFER_ACCESS_READ, 0);
+  if (src_data)
+    {
+      cairo_surface_flush (view_capture->image);
+      dst_data = cairo_image_surface_get_data (view_capture->image);
+
+      /* The rows and pixels were read the way the driver returns them, as
+       * fixing them up during the read would have mapped the buffer, and
+       * waited for the GPU, right away. */
+      for (y = 0; y < height; y++)
+        {
+          const uint8_t *src_row;
+          uint8_t *dst_row = dst_data + y * stride;
+
+          if (readback->flip)
+            src_row = src_data + (height - y - 1) * stride;
+          else
+            src_row = src_data + y * stride;
+
+          if (readback->format == CLUTTER_CAIRO_FORMAT_ARGB32)
+            memcpy (dst_row, src_row, stride);
+          else
+            convert_rgba_row_to_argb32 (src_row, dst_row, width);
+        }
+
+      cogl_buffer_unmap (COGL_BUFFER (readback->buffer));
+      cairo_surface_mark_dirty (view_capture->image);
+    }
+  else
+    {
+      g_warning ("Failed to map capture pixel buffer");
+    }
+
+  g_clear_pointer (&readback->buffer, cogl_object_unref);
+
+  maybe_complete_async_capture (capture);
+}
+
+/*
+ * Returns a format glReadPixels() can write into a pixel buffer as is; for
+ * anything else, cogl reads into client memory and converts from there,
+ * which waits for the GPU.
+ */
+static CoglPixelFormat
+get_readback_format (CoglContext *context)
+{
+  CoglRenderer *renderer = cogl_context_get_renderer (context);
+
+  if (cogl_renderer_get_driver (renderer) == COGL_DRIVER_GLES2)
+    return COGL_PIXEL_FORMAT_RGBA_8888_PRE;
+  else
+    return CLUTTER_CAIRO_FORMAT_ARGB32;
+}
+
+static void
+start_view_readback (ClutterStage        *stage,
+                     ClutterViewReadback *readback,
+                     ClutterCapture      *capture)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  CoglContext *context = clutter_backend_get_cogl_context (backend);
+  CoglFramebuffer *framebuffer;
+  cairo_rectangle_int_t view_layout;
+  float view_scale;
+  int width, height;
+  int stride;
+  CoglBitmap *bitmap;
+
+  readback->started = TRUE;
+
+  if (!cogl_has_feature (context, COGL_FEATURE_ID_FENCE) ||
+      !cogl_has_feature (context, COGL_FEATURE_ID_MAP_BUFFER_FOR_READ))
+    {
+      capture_view (stage, FALSE, readback->view, &readback->rect, capture);
+      readback->done = TRUE;
+      return;
+    }
+
+  framebuffer = clutter_stage_view_get_framebuffer (readback->view);
+  view_scale = clutter_stage_view_get_scale (readback->view);
+  clutter_stage_view_get_layout (readback->view, &view_layout);
+
+  width = readback->rect.width * view_scale;
+  height = readback->rect.height * view_scale;
+
+  capture->rect = readback->rect;
+  capture->image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                               width, height);
+  cairo_surface_set_device_scale (capture->image, view_scale, view_scale);
+  stride = cairo_image_surface_get_stride (capture->image);
+
+  /* Read into a pixel buffer, which lets the GPU finish the frame and the
+   * copy in its own time; the data is picked up once the fence passes. */
+  readback->buffer = cogl_pixel_buffer_new (context, stride * height, NULL);
+  cogl_buffer_set_update_hint (COGL_BUFFER (readback->buffer),
+                               COGL_BUFFER_UPDATE_HINT_STREAM);
+  readback->format = get_readback_format (context);
+  readback->flip = !cogl_is_offscreen (framebuffer);
+  bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (readback->buffer),
+                                        readback->format,
+                                        width, height,
+                                        stride,
+                                        0);
+  /* Flipping the rows and converting the pixels is left to
+   * on_readback_fence(); cogl would do it in place in the buffer. */
+  cogl_framebuffer_read_pixels_into_bitmap (framebuffer,
+                                            (readback->rect.x - view_layout.x) * view_scale,
+                                            (readback->rect.y - view_layout.y) * view_scale,
+                                            COGL_READ_PIXELS_COLOR_BUFFER |
+                                            COGL_READ_PIXELS_NO_FLIP,
+                                            bitmap);
+  cogl_object_unref (bitmap);
+
+  readback->framebuffer = cogl_object_ref (framebuffer);
+  readback->fence = cogl_framebuffer_add_fence_callback (framebuffer,
+                                                         on_readback_fence,
+                                                         readback);
+  if (!readback->fence)
+    {
+      /* The pixels are in the buffer already, mapping it just stalls */
+      on_readback_fence (NULL, readback);
+    }
+}
+
+/*
+ * Called by the stage window once @view has been completely painted,
+ * while its framebuffer still holds the new frame.
+ */
+void
+_clutter_stage_process_pending_captures (ClutterStage     *stage,
+                                         ClutterStageView *view)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  GList *l;
+
+  for (l = priv->pending_captures; l; l = l->next)
+    {
+      ClutterAsyncCapture *capture = l->data;
+      int i;
+
+      for (i = 0; i < capture->n_readbacks; i++)
+        {
+          ClutterViewReadback *readback = &capture->readbacks[i];
+
+          if (readback->view != view || readback->started)
+            continue;
+
+          start_view_readback (stage, readback, &capture->captures[i]);
+        }
+
+      maybe_complete_async_capture (capture);
+    }
+}
+
+/**
+ * clutter_stage_capture_async: (skip)
+ * @stage: a #ClutterStage
+ * @rect: the area of @stage to capture
+ * @callback: function to call with the captured images
+ * @user_data: data to pass to @callback
+ *
+ * Captures @rect the next time it is painted, without waiting for the GPU.
+ * The pixels are read back into pixel buffers right after each affected
+ * view is painted, and @callback is called from the main loop once the GPU
+ * has finished writing them, usually on a later frame.
+ *
+ * As with clutter_stage_capture(), there is one #ClutterCapture per view
+ * intersecting @rect. The array and the images are owned by @callback.
+ * If @stage is destroyed first, @callback is called without captures.
+ */
+void
+clutter_stage_capture_async (ClutterStage           *stage,
+                             cairo_rectangle_int_t  *rect,
+                             ClutterCaptureCallback  callback,
+                             gpointer                user_data)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  ClutterAsyncCapture *capture;
+  GList *views;
+  GList *l;
+  int n_readbacks;
+
+  g_return_if_fail (CLUTTER_IS_STAGE (stage));
+  g_return_if_fail (callback != NULL);
+
+  views = _clutter_stage_window_get_views (priv->impl);
+
+  capture = g_new0 (ClutterAsyncCapture, 1);
+  capture->stage = stage;
+  capture->callback = callback;
+  capture->user_data = user_data;
+  capture->readbacks = g_new0 (ClutterViewReadback, g_list_length (views));
+  capture->captures = g_new0 (ClutterCapture, g_list_length (views));
+
+  n_readbacks = 0;
+  for (l = views; l; l = l->next)
+    {
+      ClutterStageView *view = l->data;
+      ClutterViewReadback *readback = &capture->readbacks[n_readbacks];
+      cairo_rectangle_int_t view_layout;
+      cairo_region_t *region;
+
+      clutter_stage_view_get_layout (view, &view_layout);
+      region = cairo_region_create_rectangle (&view_layout);
+      cairo_region_intersect_rectangle (region, rect);
+      cairo_region_get_extents (region, &readback->rect);
+      cairo_region_destroy (region);
+
+      if (readback->rect.width == 0 || readback->rect.height == 0)
+        continue;
+
+      readback->capture = capture;
+      readback->view = g_object_ref (view);
+      n_readbacks++;
+    }
+  capture->n_readbacks = n_readbacks;
+
+  priv->pending_captures = g_list_append (priv->pending_captures, capture);
+
+  if (n_readbacks == 0)
+    {
+      maybe_complete_async_capture (capture);
+      return;
+    }
+
+  clutter_actor_queue_redraw_with_clip (CLUTTER_ACTOR (stage), rect);
+}
+
+static void
+cancel_pending_captures (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+
+  while (priv->pending_captures)
+    {
+      ClutterAsyncCapture *capture = priv->pending_captures->data;
+
+      priv->pending_captures = g_list_delete_link (priv->pending_captures,
+                                                   priv->pending_captures);
+
+      capture->callback (stage, NULL, 0, capture->user_data);
+      async_capture_free (capture);
+    }
+}
@@ -265,6 +265,27 @@ gboolean clutter_stage_capture (ClutterStage          *stage,
                                 ClutterCapture       **captures,
                                 int                   *n_captures);
 
+/**
+ * ClutterCaptureCallback:
+ * @stage: the #ClutterStage that was captured
+ * @captures: (array length=n_captures) (transfer full) (nullable): the
+ *   captured images
+ * @n_captures: the number of captures
+ * @user_data: data passed to clutter_stage_capture_async()
+ *
+ * The type of the callback passed to clutter_stage_capture_async().
+ */
+typedef void (* ClutterCaptureCallback) (ClutterStage   *stage,
+                                         ClutterCapture *captures,
+                                         int             n_captures,
+                                         gpointer        user_data);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+void clutter_stage_capture_async (ClutterStage           *stage,
+                                  cairo_rectangle_int_t  *rect,
+                                  ClutterCaptureCallback  callback,
+                                  gpointer                user_data);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_STAGE_H__ */
@@ -56,10 +56,50 @@ typedef struct _ClutterStageViewCoglPrivate
    */
 #define DAMAGE_HISTORY_MAX 16
 #define DAMAGE_HISTORY(x) ((x) & (DAMAGE_HISTORY_MAX - 1))
-  cairo_rectangle_int_t damage_history[DAMAGE_HISTORY_MAX];
+  cairo_region_t *damage_history[DAMAGE_HISTORY_MAX];
   unsigned int damage_index;
+
+  /*
+   * The query marking the end of the rendering of the last frame, and
+   * the render times of the previous frames, from the start of the stage
+   * update until the GPU finished drawing, in microseconds.
+   */
+#define RENDER_TIME_HISTORY_MAX 16
+  CoglTimestampQuery *render_end_query;
+  gint64 render_begin_time;
+  gint64 render_time_history[RENDER_TIME_HISTORY_MAX];
+  unsigned int render_time_index;
+
+  /*
+   * The frame clock of the view: the number of swaps that haven't
+   * completed yet, the time and refresh rate of the last presentation,
+   * and when the next update for the view should start, or -1 if none
+   * is scheduled.
+   */
+  int pending_swaps;
+  gint64 last_presentation_time;
+  float refresh_rate;
+  gint64 update_time;
+
+  /* Whether the display refreshes when a new frame is presented */
+  gboolean variable_refresh_rate;
+
+  /*
+   * The damage, in stage coordinates, waiting for the next frame of the
+   * view. If pending_full_redraw is set the whole view needs painting.
+   */
+  cairo_region_t *pending_damage;
+  gboolean pending_full_redraw;
 } ClutterStageViewCoglPrivate;
 
+/* Added to the longest recent render time to absorb jitter */
+#define RENDER_TIME_MARGIN_US 1000
+
+/* Views whose update is due this soon are painted along with the view
+ * that triggered the stage update, rather than in an update of their
+ * own right after it. */
+#define UPDATE_TIME_SLACK_US 1000
+
 G_DEFINE_TYPE_WITH_PRIVATE (ClutterStageViewCogl, clutter_stage_view_cogl,
                             CLUTTER_TYPE_STAGE_VIEW)
 
@@ -84,11 +124,76 @@ clutter_stage_cogl_unrealize (ClutterStageWindow *stage_window)
   CLUTTER_NOTE (BACKEND, "Unrealizing Cogl stage [%p]", stage_window);
 }
 
-void
-_clutter_stage_cogl_presented (ClutterStageCogl *stage_cogl,
-                               CoglFrameEvent    frame_event,
-                               ClutterFrameInfo *frame_info)
+static void
+queue_render_end_query (ClutterStageView *view)
+{
+  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+  CoglFramebuffer *onscreen = clutter_stage_view_get_onscreen (view);
+
+  g_clear_pointer (&view_priv->render_end_query, cogl_timestamp_query_free);
+
+  view_priv->render_end_query =
+    cogl_framebuffer_create_timestamp_query (onscreen);
+}
+
+static void
+collect_render_time (ClutterStageViewCogl *view_cogl)
+{
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+  gint64 render_time;
+  unsigned int index;
+
+  if (!view_priv->render_end_query ||
+      !cogl_timestamp_query_is_ready (view_priv->render_end_query))
+    return;
+
+  render_time =
+    cogl_timestamp_query_get_time (view_priv->render_end_query) -
+    view_priv->render_begin_time;
+  g_clear_pointer (&view_priv->render_end_query, cogl_timestamp_query_free);
+
+  /* Mapping GPU timestamps to the CPU clock is only approximate */
+  if (render_time <= 0)
+    return;
+
+  index = view_priv->render_time_index++ % RENDER_TIME_HISTORY_MAX;
+  view_priv->render_time_history[index] = render_time;
+}
+
+/*
+ * Returns how long before a presentation an update of the view needs to
+ * start for the frame to be ready in time, or -1 if the render times
+ * aren't known yet.
+ */
+static gint64
+get_max_render_time (ClutterStageViewCogl *view_cogl)
 {
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+  gint64 max_render_time = 0;
+  int i;
+
+  for (i = 0; i < RENDER_TIME_HISTORY_MAX; i++)
+    max_render_time = MAX (max_render_time,
+                           view_priv->render_time_history[i]);
+
+  if (max_render_time == 0)
+    return -1;
+
+  return max_render_time + RENDER_TIME_MARGIN_US;
+}
+
+static void
+view_presented (ClutterStageCogl     *stage_cogl,
+                ClutterStageViewCogl *view_cogl,
+                CoglFrameEvent        frame_event,
+                ClutterFrameInfo     *frame_info)
+{
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
 
   if (frame_event == COGL_FRAME_EVENT_SYNC)
     {
@@ -101,8 +206,8 @@ _clutter_stage_cogl_presented (ClutterStageCogl *stage_cogl,
        * FIXME: This issue can be hidden inside Cogl so we shouldn't
        * need to care about this bug here.
        */
-      if (stage_cogl->pending_swaps > 0)
-        stage_cogl->pending_swaps--;
+      if (view_priv->pending_swaps > 0)
+        view_priv->pending_swaps--;
     }
   else if (frame_event == COGL_FRAME_EVENT_COMPLETE)
     {
@@ -115,12 +220,67 @@ _clutter_stage_cogl_presented (ClutterStageCogl *stage_cogl,
           gint64 current_time_cogl = cogl_get_clock_time (context);
           gint64 now = g_get_monotonic_time ();
 
-          stage_cogl->last_presentation_time =
+          view_priv->last_presentation_time =
             now + (presentation_time_cogl - current_time_cogl) / 1000;
         }
 
-      stage_cogl->refresh_rate = frame_info->refresh_rate;
+      view_priv->refresh_rate = frame_info->refresh_rate;
+
+      collect_render_time (view_cogl);
     }
+}
+
+/*
+ * For backends that report frame events for the whole stage; every view
+ * is considered presented.
+ */
+void
+_clutter_stage_cogl_presented (ClutterStageCogl *stage_cogl,
+                               CoglFrameEvent    frame_event,
+                               ClutterFrameInfo *frame_info)
+{
+  ClutterStageWindow *stage_window = CLUTTER_STAGE_WINDOW (stage_cogl);
+  GList *l;
+
+  for (l = _clutter_stage_window_get_views (stage_window); l; l = l->next)
+    view_presented (stage_cogl, l->data, frame_event, frame_info);
+
+  _clutter_stage_presented (stage_cogl->wrapper, frame_event, frame_info);
+}
+
+/*
+ * For backends that report frame events for each view separately. The
+ * frame counter of @frame_info must be the stage frame counter, so that
+ * the stage is only notified once for the views painted in the same
+ * frame.
+ */
+void
+_clutter_stage_cogl_view_presented (ClutterStageCogl *stage_cogl,
+                                    ClutterStageView *view,
+                                    CoglFrameEvent    frame_event,
+                                    ClutterFrameInfo *frame_info)
+{
+  int64_t *presented_frame_counter;
+
+  view_presented (stage_cogl, CLUTTER_STAGE_VIEW_COGL (view),
+                  frame_event, frame_info);
+
+  switch (frame_event)
+    {
+    case COGL_FRAME_EVENT_SYNC:
+      presented_frame_counter = &stage_cogl->presented_frame_counter_sync;
+      break;
+    case COGL_FRAME_EVENT_COMPLETE:
+      presented_frame_counter = &stage_cogl->presented_frame_counter_complete;
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  if (frame_info->frame_counter <= *presented_frame_counter)
+    return;
+
+  *presented_frame_counter = frame_info->frame_counter;
 
   _clutter_stage_presented (stage_cogl->wrapper, frame_event, frame_info);
 }
@@ -146,22 +306,32 @@ clutter_stage_cogl_realize (ClutterStageWindow *stage_window)
 }
 
 static void
-clutter_stage_cogl_schedule_update (ClutterStageWindow *stage_window,
-                                    gint                sync_delay)
+schedule_view_update (ClutterStageViewCogl *view_cogl,
+                      int                   sync_delay,
+                      gint64                now)
 {
-  ClutterStageCogl *stage_cogl = CLUTTER_STAGE_COGL (stage_window);
-  gint64 now;
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
   float refresh_rate;
   gint64 refresh_interval;
+  gint64 max_render_time;
+  gint64 next_presentation_time;
 
-  if (stage_cogl->update_time != -1)
+  if (view_priv->update_time != -1)
     return;
 
-  now = g_get_monotonic_time ();
-
   if (sync_delay < 0)
     {
-      stage_cogl->update_time = now;
+      view_priv->update_time = now;
+      return;
+    }
+
+  /* With a variable refresh rate the display waits for the next frame, so
+   * there is no refresh cycle to line the update up with; the frame is
+   * presented as soon as it is ready. */
+  if (view_priv->variable_refresh_rate)
+    {
+      view_priv->update_time = now;
       return;
     }
 
@@ -170,14 +340,14 @@ clutter_stage_cogl_schedule_update (ClutterStageWindow *stage_window,
    * that the refresh interval might be wrong or the vertical refresh
    * might be downclocked if nothing is going on onscreen.
    */
-  if (stage_cogl->last_presentation_time == 0||
-      stage_cogl->last_presentation_time < now - 150000)
+  if (view_priv->last_presentation_time == 0||
+      view_priv->last_presentation_time < now - 150000)
     {
-      stage_cogl->update_time = now;
+      view_priv->update_time = now;
       return;
     }
 
-  refresh_rate = stage_cogl->refresh_rate;
+  refresh_rate = view_priv->refresh_rate;
   if (refresh_rate == 0.0)
     refresh_rate = 60.0;
 
@@ -185,29 +355,135 @@ clutter_stage_cogl_schedule_update (ClutterStageWindow *stage_window,
   if (refresh_interval == 0)
     refresh_interval = 16667; /* 1/60th second */
 
-  stage_cogl->update_time = stage_cogl->last_presentation_time + 1000 * sync_delay;
+  /* If we know how long frames take to render, start the update as late
+   * as possible while still making the next presentation, so that the
+   * content is as fresh as possible when it hits the screen. Otherwise
+   * fall back to the fixed delay after the last presentation. */
+  max_render_time = get_max_render_time (view_cogl);
+  if (max_render_time != -1)
+    {
+      if (max_render_time >= refresh_interval)
+        {
+          view_priv->update_time = now;
+          return;
+        }
+
+      next_presentation_time =
+        view_priv->last_presentation_time + refresh_interval;
+      while (next_presentation_time - max_render_time < now)
+        next_presentation_time += refresh_interval;
+
+      view_priv->update_time = next_presentation_time - max_render_time;
+
+      CLUTTER_NOTE (SCHEDULER,
+                    "Scheduling view update %" G_GINT64_FORMAT " us before "
+                    "presentation",
+                    max_render_time);
+      return;
+    }
+
+  view_priv->update_time = view_priv->last_presentation_time + 1000 * sync_delay;
+
+  while (view_priv->update_time < now)
+    view_priv->update_time += refresh_interval;
+}
+
+static void
+clutter_stage_cogl_schedule_update (ClutterStageWindow *stage_window,
+                                    gint                sync_delay)
+{
+  gint64 now = g_get_monotonic_time ();
+  GList *l;
 
-  while (stage_cogl->update_time < now)
-    stage_cogl->update_time += refresh_interval;
+  for (l = _clutter_stage_window_get_views (stage_window); l; l = l->next)
+    schedule_view_update (l->data, sync_delay, now);
+}
+
+static gboolean
+view_has_damage (ClutterStageCogl *stage_cogl,
+                 ClutterStageView *view)
+{
+  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+  cairo_rectangle_int_t view_rect;
+
+  if (view_priv->pending_full_redraw)
+    return TRUE;
+
+  if (view_priv->pending_damage &&
+      !cairo_region_is_empty (view_priv->pending_damage))
+    return TRUE;
+
+  if (!stage_cogl->initialized_redraw_clip)
+    return FALSE;
+
+  /* NB: a NULL redraw clip == full stage redraw */
+  if (!stage_cogl->redraw_clip)
+    return TRUE;
+
+  clutter_stage_view_get_layout (view, &view_rect);
+  return (cairo_region_contains_rectangle (stage_cogl->redraw_clip,
+                                           &view_rect) !=
+          CAIRO_REGION_OVERLAP_OUT);
 }
 
 static gint64
 clutter_stage_cogl_get_update_time (ClutterStageWindow *stage_window)
 {
   ClutterStageCogl *stage_cogl = CLUTTER_STAGE_COGL (stage_window);
+  GList *views = _clutter_stage_window_get_views (stage_window);
+  gboolean have_damaged_views = FALSE;
+  gint64 update_time = -1;
+  GList *l;
+
+  for (l = views; l; l = l->next)
+    {
+      if (view_has_damage (stage_cogl, l->data))
+        {
+          have_damaged_views = TRUE;
+          break;
+        }
+    }
+
+  /* The stage is due for an update as soon as one of the views that have
+   * something to paint is. If nothing has been damaged yet, e.g. because
+   * the update is for running timelines, any view will do. */
+  for (l = views; l; l = l->next)
+    {
+      ClutterStageViewCogl *view_cogl = l->data;
+      ClutterStageViewCoglPrivate *view_priv =
+        clutter_stage_view_cogl_get_instance_private (view_cogl);
 
-  if (stage_cogl->pending_swaps)
-    return -1; /* in the future, indefinite */
+      if (have_damaged_views && !view_has_damage (stage_cogl, l->data))
+        continue;
 
-  return stage_cogl->update_time;
+      if (view_priv->pending_swaps)
+        continue; /* in the future, indefinite */
+
+      if (view_priv->update_time == -1)
+        continue;
+
+      if (update_time == -1 || view_priv->update_time < update_time)
+        update_time = view_priv->update_time;
+    }
+
+  return update_time;
 }
 
 static void
 clutter_stage_cogl_clear_update_time (ClutterStageWindow *stage_window)
 {
-  ClutterStageCogl *stage_cogl = CLUTTER_STAGE_COGL (stage_window);
+  GList *l;
 
-  stage_cogl->update_time = -1;
+  for (l = _clutter_stage_window_get_views (stage_window); l; l = l->next)
+    {
+      ClutterStageViewCogl *view_cogl = l->data;
+      ClutterStageViewCoglPrivate *view_priv =
+        clutter_stage_view_cogl_get_instance_private (view_cogl);
+
+      view_priv->update_time = -1;
+    }
 }
 
 static ClutterActor *
@@ -249,12 +525,11 @@ clutter_stage_cogl_has_redraw_clips (ClutterStageWindow *stage_window)
    * clips everything (i.e. nothing would be drawn) so we need to make
    * sure we return True in the un-initialized case here.
    *
-   * NB: a clip width of 0 means a full stage redraw has been queued
+   * NB: a NULL redraw clip means a full stage redraw has been queued
    * so we effectively don't have any redraw clips in that case.
    */
   if (!stage_cogl->initialized_redraw_clip ||
-      (stage_cogl->initialized_redraw_clip &&
-       stage_cogl->bounding_redraw_clip.width != 0))
+      stage_cogl->redraw_clip != NULL)
     return TRUE;
   else
     return FALSE;
@@ -265,9 +540,9 @@ clutter_stage_cogl_ignoring_redraw_clips (ClutterStageWindow *stage_window)
 {
   ClutterStageCogl *stage_cogl = CLUTTER_STAGE_COGL (stage_window);
 
-  /* NB: a clip width of 0 means a full stage redraw is required */
+  /* NB: a NULL redraw clip means a full stage redraw is required */
   if (stage_cogl->initialized_redraw_clip &&
-      stage_cogl->bounding_redraw_clip.width == 0)
+      stage_cogl->redraw_clip == NULL)
     return TRUE;
   else
     return FALSE;
@@ -282,10 +557,11 @@ clutter_stage_cogl_ignoring_redraw_clips (ClutterStageWindow *stage_window)
  * A NULL stage_clip means the whole stage needs to be redrawn.
  *
  * What we do with this information:
- * - we keep track of the bounding box for all redraw clips
- * - when we come to redraw; we scissor the redraw to that box and use
- *   glBlitFramebuffer to present the redraw to the front
- *   buffer.
+ * - we keep track of the region covered by all redraw clips
+ * - when we come to redraw; we scissor the redraw to the rectangles
+ *   of that region (or to their bounding box when splitting the paint
+ *   wouldn't pay off) and hand the region to the winsys as damage, or
+ *   use glBlitFramebuffer to present it to the front buffer.
  */
 static void
 clutter_stage_cogl_add_redraw_clip (ClutterStageWindow    *stage_window,
@@ -298,11 +574,10 @@ clutter_stage_cogl_add_redraw_clip (ClutterStageWindow    *stage_window,
     return;
 
   /* A NULL stage clip means a full stage redraw has been queued and
-   * we keep track of this by setting a zero width
-   * stage_cogl->bounding_redraw_clip */
+   * we keep track of this by dropping stage_cogl->redraw_clip */
   if (stage_clip == NULL)
     {
-      stage_cogl->bounding_redraw_clip.width = 0;
+      g_clear_pointer (&stage_cogl->redraw_clip, cairo_region_destroy);
       stage_cogl->initialized_redraw_clip = TRUE;
       return;
     }
@@ -312,15 +587,9 @@ clutter_stage_cogl_add_redraw_clip (ClutterStageWindow    *stage_window,
     return;
 
   if (!stage_cogl->initialized_redraw_clip)
-    {
-      stage_cogl->bounding_redraw_clip = *stage_clip;
-    }
-  else if (stage_cogl->bounding_redraw_clip.width > 0)
-    {
-      _clutter_util_rectangle_union (&stage_cogl->bounding_redraw_clip,
-                                     stage_clip,
-                                     &stage_cogl->bounding_redraw_clip);
-    }
+    stage_cogl->redraw_clip = cairo_region_create_rectangle (stage_clip);
+  else
+    cairo_region_union_rectangle (stage_cogl->redraw_clip, stage_clip);
 
   stage_cogl->initialized_redraw_clip = TRUE;
 }
@@ -355,50 +624,40 @@ valid_buffer_age (ClutterStageViewCogl *view_cogl,
 }
 
 static gboolean
-swap_framebuffer (ClutterStageWindow    *stage_window,
-                  ClutterStageView      *view,
-                  cairo_rectangle_int_t *swap_region,
-                  gboolean               swap_with_damage)
+swap_framebuffer (ClutterStageWindow *stage_window,
+                  ClutterStageView   *view,
+                  const int          *damage,
+                  int                 n_rects,
+                  gboolean            swap_with_damage)
 {
   CoglFramebuffer *framebuffer = clutter_stage_view_get_onscreen (view);
-  int damage[4], ndamage;
-
-  damage[0] = swap_region->x;
-  damage[1] = swap_region->y;
-  damage[2] = swap_region->width;
-  damage[3] = swap_region->height;
-
-  if (swap_region->width != 0)
-    ndamage = 1;
-  else
-    ndamage = 0;
+  COGL_TRACE_BEGIN_SCOPED (ClutterStageCoglSwap, "Swap buffers");
 
   if (cogl_is_onscreen (framebuffer))
     {
       CoglOnscreen *onscreen = COGL_ONSCREEN (framebuffer);
 
       /* push on the screen */
-      if (ndamage == 1 && !swap_with_damage)
+      if (n_rects > 0 && !swap_with_damage)
         {
           CLUTTER_NOTE (BACKEND,
                         "cogl_onscreen_swap_region (onscreen: %p, "
-                        "x: %d, y: %d, "
-                        "width: %d, height: %d)",
-                        onscreen,
-                        damage[0], damage[1], damage[2], damage[3]);
+                        "n_rects: %d)",
+                        onscreen, n_rects);
 
           cogl_onscreen_swap_region (onscreen,
-                                     damage, ndamage);
+                                     damage, n_rects);
 
           return FALSE;
         }
       else
         {
-          CLUTTER_NOTE (BACKEND, "cogl_onscreen_swap_buffers (onscreen: %p)",
-                        onscreen);
+          CLUTTER_NOTE (BACKEND, "cogl_onscreen_swap_buffers (onscreen: %p, "
+                        "n_rects: %d)",
+                        onscreen, n_rects);
 
           cogl_onscreen_swap_buffers_with_damage (onscreen,
-                                                  damage, ndamage);
+                                                  damage, n_rects);
 
           return TRUE;
         }
@@ -419,6 +678,12 @@ paint_stage (ClutterStageCogl            *stage_cogl,
              const cairo_rectangle_int_t *clip)
 {
   ClutterStage *stage = stage_cogl->wrapper;
+  CoglTraceGpuSpan *gpu_span;
+  COGL_TRACE_BEGIN (ClutterStageCoglPaintView, "Paint view");
+
+  gpu_span =
+    cogl_trace_gpu_span_begin (clutter_stage_view_get_framebuffer (view),
+                               "Paint view (GPU)");
 
   _clutter_stage_maybe_setup_viewport (stage, view);
   _clutter_stage_paint_view (stage, view, clip);
@@ -428,29 +693,44 @@ paint_stage (ClutterStageCogl            *stage_cogl,
     {
       clutter_stage_view_blit_offscreen (view, clip);
     }
+
+  /* Flushing the onscreen journal also flushes the offscreen one the
+   * view may have been painted to */
+  cogl_trace_gpu_span_end (clutter_stage_view_get_onscreen (view), gpu_span);
+
+  COGL_TRACE_END (ClutterStageCoglPaintView);
 }
 
-static void
-fill_current_damage_history_and_step (ClutterStageView *view)
+static cairo_region_t *
+create_full_fb_damage (ClutterStageView *view)
 {
-  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
-  ClutterStageViewCoglPrivate *view_priv =
-    clutter_stage_view_cogl_get_instance_private (view_cogl);
   cairo_rectangle_int_t view_rect;
   float fb_scale;
-  cairo_rectangle_int_t *current_fb_damage;
 
-  current_fb_damage =
-    &view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index)];
   clutter_stage_view_get_layout (view, &view_rect);
   fb_scale = clutter_stage_view_get_scale (view);
 
-  *current_fb_damage = (cairo_rectangle_int_t) {
+  return cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
     .x = 0,
     .y = 0,
     .width = view_rect.width * fb_scale,
     .height = view_rect.height * fb_scale
-  };
+  });
+}
+
+static void
+fill_current_damage_history_and_step (ClutterStageView *view)
+{
+  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+  cairo_region_t **current_fb_damage;
+
+  current_fb_damage =
+    &view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index)];
+
+  g_clear_pointer (current_fb_damage, cairo_region_destroy);
+  *current_fb_damage = create_full_fb_damage (view);
   view_priv->damage_index++;
 }
 
@@ -491,11 +771,11 @@ transform_swap_region_to_onscreen (ClutterStageView      *view,
 }
 
 static void
-calculate_scissor_region (cairo_rectangle_int_t *fb_clip_region,
-                          int                    subpixel_compensation,
-                          int                    fb_width,
-                          int                    fb_height,
-                          cairo_rectangle_int_t *out_scissor_rect)
+calculate_scissor_region (const cairo_rectangle_int_t *fb_clip_region,
+                          int                          subpixel_compensation,
+                          int                          fb_width,
+                          int                          fb_height,
+                          cairo_rectangle_int_t       *out_scissor_rect)
 {
   int scissor_x;
   int scissor_y;
@@ -524,6 +804,146 @@ calculate_scissor_region (cairo_rectangle_int_t *fb_clip_region,
   };
 }
 
+static cairo_region_t *
+create_fb_clip_region (const cairo_region_t        *redraw_clip,
+                       const cairo_rectangle_int_t *view_rect,
+                       float                        fb_scale,
+                       int                          subpixel_compensation)
+{
+  cairo_region_t *fb_clip_region;
+  int n_rects, i;
+
+  fb_clip_region = cairo_region_create ();
+
+  n_rects = cairo_region_num_rectangles (redraw_clip);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (redraw_clip, i, &rect);
+      cairo_region_union_rectangle (fb_clip_region, &(cairo_rectangle_int_t) {
+        .x = (floorf ((rect.x - view_rect->x) * fb_scale) -
+              subpixel_compensation),
+        .y = (floorf ((rect.y - view_rect->y) * fb_scale) -
+              subpixel_compensation),
+        .width = (ceilf (rect.width * fb_scale) +
+                  (2 * subpixel_compensation)),
+        .height = (ceilf (rect.height * fb_scale) +
+                   (2 * subpixel_compensation))
+      });
+    }
+
+  return fb_clip_region;
+}
+
+/* Every separately painted rectangle costs a full traversal of the
+ * scene graph, so only split the paint for a few rectangles that cover
+ * clearly less than their bounding box, like a blinking cursor and a
+ * clock in opposite corners of a monitor.
+ */
+#define MAX_SEPARATELY_PAINTED_RECTS 4
+
+static gboolean
+should_paint_rects_separately (const cairo_region_t *fb_clip_region,
+                               int                   subpixel_compensation)
+{
+  cairo_rectangle_int_t extents;
+  gint64 area = 0;
+  int n_rects, i;
+
+  /* The scissor compensation for fractional scales shrinks every
+   * rectangle, which would leave seams between adjacent ones. */
+  if (subpixel_compensation != 0)
+    return FALSE;
+
+  n_rects = cairo_region_num_rectangles (fb_clip_region);
+  if (n_rects <= 1 || n_rects > MAX_SEPARATELY_PAINTED_RECTS)
+    return FALSE;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (fb_clip_region, i, &rect);
+      area += (gint64) rect.width * rect.height;
+    }
+
+  cairo_region_get_extents (fb_clip_region, &extents);
+
+  return area * 2 < (gint64) extents.width * extents.height;
+}
+
+static void
+paint_stage_rect (ClutterStageCogl            *stage_cogl,
+                  ClutterStageView            *view,
+                  const cairo_rectangle_int_t *fb_clip_rect,
+                  int                          subpixel_compensation)
+{
+  CoglFramebuffer *fb = clutter_stage_view_get_framebuffer (view);
+  cairo_rectangle_int_t view_rect;
+  cairo_rectangle_int_t scissor_rect;
+  cairo_rectangle_int_t stage_clip;
+  float fb_scale;
+
+  clutter_stage_view_get_layout (view, &view_rect);
+  fb_scale = clutter_stage_view_get_scale (view);
+
+  calculate_scissor_region (fb_clip_rect,
+                            subpixel_compensation,
+                            cogl_framebuffer_get_width (fb),
+                            cogl_framebuffer_get_height (fb),
+                            &scissor_rect);
+
+  CLUTTER_NOTE (CLIPPING,
+                "Stage clip pushed: x=%d, y=%d, width=%d, height=%d\n",
+                scissor_rect.x,
+                scissor_rect.y,
+                scissor_rect.width,
+                scissor_rect.height);
+
+  stage_clip = (cairo_rectangle_int_t) {
+    .x = view_rect.x + floorf (fb_clip_rect->x / fb_scale),
+    .y = view_rect.y + floorf (fb_clip_rect->y / fb_scale),
+    .width = ceilf (fb_clip_rect->width / fb_scale),
+    .height = ceilf (fb_clip_rect->height / fb_scale)
+  };
+  stage_cogl->bounding_redraw_clip = stage_clip;
+
+  cogl_framebuffer_push_scissor_clip (fb,
+                                      scissor_rect.x,
+                                      scissor_rect.y,
+                                      scissor_rect.width,
+                                      scissor_rect.height);
+  paint_stage (stage_cogl, view, &stage_clip);
+  cogl_framebuffer_pop_clip (fb);
+}
+
+static void
+paint_stage_region (ClutterStageCogl     *stage_cogl,
+                    ClutterStageView     *view,
+                    const cairo_region_t *fb_clip_region,
+                    int                   subpixel_compensation)
+{
+  cairo_rectangle_int_t rect;
+
+  if (should_paint_rects_separately (fb_clip_region, subpixel_compensation))
+    {
+      int n_rects, i;
+
+      n_rects = cairo_region_num_rectangles (fb_clip_region);
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_region_get_rectangle (fb_clip_region, i, &rect);
+          paint_stage_rect (stage_cogl, view, &rect, subpixel_compensation);
+        }
+    }
+  else
+    {
+      cairo_region_get_extents (fb_clip_region, &rect);
+      paint_stage_rect (stage_cogl, view, &rect, subpixel_compensation);
+    }
+}
+
 static gboolean
 clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
                                 ClutterStageView   *view)
@@ -541,21 +961,33 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
   gboolean has_buffer_age;
   gboolean do_swap_buffer;
   gboolean swap_with_damage;
+  gboolean swap_event = FALSE;
   ClutterActor *wrapper;
-  cairo_rectangle_int_t redraw_clip;
-  cairo_rectangle_int_t swap_region;
-  cairo_rectangle_int_t fb_clip_region;
+  cairo_region_t *redraw_clip = NULL;
+  cairo_region_t *fb_clip_region;
   gboolean clip_region_empty;
   float fb_scale;
   int subpixel_compensation = 0;
-  int fb_width, fb_height;
 
   wrapper = CLUTTER_ACTOR (stage_cogl->wrapper);
 
+  if (clutter_stage_view_take_next_scanout (view))
+    {
+      CLUTTER_NOTE (BACKEND, "Direct scanout, skipping stage paint");
+
+      /* Whatever the back buffers contain now is older than what is on
+       * screen, so the next painted frame needs to repair all of it. */
+      if (cogl_is_onscreen (fb) &&
+          cogl_clutter_winsys_has_feature (COGL_WINSYS_FEATURE_BUFFER_AGE))
+        fill_current_damage_history_and_step (view);
+
+      _clutter_stage_emit_after_paint (stage_cogl->wrapper);
+
+      return swap_framebuffer (stage_window, view, NULL, 0, FALSE);
+    }
+
   clutter_stage_view_get_layout (view, &view_rect);
   fb_scale = clutter_stage_view_get_scale (view);
-  fb_width = cogl_framebuffer_get_width (fb);
-  fb_height = cogl_framebuffer_get_height (fb);
 
   can_blit_sub_buffer =
     cogl_is_onscreen (fb) &&
@@ -565,20 +997,14 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
     cogl_is_onscreen (fb) &&
     cogl_clutter_winsys_has_feature (COGL_WINSYS_FEATURE_BUFFER_AGE);
 
-  /* NB: a zero width redraw clip == full stage redraw */
-  if (stage_cogl->bounding_redraw_clip.width == 0)
+  if (view_priv->pending_full_redraw)
     have_clip = FALSE;
   else
     {
-      redraw_clip = stage_cogl->bounding_redraw_clip;
-      _clutter_util_rectangle_intersection (&redraw_clip,
-                                            &view_rect,
-                                            &redraw_clip);
+      redraw_clip = cairo_region_copy (view_priv->pending_damage);
 
-      have_clip = !(redraw_clip.x == view_rect.x &&
-                    redraw_clip.y == view_rect.y &&
-                    redraw_clip.width == view_rect.width &&
-                    redraw_clip.height == view_rect.height);
+      have_clip = (cairo_region_contains_rectangle (redraw_clip, &view_rect) !=
+                   CAIRO_REGION_OVERLAP_IN);
     }
 
   may_use_clipped_redraw = FALSE;
@@ -594,20 +1020,14 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
       if (fb_scale != floorf (fb_scale))
         subpixel_compensation = ceilf (fb_scale);
 
-      fb_clip_region = (cairo_rectangle_int_t) {
-        .x = (floorf ((redraw_clip.x - view_rect.x) * fb_scale) -
-              subpixel_compensation),
-        .y = (floorf ((redraw_clip.y - view_rect.y) * fb_scale) -
-              subpixel_compensation),
-        .width = (ceilf (redraw_clip.width * fb_scale) +
-                  (2 * subpixel_compensation)),
-        .height = (ceilf (redraw_clip.height * fb_scale) +
-                   (2 * subpixel_compensation))
-      };
+      fb_clip_region = create_fb_clip_region (redraw_clip,
+                                              &view_rect,
+                                              fb_scale,
+                                              subpixel_compensation);
     }
   else
     {
-      fb_clip_region = (cairo_rectangle_int_t) { 0 };
+      fb_clip_region = cairo_region_create ();
     }
 
   if (may_use_clipped_redraw &&
@@ -616,7 +1036,8 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
   else
     use_clipped_redraw = FALSE;
 
-  clip_region_empty = may_use_clipped_redraw && fb_clip_region.width == 0;
+  clip_region_empty = may_use_clipped_redraw &&
+                      cairo_region_is_empty (fb_clip_region);
 
   swap_with_damage = FALSE;
   if (has_buffer_age)
@@ -624,44 +1045,28 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
       if (use_clipped_redraw && !clip_region_empty)
         {
           int age, i;
-          cairo_rectangle_int_t *current_fb_damage =
+          cairo_region_t **current_fb_damage =
             &view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index++)];
 
+          g_clear_pointer (current_fb_damage, cairo_region_destroy);
+
           age = cogl_onscreen_get_buffer_age (COGL_ONSCREEN (fb));
 
           if (valid_buffer_age (view_cogl, age))
             {
-              cairo_rectangle_int_t damage_region;
-
-              *current_fb_damage = fb_clip_region;
+              *current_fb_damage = cairo_region_copy (fb_clip_region);
 
               for (i = 1; i <= age; i++)
                 {
-                  cairo_rectangle_int_t *fb_damage =
-                    &view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index - i - 1)];
+                  cairo_region_t *fb_damage =
+                    view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index - i - 1)];
 
-                  _clutter_util_rectangle_union (&fb_clip_region,
-                                                 fb_damage,
-                                                 &fb_clip_region);
+                  cairo_region_union (fb_clip_region, fb_damage);
                 }
 
-              /* Update the bounding redraw clip state with the extra damage. */
-              damage_region = (cairo_rectangle_int_t) {
-                .x = view_rect.x + floorf (fb_clip_region.x / fb_scale),
-                .y = view_rect.y + floorf (fb_clip_region.y / fb_scale),
-                .width = ceilf (fb_clip_region.width / fb_scale),
-                .height = ceilf (fb_clip_region.height / fb_scale)
-              };
-              _clutter_util_rectangle_union (&stage_cogl->bounding_redraw_clip,
-                                             &damage_region,
-                                             &stage_cogl->bounding_redraw_clip);
-
-              CLUTTER_NOTE (CLIPPING, "Reusing back buffer(age=%d) - repairing region: x=%d, y=%d, width=%d, height=%d\n",
+              CLUTTER_NOTE (CLIPPING, "Reusing back buffer(age=%d) - repairing %d rectangle(s)\n",
                             age,
-                            fb_clip_region.x,
-                            fb_clip_region.y,
-                            fb_clip_region.width,
-                            fb_clip_region.height);
+                            cairo_region_num_rectangles (fb_clip_region));
 
               swap_with_damage = TRUE;
             }
@@ -669,12 +1074,7 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
             {
               CLUTTER_NOTE (CLIPPING, "Invalid back buffer(age=%d): forcing full redraw\n", age);
               use_clipped_redraw = FALSE;
-              *current_fb_damage = (cairo_rectangle_int_t) {
-                .x = 0,
-                .y = 0,
-                .width = view_rect.width * fb_scale,
-                .height = view_rect.height * fb_scale
-              };
+              *current_fb_damage = create_full_fb_damage (view);
             }
         }
       else if (!use_clipped_redraw)
@@ -690,71 +1090,42 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
     }
   else if (use_clipped_redraw)
     {
-      cairo_rectangle_int_t scissor_rect;
-
-      calculate_scissor_region (&fb_clip_region,
-                                subpixel_compensation,
-                                fb_width, fb_height,
-                                &scissor_rect);
-
-      CLUTTER_NOTE (CLIPPING,
-                    "Stage clip pushed: x=%d, y=%d, width=%d, height=%d\n",
-                    scissor_rect.x,
-                    scissor_rect.y,
-                    scissor_rect.width,
-                    scissor_rect.height);
-
       stage_cogl->using_clipped_redraw = TRUE;
 
-      cogl_framebuffer_push_scissor_clip (fb,
-                                          scissor_rect.x,
-                                          scissor_rect.y,
-                                          scissor_rect.width,
-                                          scissor_rect.height);
-      paint_stage (stage_cogl, view,
-                   &(cairo_rectangle_int_t) {
-                     .x = view_rect.x + floorf ((fb_clip_region.x - 0) / fb_scale),
-                     .y = view_rect.y + floorf ((fb_clip_region.y - 0) / fb_scale),
-                     .width = ceilf ((fb_clip_region.width + 0) / fb_scale),
-                     .height = ceilf ((fb_clip_region.height + 0) / fb_scale)
-                   });
-      cogl_framebuffer_pop_clip (fb);
+      paint_stage_region (stage_cogl, view,
+                          fb_clip_region,
+                          subpixel_compensation);
 
       stage_cogl->using_clipped_redraw = FALSE;
+
+      _clutter_stage_process_pending_captures (stage_cogl->wrapper, view);
+      _clutter_stage_emit_view_painted (stage_cogl->wrapper, view, redraw_clip);
+      _clutter_stage_emit_after_paint (stage_cogl->wrapper);
     }
   else
     {
       CLUTTER_NOTE (CLIPPING, "Unclipped stage paint\n");
 
       /* If we are trying to debug redraw issues then we want to pass
-       * the bounding_redraw_clip so it can be visualized */
+       * the redraw clip so it can be visualized */
       if (G_UNLIKELY (clutter_paint_debug_flags & CLUTTER_DEBUG_DISABLE_CLIPPED_REDRAWS) &&
           may_use_clipped_redraw &&
           !clip_region_empty)
         {
-          cairo_rectangle_int_t scissor_rect;
-
-          calculate_scissor_region (&fb_clip_region,
-                                    subpixel_compensation,
-                                    fb_width, fb_height,
-                                    &scissor_rect);
-
-          cogl_framebuffer_push_scissor_clip (fb,
-                                              scissor_rect.x,
-                                              scissor_rect.y,
-                                              scissor_rect.width,
-                                              scissor_rect.height);
-          paint_stage (stage_cogl, view,
-                       &(cairo_rectangle_int_t) {
-                         .x = view_rect.x + floorf (fb_clip_region.x / fb_scale),
-                         .y = view_rect.y + floorf (fb_clip_region.y / fb_scale),
-                         .width = ceilf (fb_clip_region.width / fb_scale),
-                         .height = ceilf (fb_clip_region.height / fb_scale)
-                       });
-          cogl_framebuffer_pop_clip (fb);
+          paint_stage_region (stage_cogl, view,
+                              fb_clip_region,
+                              subpixel_compensation);
+          _clutter_stage_emit_view_painted (stage_cogl->wrapper, view,
+                                            redraw_clip);
         }
       else
-        paint_stage (stage_cogl, view, &view_rect);
+        {
+          paint_stage (stage_cogl, view, &view_rect);
+          _clutter_stage_emit_view_painted (stage_cogl->wrapper, view, NULL);
+        }
+
+      _clutter_stage_process_pending_captures (stage_cogl->wrapper, view);
+      _clutter_stage_emit_after_paint (stage_cogl->wrapper);
     }
   cogl_pop_framebuffer ();
 
@@ -764,18 +1135,8 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
       CoglContext *ctx = cogl_framebuffer_get_context (fb);
       static CoglPipeline *outline = NULL;
       ClutterActor *actor = CLUTTER_ACTOR (wrapper);
-      float x_1 = redraw_clip.x;
-      float x_2 = redraw_clip.x + redraw_clip.width;
-      float y_1 = redraw_clip.y;
-      float y_2 = redraw_clip.y + redraw_clip.height;
-      CoglVertexP2 quad[4] = {
-        { x_1, y_1 },
-        { x_2, y_1 },
-        { x_2, y_2 },
-        { x_1, y_2 }
-      };
-      CoglPrimitive *prim;
       CoglMatrix modelview;
+      int n_rects, i;
 
       if (outline == NULL)
         {
@@ -783,18 +1144,34 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
           cogl_pipeline_set_color4ub (outline, 0xff, 0x00, 0x00, 0xff);
         }
 
-      prim = cogl_primitive_new_p2 (ctx,
-                                    COGL_VERTICES_MODE_LINE_LOOP,
-                                    4, /* n_vertices */
-                                    quad);
-
       cogl_framebuffer_push_matrix (fb);
       cogl_matrix_init_identity (&modelview);
       _clutter_actor_apply_modelview_transform (actor, &modelview);
       cogl_framebuffer_set_modelview_matrix (fb, &modelview);
-      cogl_framebuffer_draw_primitive (fb, outline, prim);
+
+      n_rects = cairo_region_num_rectangles (redraw_clip);
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+          CoglVertexP2 quad[4];
+          CoglPrimitive *prim;
+
+          cairo_region_get_rectangle (redraw_clip, i, &rect);
+
+          quad[0] = (CoglVertexP2) { rect.x, rect.y };
+          quad[1] = (CoglVertexP2) { rect.x + rect.width, rect.y };
+          quad[2] = (CoglVertexP2) { rect.x + rect.width, rect.y + rect.height };
+          quad[3] = (CoglVertexP2) { rect.x, rect.y + rect.height };
+
+          prim = cogl_primitive_new_p2 (ctx,
+                                        COGL_VERTICES_MODE_LINE_LOOP,
+                                        4, /* n_vertices */
+                                        quad);
+          cogl_framebuffer_draw_primitive (fb, outline, prim);
+          cogl_object_unref (prim);
+        }
+
       cogl_framebuffer_pop_matrix (fb);
-      cogl_object_unref (prim);
     }
 
   /* XXX: It seems there will be a race here in that the stage
@@ -805,133 +1182,183 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
    * the resize anyway so it should only exhibit temporary
    * artefacts.
    */
-  if (use_clipped_redraw)
-    {
-      if (use_clipped_redraw && clip_region_empty)
-        {
-          do_swap_buffer = FALSE;
-        }
-      else if (use_clipped_redraw)
-        {
-          swap_region = fb_clip_region;
-          g_assert (swap_region.width > 0);
-          do_swap_buffer = TRUE;
-        }
-      else
-        {
-          swap_region = (cairo_rectangle_int_t) {
-            .x = 0,
-            .y = 0,
-            .width = view_rect.width * fb_scale,
-            .height = view_rect.height * fb_scale,
-          };
-          do_swap_buffer = TRUE;
-        }
-    }
+  if (use_clipped_redraw && clip_region_empty)
+    do_swap_buffer = FALSE;
   else
-    {
-      swap_region = (cairo_rectangle_int_t) { 0 };
-      do_swap_buffer = TRUE;
-    }
+    do_swap_buffer = TRUE;
 
   if (do_swap_buffer)
     {
-      if (clutter_stage_view_get_onscreen (view) !=
-          clutter_stage_view_get_framebuffer (view))
+      int *damage;
+      int n_rects, i;
+
+      /* NB: no damage rectangles means the whole framebuffer */
+      if (use_clipped_redraw)
+        n_rects = cairo_region_num_rectangles (fb_clip_region);
+      else
+        n_rects = 0;
+
+      damage = g_newa (int, n_rects * 4);
+      for (i = 0; i < n_rects; i++)
         {
-          transform_swap_region_to_onscreen (view, &swap_region);
+          cairo_rectangle_int_t rect;
+
+          cairo_region_get_rectangle (fb_clip_region, i, &rect);
+
+          if (clutter_stage_view_get_onscreen (view) !=
+              clutter_stage_view_get_framebuffer (view))
+            {
+              transform_swap_region_to_onscreen (view, &rect);
+            }
+
+          damage[i * 4] = rect.x;
+          damage[i * 4 + 1] = rect.y;
+          damage[i * 4 + 2] = rect.width;
+          damage[i * 4 + 3] = rect.height;
         }
 
-      return swap_framebuffer (stage_window,
-                               view,
-                               &swap_region,
-                               swap_with_damage);
+      if (cogl_is_onscreen (clutter_stage_view_get_onscreen (view)))
+        queue_render_end_query (view);
+
+      swap_event = swap_framebuffer (stage_window,
+                                     view,
+                                     damage,
+                                     n_rects,
+                                     swap_with_damage);
     }
-  else
+
+  g_clear_pointer (&redraw_clip, cairo_region_destroy);
+  cairo_region_destroy (fb_clip_region);
+
+  return swap_event;
+}
+
+/* Moves the damage queued on the stage into the view's pending damage */
+static void
+accumulate_view_damage (ClutterStageCogl *stage_cogl,
+                        ClutterStageView *view)
+{
+  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+  cairo_rectangle_int_t view_rect;
+
+  if (view_priv->pending_full_redraw)
+    return;
+
+  /* NB: a NULL redraw clip == full stage redraw */
+  if (!stage_cogl->initialized_redraw_clip || !stage_cogl->redraw_clip)
     {
-      return FALSE;
+      g_clear_pointer (&view_priv->pending_damage, cairo_region_destroy);
+      view_priv->pending_full_redraw = TRUE;
+      return;
     }
+
+  clutter_stage_view_get_layout (view, &view_rect);
+
+  if (!view_priv->pending_damage)
+    view_priv->pending_damage = cairo_region_create ();
+
+  cairo_region_union (view_priv->pending_damage, stage_cogl->redraw_clip);
+  cairo_region_intersect_rectangle (view_priv->pending_damage, &view_rect);
 }
 
 static void
 clutter_stage_cogl_redraw (ClutterStageWindow *stage_window)
 {
   ClutterStageCogl *stage_cogl = CLUTTER_STAGE_COGL (stage_window);
-  gboolean swap_event = FALSE;
+  GList *views = _clutter_stage_window_get_views (stage_window);
+  gboolean have_deferred_views = FALSE;
+  gint64 now;
   GList *l;
 
-  for (l = _clutter_stage_window_get_views (stage_window); l; l = l->next)
+  now = g_get_monotonic_time ();
+
+  for (l = views; l; l = l->next)
+    accumulate_view_damage (stage_cogl, l->data);
+
+  /* Each view is painted at the cadence of its own frame clock; views
+   * that aren't due yet keep their damage until they are. */
+  for (l = views; l; l = l->next)
     {
       ClutterStageView *view = l->data;
+      ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
+      ClutterStageViewCoglPrivate *view_priv =
+        clutter_stage_view_cogl_get_instance_private (view_cogl);
 
-      swap_event =
-        clutter_stage_cogl_redraw_view (stage_window, view) || swap_event;
-    }
+      if (!view_priv->pending_full_redraw &&
+          (!view_priv->pending_damage ||
+           cairo_region_is_empty (view_priv->pending_damage)))
+        continue;
 
-  _clutter_stage_window_finish_frame (stage_window);
+      if (view_priv->pending_swaps > 0 ||
+          (view_priv->update_time != -1 &&
+           view_priv->update_time > now + UPDATE_TIME_SLACK_US))
+        {
+          CLUTTER_NOTE (SCHEDULER, "Deferring paint of view %p", view);
+          have_deferred_views = TRUE;
+          continue;
+        }
 
-  if (swap_event)
-    {
-      /* If we have swap buffer events then cogl_onscreen_swap_buffers
-       * will return immediately and we need to track that there is a
-       * swap in progress... */
-      if (clutter_feature_available (CLUTTER_FEATURE_SWAP_EVENTS))
-        stage_cogl->pending_swaps++;
+      /* The frame is considered to begin when the update was scheduled,
+       * so that the render times include the latency of getting
+       * dispatched, but not any time spent waiting for the previous
+       * frame to be presented. */
+      if (view_priv->update_time == -1 || view_priv->update_time > now)
+        view_priv->render_begin_time = now;
+      else
+        view_priv->render_begin_time =
+          MAX (view_priv->update_time,
+               MIN (view_priv->last_presentation_time, now));
+
+      if (clutter_stage_cogl_redraw_view (stage_window, view))
+        {
+          /* If we have swap buffer events then cogl_onscreen_swap_buffers
+           * will return immediately and we need to track that there is a
+           * swap in progress... */
+          if (clutter_feature_available (CLUTTER_FEATURE_SWAP_EVENTS))
+            view_priv->pending_swaps++;
+        }
+
+      g_clear_pointer (&view_priv->pending_damage, cairo_region_destroy);
+      view_priv->pending_full_redraw = FALSE;
     }
 
+  _clutter_stage_window_finish_frame (stage_window);
+
   /* reset the redraw clipping for the next paint... */
+  g_clear_pointer (&stage_cogl->redraw_clip, cairo_region_destroy);
   stage_cogl->initialized_redraw_clip = FALSE;
 
+  /* ...but if some views still have damage to paint, the next paint must
+   * not be mistaken for a full stage redraw. */
+  if (have_deferred_views)
+    {
+      stage_cogl->redraw_clip = cairo_region_create ();
+      stage_cogl->initialized_redraw_clip = TRUE;
+    }
+
   stage_cogl->frame_count++;
 }
 
-static void
-clutter_stage_cogl_get_dirty_pixel (ClutterStageWindow *stage_window,
-                                    ClutterStageView   *view,
-                                    int                *x,
-                                    int                *y)
-{
-  CoglFramebuffer *framebuffer = clutter_stage_view_get_framebuffer (view);
-  gboolean has_buffer_age =
-    cogl_is_onscreen (framebuffer) &&
-    cogl_clutter_winsys_has_feature (COGL_WINSYS_FEATURE_BUFFER_AGE);
-  float fb_scale;
-  gboolean scale_is_fractional;
-
-  fb_scale = clutter_stage_view_get_scale (view);
-  if (fb_scale != floorf (fb_scale))
-    scale_is_fractional = TRUE;
-  else
-    scale_is_fractional = FALSE;
+static gboolean
+clutter_stage_cogl_has_deferred_redraws (ClutterStageWindow *stage_window)
+{
+  GList *l;
 
-  /*
-   * Buffer damage is tracked in the framebuffer coordinate space
-   * using the damage history. When fractional scaling is used, a
-   * coordinate on the stage might not correspond to the exact position of any
-   * physical pixel, which causes issues when painting using the pick mode.
-   *
-   * For now, always use the (0, 0) pixel for picking when using fractional
-   * framebuffer scaling.
-   */
-  if (!has_buffer_age || scale_is_fractional)
-    {
-      *x = 0;
-      *y = 0;
-    }
-  else
+  for (l = _clutter_stage_window_get_views (stage_window); l; l = l->next)
     {
-      ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
+      ClutterStageViewCogl *view_cogl = l->data;
       ClutterStageViewCoglPrivate *view_priv =
         clutter_stage_view_cogl_get_instance_private (view_cogl);
-      cairo_rectangle_int_t view_layout;
-      cairo_rectangle_int_t *fb_damage;
-
-      clutter_stage_view_get_layout (view, &view_layout);
 
-      fb_damage = &view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index - 1)];
-      *x = fb_damage->x / fb_scale;
-      *y = fb_damage->y / fb_scale;
+      if (view_priv->pending_full_redraw ||
+          (view_priv->pending_damage &&
+           !cairo_region_is_empty (view_priv->pending_damage)))
+        return TRUE;
     }
+
+  return FALSE;
 }
 
 static void
@@ -951,7 +1378,7 @@ clutter_stage_window_iface_init (ClutterStageWindowIface *iface)
   iface->ignoring_redraw_clips = clutter_stage_cogl_ignoring_redraw_clips;
   iface->get_redraw_clip_bounds = clutter_stage_cogl_get_redraw_clip_bounds;
   iface->redraw = clutter_stage_cogl_redraw;
-  iface->get_dirty_pixel = clutter_stage_cogl_get_dirty_pixel;
+  iface->has_deferred_redraws = clutter_stage_cogl_has_deferred_redraws;
 }
 
 static void
@@ -978,12 +1405,23 @@ clutter_stage_cogl_set_property (GObject      *gobject,
     }
 }
 
+static void
+clutter_stage_cogl_finalize (GObject *gobject)
+{
+  ClutterStageCogl *stage_cogl = CLUTTER_STAGE_COGL (gobject);
+
+  g_clear_pointer (&stage_cogl->redraw_clip, cairo_region_destroy);
+
+  G_OBJECT_CLASS (_clutter_stage_cogl_parent_class)->finalize (gobject);
+}
+
 static void
 _clutter_stage_cogl_class_init (ClutterStageCoglClass *klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
   gobject_class->set_property = clutter_stage_cogl_set_property;
+  gobject_class->finalize = clutter_stage_cogl_finalize;
 
   g_object_class_override_property (gobject_class, PROP_WRAPPER, "wrapper");
   g_object_class_override_property (gobject_class, PROP_BACKEND, "backend");
@@ -992,18 +1430,60 @@ _clutter_stage_cogl_class_init (ClutterStageCoglClass *klass)
 static void
 _clutter_stage_cogl_init (ClutterStageCogl *stage)
 {
-  stage->last_presentation_time = 0;
-  stage->refresh_rate = 0.0;
+  stage->presented_frame_counter_sync = -1;
+  stage->presented_frame_counter_complete = -1;
+}
+
+/**
+ * clutter_stage_view_cogl_set_variable_refresh_rate: (skip)
+ * @view_cogl: a #ClutterStageViewCogl
+ * @enabled: whether the display of the view has a variable refresh rate
+ *
+ * Sets whether the display of the view refreshes whenever a new frame is
+ * presented, in which case updates of the view are started right away
+ * rather than timed to a fixed refresh cycle.
+ */
+void
+clutter_stage_view_cogl_set_variable_refresh_rate (ClutterStageViewCogl *view_cogl,
+                                                   gboolean              enabled)
+{
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
 
-  stage->update_time = -1;
+  view_priv->variable_refresh_rate = enabled;
 }
 
 static void
 clutter_stage_view_cogl_init (ClutterStageViewCogl *view_cogl)
 {
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+
+  view_priv->update_time = -1;
+  view_priv->pending_full_redraw = TRUE;
+}
+
+static void
+clutter_stage_view_cogl_finalize (GObject *object)
+{
+  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (object);
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+  int i;
+
+  for (i = 0; i < DAMAGE_HISTORY_MAX; i++)
+    g_clear_pointer (&view_priv->damage_history[i], cairo_region_destroy);
+
+  g_clear_pointer (&view_priv->render_end_query, cogl_timestamp_query_free);
+  g_clear_pointer (&view_priv->pending_damage, cairo_region_destroy);
+
+  G_OBJECT_CLASS (clutter_stage_view_cogl_parent_class)->finalize (object);
 }
 
 static void
 clutter_stage_view_cogl_class_init (ClutterStageViewCoglClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = clutter_stage_view_cogl_finalize;
 }
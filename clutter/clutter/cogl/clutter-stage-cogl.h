@@ -48,17 +48,21 @@ struct _ClutterStageCogl
   /* back pointer to the backend */
   ClutterBackend *backend;
 
-  float refresh_rate;
-  int pending_swaps;
-
-  gint64 last_presentation_time;
-  gint64 update_time;
+  /* The last frames the stage was notified about having been presented,
+   * for backends reporting frame events for each view */
+  int64_t presented_frame_counter_sync;
+  int64_t presented_frame_counter_complete;
 
   /* We only enable clipped redraws after 2 frames, since we've seen
    * a lot of drivers can struggle to get going and may output some
    * junk frames to start with. */
   unsigned int frame_count;
 
+  /* The damage queued for the next frame, in stage coordinates. NULL
+   * once initialized_redraw_clip is set means a full redraw. */
+  cairo_region_t *redraw_clip;
+
+  /* The rectangle currently being painted during a clipped redraw */
   cairo_rectangle_int_t bounding_redraw_clip;
 
   guint initialized_redraw_clip : 1;
@@ -81,6 +85,16 @@ void _clutter_stage_cogl_presented (ClutterStageCogl *stage_cogl,
                                     CoglFrameEvent    frame_event,
                                     ClutterFrameInfo *frame_info);
 
+CLUTTER_AVAILABLE_IN_MUTTER
+void clutter_stage_view_cogl_set_variable_refresh_rate (ClutterStageViewCogl *view_cogl,
+                                                        gboolean              enabled);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+void _clutter_stage_cogl_view_presented (ClutterStageCogl *stage_cogl,
+                                         ClutterStageView *view,
+                                         CoglFrameEvent    frame_event,
+                                         ClutterFrameInfo *frame_info);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_STAGE_COGL_H__ */
@@ -82,8 +82,6 @@ struct _ClutterTexturePrivate
   ClutterActor *fbo_source;
   CoglHandle fbo_handle;
 
-  CoglPipeline *pick_pipeline;
-
   gchar *filename;
 
   ClutterTextureAsyncData *async_data;
@@ -97,8 +95,6 @@ struct _ClutterTexturePrivate
   guint load_data_async : 1;
   guint load_async_set : 1;  /* used to make load_async possible */
   guint pick_with_alpha : 1;
-  guint pick_with_alpha_supported : 1;
-  guint seen_create_pick_pipeline_warning : 1;
 };
 
 #define ASYNC_STATE_LOCKED      1
@@ -588,83 +584,6 @@ gen_texcoords_and_draw_cogl_rectangle (ClutterActor *self)
 			              0, 0, t_w, t_h);
 }
 
-static CoglPipeline *
-create_pick_pipeline (ClutterActor *self)
-{
-  ClutterTexture *texture = CLUTTER_TEXTURE (self);
-  ClutterTexturePrivate *priv = texture->priv;
-  CoglPipeline *pick_pipeline = cogl_pipeline_copy (texture_template_pipeline);
-  GError *error = NULL;
-
-  if (!cogl_pipeline_set_layer_combine (pick_pipeline, 0,
-                                        "RGBA = "
-                                        "  MODULATE (CONSTANT, TEXTURE[A])",
-                                        &error))
-    {
-      if (!priv->seen_create_pick_pipeline_warning)
-        g_warning ("Error setting up texture combine for shaped "
-                   "texture picking: %s", error->message);
-      priv->seen_create_pick_pipeline_warning = TRUE;
-      g_error_free (error);
-      cogl_object_unref (pick_pipeline);
-      return NULL;
-    }
-
-  cogl_pipeline_set_blend (pick_pipeline,
-                           "RGBA = ADD (SRC_COLOR[RGBA], 0)",
-                           NULL);
-
-  cogl_pipeline_set_alpha_test_function (pick_pipeline,
-                                         COGL_PIPELINE_ALPHA_FUNC_EQUAL,
-                                         1.0);
-
-  return pick_pipeline;
-}
-
-static void
-clutter_texture_pick (ClutterActor       *self,
-                      const ClutterColor *color)
-{
-  ClutterTexture *texture = CLUTTER_TEXTURE (self);
-  ClutterTexturePrivate *priv = texture->priv;
-
-  if (!clutter_actor_should_pick_paint (self))
-    return;
-
-  if (G_LIKELY (priv->pick_with_alpha_supported) && priv->pick_with_alpha)
-    {
-      CoglColor pick_color;
-
-      if (priv->pick_pipeline == NULL)
-        priv->pick_pipeline = create_pick_pipeline (self);
-
-      if (priv->pick_pipeline == NULL)
-        {
-          priv->pick_with_alpha_supported = FALSE;
-          CLUTTER_ACTOR_CLASS (clutter_texture_parent_class)->pick (self,
-                                                                    color);
-          return;
-        }
-
-      if (priv->fbo_handle != NULL)
-        update_fbo (self);
-
-      cogl_color_init_from_4ub (&pick_color,
-                                color->red,
-                                color->green,
-                                color->blue,
-                                0xff);
-      cogl_pipeline_set_layer_combine_constant (priv->pick_pipeline,
-                                                0, &pick_color);
-      cogl_pipeline_set_layer_texture (priv->pick_pipeline, 0,
-                                       clutter_texture_get_cogl_texture (texture));
-      cogl_set_source (priv->pick_pipeline);
-      gen_texcoords_and_draw_cogl_rectangle (self);
-    }
-  else
-    CLUTTER_ACTOR_CLASS (clutter_texture_parent_class)->pick (self, color);
-}
-
 static void
 clutter_texture_paint (ClutterActor *self)
 {
@@ -783,12 +702,6 @@ clutter_texture_dispose (GObject *object)
       priv->pipeline = NULL;
     }
 
-  if (priv->pick_pipeline != NULL)
-    {
-      cogl_object_unref (priv->pick_pipeline);
-      priv->pick_pipeline = NULL;
-    }
-
   G_OBJECT_CLASS (clutter_texture_parent_class)->dispose (object);
 }
 
@@ -960,7 +873,6 @@ clutter_texture_class_init (ClutterTextureClass *klass)
   GParamSpec *pspec;
 
   actor_class->paint            = clutter_texture_paint;
-  actor_class->pick             = clutter_texture_pick;
   actor_class->get_paint_volume = clutter_texture_get_paint_volume;
   actor_class->realize          = clutter_texture_realize;
   actor_class->unrealize        = clutter_texture_unrealize;
@@ -1125,14 +1037,8 @@ clutter_texture_class_init (ClutterTextureClass *klass)
    * Determines whether a #ClutterTexture should have it's shape defined
    * by its alpha channel when picking.
    *
-   * Be aware that this is a bit more costly than the default picking
-   * due to the texture lookup, extra test against the alpha value and
-   * the fact that it will also interrupt the batching of geometry
-   * done internally.
-   *
-   * Also there is currently no control over the threshold used to
-   * determine what value of alpha is considered pickable, and so
-   * only fully opaque parts of the texture will react to picking.
+   * Picking is resolved against the actor geometry and never reads
+   * back texture contents, so this property has no effect anymore.
    *
    * Since: 1.4
    *
@@ -1279,11 +1185,8 @@ clutter_texture_init (ClutterTexture *self)
   priv->repeat_y          = FALSE;
   priv->sync_actor_size   = TRUE;
   priv->fbo_handle        = NULL;
-  priv->pick_pipeline     = NULL;
   priv->keep_aspect_ratio = FALSE;
   priv->pick_with_alpha   = FALSE;
-  priv->pick_with_alpha_supported = TRUE;
-  priv->seen_create_pick_pipeline_warning = FALSE;
 
   if (G_UNLIKELY (texture_template_pipeline == NULL))
     {
@@ -3042,14 +2945,9 @@ clutter_texture_get_load_data_async (ClutterTexture *texture)
  * Sets whether @texture should have it's shape defined by the alpha
  * channel when picking.
  *
- * Be aware that this is a bit more costly than the default picking
- * due to the texture lookup, extra test against the alpha value and
- * the fact that it will also interrupt the batching of geometry done
- * internally.
- *
- * Also there is currently no control over the threshold used to
- * determine what value of alpha is considered pickable, and so only
- * fully opaque parts of the texture will react to picking.
+ * Picking is resolved against the actor geometry and never reads
+ * back texture contents, so the value is stored but does not affect
+ * the picking shape anymore.
  *
  * Since: 1.4
  *
@@ -3068,19 +2966,7 @@ clutter_texture_set_pick_with_alpha (ClutterTexture *texture,
   if (priv->pick_with_alpha == pick_with_alpha)
     return;
 
-  if (!pick_with_alpha && priv->pick_pipeline != NULL)
-    {
-      cogl_object_unref (priv->pick_pipeline);
-      priv->pick_pipeline = NULL;
-    }
-
-  /* NB: the pick pipeline is created lazily when we first pick */
   priv->pick_with_alpha = pick_with_alpha;
-
-  /* NB: actors are expected to call clutter_actor_queue_redraw when
-   * ever some state changes that will affect painting *or picking...
-   */
-  clutter_actor_queue_redraw (CLUTTER_ACTOR (texture));
 }
 
 /**
@@ -38,6 +38,7 @@
 #include <unistd.h>
 
 #include <glib.h>
+#include <glib-unix.h>
 #include <libinput.h>
 
 #include "clutter-backend.h"
@@ -89,6 +90,26 @@ struct _ClutterDeviceManagerEvdevPrivate
 
   ClutterEventSource *event_source;
 
+  /* libinput is read from a dedicated thread, so that pointer motion keeps
+   * reaching the cursor while the main loop is busy. The thread only calls
+   * libinput_dispatch() and moves the resulting events into pending_events;
+   * they are still translated into ClutterEvents on the main thread.
+   * libinput_lock protects the libinput context and everything below it.
+   */
+  GThread *input_thread;
+  GMainContext *input_context;
+  GMainLoop *input_loop;
+  GRecMutex libinput_lock;
+  GQueue pending_events;
+  gint n_pending_events;
+
+  ClutterPointerMotionCallback pointer_motion_callback;
+  gpointer                     pointer_motion_data;
+  GDestroyNotify               pointer_motion_data_notify;
+  gboolean pointer_prediction_valid;
+  float predicted_pointer_x;
+  float predicted_pointer_y;
+
   GSList *devices;
   GSList *seats;
 
@@ -192,22 +213,29 @@ struct _ClutterEventSource
   GSource source;
 
   ClutterDeviceManagerEvdev *manager_evdev;
-  GPollFD event_poll_fd;
 };
 
 static void
 process_events (ClutterDeviceManagerEvdev *manager_evdev);
 
+static gboolean
+has_pending_libinput_events (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  return g_atomic_int_get (&manager_evdev->priv->n_pending_events) > 0;
+}
+
 static gboolean
 clutter_event_prepare (GSource *source,
                        gint    *timeout)
 {
+  ClutterEventSource *event_source = (ClutterEventSource *) source;
   gboolean retval;
 
   _clutter_threads_acquire_lock ();
 
   *timeout = -1;
-  retval = clutter_events_pending ();
+  retval = (clutter_events_pending () ||
+            has_pending_libinput_events (event_source->manager_evdev));
 
   _clutter_threads_release_lock ();
 
@@ -222,8 +250,8 @@ clutter_event_check (GSource *source)
 
   _clutter_threads_acquire_lock ();
 
-  retval = ((event_source->event_poll_fd.revents & G_IO_IN) ||
-            clutter_events_pending ());
+  retval = (clutter_events_pending () ||
+            has_pending_libinput_events (event_source->manager_evdev));
 
   _clutter_threads_release_lock ();
 
@@ -348,6 +376,7 @@ new_absolute_motion_event (ClutterInputDevice *input_device,
     {
       seat->pointer_x = x;
       seat->pointer_y = y;
+      _clutter_device_manager_evdev_sync_pointer_prediction (manager_evdev);
     }
 
   return event;
@@ -710,13 +739,138 @@ notify_pad_ring (ClutterInputDevice *input_device,
   queue_event (event);
 }
 
+static void
+predict_pointer_motion (ClutterDeviceManagerEvdev *manager_evdev,
+                        struct libinput_event     *event)
+{
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+  struct libinput_event_pointer *pointer_event;
+  float dx, dy;
+  float x, y;
+
+  switch (libinput_event_get_type (event))
+    {
+    case LIBINPUT_EVENT_POINTER_MOTION:
+      break;
+
+    case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+      /* Absolute positions depend on the stage and device mapping, which
+       * only the main thread knows about; wait for it to catch up.
+       */
+      priv->pointer_prediction_valid = FALSE;
+      return;
+
+    default:
+      return;
+    }
+
+  if (!priv->pointer_prediction_valid || !priv->pointer_motion_callback)
+    return;
+
+  pointer_event = libinput_event_get_pointer_event (event);
+  dx = libinput_event_pointer_get_dx (pointer_event);
+  dy = libinput_event_pointer_get_dy (pointer_event);
+
+  if (priv->pointer_motion_callback (priv->predicted_pointer_x,
+                                     priv->predicted_pointer_y,
+                                     dx, dy,
+                                     &x, &y,
+                                     priv->pointer_motion_data))
+    {
+      priv->predicted_pointer_x = x;
+      priv->predicted_pointer_y = y;
+    }
+  else
+    {
+      priv->pointer_prediction_valid = FALSE;
+    }
+}
+
+/*
+ * Moves the events read by libinput into the pending event queue. When
+ * called from the input thread, relative pointer motion is also passed
+ * on to the pointer motion callback right away, so that the cursor can
+ * be moved before the main thread gets to process the event.
+ *
+ * Must be called with the libinput lock held.
+ */
+static void
+queue_libinput_events (ClutterDeviceManagerEvdev *manager_evdev,
+                       gboolean                   from_input_thread)
+{
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+  struct libinput_event *event;
+
+  while ((event = libinput_get_event (priv->libinput)))
+    {
+      if (from_input_thread)
+        predict_pointer_motion (manager_evdev, event);
+
+      g_queue_push_tail (&priv->pending_events, event);
+    }
+
+  g_atomic_int_set (&priv->n_pending_events,
+                    g_queue_get_length (&priv->pending_events));
+}
+
+/*
+ * Restarts the input thread's pointer prediction from the position the
+ * main thread settled on, once every queued event has been processed.
+ * Until then, the input thread keeps building on its own prediction.
+ *
+ * Must be called with the libinput lock held.
+ */
+static void
+sync_pointer_prediction (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+
+  if (!priv->main_seat || !g_queue_is_empty (&priv->pending_events))
+    return;
+
+  priv->predicted_pointer_x = priv->main_seat->pointer_x;
+  priv->predicted_pointer_y = priv->main_seat->pointer_y;
+  priv->pointer_prediction_valid = TRUE;
+}
+
+void
+_clutter_device_manager_evdev_sync_pointer_prediction (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+
+  g_rec_mutex_lock (&priv->libinput_lock);
+  sync_pointer_prediction (manager_evdev);
+  g_rec_mutex_unlock (&priv->libinput_lock);
+}
+
+/*
+ * Drops the input thread's pointer prediction after the main thread moved
+ * the pointer on its own, e.g. when warping it; relative motion queued
+ * before that would otherwise be applied to the old position.
+ */
+void
+_clutter_device_manager_evdev_reset_pointer_prediction (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+
+  g_rec_mutex_lock (&priv->libinput_lock);
+  priv->pointer_prediction_valid = FALSE;
+  sync_pointer_prediction (manager_evdev);
+  g_rec_mutex_unlock (&priv->libinput_lock);
+}
+
 static void
 dispatch_libinput (ClutterDeviceManagerEvdev *manager_evdev)
 {
   ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
 
+  g_rec_mutex_lock (&priv->libinput_lock);
+
   libinput_dispatch (priv->libinput);
+  queue_libinput_events (manager_evdev, FALSE);
   process_events (manager_evdev);
+
+  g_rec_mutex_unlock (&priv->libinput_lock);
 }
 
 static gboolean
@@ -737,7 +891,7 @@ clutter_event_dispatch (GSource     *g_source,
   if (clutter_events_pending ())
     goto queue_event;
 
-  dispatch_libinput (manager_evdev);
+  process_events (manager_evdev);
 
  queue_event:
   event = clutter_event_get ();
@@ -781,10 +935,8 @@ static GSourceFuncs event_funcs = {
 static ClutterEventSource *
 clutter_event_source_new (ClutterDeviceManagerEvdev *manager_evdev)
 {
-  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
   GSource *source;
   ClutterEventSource *event_source;
-  gint fd;
 
   source = g_source_new (&event_funcs, sizeof (ClutterEventSource));
   event_source = (ClutterEventSource *) source;
@@ -792,13 +944,10 @@ clutter_event_source_new (ClutterDeviceManagerEvdev *manager_evdev)
   /* setup the source */
   event_source->manager_evdev = manager_evdev;
 
-  fd = libinput_get_fd (priv->libinput);
-  event_source->event_poll_fd.fd = fd;
-  event_source->event_poll_fd.events = G_IO_IN;
-
-  /* and finally configure and attach the GSource */
+  /* and finally configure and attach the GSource; the libinput fd itself
+   * is polled by the input thread, which wakes up the main context when
+   * there are events to process */
   g_source_set_priority (source, CLUTTER_PRIORITY_EVENTS);
-  g_source_add_poll (source, &event_source->event_poll_fd);
   g_source_set_can_recurse (source, TRUE);
   g_source_attach (source, NULL);
 
@@ -812,14 +961,93 @@ clutter_event_source_free (ClutterEventSource *source)
 
   CLUTTER_NOTE (EVENT, "Removing GSource for evdev device manager");
 
-  /* ignore the return value of close, it's not like we can do something
-   * about it */
-  close (source->event_poll_fd.fd);
-
   g_source_destroy (g_source);
   g_source_unref (g_source);
 }
 
+/*
+ * Input thread
+ */
+
+static gboolean
+input_thread_dispatch (gint         fd,
+                       GIOCondition condition,
+                       gpointer     user_data)
+{
+  ClutterDeviceManagerEvdev *manager_evdev = user_data;
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+  gboolean has_events;
+
+  g_rec_mutex_lock (&priv->libinput_lock);
+
+  libinput_dispatch (priv->libinput);
+  queue_libinput_events (manager_evdev, TRUE);
+  has_events = !g_queue_is_empty (&priv->pending_events);
+
+  g_rec_mutex_unlock (&priv->libinput_lock);
+
+  if (has_events)
+    g_main_context_wakeup (NULL);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gpointer
+input_thread_func (gpointer user_data)
+{
+  ClutterDeviceManagerEvdev *manager_evdev = user_data;
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+
+  g_main_context_push_thread_default (priv->input_context);
+  g_main_loop_run (priv->input_loop);
+  g_main_context_pop_thread_default (priv->input_context);
+
+  return NULL;
+}
+
+static void
+start_input_thread (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+  GSource *source;
+
+  priv->input_context = g_main_context_new ();
+  priv->input_loop = g_main_loop_new (priv->input_context, FALSE);
+
+  source = g_unix_fd_source_new (libinput_get_fd (priv->libinput), G_IO_IN);
+  g_source_set_callback (source, (GSourceFunc) input_thread_dispatch,
+                         manager_evdev, NULL);
+  g_source_attach (source, priv->input_context);
+  g_source_unref (source);
+
+  priv->input_thread = g_thread_new ("clutter-evdev-input",
+                                     input_thread_func,
+                                     manager_evdev);
+}
+
+static void
+stop_input_thread (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+  struct libinput_event *event;
+
+  if (!priv->input_thread)
+    return;
+
+  g_main_loop_quit (priv->input_loop);
+  g_thread_join (priv->input_thread);
+  priv->input_thread = NULL;
+
+  g_main_loop_unref (priv->input_loop);
+  priv->input_loop = NULL;
+  g_main_context_unref (priv->input_context);
+  priv->input_context = NULL;
+
+  while ((event = g_queue_pop_head (&priv->pending_events)))
+    libinput_event_destroy (event);
+  g_atomic_int_set (&priv->n_pending_events, 0);
+}
+
 static void
 evdev_add_device (ClutterDeviceManagerEvdev *manager_evdev,
                   struct libinput_device    *libinput_device)
@@ -1835,11 +2063,18 @@ process_events (ClutterDeviceManagerEvdev *manager_evdev)
   ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
   struct libinput_event *event;
 
-  while ((event = libinput_get_event (priv->libinput)))
+  g_rec_mutex_lock (&priv->libinput_lock);
+
+  while ((event = g_queue_pop_head (&priv->pending_events)))
     {
       process_event(manager_evdev, event);
       libinput_event_destroy(event);
     }
+
+  g_atomic_int_set (&priv->n_pending_events, 0);
+  sync_pointer_prediction (manager_evdev);
+
+  g_rec_mutex_unlock (&priv->libinput_lock);
 }
 
 static int
@@ -1903,31 +2138,6 @@ clutter_device_manager_evdev_create_virtual_device (ClutterDeviceManager  *manag
                        NULL);
 }
 
-static void
-clutter_device_manager_evdev_compress_motion (ClutterDeviceManager *device_manger,
-                                              ClutterEvent         *event,
-                                              const ClutterEvent   *to_discard)
-{
-  double dx, dy;
-  double dx_unaccel, dy_unaccel;
-  double dst_dx = 0.0, dst_dy = 0.0;
-  double dst_dx_unaccel = 0.0, dst_dy_unaccel = 0.0;
-
-  if (!clutter_evdev_event_get_relative_motion (to_discard,
-                                                &dx, &dy,
-                                                &dx_unaccel, &dy_unaccel))
-    return;
-
-  clutter_evdev_event_get_relative_motion (event,
-                                           &dst_dx, &dst_dy,
-                                           &dst_dx_unaccel, &dst_dy_unaccel);
-  _clutter_evdev_event_set_relative_motion (event,
-                                            dx + dst_dx,
-                                            dy + dst_dy,
-                                            dx_unaccel + dst_dx_unaccel,
-                                            dy_unaccel + dst_dy_unaccel);
-}
-
 static void
 clutter_device_manager_evdev_apply_kbd_a11y_settings (ClutterDeviceManager   *device_manager,
                                                       ClutterKbdA11ySettings *settings)
@@ -2001,6 +2211,8 @@ clutter_device_manager_evdev_constructed (GObject *gobject)
 
   source = clutter_event_source_new (manager_evdev);
   priv->event_source = source;
+
+  start_input_thread (manager_evdev);
 }
 
 static void
@@ -2044,6 +2256,8 @@ clutter_device_manager_evdev_finalize (GObject *object)
   manager_evdev = CLUTTER_DEVICE_MANAGER_EVDEV (object);
   priv = manager_evdev->priv;
 
+  stop_input_thread (manager_evdev);
+
   g_slist_free_full (priv->seats, (GDestroyNotify) clutter_seat_evdev_free);
   g_slist_free (priv->devices);
 
@@ -2056,9 +2270,14 @@ clutter_device_manager_evdev_finalize (GObject *object)
   if (priv->constrain_data_notify != NULL)
     priv->constrain_data_notify (priv->constrain_data);
 
+  if (priv->pointer_motion_data_notify != NULL)
+    priv->pointer_motion_data_notify (priv->pointer_motion_data);
+
   if (priv->libinput != NULL)
     libinput_unref (priv->libinput);
 
+  g_rec_mutex_clear (&priv->libinput_lock);
+
   g_list_free (priv->free_device_ids);
 
   G_OBJECT_CLASS (clutter_device_manager_evdev_parent_class)->finalize (object);
@@ -2081,7 +2300,6 @@ clutter_device_manager_evdev_class_init (ClutterDeviceManagerEvdevClass *klass)
   manager_class->get_core_device = clutter_device_manager_evdev_get_core_device;
   manager_class->get_device = clutter_device_manager_evdev_get_device;
   manager_class->create_virtual_device = clutter_device_manager_evdev_create_virtual_device;
-  manager_class->compress_motion = clutter_device_manager_evdev_compress_motion;
   manager_class->apply_kbd_a11y_settings = clutter_device_manager_evdev_apply_kbd_a11y_settings;
 }
 
@@ -2143,6 +2361,9 @@ clutter_device_manager_evdev_init (ClutterDeviceManagerEvdev *self)
 
   priv = self->priv = clutter_device_manager_evdev_get_instance_private (self);
 
+  g_rec_mutex_init (&priv->libinput_lock);
+  g_queue_init (&priv->pending_events);
+
   priv->stage_manager = clutter_stage_manager_get_default ();
   g_object_ref (priv->stage_manager);
 
@@ -2290,9 +2511,14 @@ clutter_evdev_release_devices (void)
       return;
     }
 
+  g_rec_mutex_lock (&priv->libinput_lock);
+
   libinput_suspend (priv->libinput);
+  queue_libinput_events (manager_evdev, FALSE);
   process_events (manager_evdev);
 
+  g_rec_mutex_unlock (&priv->libinput_lock);
+
   priv->released = TRUE;
 }
 
@@ -2361,10 +2587,15 @@ clutter_evdev_reclaim_devices (void)
       return;
     }
 
+  g_rec_mutex_lock (&priv->libinput_lock);
+
   libinput_resume (priv->libinput);
   clutter_evdev_update_xkb_state (manager_evdev);
+  queue_libinput_events (manager_evdev, FALSE);
   process_events (manager_evdev);
 
+  g_rec_mutex_unlock (&priv->libinput_lock);
+
   priv->released = FALSE;
 }
 
@@ -2609,6 +2840,137 @@ clutter_evdev_set_relative_motion_filter (ClutterDeviceManager       *evdev,
   priv->relative_motion_filter_user_data = user_data;
 }
 
+/**
+ * clutter_evdev_set_pointer_motion_callback:
+ * @evdev: the #ClutterDeviceManager created by the evdev backend
+ * @callback: the callback
+ * @user_data: data to pass to the callback
+ * @user_data_notify: function to be called when removing the callback
+ *
+ * Sets a callback to be invoked from the input thread for every relative
+ * pointer motion, see #ClutterPointerMotionCallback. The pointer position
+ * passed to the callback is resynchronized with the one of the core
+ * pointer every time the main thread catches up with the input thread.
+ *
+ * Stability: unstable
+ */
+void
+clutter_evdev_set_pointer_motion_callback (ClutterDeviceManager         *evdev,
+                                           ClutterPointerMotionCallback  callback,
+                                           gpointer                      user_data,
+                                           GDestroyNotify                user_data_notify)
+{
+  ClutterDeviceManagerEvdev *manager_evdev;
+  ClutterDeviceManagerEvdevPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_DEVICE_MANAGER_EVDEV (evdev));
+
+  manager_evdev = CLUTTER_DEVICE_MANAGER_EVDEV (evdev);
+  priv = manager_evdev->priv;
+
+  g_rec_mutex_lock (&priv->libinput_lock);
+
+  if (priv->pointer_motion_data_notify)
+    priv->pointer_motion_data_notify (priv->pointer_motion_data);
+
+  priv->pointer_motion_callback = callback;
+  priv->pointer_motion_data = user_data;
+  priv->pointer_motion_data_notify = user_data_notify;
+
+  g_rec_mutex_unlock (&priv->libinput_lock);
+}
+
+/**
+ * clutter_evdev_get_predicted_pointer_position:
+ * @evdev: the #ClutterDeviceManager created by the evdev backend
+ * @x: (out): return location for the X position of the pointer
+ * @y: (out): return location for the Y position of the pointer
+ *
+ * Retrieves where the input thread expects the core pointer to end up
+ * once the main thread has processed all the motion read so far; this is
+ * the last position passed back by the #ClutterPointerMotionCallback, or
+ * the position of the core pointer if the main thread has caught up.
+ *
+ * To keep the input thread from moving on while the position is in use,
+ * call this between clutter_evdev_lock_libinput() and
+ * clutter_evdev_unlock_libinput().
+ *
+ * Returns: %TRUE if (@x, @y) were set, %FALSE if only the main thread
+ *   knows where the pointer is, e.g. because the last motion was absolute
+ *   or was left to the main thread by the callback
+ *
+ * Stability: unstable
+ */
+gboolean
+clutter_evdev_get_predicted_pointer_position (ClutterDeviceManager *evdev,
+                                              float                *x,
+                                              float                *y)
+{
+  ClutterDeviceManagerEvdev *manager_evdev;
+  ClutterDeviceManagerEvdevPrivate *priv;
+  gboolean valid;
+
+  g_return_val_if_fail (CLUTTER_IS_DEVICE_MANAGER_EVDEV (evdev), FALSE);
+
+  manager_evdev = CLUTTER_DEVICE_MANAGER_EVDEV (evdev);
+  priv = manager_evdev->priv;
+
+  g_rec_mutex_lock (&priv->libinput_lock);
+
+  valid = priv->pointer_prediction_valid;
+  if (valid)
+    {
+      *x = priv->predicted_pointer_x;
+      *y = priv->predicted_pointer_y;
+    }
+
+  g_rec_mutex_unlock (&priv->libinput_lock);
+
+  return valid;
+}
+
+/**
+ * clutter_evdev_lock_libinput:
+ * @evdev: the #ClutterDeviceManager created by the evdev backend
+ *
+ * libinput is not thread safe, and the evdev backend reads it from a
+ * separate input thread. Any direct use of the libinput objects, such as
+ * changing the configuration of a device returned by
+ * clutter_evdev_input_device_get_libinput_device(), must be done between
+ * a call to this function and clutter_evdev_unlock_libinput().
+ *
+ * Stability: unstable
+ */
+void
+clutter_evdev_lock_libinput (ClutterDeviceManager *evdev)
+{
+  ClutterDeviceManagerEvdev *manager_evdev;
+
+  g_return_if_fail (CLUTTER_IS_DEVICE_MANAGER_EVDEV (evdev));
+
+  manager_evdev = CLUTTER_DEVICE_MANAGER_EVDEV (evdev);
+  g_rec_mutex_lock (&manager_evdev->priv->libinput_lock);
+}
+
+/**
+ * clutter_evdev_unlock_libinput:
+ * @evdev: the #ClutterDeviceManager created by the evdev backend
+ *
+ * Releases the lock taken by clutter_evdev_lock_libinput().
+ *
+ * Stability: unstable
+ */
+void
+clutter_evdev_unlock_libinput (ClutterDeviceManager *evdev)
+{
+  ClutterDeviceManagerEvdev *manager_evdev;
+
+  g_return_if_fail (CLUTTER_IS_DEVICE_MANAGER_EVDEV (evdev));
+
+  manager_evdev = CLUTTER_DEVICE_MANAGER_EVDEV (evdev);
+  g_rec_mutex_unlock (&manager_evdev->priv->libinput_lock);
+}
+
 /**
  * clutter_evdev_set_keyboard_repeat:
  * @evdev: the #ClutterDeviceManager created by the evdev backend
@@ -2758,7 +3120,11 @@ clutter_evdev_warp_pointer (ClutterInputDevice   *pointer_device,
                             int                   x,
                             int                   y)
 {
+  ClutterDeviceManagerEvdev *manager_evdev =
+    CLUTTER_DEVICE_MANAGER_EVDEV (pointer_device->device_manager);
+
   notify_absolute_motion (pointer_device, ms2us(time_), x, y, NULL);
+  _clutter_device_manager_evdev_reset_pointer_prediction (manager_evdev);
 }
 
 /**
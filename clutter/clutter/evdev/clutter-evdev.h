@@ -109,6 +109,50 @@ void clutter_evdev_set_relative_motion_filter (ClutterDeviceManager       *evdev
                                                ClutterRelativeMotionFilter filter,
                                                gpointer                    user_data);
 
+/**
+ * ClutterPointerMotionCallback:
+ * @prev_x: the X coordinate of the pointer before the motion
+ * @prev_y: the Y coordinate of the pointer before the motion
+ * @dx: the relative motion on the X axis, with acceleration applied
+ * @dy: the relative motion on the Y axis, with acceleration applied
+ * @x: (out): return location for the new X coordinate
+ * @y: (out): return location for the new Y coordinate
+ * @user_data: user data passed to this function
+ *
+ * This callback is called from the input thread for every relative
+ * pointer motion, as soon as it is read from the device and before the
+ * main thread gets to process the corresponding event. It should
+ * compute where the pointer ends up, and can be used to move the cursor
+ * without waiting for the main loop. It must only use state that is
+ * safe to access from another thread.
+ *
+ * Returns: %TRUE if (@x, @y) were set, %FALSE if the motion can only be
+ *   resolved by the main thread
+ */
+typedef gboolean (*ClutterPointerMotionCallback) (float     prev_x,
+                                                  float     prev_y,
+                                                  float     dx,
+                                                  float     dy,
+                                                  float    *x,
+                                                  float    *y,
+                                                  gpointer  user_data);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+void clutter_evdev_set_pointer_motion_callback (ClutterDeviceManager         *evdev,
+                                                ClutterPointerMotionCallback  callback,
+                                                gpointer                      user_data,
+                                                GDestroyNotify                user_data_notify);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+gboolean clutter_evdev_get_predicted_pointer_position (ClutterDeviceManager *evdev,
+                                                       float                *x,
+                                                       float                *y);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+void clutter_evdev_lock_libinput   (ClutterDeviceManager *evdev);
+CLUTTER_AVAILABLE_IN_MUTTER
+void clutter_evdev_unlock_libinput (ClutterDeviceManager *evdev);
+
 CLUTTER_AVAILABLE_IN_1_16
 void               clutter_evdev_set_keyboard_map   (ClutterDeviceManager *evdev,
 						     struct xkb_keymap    *keymap);
@@ -32,6 +32,7 @@
 #include <math.h>
 
 #include "clutter-event-private.h"
+#include "clutter-evdev.h"
 #include "clutter-input-device-evdev.h"
 #include "clutter-input-device-tool-evdev.h"
 #include "clutter-main.h"
@@ -79,11 +80,15 @@ clutter_seat_evdev_sync_leds (ClutterSeatEvdev *seat)
   if (scroll_lock)
     leds |= LIBINPUT_LED_SCROLL_LOCK;
 
+  clutter_evdev_lock_libinput (CLUTTER_DEVICE_MANAGER (seat->manager_evdev));
+
   for (iter = seat->devices; iter; iter = iter->next)
     {
       device_evdev = iter->data;
       _clutter_input_device_evdev_update_leds (device_evdev, leds);
     }
+
+  clutter_evdev_unlock_libinput (CLUTTER_DEVICE_MANAGER (seat->manager_evdev));
 }
 
 static void
@@ -390,6 +395,7 @@ new_absolute_motion_event (ClutterSeatEvdev   *seat,
     {
       seat->pointer_x = x;
       seat->pointer_y = y;
+      _clutter_device_manager_evdev_sync_pointer_prediction (seat->manager_evdev);
     }
 
   return event;
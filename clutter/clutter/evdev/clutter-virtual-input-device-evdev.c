@@ -164,6 +164,7 @@ clutter_virtual_input_device_evdev_notify_relative_motion (ClutterVirtualInputDe
                                              time_us,
                                              dx, dy,
                                              dx, dy);
+  _clutter_device_manager_evdev_reset_pointer_prediction (virtual_evdev->seat->manager_evdev);
 }
 
 static void
@@ -183,6 +184,7 @@ clutter_virtual_input_device_evdev_notify_absolute_motion (ClutterVirtualInputDe
                                              time_us,
                                              x, y,
                                              NULL);
+  _clutter_device_manager_evdev_reset_pointer_prediction (virtual_evdev->seat->manager_evdev);
 }
 
 static void
@@ -5,7 +5,6 @@
 #define STAGE_HEIGHT 480
 #define ACTORS_X 12
 #define ACTORS_Y 16
-#define SHIFT_STEP STAGE_WIDTH / ACTORS_X
 
 typedef struct _State State;
 
@@ -20,84 +19,12 @@ struct _State
   gboolean pass;
 };
 
-struct _ShiftEffect
-{
-  ClutterShaderEffect parent_instance;
-};
-
-struct _ShiftEffectClass
-{
-  ClutterShaderEffectClass parent_class;
-};
-
-typedef struct _ShiftEffect       ShiftEffect;
-typedef struct _ShiftEffectClass  ShiftEffectClass;
-
-#define TYPE_SHIFT_EFFECT        (shift_effect_get_type ())
-
-GType shift_effect_get_type (void);
-
-G_DEFINE_TYPE (ShiftEffect,
-               shift_effect,
-               CLUTTER_TYPE_SHADER_EFFECT);
-
-static void
-shader_paint (ClutterEffect           *effect,
-              ClutterEffectPaintFlags  flags)
-{
-  ClutterShaderEffect *shader = CLUTTER_SHADER_EFFECT (effect);
-  float tex_width;
-  ClutterActor *actor =
-    clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
-
-  if (g_test_verbose ())
-    g_debug ("shader_paint");
-
-  clutter_shader_effect_set_shader_source (shader,
-    "uniform sampler2D tex;\n"
-    "uniform float step;\n"
-    "void main (void)\n"
-    "{\n"
-    "  cogl_color_out = texture2D(tex, vec2 (cogl_tex_coord_in[0].s + step,\n"
-    "                                        cogl_tex_coord_in[0].t));\n"
-    "}\n");
-
-  tex_width = clutter_actor_get_width (actor);
-
-  clutter_shader_effect_set_uniform (shader, "tex", G_TYPE_INT, 1, 0);
-  clutter_shader_effect_set_uniform (shader, "step", G_TYPE_FLOAT, 1,
-                                     SHIFT_STEP / tex_width);
-
-  CLUTTER_EFFECT_CLASS (shift_effect_parent_class)->paint (effect, flags);
-}
-
-static void
-shader_pick (ClutterEffect           *effect,
-             ClutterEffectPaintFlags  flags)
-{
-  shader_paint (effect, flags);
-}
-
-static void
-shift_effect_class_init (ShiftEffectClass *klass)
-{
-  ClutterEffectClass *shader_class = CLUTTER_EFFECT_CLASS (klass);
-
-  shader_class->paint = shader_paint;
-  shader_class->pick = shader_pick;
-}
-
-static void
-shift_effect_init (ShiftEffect *self)
-{
-}
-
 static const char *test_passes[] = {
   "No covering actor",
   "Invisible covering actor",
   "Clipped covering actor",
   "Blur effect",
-  "Shift effect",
+  "Scaled covering actor",
 };
 
 static gboolean
@@ -167,46 +94,45 @@ on_timeout (gpointer data)
         }
       else if (test_num == 4)
         {
-          if (!clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL))
-            continue;
-
-          clutter_actor_hide (over_actor);
-          clutter_actor_remove_effect_by_name (CLUTTER_ACTOR (state->stage),
-                                               "blur");
-
-          clutter_actor_add_effect_with_name (CLUTTER_ACTOR (state->stage),
-                                              "shift",
-                                              g_object_new (TYPE_SHIFT_EFFECT,
-                                                            NULL));
+          if (clutter_actor_get_effect (CLUTTER_ACTOR (state->stage),
+                                        "blur") != NULL)
+            clutter_actor_remove_effect_by_name (CLUTTER_ACTOR (state->stage),
+                                                 "blur");
+
+          /* Scale the covering actor down around its center so that it
+             only covers the middle of the stage; picking has to follow
+             the transformed geometry */
+          clutter_actor_remove_clip (over_actor);
+          clutter_actor_set_pivot_point (over_actor, 0.5f, 0.5f);
+          clutter_actor_set_scale (over_actor, 0.5, 0.5);
+          clutter_actor_show (over_actor);
 
           if (g_test_verbose ())
-            g_print ("With shift effect:\n");
+            g_print ("Scaled covering actor:\n");
         }
 
       for (y = 0; y < ACTORS_Y; y++)
         {
-          if (test_num == 4)
-            x = 1;
-          else
-            x = 0;
-
-          for (; x < ACTORS_X; x++)
+          for (x = 0; x < ACTORS_X; x++)
             {
               gboolean pass = FALSE;
-              gfloat pick_x;
+              gfloat pick_x, pick_y;
+              gboolean over_scaled_actor;
               ClutterActor *actor;
 
               pick_x = x * state->actor_width + state->actor_width / 2;
+              pick_y = y * state->actor_height + state->actor_height / 2;
 
-              if (test_num == 4)
-                pick_x -= SHIFT_STEP;
+              over_scaled_actor = (pick_x >= STAGE_WIDTH / 4 &&
+                                   pick_x < STAGE_WIDTH * 3 / 4 &&
+                                   pick_y >= STAGE_HEIGHT / 4 &&
+                                   pick_y < STAGE_HEIGHT * 3 / 4);
 
               actor =
                 clutter_stage_get_actor_at_pos (CLUTTER_STAGE (state->stage),
                                                 CLUTTER_PICK_ALL,
                                                 pick_x,
-                                                y * state->actor_height
-                                                + state->actor_height / 2);
+                                                pick_y);
 
               if (g_test_verbose ())
                 g_print ("% 3i,% 3i / %p -> ",
@@ -223,6 +149,8 @@ on_timeout (gpointer data)
                       && x >= 2 && x < ACTORS_X - 2
                       && y >= 2 && y < ACTORS_Y - 2)
                     pass = TRUE;
+                  else if (test_num == 4 && over_scaled_actor)
+                    pass = TRUE;
 
                   if (g_test_verbose ())
                     g_print ("over_actor: %s\n", pass ? "pass" : "FAIL");
@@ -232,7 +160,8 @@ on_timeout (gpointer data)
                   if (actor == state->actors[y * ACTORS_X + x]
                       && (test_num != 2
                           || x < 2 || x >= ACTORS_X - 2
-                          || y < 2 || y >= ACTORS_Y - 2))
+                          || y < 2 || y >= ACTORS_Y - 2)
+                      && (test_num != 4 || !over_scaled_actor))
                     pass = TRUE;
 
                   if (g_test_verbose ())
@@ -306,6 +235,127 @@ actor_pick (void)
   g_assert (state.pass);
 }
 
+typedef struct _PointerState
+{
+  ClutterActor *stage;
+  ClutterActor *below;
+  ClutterActor *above;
+  int n_events;
+  gboolean pass;
+} PointerState;
+
+/* Pointer positions, and which actor they should end up on: moving
+ * within the lower actor into the part covered by the upper one must
+ * not keep picking the lower actor.
+ */
+static const struct {
+  float x, y;
+  int expected;
+} pointer_moves[] = {
+  { 10, 10, 0 },
+  { 20, 20, 0 },
+  { 60, 60, 1 },
+  { 90, 90, 1 },
+  { 30, 30, 0 },
+  { 99, 10, 0 },
+  { 149, 149, 1 },
+  { 160, 20, 2 },
+};
+
+static gboolean
+on_pointer_captured_event (ClutterActor *stage,
+                           ClutterEvent *event,
+                           PointerState *state)
+{
+  ClutterActor *expected_actors[] = { state->below, state->above, stage };
+  ClutterActor *source;
+  int expected;
+
+  if (clutter_event_type (event) != CLUTTER_MOTION)
+    return CLUTTER_EVENT_PROPAGATE;
+
+  expected = pointer_moves[state->n_events].expected;
+  source = clutter_event_get_source (event);
+
+  if (g_test_verbose ())
+    g_print ("pointer at %.0f,%.0f -> %s (expected %s)\n",
+             pointer_moves[state->n_events].x,
+             pointer_moves[state->n_events].y,
+             clutter_actor_get_name (source),
+             clutter_actor_get_name (expected_actors[expected]));
+
+  if (source != expected_actors[expected])
+    state->pass = FALSE;
+
+  state->n_events++;
+  if (state->n_events == G_N_ELEMENTS (pointer_moves))
+    clutter_main_quit ();
+
+  return CLUTTER_EVENT_PROPAGATE;
+}
+
+static gboolean
+put_pointer_moves (gpointer data)
+{
+  PointerState *state = data;
+  ClutterDeviceManager *manager = clutter_device_manager_get_default ();
+  ClutterInputDevice *pointer;
+  int i;
+
+  pointer = clutter_device_manager_get_core_device (manager,
+                                                    CLUTTER_POINTER_DEVICE);
+
+  for (i = 0; i < G_N_ELEMENTS (pointer_moves); i++)
+    {
+      ClutterEvent *event = clutter_event_new (CLUTTER_MOTION);
+
+      clutter_event_set_stage (event, CLUTTER_STAGE (state->stage));
+      clutter_event_set_device (event, pointer);
+      clutter_event_set_coords (event, pointer_moves[i].x, pointer_moves[i].y);
+
+      clutter_event_put (event);
+      clutter_event_free (event);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+actor_pick_pointer (void)
+{
+  PointerState state = { 0, };
+
+  state.pass = TRUE;
+  state.stage = clutter_test_get_stage ();
+  clutter_actor_set_name (state.stage, "stage");
+  clutter_stage_set_throttle_motion_events (CLUTTER_STAGE (state.stage),
+                                            FALSE);
+
+  state.below = clutter_actor_new ();
+  clutter_actor_set_name (state.below, "below");
+  clutter_actor_set_size (state.below, 100, 100);
+  clutter_actor_set_reactive (state.below, TRUE);
+  clutter_actor_add_child (state.stage, state.below);
+
+  state.above = clutter_actor_new ();
+  clutter_actor_set_name (state.above, "above");
+  clutter_actor_set_position (state.above, 50, 50);
+  clutter_actor_set_size (state.above, 100, 100);
+  clutter_actor_set_reactive (state.above, TRUE);
+  clutter_actor_add_child (state.stage, state.above);
+
+  g_signal_connect (state.stage, "captured-event",
+                    G_CALLBACK (on_pointer_captured_event), &state);
+  clutter_actor_show (state.stage);
+
+  clutter_threads_add_idle (put_pointer_moves, &state);
+
+  clutter_main ();
+
+  g_assert (state.pass);
+}
+
 CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/actor/pick", actor_pick)
+  CLUTTER_TEST_UNIT ("/actor/pick/pointer", actor_pick_pointer)
 )
@@ -0,0 +1,127 @@
+#include <clutter/clutter.h>
+
+#define N_MOTION_EVENTS 64
+
+typedef struct _State
+{
+  guint n_samples;
+  guint n_delivered;
+  guint n_with_history;
+  guint32 last_time;
+  gboolean pass;
+} State;
+
+static void
+check_sample (State              *state,
+              const ClutterEvent *event)
+{
+  guint32 time = clutter_event_get_time (event);
+  gfloat x, y;
+
+  clutter_event_get_coords (event, &x, &y);
+
+  /* every sample must arrive exactly once, in order */
+  if (time != state->last_time + 1 || (guint32) x != time)
+    {
+      if (g_test_verbose ())
+        g_print ("unexpected sample %u at %.0f (last %u)\n",
+                 time, x, state->last_time);
+
+      state->pass = FALSE;
+    }
+
+  state->last_time = time;
+  state->n_samples++;
+}
+
+static gboolean
+on_captured_event (ClutterActor *stage,
+                   ClutterEvent *event,
+                   State        *state)
+{
+  ClutterEvent **history;
+  guint n_history, n_nested, i;
+
+  if (clutter_event_type (event) != CLUTTER_MOTION)
+    return CLUTTER_EVENT_PROPAGATE;
+
+  state->n_delivered++;
+
+  history = clutter_event_get_motion_history (event, &n_history);
+  if (n_history > 0)
+    state->n_with_history++;
+
+  for (i = 0; i < n_history; i++)
+    {
+      /* the history is flattened as events get coalesced */
+      clutter_event_get_motion_history (history[i], &n_nested);
+      if (n_nested != 0)
+        state->pass = FALSE;
+
+      check_sample (state, history[i]);
+    }
+
+  check_sample (state, event);
+
+  if (state->n_samples >= N_MOTION_EVENTS)
+    clutter_main_quit ();
+
+  return CLUTTER_EVENT_PROPAGATE;
+}
+
+/* All events are put from a single idle; the event source runs before the
+ * master clock, so they are all queued on the stage before the next frame
+ * processes them. */
+static gboolean
+put_motion_events (gpointer data)
+{
+  ClutterDeviceManager *manager = clutter_device_manager_get_default ();
+  ClutterActor *stage = data;
+  guint i;
+
+  for (i = 1; i <= N_MOTION_EVENTS; i++)
+    {
+      ClutterEvent *event = clutter_event_new (CLUTTER_MOTION);
+
+      clutter_event_set_stage (event, CLUTTER_STAGE (stage));
+      clutter_event_set_device (event,
+                                clutter_device_manager_get_core_device (manager,
+                                                                        CLUTTER_POINTER_DEVICE));
+      clutter_event_set_coords (event, i, i);
+      clutter_event_set_time (event, i);
+
+      clutter_event_put (event);
+      clutter_event_free (event);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+events_motion_history (void)
+{
+  ClutterActor *stage;
+  State state = { 0, 0, 0, 0, TRUE };
+
+  stage = clutter_test_get_stage ();
+  clutter_stage_set_throttle_motion_events (CLUTTER_STAGE (stage), TRUE);
+  g_signal_connect (stage, "captured-event",
+                    G_CALLBACK (on_captured_event), &state);
+  clutter_actor_show (stage);
+
+  clutter_threads_add_idle (put_motion_events, stage);
+
+  clutter_main ();
+
+  g_assert (state.pass);
+  g_assert_cmpuint (state.n_samples, ==, N_MOTION_EVENTS);
+
+  /* With throttling, the motions of a frame are coalesced into fewer
+   * events, carrying the others as their history */
+  g_assert_cmpuint (state.n_delivered, <, N_MOTION_EVENTS);
+  g_assert_cmpuint (state.n_with_history, >, 0);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/events/motion-history", events_motion_history)
+)
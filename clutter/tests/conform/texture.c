@@ -45,17 +45,19 @@ texture_pick_with_alpha (void)
       g_print ("texture = %p\n\n", tex);
     }
 
+  /* Picking is resolved against the actor geometry, so the alpha
+   * channel of the texture no longer shapes the picked area */
   clutter_texture_set_pick_with_alpha (tex, TRUE);
   if (g_test_verbose ())
     g_print ("Testing with pick-with-alpha enabled:\n");
 
-  /* This should fall through and hit the stage: */
+  g_assert (clutter_texture_get_pick_with_alpha (tex));
+
   actor = clutter_stage_get_actor_at_pos (stage, CLUTTER_PICK_ALL, 10, 10);
   if (g_test_verbose ())
     g_print ("actor @ (10, 10) = %p\n", actor);
-  g_assert (actor == CLUTTER_ACTOR (stage));
+  g_assert (actor == CLUTTER_ACTOR (tex));
 
-  /* The rest should hit the texture */
   actor = clutter_stage_get_actor_at_pos (stage, CLUTTER_PICK_ALL, 90, 10);
   if (g_test_verbose ())
     g_print ("actor @ (90, 10) = %p\n", actor);
@@ -69,6 +71,12 @@ texture_pick_with_alpha (void)
     g_print ("actor @ (10, 90) = %p\n", actor);
   g_assert (actor == CLUTTER_ACTOR (tex));
 
+  /* Outside of the texture geometry we hit the stage */
+  actor = clutter_stage_get_actor_at_pos (stage, CLUTTER_PICK_ALL, 110, 110);
+  if (g_test_verbose ())
+    g_print ("actor @ (110, 110) = %p\n", actor);
+  g_assert (actor == CLUTTER_ACTOR (stage));
+
   clutter_texture_set_pick_with_alpha (tex, FALSE);
   if (g_test_verbose ())
     g_print ("Testing with pick-with-alpha disabled:\n");
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <clutter/clutter.h>
+
+/* Measures the cost of moving input events through clutter. Two things
+ * are timed:
+ *
+ *  - "new/free" and "copy/free": allocating, copying and releasing motion
+ *    events, which happens for every event read from the input devices;
+ *  - "delivery": motion events put on the clutter event queue with
+ *    clutter_event_put() until all of them have been emitted on the stage,
+ *    i.e. the path from the backend through clutter_do_event() and the
+ *    stage event queue to the actors.
+ *
+ * Motion compression is disabled on the stage so that every event is
+ * delivered. Only public API is used, so the same program can be built
+ * against different revisions to compare event latency before and after
+ * a change.
+ */
+
+#define N_EVENTS 10000
+
+static gint n_events = N_EVENTS;
+
+static GOptionEntry entries[] = {
+  {
+    "num-events", 'e',
+    0,
+    G_OPTION_ARG_INT, &n_events,
+    "Number of events per measurement", "EVENTS"
+  },
+  { NULL }
+};
+
+static gint n_delivered = 0;
+static gint64 delivery_start = 0;
+
+static ClutterEvent *
+create_motion_event (ClutterStage *stage,
+                     gint          i)
+{
+  ClutterDeviceManager *manager = clutter_device_manager_get_default ();
+  ClutterEvent *event;
+
+  event = clutter_event_new (CLUTTER_MOTION);
+  clutter_event_set_stage (event, stage);
+  clutter_event_set_device (event,
+                            clutter_device_manager_get_core_device (manager,
+                                                                    CLUTTER_POINTER_DEVICE));
+  clutter_event_set_coords (event, i % 512, (i / 512) % 512);
+  clutter_event_set_time (event, i);
+
+  return event;
+}
+
+static gdouble
+run_new_free (ClutterStage *stage)
+{
+  gint64 start, end;
+  gint i;
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_events; i++)
+    clutter_event_free (create_motion_event (stage, i));
+
+  end = g_get_monotonic_time ();
+
+  return (gdouble) (end - start) / n_events;
+}
+
+static gdouble
+run_copy_free (ClutterStage *stage)
+{
+  ClutterEvent *event;
+  gint64 start, end;
+  gint i;
+
+  event = create_motion_event (stage, 0);
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_events; i++)
+    clutter_event_free (clutter_event_copy (event));
+
+  end = g_get_monotonic_time ();
+
+  clutter_event_free (event);
+
+  return (gdouble) (end - start) / n_events;
+}
+
+static gboolean
+on_captured_event (ClutterActor *stage,
+                   ClutterEvent *event,
+                   gpointer      data)
+{
+  if (clutter_event_type (event) != CLUTTER_MOTION || delivery_start == 0)
+    return CLUTTER_EVENT_PROPAGATE;
+
+  n_delivered++;
+
+  if (n_delivered == n_events)
+    {
+      gint64 end = g_get_monotonic_time ();
+
+      printf ("delivery:  %8.2f us per event\n",
+              (gdouble) (end - delivery_start) / n_events);
+
+      clutter_main_quit ();
+    }
+
+  return CLUTTER_EVENT_PROPAGATE;
+}
+
+static gboolean
+run_benchmark (gpointer data)
+{
+  ClutterStage *stage = data;
+  gint i;
+
+  /* warm up any lazily created state */
+  run_new_free (stage);
+
+  printf ("new/free:  %8.2f us per event\n", run_new_free (stage));
+  printf ("copy/free: %8.2f us per event\n", run_copy_free (stage));
+
+  delivery_start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_events; i++)
+    {
+      ClutterEvent *event = create_motion_event (stage, i);
+
+      clutter_event_put (event);
+      clutter_event_free (event);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_after_paint (ClutterStage *stage,
+                gpointer      data)
+{
+  g_signal_handlers_disconnect_by_func (stage, on_after_paint, data);
+
+  clutter_threads_add_idle (run_benchmark, stage);
+}
+
+int
+main (int argc, char **argv)
+{
+  ClutterActor *stage;
+  GError *error = NULL;
+
+  g_setenv ("CLUTTER_VBLANK", "none", FALSE);
+
+  if (clutter_init_with_args (&argc, &argv,
+                              NULL,
+                              entries,
+                              NULL,
+                              &error) != CLUTTER_INIT_SUCCESS)
+    return 1;
+
+  if (n_events <= 0)
+    return 1;
+
+  stage = clutter_stage_new ();
+  clutter_actor_set_size (stage, 512, 512);
+  clutter_stage_set_color (CLUTTER_STAGE (stage), CLUTTER_COLOR_Black);
+  clutter_stage_set_title (CLUTTER_STAGE (stage), "Event latency");
+  clutter_stage_set_throttle_motion_events (CLUTTER_STAGE (stage), FALSE);
+
+  printf ("Event latency test with %d events per measurement\n", n_events);
+
+  g_signal_connect (stage, "captured-event",
+                    G_CALLBACK (on_captured_event), NULL);
+  g_signal_connect (stage, "after-paint", G_CALLBACK (on_after_paint), NULL);
+
+  clutter_actor_show (stage);
+
+  clutter_main ();
+
+  clutter_actor_destroy (stage);
+
+  return 0;
+}
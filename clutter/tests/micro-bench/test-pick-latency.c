@@ -0,0 +1,154 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <clutter/clutter.h>
+
+/* Measures the latency of clutter_stage_get_actor_at_pos() on a scene of
+ * reactive actors, some of them rotated and clipped. Two cases are timed:
+ *
+ *  - "static scene": repeated picks while nothing changes, like pointer
+ *    motion over an idle desktop;
+ *  - "changing scene": a redraw is queued before every pick, so whatever
+ *    was computed for the previous pick cannot be reused.
+ *
+ * Only public API is used, so the same program can be built against
+ * different revisions to compare pick latency before and after a change.
+ */
+
+#define N_ACTORS 100
+#define N_PICKS 1000
+
+static gint n_actors = N_ACTORS;
+static gint n_picks = N_PICKS;
+
+static GOptionEntry entries[] = {
+  {
+    "num-actors", 'a',
+    0,
+    G_OPTION_ARG_INT, &n_actors,
+    "Number of actors", "ACTORS"
+  },
+  {
+    "num-picks", 'p',
+    0,
+    G_OPTION_ARG_INT, &n_picks,
+    "Number of picks per measurement", "PICKS"
+  },
+  { NULL }
+};
+
+static gdouble
+run_picks (ClutterStage *stage,
+           gboolean      queue_redraw)
+{
+  gint64 start, end;
+  gint i;
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_picks; i++)
+    {
+      gdouble angle = ((2.0 * G_PI) / (gdouble) n_picks) * i;
+
+      if (queue_redraw)
+        clutter_actor_queue_redraw (CLUTTER_ACTOR (stage));
+
+      clutter_stage_get_actor_at_pos (stage,
+                                      CLUTTER_PICK_REACTIVE,
+                                      256.0 + 206.0 * cos (angle),
+                                      256.0 + 206.0 * sin (angle));
+    }
+
+  end = g_get_monotonic_time ();
+
+  return (gdouble) (end - start) / n_picks;
+}
+
+static gboolean
+run_benchmark (gpointer data)
+{
+  ClutterStage *stage = data;
+
+  /* warm up any lazily created state */
+  run_picks (stage, FALSE);
+
+  printf ("static scene:   %8.2f us per pick\n", run_picks (stage, FALSE));
+  printf ("changing scene: %8.2f us per pick\n", run_picks (stage, TRUE));
+
+  clutter_main_quit ();
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_after_paint (ClutterStage *stage,
+                gpointer      data)
+{
+  g_signal_handlers_disconnect_by_func (stage, on_after_paint, data);
+
+  clutter_threads_add_idle (run_benchmark, stage);
+}
+
+int
+main (int argc, char **argv)
+{
+  ClutterActor *stage;
+  GError *error = NULL;
+  gint i;
+
+  g_setenv ("CLUTTER_VBLANK", "none", FALSE);
+
+  if (clutter_init_with_args (&argc, &argv,
+                              NULL,
+                              entries,
+                              NULL,
+                              &error) != CLUTTER_INIT_SUCCESS)
+    return 1;
+
+  stage = clutter_stage_new ();
+  clutter_actor_set_size (stage, 512, 512);
+  clutter_stage_set_color (CLUTTER_STAGE (stage), CLUTTER_COLOR_Black);
+  clutter_stage_set_title (CLUTTER_STAGE (stage), "Pick latency");
+
+  printf ("Pick latency test with %d actors and %d picks per measurement\n",
+          n_actors,
+          n_picks);
+
+  for (i = 0; i < n_actors; i++)
+    {
+      gdouble angle = ((2.0 * G_PI) / (gdouble) n_actors) * i;
+      ClutterColor color = { 0x00, 0x00, 0x00, 0xff };
+      ClutterActor *rect;
+
+      color.red = 0xff * i / n_actors;
+      color.green = 0xff - color.red;
+      color.blue = 0x80;
+
+      rect = clutter_actor_new ();
+      clutter_actor_set_background_color (rect, &color);
+      clutter_actor_set_size (rect, 100, 100);
+      clutter_actor_set_pivot_point (rect, 0.5f, 0.5f);
+      clutter_actor_set_position (rect,
+                                  206 + 206 * cos (angle),
+                                  206 + 206 * sin (angle));
+      clutter_actor_set_reactive (rect, TRUE);
+
+      /* exercise the unaligned and clipped paths as well */
+      if (i % 3 == 0)
+        clutter_actor_set_rotation_angle (rect, CLUTTER_Z_AXIS, 30.0);
+      if (i % 5 == 0)
+        clutter_actor_set_clip (rect, 10, 10, 80, 80);
+
+      clutter_actor_add_child (stage, rect);
+    }
+
+  g_signal_connect (stage, "after-paint", G_CALLBACK (on_after_paint), NULL);
+
+  clutter_actor_show (stage);
+
+  clutter_main ();
+
+  clutter_actor_destroy (stage);
+
+  return 0;
+}
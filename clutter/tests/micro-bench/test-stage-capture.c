@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <clutter/clutter.h>
+
+/* Measures how long capturing the stage keeps the main loop from getting on
+ * with the next frame. Three runs of redrawn frames are timed:
+ *
+ *  - "none": the stage is painted without any capture, as a baseline;
+ *  - "async": each frame is captured with clutter_stage_capture_async();
+ *    the time from the start of the stage paint to "after-paint" includes
+ *    queueing the readback, but should not include waiting for the GPU;
+ *  - "sync": each frame is read back with clutter_stage_capture() from the
+ *    "after-paint" handler, which waits for the GPU to finish the frame and
+ *    the copy.
+ *
+ * If the asynchronous capture blocks, its per frame time ends up close to
+ * the synchronous one rather than to the baseline.
+ */
+
+#define N_FRAMES 200
+
+typedef enum
+{
+  CAPTURE_MODE_NONE,
+  CAPTURE_MODE_ASYNC,
+  CAPTURE_MODE_SYNC,
+
+  N_CAPTURE_MODES
+} CaptureMode;
+
+static const char *capture_mode_names[] = {
+  "none",
+  "async",
+  "sync",
+};
+
+static gint n_frames = N_FRAMES;
+
+static GOptionEntry entries[] = {
+  {
+    "num-frames", 'f',
+    0,
+    G_OPTION_ARG_INT, &n_frames,
+    "Number of frames per measurement", "FRAMES"
+  },
+  { NULL }
+};
+
+static CaptureMode capture_mode = CAPTURE_MODE_NONE;
+static gint frame = 0;
+static gint n_captured = 0;
+static gint64 paint_start = 0;
+static gint64 frame_time = 0;
+static ClutterActor *rotating_actor;
+
+static void
+free_captures (ClutterCapture *captures,
+               int             n_captures)
+{
+  int i;
+
+  for (i = 0; i < n_captures; i++)
+    cairo_surface_destroy (captures[i].image);
+
+  g_free (captures);
+}
+
+static void
+on_captured (ClutterStage   *stage,
+             ClutterCapture *captures,
+             int             n_captures,
+             gpointer        data)
+{
+  if (capture_mode == CAPTURE_MODE_ASYNC && captures)
+    n_captured++;
+
+  free_captures (captures, n_captures);
+}
+
+static void
+queue_frame (ClutterStage *stage)
+{
+  cairo_rectangle_int_t rect = { 0, 0, 512, 512 };
+
+  clutter_actor_set_rotation_angle (rotating_actor, CLUTTER_Z_AXIS,
+                                    frame % 360);
+
+  if (capture_mode == CAPTURE_MODE_ASYNC)
+    clutter_stage_capture_async (stage, &rect, on_captured, NULL);
+}
+
+static void
+on_paint (ClutterActor *stage,
+          gpointer      data)
+{
+  paint_start = g_get_monotonic_time ();
+}
+
+static void
+on_after_paint (ClutterStage *stage,
+                gpointer      data)
+{
+  if (capture_mode == CAPTURE_MODE_SYNC)
+    {
+      cairo_rectangle_int_t rect = { 0, 0, 512, 512 };
+      ClutterCapture *captures;
+      int n_captures;
+
+      if (clutter_stage_capture (stage, FALSE, &rect,
+                                 &captures, &n_captures))
+        {
+          n_captured++;
+          free_captures (captures, n_captures);
+        }
+    }
+
+  frame_time += g_get_monotonic_time () - paint_start;
+  frame++;
+
+  if (frame == n_frames)
+    {
+      printf ("%-6s %8.2f us per frame, %d frames captured\n",
+              capture_mode_names[capture_mode],
+              (gdouble) frame_time / n_frames,
+              n_captured);
+
+      capture_mode++;
+      frame = 0;
+      frame_time = 0;
+      n_captured = 0;
+
+      if (capture_mode == N_CAPTURE_MODES)
+        {
+          clutter_main_quit ();
+          return;
+        }
+    }
+
+  queue_frame (stage);
+}
+
+int
+main (int argc, char **argv)
+{
+  ClutterActor *stage;
+  GError *error = NULL;
+
+  g_setenv ("CLUTTER_VBLANK", "none", FALSE);
+
+  if (clutter_init_with_args (&argc, &argv,
+                              NULL,
+                              entries,
+                              NULL,
+                              &error) != CLUTTER_INIT_SUCCESS)
+    return 1;
+
+  if (n_frames <= 0)
+    return 1;
+
+  stage = clutter_stage_new ();
+  clutter_actor_set_size (stage, 512, 512);
+  clutter_stage_set_color (CLUTTER_STAGE (stage), CLUTTER_COLOR_Black);
+  clutter_stage_set_title (CLUTTER_STAGE (stage), "Stage capture");
+
+  rotating_actor = clutter_actor_new ();
+  clutter_actor_set_background_color (rotating_actor, CLUTTER_COLOR_Red);
+  clutter_actor_set_size (rotating_actor, 256, 256);
+  clutter_actor_set_position (rotating_actor, 128, 128);
+  clutter_actor_set_pivot_point (rotating_actor, 0.5, 0.5);
+  clutter_actor_add_child (stage, rotating_actor);
+
+  printf ("Stage capture test with %d frames per measurement\n", n_frames);
+
+  g_signal_connect (stage, "paint", G_CALLBACK (on_paint), NULL);
+  g_signal_connect (stage, "after-paint", G_CALLBACK (on_after_paint), NULL);
+
+  clutter_actor_show (stage);
+
+  clutter_main ();
+
+  clutter_actor_destroy (stage);
+
+  return 0;
+}
@@ -41,6 +41,7 @@
 #include "cogl-object-private.h"
 #include "cogl-util.h"
 #include "cogl-texture-private.h"
+#include "cogl-texture-2d-private.h"
 #include "cogl-framebuffer-private.h"
 #include "cogl-onscreen-template-private.h"
 #include "cogl-clip-stack.h"
@@ -250,6 +251,17 @@ void
 _cogl_framebuffer_mark_mid_scene (CoglFramebuffer *framebuffer)
 {
   framebuffer->mid_scene = TRUE;
+
+  /* Rendering to the base level of a texture invalidates any mipmaps
+   * that were generated for it, so make sure they get regenerated the
+   * next time the texture is painted with a mipmap filter. */
+  if (framebuffer->type == COGL_FRAMEBUFFER_TYPE_OFFSCREEN)
+    {
+      CoglOffscreen *offscreen = COGL_OFFSCREEN (framebuffer);
+
+      if (offscreen->texture_level == 0)
+        _cogl_texture_2d_externally_modified (offscreen->texture);
+    }
 }
 
 void
@@ -1509,6 +1521,109 @@ cogl_framebuffer_finish (CoglFramebuffer *framebuffer)
   ctx->driver_vtable->framebuffer_finish (framebuffer);
 }
 
+void
+cogl_framebuffer_flush (CoglFramebuffer *framebuffer)
+{
+  CoglContext *ctx = framebuffer->context;
+
+  _cogl_framebuffer_flush_journal (framebuffer);
+
+  ctx->driver_vtable->framebuffer_flush (framebuffer);
+}
+
+CoglBool
+cogl_blit_framebuffer (CoglFramebuffer *src,
+                       CoglFramebuffer *dst,
+                       int src_x,
+                       int src_y,
+                       int dst_x,
+                       int dst_y,
+                       int width,
+                       int height,
+                       CoglError **error)
+{
+  CoglContext *ctx = src->context;
+  int src_x1, src_y1, src_x2, src_y2;
+  int dst_x1, dst_y1, dst_x2, dst_y2;
+
+  if (!_cogl_has_private_feature (ctx, COGL_PRIVATE_FEATURE_OFFSCREEN_BLIT))
+    {
+      _cogl_set_error (error, COGL_SYSTEM_ERROR,
+                       COGL_SYSTEM_ERROR_UNSUPPORTED,
+                       "Cogl BLIT_FRAMEBUFFER is not supported by the system.");
+      return FALSE;
+    }
+
+  /* The GLES2 extension can't mirror a blit, and onscreen framebuffers are
+   * upside down compared to offscreen ones, so only offscreens are supported
+   * there. */
+  if ((!cogl_is_offscreen (src) || !cogl_is_offscreen (dst)) &&
+      _cogl_has_private_feature (ctx, COGL_PRIVATE_FEATURE_GL_EMBEDDED))
+    {
+      _cogl_set_error (error, COGL_SYSTEM_ERROR,
+                       COGL_SYSTEM_ERROR_UNSUPPORTED,
+                       "Blitting from or to an onscreen framebuffer is not "
+                       "supported by the system.");
+      return FALSE;
+    }
+
+  /* Offscreens are used as is, onscreens need to be flipped so that
+   * (0, 0) is the top left of both. */
+  src_x1 = src_x;
+  src_x2 = src_x + width;
+  if (cogl_is_offscreen (src))
+    {
+      src_y1 = src_y;
+      src_y2 = src_y + height;
+    }
+  else
+    {
+      src_y1 = cogl_framebuffer_get_height (src) - src_y;
+      src_y2 = src_y1 - height;
+    }
+
+  dst_x1 = dst_x;
+  dst_x2 = dst_x + width;
+  if (cogl_is_offscreen (dst))
+    {
+      dst_y1 = dst_y;
+      dst_y2 = dst_y + height;
+    }
+  else
+    {
+      dst_y1 = cogl_framebuffer_get_height (dst) - dst_y;
+      dst_y2 = dst_y1 - height;
+    }
+
+  /* Make sure any batched primitives get submitted to the driver before
+   * blitting */
+  _cogl_framebuffer_flush_journal (src);
+
+  /* Make sure the current framebuffers are bound. We explicitly avoid
+     flushing the clip state so we can bind our own empty state */
+  _cogl_framebuffer_flush_state (dst,
+                                 src,
+                                 COGL_FRAMEBUFFER_STATE_ALL &
+                                 ~COGL_FRAMEBUFFER_STATE_CLIP);
+
+  /* Flush any empty clip stack because glBlitFramebuffer is affected
+   * by the scissor */
+  _cogl_clip_stack_flush (NULL, dst);
+
+  /* As in _cogl_blit_framebuffer(), the clip state of the current
+   * framebuffer needs to be flushed again next time */
+  ctx->current_draw_buffer_changes |= COGL_FRAMEBUFFER_STATE_CLIP;
+
+  ctx->glBlitFramebuffer (src_x1, src_y1,
+                          src_x2, src_y2,
+                          dst_x1, dst_y1,
+                          dst_x2, dst_y2,
+                          GL_COLOR_BUFFER_BIT,
+                          GL_NEAREST);
+
+  return TRUE;
+}
+
 void
 cogl_framebuffer_push_matrix (CoglFramebuffer *framebuffer)
 {
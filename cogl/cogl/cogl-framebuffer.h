@@ -1723,6 +1723,61 @@ cogl_framebuffer_discard_buffers (CoglFramebuffer *framebuffer,
 void
 cogl_framebuffer_finish (CoglFramebuffer *framebuffer);
 
+/**
+ * cogl_framebuffer_flush:
+ * @framebuffer: A #CoglFramebuffer pointer
+ *
+ * Flushes @framebuffer to ensure the current batch of commands is
+ * submitted to the GPU.
+ *
+ * Unlike cogl_framebuffer_finish(), this does not block the CPU. It is
+ * useful when the results of the rendering are consumed by another
+ * process or device which synchronizes with the GPU implicitly, for
+ * example when rendering into a shared dma-buf.
+ *
+ * Stability: unstable
+ */
+void
+cogl_framebuffer_flush (CoglFramebuffer *framebuffer);
+
+/**
+ * cogl_blit_framebuffer:
+ * @src: The source #CoglFramebuffer
+ * @dst: The destination #CoglFramebuffer
+ * @src_x: Source x position
+ * @src_y: Source y position
+ * @dst_x: Destination x position
+ * @dst_y: Destination y position
+ * @width: Width of region to copy
+ * @height: Height of region to copy
+ * @error: optional error object
+ *
+ * Copies a region of the color buffer of @src to @dst on the GPU, without
+ * any scaling. For both framebuffers (0, 0) is the top left, whether they
+ * are onscreen or offscreen.
+ *
+ * This requires the GL_EXT_framebuffer_blit extension or GL 3.0. Blitting
+ * from or to an onscreen framebuffer isn't supported with GLES2, as the
+ * extension there can't mirror the image.
+ *
+ * The source and destination must be of compatible formats, but they may
+ * differ in their color channel order. The blit is not affected by the clip
+ * state of either framebuffer.
+ *
+ * Return value: %TRUE if the blit was issued, %FALSE otherwise
+ * Stability: unstable
+ */
+CoglBool
+cogl_blit_framebuffer (CoglFramebuffer *src,
+                       CoglFramebuffer *dst,
+                       int src_x,
+                       int src_y,
+                       int dst_x,
+                       int dst_y,
+                       int width,
+                       int height,
+                       CoglError **error);
+
 /**
  * cogl_framebuffer_read_pixels_into_bitmap:
  * @framebuffer: A #CoglFramebuffer
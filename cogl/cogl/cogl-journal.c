@@ -41,6 +41,7 @@
 #include "cogl-vertex-buffer-private.h"
 #include "cogl-framebuffer-private.h"
 #include "cogl-profile.h"
+#include "cogl-trace.h"
 #include "cogl-attribute-private.h"
 #include "cogl-point-in-poly-private.h"
 #include "cogl-private.h"
@@ -1310,6 +1311,7 @@ _cogl_journal_flush (CoglJournal *journal)
                      "flush: discard",
                      "The time spent discarding the Cogl journal after a flush",
                      0 /* no application private data */);
+  COGL_TRACE_BEGIN (CoglJournalFlush, "Journal flush");
 
   if (journal->entries->len == 0)
     {
@@ -1416,6 +1418,8 @@ _cogl_journal_flush (CoglJournal *journal)
   post_fences (journal);
 
   COGL_TIMER_STOP (_cogl_uprof_context, flush_timer);
+
+  COGL_TRACE_END (CoglJournalFlush);
 }
 
 static CoglBool
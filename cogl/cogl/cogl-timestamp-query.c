@@ -0,0 +1,127 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "cogl-config.h"
+#endif
+
+
+#include "cogl-timestamp-query.h"
+#include "cogl-context-private.h"
+#include "cogl-framebuffer-private.h"
+
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+struct _CoglTimestampQuery
+{
+  CoglContext *context;
+  GLuint id;
+  /* CPU monotonic time minus GPU time, in nanoseconds */
+  int64_t clock_offset;
+};
+
+CoglTimestampQuery *
+cogl_framebuffer_create_timestamp_query (CoglFramebuffer *framebuffer)
+{
+#ifdef GL_ARB_timer_query
+  CoglContext *ctx = framebuffer->context;
+  CoglTimestampQuery *query;
+  GLint64 gpu_time;
+
+  if (ctx->glQueryCounter == NULL)
+    return NULL;
+
+  /* Make sure the query comes after everything drawn so far and that
+   * the framebuffer's context is current */
+  _cogl_framebuffer_flush_journal (framebuffer);
+  _cogl_framebuffer_flush_state (framebuffer, framebuffer,
+                                 COGL_FRAMEBUFFER_STATE_BIND);
+
+  query = g_slice_new (CoglTimestampQuery);
+  query->context = ctx;
+
+  ctx->glGenQueries (1, &query->id);
+  ctx->glGetInteger64v (GL_TIMESTAMP, &gpu_time);
+  query->clock_offset = g_get_monotonic_time () * 1000 - gpu_time;
+  ctx->glQueryCounter (query->id, GL_TIMESTAMP);
+
+  return query;
+#else
+  return NULL;
+#endif
+}
+
+CoglBool
+cogl_timestamp_query_is_ready (CoglTimestampQuery *query)
+{
+#ifdef GL_ARB_timer_query
+  GLint available = 0;
+
+  query->context->glGetQueryObjectiv (query->id,
+                                      GL_QUERY_RESULT_AVAILABLE,
+                                      &available);
+
+  return available;
+#else
+  return TRUE;
+#endif
+}
+
+int64_t
+cogl_timestamp_query_get_time (CoglTimestampQuery *query)
+{
+#ifdef GL_ARB_timer_query
+  GLuint64 gpu_time;
+
+  query->context->glGetQueryObjectui64v (query->id, GL_QUERY_RESULT,
+                                         &gpu_time);
+
+  return ((int64_t) gpu_time + query->clock_offset) / 1000;
+#else
+  return 0;
+#endif
+}
+
+void
+cogl_timestamp_query_free (CoglTimestampQuery *query)
+{
+#ifdef GL_ARB_timer_query
+  query->context->glDeleteQueries (1, &query->id);
+#endif
+  g_slice_free (CoglTimestampQuery, query);
+}
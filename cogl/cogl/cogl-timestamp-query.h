@@ -0,0 +1,108 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ */
+
+#if !defined(__COGL_H_INSIDE__) && !defined(COGL_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_TIMESTAMP_QUERY_H__
+#define __COGL_TIMESTAMP_QUERY_H__
+
+#include <cogl/cogl-types.h>
+#include <cogl/cogl-framebuffer.h>
+
+COGL_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-timestamp-query
+ * @short_description: Functions for finding out when the GPU reached a
+ *   point in the command stream
+ *
+ * A timestamp query records the time at which the GPU has executed
+ * all of the drawing submitted before it. The time is reported in
+ * the same clock as g_get_monotonic_time(), so it can be compared
+ * with CPU side timings.
+ */
+
+/**
+ * CoglTimestampQuery:
+ *
+ * An opaque object representing a pending timestamp query.
+ */
+typedef struct _CoglTimestampQuery CoglTimestampQuery;
+
+/**
+ * cogl_framebuffer_create_timestamp_query:
+ * @framebuffer: A #CoglFramebuffer
+ *
+ * Flushes the drawing done to @framebuffer so far and inserts a
+ * timestamp query after it. This needs GL timer query support.
+ *
+ * Return value: a new #CoglTimestampQuery, or %NULL if timestamp
+ *   queries are not supported by the driver.
+ */
+CoglTimestampQuery *
+cogl_framebuffer_create_timestamp_query (CoglFramebuffer *framebuffer);
+
+/**
+ * cogl_timestamp_query_is_ready:
+ * @query: A #CoglTimestampQuery
+ *
+ * Return value: %TRUE if the GPU has reached @query, in which case
+ *   cogl_timestamp_query_get_time() won't block.
+ */
+CoglBool
+cogl_timestamp_query_is_ready (CoglTimestampQuery *query);
+
+/**
+ * cogl_timestamp_query_get_time:
+ * @query: A #CoglTimestampQuery
+ *
+ * Retrieves the time at which the GPU reached @query, waiting for it
+ * if necessary.
+ *
+ * Return value: the time in microseconds, in the g_get_monotonic_time()
+ *   time base.
+ */
+int64_t
+cogl_timestamp_query_get_time (CoglTimestampQuery *query);
+
+/**
+ * cogl_timestamp_query_free:
+ * @query: A #CoglTimestampQuery
+ *
+ * Frees @query, whether or not the GPU has reached it.
+ */
+void
+cogl_timestamp_query_free (CoglTimestampQuery *query);
+
+COGL_END_DECLS
+
+#endif /* __COGL_TIMESTAMP_QUERY_H__ */
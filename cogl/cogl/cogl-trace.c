@@ -0,0 +1,374 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "cogl-config.h"
+#endif
+
+#include <unistd.h>
+
+#include "cogl-trace.h"
+#include "cogl-timestamp-query.h"
+#include "cogl-error-private.h"
+
+/* GPU spans are reported as if they ran on a thread of their own */
+#define GPU_THREAD_ID 0
+
+typedef enum
+{
+  TRACE_EVENT_SPAN,
+  TRACE_EVENT_MARK
+} TraceEventType;
+
+typedef struct
+{
+  const char *name;
+  int64_t time;
+  int64_t duration;
+  unsigned int thread_id;
+  TraceEventType type;
+} TraceEvent;
+
+struct _CoglTraceGpuSpan
+{
+  const char *name;
+  CoglTimestampQuery *begin_query;
+  CoglTimestampQuery *end_query;
+};
+
+volatile int cogl_trace_running = 0;
+
+static GMutex trace_mutex;
+static TraceEvent *trace_events;
+static unsigned int trace_max_events;
+static unsigned int trace_n_events;
+static unsigned int trace_next_event;
+static GList *pending_gpu_spans;
+
+static int trace_next_thread_id = GPU_THREAD_ID + 1;
+static GPrivate trace_thread_id;
+
+static unsigned int
+get_thread_id (void)
+{
+  unsigned int id = GPOINTER_TO_UINT (g_private_get (&trace_thread_id));
+
+  if (id == 0)
+    {
+      id = g_atomic_int_add (&trace_next_thread_id, 1);
+      g_private_set (&trace_thread_id, GUINT_TO_POINTER (id));
+    }
+
+  return id;
+}
+
+static void
+add_event_locked (TraceEventType type,
+                  const char    *name,
+                  int64_t        time,
+                  int64_t        duration,
+                  unsigned int   thread_id)
+{
+  TraceEvent *event;
+
+  if (!trace_events)
+    return;
+
+  event = &trace_events[trace_next_event];
+  event->type = type;
+  event->name = name;
+  event->time = time;
+  event->duration = duration;
+  event->thread_id = thread_id;
+
+  trace_next_event = (trace_next_event + 1) % trace_max_events;
+  if (trace_n_events < trace_max_events)
+    trace_n_events++;
+}
+
+static void
+add_event (TraceEventType type,
+           const char    *name,
+           int64_t        time,
+           int64_t        duration)
+{
+  unsigned int thread_id = get_thread_id ();
+
+  g_mutex_lock (&trace_mutex);
+  if (cogl_trace_running)
+    add_event_locked (type, name, time, duration, thread_id);
+  g_mutex_unlock (&trace_mutex);
+}
+
+void
+cogl_trace_add_span (const char *name,
+                     int64_t     begin_time,
+                     int64_t     end_time)
+{
+  if (!cogl_trace_running)
+    return;
+
+  add_event (TRACE_EVENT_SPAN, name, begin_time, end_time - begin_time);
+}
+
+void
+cogl_trace_add_mark (const char *name,
+                     int64_t     time)
+{
+  if (!cogl_trace_running)
+    return;
+
+  add_event (TRACE_EVENT_MARK, name, time, 0);
+}
+
+static void
+gpu_span_free (CoglTraceGpuSpan *span)
+{
+  cogl_timestamp_query_free (span->begin_query);
+  if (span->end_query)
+    cogl_timestamp_query_free (span->end_query);
+  g_slice_free (CoglTraceGpuSpan, span);
+}
+
+/* Moves the GPU spans whose timestamp queries have landed into the
+ * ring buffer. If @wait is set, this blocks until all of them have. */
+static void
+process_pending_gpu_spans (CoglBool wait)
+{
+  GList *l = pending_gpu_spans;
+
+  while (l)
+    {
+      CoglTraceGpuSpan *span = l->data;
+      GList *next = l->next;
+      int64_t begin_time, end_time;
+
+      if (!wait && !cogl_timestamp_query_is_ready (span->end_query))
+        break;
+
+      begin_time = cogl_timestamp_query_get_time (span->begin_query);
+      end_time = cogl_timestamp_query_get_time (span->end_query);
+
+      g_mutex_lock (&trace_mutex);
+      add_event_locked (TRACE_EVENT_SPAN,
+                        span->name,
+                        begin_time,
+                        end_time - begin_time,
+                        GPU_THREAD_ID);
+      g_mutex_unlock (&trace_mutex);
+
+      pending_gpu_spans = g_list_delete_link (pending_gpu_spans, l);
+      gpu_span_free (span);
+
+      l = next;
+    }
+}
+
+CoglTraceGpuSpan *
+cogl_trace_gpu_span_begin (CoglFramebuffer *framebuffer,
+                           const char      *name)
+{
+  CoglTimestampQuery *begin_query;
+  CoglTraceGpuSpan *span;
+
+  if (G_LIKELY (!cogl_trace_running))
+    return NULL;
+
+  /* Creating the query flushes the drawing done so far, so the span
+   * only covers what gets drawn from now on */
+  begin_query = cogl_framebuffer_create_timestamp_query (framebuffer);
+  if (!begin_query)
+    return NULL;
+
+  /* Spans are queued in the order they were started, so only the
+   * oldest ones need checking */
+  process_pending_gpu_spans (FALSE);
+
+  span = g_slice_new0 (CoglTraceGpuSpan);
+  span->name = name;
+  span->begin_query = begin_query;
+
+  return span;
+}
+
+void
+cogl_trace_gpu_span_end (CoglFramebuffer  *framebuffer,
+                         CoglTraceGpuSpan *span)
+{
+  if (span == NULL)
+    return;
+
+  span->end_query = cogl_framebuffer_create_timestamp_query (framebuffer);
+
+  pending_gpu_spans = g_list_append (pending_gpu_spans, span);
+}
+
+void
+cogl_trace_start (unsigned int max_events)
+{
+  g_return_if_fail (max_events > 0);
+
+  g_mutex_lock (&trace_mutex);
+
+  g_free (trace_events);
+  trace_events = g_new0 (TraceEvent, max_events);
+  trace_max_events = max_events;
+  trace_n_events = 0;
+  trace_next_event = 0;
+
+  cogl_trace_running = TRUE;
+
+  g_mutex_unlock (&trace_mutex);
+}
+
+void
+cogl_trace_stop (void)
+{
+  if (!cogl_trace_running)
+    return;
+
+  /* The spans still in flight belong to the trace; stopping is rare
+   * enough that waiting for the GPU to catch up is fine. */
+  process_pending_gpu_spans (TRUE);
+
+  g_mutex_lock (&trace_mutex);
+  cogl_trace_running = FALSE;
+  g_mutex_unlock (&trace_mutex);
+}
+
+static void
+append_json_string (GString    *string,
+                    const char *str)
+{
+  const char *p;
+
+  g_string_append_c (string, '"');
+  for (p = str; *p; p++)
+    {
+      if (*p == '"' || *p == '\\')
+        g_string_append_c (string, '\\');
+
+      if ((unsigned char) *p < 0x20)
+        g_string_append_printf (string, "\\u%04x", *p);
+      else
+        g_string_append_c (string, *p);
+    }
+  g_string_append_c (string, '"');
+}
+
+static void
+append_thread_name (GString     *string,
+                    int          pid,
+                    unsigned int thread_id,
+                    const char  *name)
+{
+  g_string_append_printf (string,
+                          "{\"ph\":\"M\",\"name\":\"thread_name\","
+                          "\"pid\":%d,\"tid\":%u,\"args\":{\"name\":",
+                          pid, thread_id);
+  append_json_string (string, name);
+  g_string_append (string, "}},\n");
+}
+
+static GString *
+dump_json (void)
+{
+  GString *string;
+  unsigned int first_event, n_events, i;
+  int pid = getpid ();
+
+  string = g_string_new ("{\"traceEvents\":[\n");
+
+  append_thread_name (string, pid, GPU_THREAD_ID, "GPU");
+
+  g_mutex_lock (&trace_mutex);
+
+  n_events = trace_n_events;
+  first_event = (trace_next_event + trace_max_events - trace_n_events) %
+                MAX (trace_max_events, 1);
+
+  for (i = 0; i < n_events; i++)
+    {
+      TraceEvent *event = &trace_events[(first_event + i) % trace_max_events];
+
+      g_string_append (string, "{\"name\":");
+      append_json_string (string, event->name);
+
+      switch (event->type)
+        {
+        case TRACE_EVENT_SPAN:
+          g_string_append_printf (string,
+                                  ",\"ph\":\"X\",\"ts\":%" G_GINT64_FORMAT
+                                  ",\"dur\":%" G_GINT64_FORMAT,
+                                  event->time, event->duration);
+          break;
+        case TRACE_EVENT_MARK:
+          g_string_append_printf (string,
+                                  ",\"ph\":\"i\",\"s\":\"p\",\"ts\":%"
+                                  G_GINT64_FORMAT,
+                                  event->time);
+          break;
+        }
+
+      g_string_append_printf (string, ",\"pid\":%d,\"tid\":%u}%s\n",
+                              pid, event->thread_id,
+                              i + 1 < n_events ? "," : "");
+    }
+
+  g_mutex_unlock (&trace_mutex);
+
+  /* Drop the separator left after the metadata if there are no events */
+  if (n_events == 0)
+    g_string_truncate (string, string->len - 2);
+
+  g_string_append (string, "]}\n");
+
+  return string;
+}
+
+CoglBool
+cogl_trace_write_json (const char  *path,
+                       CoglError  **error)
+{
+  GString *string;
+  GError *glib_error = NULL;
+  CoglBool ret;
+
+  process_pending_gpu_spans (FALSE);
+
+  string = dump_json ();
+  ret = g_file_set_contents (path, string->str, string->len, &glib_error);
+  g_string_free (string, TRUE);
+
+  if (!ret)
+    _cogl_propagate_gerror (error, glib_error);
+
+  return ret;
+}
@@ -0,0 +1,202 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ */
+
+#if !defined(__COGL_H_INSIDE__) && !defined(COGL_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_TRACE_H__
+#define __COGL_TRACE_H__
+
+#include <glib.h>
+
+#include <cogl/cogl-types.h>
+#include <cogl/cogl-framebuffer.h>
+
+COGL_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-trace
+ * @short_description: Functions for recording where frame time goes
+ *
+ * Cogl can record timestamped spans of CPU and GPU work into a ring
+ * buffer, which can later be written out in the Chrome trace event
+ * format, as understood by chrome://tracing and Perfetto.
+ *
+ * Spans are usually recorded using the COGL_TRACE_BEGIN() and
+ * COGL_TRACE_END() macros, which only read a global flag while tracing
+ * is not running.
+ *
+ * Span names are not copied; they must be string literals or strings
+ * interned with g_intern_string().
+ */
+
+typedef struct _CoglTraceHead
+{
+  const char *name;
+  int64_t begin_time;
+} CoglTraceHead;
+
+/**
+ * CoglTraceGpuSpan:
+ *
+ * An opaque object tracking a span of GPU work, see
+ * cogl_trace_gpu_span_begin().
+ */
+typedef struct _CoglTraceGpuSpan CoglTraceGpuSpan;
+
+extern volatile int cogl_trace_running;
+
+/**
+ * cogl_trace_start:
+ * @max_events: the number of events to keep
+ *
+ * Starts recording trace events. Once @max_events events have been
+ * recorded, the oldest ones are overwritten. Any previously recorded
+ * events are discarded.
+ */
+void
+cogl_trace_start (unsigned int max_events);
+
+/**
+ * cogl_trace_stop:
+ *
+ * Stops recording trace events. The events recorded so far are kept
+ * until tracing is started again.
+ */
+void
+cogl_trace_stop (void);
+
+/**
+ * cogl_trace_add_span:
+ * @name: the name of the span
+ * @begin_time: the monotonic time the span started at, in microseconds
+ * @end_time: the monotonic time the span ended at, in microseconds
+ *
+ * Records a span of work done by the calling thread, if tracing is
+ * running.
+ */
+void
+cogl_trace_add_span (const char *name,
+                     int64_t     begin_time,
+                     int64_t     end_time);
+
+/**
+ * cogl_trace_add_mark:
+ * @name: the name of the mark
+ * @time: the monotonic time of the mark, in microseconds
+ *
+ * Records something happening at an instant, such as a page flip
+ * completing, if tracing is running.
+ */
+void
+cogl_trace_add_mark (const char *name,
+                     int64_t     time);
+
+/**
+ * cogl_trace_gpu_span_begin:
+ * @framebuffer: the #CoglFramebuffer being drawn to
+ * @name: the name of the span
+ *
+ * Starts measuring the GPU time taken by the drawing done to
+ * @framebuffer until cogl_trace_gpu_span_end() is called. This needs
+ * support for GL timer queries; the span is added to the trace once
+ * the GPU has finished the work and the queries are available.
+ *
+ * Return value: a span to pass to cogl_trace_gpu_span_end(), or %NULL
+ *   if tracing isn't running or GPU timings aren't available.
+ */
+CoglTraceGpuSpan *
+cogl_trace_gpu_span_begin (CoglFramebuffer *framebuffer,
+                           const char      *name);
+
+/**
+ * cogl_trace_gpu_span_end:
+ * @framebuffer: the #CoglFramebuffer being drawn to
+ * @span: (allow-none): a span returned by cogl_trace_gpu_span_begin()
+ *
+ * Ends measuring the GPU time of @span.
+ */
+void
+cogl_trace_gpu_span_end (CoglFramebuffer  *framebuffer,
+                         CoglTraceGpuSpan *span);
+
+/**
+ * cogl_trace_write_json:
+ * @path: the file to write to
+ * @error: return location for a #CoglError
+ *
+ * Writes the recorded events to @path in the Chrome trace event
+ * format.
+ *
+ * Return value: %TRUE on success
+ */
+CoglBool
+cogl_trace_write_json (const char  *path,
+                       CoglError  **error);
+
+static inline void
+cogl_trace_begin (CoglTraceHead *head,
+                  const char    *name)
+{
+  head->name = name;
+  head->begin_time = G_UNLIKELY (cogl_trace_running) ? g_get_monotonic_time () : 0;
+}
+
+static inline void
+cogl_trace_end (CoglTraceHead *head)
+{
+  if (G_UNLIKELY (head->begin_time != 0))
+    cogl_trace_add_span (head->name, head->begin_time, g_get_monotonic_time ());
+}
+
+static inline void
+cogl_auto_trace_end_helper (CoglTraceHead **head)
+{
+  if (*head)
+    cogl_trace_end (*head);
+}
+
+#define COGL_TRACE_BEGIN(Name, description) \
+  CoglTraceHead CoglTrace##Name; \
+  cogl_trace_begin (&CoglTrace##Name, description)
+
+#define COGL_TRACE_END(Name) \
+  cogl_trace_end (&CoglTrace##Name)
+
+#define COGL_TRACE_BEGIN_SCOPED(Name, description) \
+  CoglTraceHead CoglTrace##Name; \
+  __attribute__((cleanup (cogl_auto_trace_end_helper))) \
+    CoglTraceHead *ScopedCoglTrace##Name = &CoglTrace##Name; \
+  cogl_trace_begin (&CoglTrace##Name, description)
+
+COGL_END_DECLS
+
+#endif /* __COGL_TRACE_H__ */
@@ -869,13 +869,18 @@ typedef enum {
 /**
  * CoglReadPixelsFlags:
  * @COGL_READ_PIXELS_COLOR_BUFFER: Read from the color buffer
+ * @COGL_READ_PIXELS_NO_FLIP: Leave the rows in the order GL returns them,
+ *   i.e. bottom-up for onscreen framebuffers, instead of flipping them
+ *   after the read. This avoids mapping the destination bitmap, which for
+ *   a pixel buffer would wait for the read to complete.
  *
  * Flags for cogl_framebuffer_read_pixels_into_bitmap()
  *
  * Since: 1.0
  */
 typedef enum { /*< prefix=COGL_READ_PIXELS >*/
-  COGL_READ_PIXELS_COLOR_BUFFER = 1L << 0
+  COGL_READ_PIXELS_COLOR_BUFFER = 1L << 0,
+  COGL_READ_PIXELS_NO_FLIP = 1L << 30
 } CoglReadPixelsFlags;
 
 /**
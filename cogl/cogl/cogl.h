@@ -127,6 +127,8 @@
 #include <cogl/cogl-frame-info.h>
 #include <cogl/cogl-poll.h>
 #include <cogl/cogl-fence.h>
+#include <cogl/cogl-trace.h>
+#include <cogl/cogl-timestamp-query.h>
 #include <cogl/cogl-glib-source.h>
 /* XXX: This will definitly go away once all the Clutter winsys
  * code has been migrated down into Cogl! */
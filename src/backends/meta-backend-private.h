@@ -159,6 +159,7 @@ gboolean meta_backend_get_relative_motion_deltas (MetaBackend *backend,
 MetaPointerConstraint * meta_backend_get_client_pointer_constraint (MetaBackend *backend);
 void meta_backend_set_client_pointer_constraint (MetaBackend *backend,
                                                  MetaPointerConstraint *constraint);
+gboolean meta_backend_has_client_pointer_constraint (MetaBackend *backend);
 
 ClutterBackend * meta_backend_get_clutter_backend (MetaBackend *backend);
 
@@ -50,6 +50,7 @@
 #include "backends/meta-logical-monitor.h"
 #include "backends/meta-monitor-manager-dummy.h"
 #include "backends/meta-settings-private.h"
+#include "backends/meta-profiler.h"
 
 #define META_IDLE_MONITOR_CORE_DEVICE 0
 
@@ -91,6 +92,7 @@ struct _MetaBackendPrivate
   MetaRenderer *renderer;
   MetaEgl *egl;
   MetaSettings *settings;
+  MetaProfiler *profiler;
 #ifdef HAVE_REMOTE_DESKTOP
   MetaDbusSessionWatcher *dbus_session_watcher;
   MetaScreenCast *screen_cast;
@@ -109,6 +111,7 @@ struct _MetaBackendPrivate
   int current_device_id;
 
   MetaPointerConstraint *client_pointer_constraint;
+  int has_client_pointer_constraint;
   MetaDnd *dnd;
 };
 typedef struct _MetaBackendPrivate MetaBackendPrivate;
@@ -130,6 +133,7 @@ meta_backend_finalize (GObject *object)
   g_clear_object (&priv->monitor_manager);
   g_clear_object (&priv->orientation_manager);
   g_clear_object (&priv->input_settings);
+  g_clear_object (&priv->profiler);
 #ifdef HAVE_REMOTE_DESKTOP
   g_clear_object (&priv->remote_desktop);
   g_clear_object (&priv->screen_cast);
@@ -455,6 +459,8 @@ meta_backend_real_post_init (MetaBackend *backend)
 
   priv->input_settings = meta_backend_create_input_settings (backend);
 
+  priv->profiler = meta_profiler_new ();
+
 #ifdef HAVE_REMOTE_DESKTOP
   priv->dbus_session_watcher = g_object_new (META_TYPE_DBUS_SESSION_WATCHER, NULL);
   if (is_screen_cast_enabled (backend))
@@ -933,6 +939,20 @@ meta_backend_set_client_pointer_constraint (MetaBackend           *backend,
   g_clear_object (&priv->client_pointer_constraint);
   if (constraint)
     priv->client_pointer_constraint = g_object_ref (constraint);
+
+  g_atomic_int_set (&priv->has_client_pointer_constraint, constraint != NULL);
+}
+
+/*
+ * Unlike meta_backend_get_client_pointer_constraint(), this can be called
+ * from any thread.
+ */
+gboolean
+meta_backend_has_client_pointer_constraint (MetaBackend *backend)
+{
+  MetaBackendPrivate *priv = meta_backend_get_instance_private (backend);
+
+  return g_atomic_int_get (&priv->has_client_pointer_constraint);
 }
 
 /* Mutter is responsible for pulling events off the X queue, so Clutter
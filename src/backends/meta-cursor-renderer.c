@@ -272,6 +272,16 @@ meta_cursor_renderer_get_cursor (MetaCursorRenderer *renderer)
   return priv->displayed_cursor;
 }
 
+/* Whether the cursor is currently drawn as part of the stage, rather than
+ * on a plane handled by the backend. */
+gboolean
+meta_cursor_renderer_is_overlay_visible (MetaCursorRenderer *renderer)
+{
+  MetaCursorRendererPrivate *priv = meta_cursor_renderer_get_instance_private (renderer);
+
+  return priv->displayed_cursor && !priv->handled_by_backend;
+}
+
 #ifdef HAVE_WAYLAND
 void
 meta_cursor_renderer_realize_cursor_from_wl_buffer (MetaCursorRenderer *renderer,
@@ -205,6 +205,11 @@ struct _MetaMonitorManagerClass
                                      MetaMonitorsConfigMethod ,
                                      GError                 **);
 
+  gboolean (*verify_crtc_assignments) (MetaMonitorManager *,
+                                       MetaCrtcInfo      **,
+                                       unsigned int        ,
+                                       GError            **);
+
   void (*set_power_save_mode) (MetaMonitorManager *,
                                MetaPowerSave);
 
@@ -252,6 +257,10 @@ struct _MetaMonitorManagerClass
                                    int                *);
 
   MetaLogicalMonitorLayoutMode (*get_default_layout_mode) (MetaMonitorManager *);
+
+  void (*set_vrr_enabled) (MetaMonitorManager *,
+                           MetaMonitor        *,
+                           gboolean            );
 };
 
 MetaBackend *       meta_monitor_manager_get_backend (MetaMonitorManager *manager);
@@ -329,6 +338,14 @@ gboolean           meta_monitor_manager_is_transform_handled (MetaMonitorManager
                                                               MetaCrtc            *crtc,
                                                               MetaMonitorTransform transform);
 
+void               meta_monitor_manager_update_vrr (MetaMonitorManager *manager,
+                                                    MetaLogicalMonitor *fullscreen_logical_monitor);
+
+gboolean           meta_monitor_manager_verify_crtc_assignments (MetaMonitorManager *manager,
+                                                                 MetaCrtcInfo      **crtcs,
+                                                                 unsigned int        n_crtcs,
+                                                                 GError            **error);
+
 MetaMonitorsConfig * meta_monitor_manager_ensure_configured (MetaMonitorManager *manager);
 
 void               meta_monitor_manager_update_logical_state (MetaMonitorManager *manager,
@@ -1376,6 +1376,13 @@ meta_monitor_manager_handle_get_current_state (MetaDBusDisplayConfig *skeleton,
                                  g_variant_new_boolean (is_underscanning));
         }
 
+      if (meta_monitor_is_vrr_capable (monitor))
+        {
+          g_variant_builder_add (&monitor_properties_builder, "{sv}",
+                                 "is-vrr-capable",
+                                 g_variant_new_boolean (TRUE));
+        }
+
       is_builtin = meta_monitor_is_laptop_panel (monitor);
       g_variant_builder_add (&monitor_properties_builder, "{sv}",
                              "is-builtin",
@@ -2599,6 +2606,76 @@ meta_monitor_manager_is_transform_handled (MetaMonitorManager  *manager,
   return manager_class->is_transform_handled (manager, crtc, transform);
 }
 
+/*
+ * Lets the backend reject CRTC assignments the hardware can't drive, e.g.
+ * due to bandwidth or clock limits. Backends call this both when verifying
+ * and when applying a configuration, before anything is changed.
+ */
+gboolean
+meta_monitor_manager_verify_crtc_assignments (MetaMonitorManager *manager,
+                                              MetaCrtcInfo      **crtcs,
+                                              unsigned int        n_crtcs,
+                                              GError            **error)
+{
+  MetaMonitorManagerClass *manager_class =
+    META_MONITOR_MANAGER_GET_CLASS (manager);
+
+  if (!manager_class->verify_crtc_assignments)
+    return TRUE;
+
+  return manager_class->verify_crtc_assignments (manager, crtcs, n_crtcs,
+                                                 error);
+}
+
+static gboolean
+should_enable_vrr (MetaMonitorManager *manager,
+                   MetaMonitor        *monitor,
+                   MetaLogicalMonitor *fullscreen_logical_monitor)
+{
+  MetaMonitorManagerClass *manager_class =
+    META_MONITOR_MANAGER_GET_CLASS (manager);
+
+  if (!manager_class->set_vrr_enabled)
+    return FALSE;
+
+  if (!fullscreen_logical_monitor)
+    return FALSE;
+
+  if (!meta_monitor_is_active (monitor) ||
+      !meta_monitor_is_vrr_capable (monitor))
+    return FALSE;
+
+  return meta_monitor_get_logical_monitor (monitor) == fullscreen_logical_monitor;
+}
+
+/*
+ * Variable refresh rates are only enabled for the monitors showing a focused
+ * fullscreen window; with the rest of the desktop, frames can be presented at
+ * irregular intervals, which makes e.g. animations stutter and some panels
+ * flicker.
+ */
+void
+meta_monitor_manager_update_vrr (MetaMonitorManager *manager,
+                                 MetaLogicalMonitor *fullscreen_logical_monitor)
+{
+  MetaMonitorManagerClass *manager_class =
+    META_MONITOR_MANAGER_GET_CLASS (manager);
+  GList *l;
+
+  for (l = manager->monitors; l; l = l->next)
+    {
+      MetaMonitor *monitor = l->data;
+      gboolean enable;
+
+      enable = should_enable_vrr (manager, monitor, fullscreen_logical_monitor);
+      if (enable == meta_monitor_is_vrr_enabled (monitor))
+        continue;
+
+      meta_monitor_set_vrr_enabled (monitor, enable);
+      manager_class->set_vrr_enabled (manager, monitor, enable);
+    }
+}
+
 void
 meta_monitor_manager_read_current_state (MetaMonitorManager *manager)
 {
@@ -74,6 +74,8 @@ typedef struct _MetaMonitorPrivate
    * the primary one).
    */
   long winsys_id;
+
+  gboolean is_vrr_enabled;
 } MetaMonitorPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (MetaMonitor, meta_monitor, G_TYPE_OBJECT)
@@ -240,6 +242,40 @@ meta_monitor_is_underscanning (MetaMonitor *monitor)
   return output->is_underscanning;
 }
 
+gboolean
+meta_monitor_is_vrr_capable (MetaMonitor *monitor)
+{
+  MetaMonitorPrivate *priv = meta_monitor_get_instance_private (monitor);
+  GList *l;
+
+  for (l = priv->outputs; l; l = l->next)
+    {
+      MetaOutput *output = l->data;
+
+      if (!output->is_vrr_capable)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+gboolean
+meta_monitor_is_vrr_enabled (MetaMonitor *monitor)
+{
+  MetaMonitorPrivate *priv = meta_monitor_get_instance_private (monitor);
+
+  return priv->is_vrr_enabled;
+}
+
+void
+meta_monitor_set_vrr_enabled (MetaMonitor *monitor,
+                              gboolean     enabled)
+{
+  MetaMonitorPrivate *priv = meta_monitor_get_instance_private (monitor);
+
+  priv->is_vrr_enabled = enabled;
+}
+
 gboolean
 meta_monitor_is_laptop_panel (MetaMonitor *monitor)
 {
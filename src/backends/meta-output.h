@@ -103,6 +103,9 @@ struct _MetaOutput
   gboolean is_underscanning;
   gboolean supports_underscanning;
 
+  /* Whether the sink supports variable refresh rates */
+  gboolean is_vrr_capable;
+
   gpointer driver_private;
   GDestroyNotify driver_notify;
 
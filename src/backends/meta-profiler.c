@@ -0,0 +1,244 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#include "config.h"
+
+#include "backends/meta-profiler.h"
+
+#include <cogl/cogl.h>
+#include <meta/main.h>
+
+#ifdef HAVE_WAYLAND
+#include "wayland/meta-wayland.h"
+#endif
+
+#define META_PROFILER_DBUS_SERVICE "org.gnome.Mutter.Profiler"
+#define META_PROFILER_DBUS_PATH "/org/gnome/Mutter/Profiler"
+
+#define DEFAULT_MAX_EVENTS 100000
+
+struct _MetaProfiler
+{
+  MetaDBusProfilerSkeleton parent;
+
+  int dbus_name_id;
+};
+
+static void
+meta_profiler_init_iface (MetaDBusProfilerIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (MetaProfiler, meta_profiler,
+                         META_DBUS_TYPE_PROFILER_SKELETON,
+                         G_IMPLEMENT_INTERFACE (META_DBUS_TYPE_PROFILER,
+                                                meta_profiler_init_iface))
+
+static gboolean
+handle_start (MetaDBusProfiler      *skeleton,
+              GDBusMethodInvocation *invocation,
+              GVariant              *options)
+{
+  uint32_t max_events = DEFAULT_MAX_EVENTS;
+
+  g_variant_lookup (options, "max-events", "u", &max_events);
+  if (max_events == 0)
+    {
+      g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                             G_DBUS_ERROR_INVALID_ARGS,
+                                             "max-events must be positive");
+      return TRUE;
+    }
+
+  cogl_trace_start (max_events);
+  meta_dbus_profiler_set_running (skeleton, TRUE);
+
+  meta_dbus_profiler_complete_start (skeleton, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+handle_stop (MetaDBusProfiler      *skeleton,
+             GDBusMethodInvocation *invocation)
+{
+  cogl_trace_stop ();
+  meta_dbus_profiler_set_running (skeleton, FALSE);
+
+  meta_dbus_profiler_complete_stop (skeleton, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+handle_write_trace (MetaDBusProfiler      *skeleton,
+                    GDBusMethodInvocation *invocation,
+                    const char            *path)
+{
+  CoglError *error = NULL;
+
+  if (!cogl_trace_write_json (path, &error))
+    {
+      g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                             G_DBUS_ERROR_FAILED,
+                                             "Failed to write trace: %s",
+                                             error->message);
+      cogl_error_free (error);
+
+      return TRUE;
+    }
+
+  meta_dbus_profiler_complete_write_trace (skeleton, invocation);
+
+  return TRUE;
+}
+
+#ifdef HAVE_WAYLAND
+static void
+add_client_stats (const MetaWaylandClientStats *stats,
+                  gpointer                      user_data)
+{
+  GVariantBuilder *builder = user_data;
+
+  g_variant_builder_add (builder, "(uttt)",
+                         (uint32_t) stats->pid,
+                         stats->n_flushes,
+                         stats->n_messages,
+                         stats->n_bytes);
+}
+#endif
+
+static gboolean
+handle_get_wayland_client_stats (MetaDBusProfiler      *skeleton,
+                                 GDBusMethodInvocation *invocation)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(uttt)"));
+
+#ifdef HAVE_WAYLAND
+  if (meta_is_wayland_compositor ())
+    meta_wayland_compositor_foreach_client_stats (meta_wayland_compositor_get_default (),
+                                                  add_client_stats,
+                                                  &builder);
+#endif
+
+  meta_dbus_profiler_complete_get_wayland_client_stats (skeleton,
+                                                        invocation,
+                                                        g_variant_builder_end (&builder));
+
+  return TRUE;
+}
+
+static void
+meta_profiler_init_iface (MetaDBusProfilerIface *iface)
+{
+  iface->handle_start = handle_start;
+  iface->handle_stop = handle_stop;
+  iface->handle_write_trace = handle_write_trace;
+  iface->handle_get_wayland_client_stats = handle_get_wayland_client_stats;
+}
+
+static void
+on_bus_acquired (GDBusConnection *connection,
+                 const char      *name,
+                 gpointer         user_data)
+{
+  MetaProfiler *profiler = user_data;
+  GDBusInterfaceSkeleton *interface_skeleton =
+    G_DBUS_INTERFACE_SKELETON (profiler);
+  GError *error = NULL;
+
+  if (!g_dbus_interface_skeleton_export (interface_skeleton,
+                                         connection,
+                                         META_PROFILER_DBUS_PATH,
+                                         &error))
+    {
+      g_warning ("Failed to export profiler object: %s", error->message);
+      g_error_free (error);
+    }
+}
+
+static void
+on_name_acquired (GDBusConnection *connection,
+                  const char      *name,
+                  gpointer         user_data)
+{
+  g_info ("Acquired name %s\n", name);
+}
+
+static void
+on_name_lost (GDBusConnection *connection,
+              const char      *name,
+              gpointer         user_data)
+{
+  /* Not having a session bus (e.g. when running the tests) is no
+   * reason to complain; the profiler is only a debugging aid. */
+  g_info ("Lost or failed to acquire name %s\n", name);
+}
+
+static void
+meta_profiler_constructed (GObject *object)
+{
+  MetaProfiler *profiler = META_PROFILER (object);
+
+  profiler->dbus_name_id =
+    g_bus_own_name (G_BUS_TYPE_SESSION,
+                    META_PROFILER_DBUS_SERVICE,
+                    G_BUS_NAME_OWNER_FLAGS_NONE,
+                    on_bus_acquired,
+                    on_name_acquired,
+                    on_name_lost,
+                    profiler,
+                    NULL);
+}
+
+static void
+meta_profiler_finalize (GObject *object)
+{
+  MetaProfiler *profiler = META_PROFILER (object);
+
+  if (profiler->dbus_name_id)
+    g_bus_unown_name (profiler->dbus_name_id);
+
+  cogl_trace_stop ();
+
+  G_OBJECT_CLASS (meta_profiler_parent_class)->finalize (object);
+}
+
+MetaProfiler *
+meta_profiler_new (void)
+{
+  return g_object_new (META_TYPE_PROFILER, NULL);
+}
+
+static void
+meta_profiler_init (MetaProfiler *profiler)
+{
+}
+
+static void
+meta_profiler_class_init (MetaProfilerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = meta_profiler_constructed;
+  object_class->finalize = meta_profiler_finalize;
+}
@@ -28,8 +28,11 @@
 #include "backends/meta-screen-cast-monitor-stream.h"
 #include "backends/meta-logical-monitor.h"
 #include "backends/meta-monitor.h"
+#include "backends/meta-renderer.h"
 #include "clutter/clutter.h"
 #include "clutter/clutter-mutter.h"
+#include "core/display-private.h"
+#include "meta/compositor-mutter.h"
 
 struct _MetaScreenCastMonitorStreamSrc
 {
@@ -93,13 +96,126 @@ meta_screen_cast_monitor_stream_src_get_specs (MetaScreenCastStreamSrc *src,
   *frame_rate = meta_monitor_mode_get_refresh_rate (mode);
 }
 
+static ClutterStageView *
+find_view_containing (MetaRectangle *rect)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  GList *l;
+
+  for (l = meta_renderer_get_views (renderer); l; l = l->next)
+    {
+      ClutterStageView *view = l->data;
+      MetaRectangle view_layout;
+
+      clutter_stage_view_get_layout (view, &view_layout);
+      if (meta_rectangle_contains_rect (&view_layout, rect))
+        return view;
+    }
+
+  return NULL;
+}
+
+/*
+ * Translates the part of the stage painted into @view to stream
+ * coordinates. Returns %NULL if the whole stream is damaged.
+ */
+static cairo_region_t *
+get_stream_damage (MetaScreenCastMonitorStreamSrc *monitor_src,
+                   ClutterStageView               *view,
+                   const cairo_region_t           *view_redraw_clip)
+{
+  MetaMonitor *monitor;
+  MetaLogicalMonitor *logical_monitor;
+  cairo_region_t *redraw_clip;
+  cairo_region_t *damage;
+  cairo_rectangle_int_t stream_rect;
+  float scale;
+  int n_rects, i;
+
+  if (!view_redraw_clip)
+    return NULL;
+
+  monitor = get_monitor (monitor_src);
+  logical_monitor = meta_monitor_get_logical_monitor (monitor);
+
+  redraw_clip = cairo_region_copy (view_redraw_clip);
+  cairo_region_intersect_rectangle (redraw_clip, &logical_monitor->rect);
+
+  scale = clutter_stage_view_get_scale (view);
+  stream_rect = (cairo_rectangle_int_t) {
+    .width = (int) roundf (logical_monitor->rect.width * scale),
+    .height = (int) roundf (logical_monitor->rect.height * scale),
+  };
+
+  damage = cairo_region_create ();
+
+  n_rects = cairo_region_num_rectangles (redraw_clip);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int x1, y1, x2, y2;
+
+      cairo_region_get_rectangle (redraw_clip, i, &rect);
+
+      x1 = (int) floorf ((rect.x - logical_monitor->rect.x) * scale);
+      y1 = (int) floorf ((rect.y - logical_monitor->rect.y) * scale);
+      x2 = (int) ceilf ((rect.x + rect.width - logical_monitor->rect.x) * scale);
+      y2 = (int) ceilf ((rect.y + rect.height - logical_monitor->rect.y) * scale);
+
+      cairo_region_union_rectangle (damage, &(cairo_rectangle_int_t) {
+        .x = x1,
+        .y = y1,
+        .width = x2 - x1,
+        .height = y2 - y1,
+      });
+    }
+
+  cairo_region_intersect_rectangle (damage, &stream_rect);
+  cairo_region_destroy (redraw_clip);
+
+  return damage;
+}
+
 static void
-stage_painted (ClutterActor                   *actor,
-               MetaScreenCastMonitorStreamSrc *monitor_src)
+stage_view_painted (ClutterStage                   *stage,
+                    ClutterStageView               *view,
+                    const cairo_region_t           *redraw_clip,
+                    MetaScreenCastMonitorStreamSrc *monitor_src)
 {
   MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (monitor_src);
+  MetaMonitor *monitor;
+  MetaLogicalMonitor *logical_monitor;
+  ClutterStageView *monitor_view;
+  cairo_region_t *damage;
+
+  monitor = get_monitor (monitor_src);
+  logical_monitor = meta_monitor_get_logical_monitor (monitor);
+
+  /* Views are painted at their own pace; only the view showing the monitor
+   * is known to be up to date now. Monitors spanning several views are
+   * captured from the stage, so any of them will do. */
+  monitor_view = find_view_containing (&logical_monitor->rect);
+  if (monitor_view)
+    {
+      if (monitor_view != view)
+        return;
+
+      damage = get_stream_damage (monitor_src, view, redraw_clip);
+    }
+  else
+    {
+      MetaRectangle view_layout;
+
+      clutter_stage_view_get_layout (view, &view_layout);
+      if (!meta_rectangle_overlap (&view_layout, &logical_monitor->rect))
+        return;
+
+      damage = NULL;
+    }
 
-  meta_screen_cast_stream_src_maybe_record_frame (src);
+  meta_screen_cast_stream_src_maybe_record_frame (src, damage);
+  g_clear_pointer (&damage, cairo_region_destroy);
 }
 
 static void
@@ -107,13 +223,18 @@ meta_screen_cast_monitor_stream_src_enable (MetaScreenCastStreamSrc *src)
 {
   MetaScreenCastMonitorStreamSrc *monitor_src =
     META_SCREEN_CAST_MONITOR_STREAM_SRC (src);
+  MetaDisplay *display = meta_get_display ();
   ClutterStage *stage;
 
+  /* Buffers scanned out directly, or put on overlay planes, never end up
+   * on the stage, so the stage must be composited while it is recorded. */
+  meta_disable_unredirect_for_screen (display->screen);
+
   stage = get_stage (monitor_src);
   monitor_src->stage_painted_handler_id =
-    g_signal_connect_after (stage, "paint",
-                            G_CALLBACK (stage_painted),
-                            monitor_src);
+    g_signal_connect (stage, "view-painted",
+                      G_CALLBACK (stage_view_painted),
+                      monitor_src);
   clutter_actor_queue_redraw (CLUTTER_ACTOR (stage));
 }
 
@@ -122,27 +243,77 @@ meta_screen_cast_monitor_stream_src_disable (MetaScreenCastStreamSrc *src)
 {
   MetaScreenCastMonitorStreamSrc *monitor_src =
     META_SCREEN_CAST_MONITOR_STREAM_SRC (src);
+  MetaDisplay *display = meta_get_display ();
   ClutterStage *stage;
 
   stage = get_stage (monitor_src);
   g_signal_handler_disconnect (stage, monitor_src->stage_painted_handler_id);
   monitor_src->stage_painted_handler_id = 0;
+
+  if (display && display->screen)
+    meta_enable_unredirect_for_screen (display->screen);
 }
 
 static void
 meta_screen_cast_monitor_stream_src_record_frame (MetaScreenCastStreamSrc *src,
-                                                  uint8_t                 *data)
+                                                  uint8_t                 *data,
+                                                  int                      stride,
+                                                  const cairo_region_t    *region)
 {
   MetaScreenCastMonitorStreamSrc *monitor_src =
     META_SCREEN_CAST_MONITOR_STREAM_SRC (src);
-  ClutterStage *stage;
+  ClutterBackend *clutter_backend = clutter_get_default_backend ();
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
   MetaMonitor *monitor;
   MetaLogicalMonitor *logical_monitor;
+  ClutterStageView *view;
+  CoglFramebuffer *framebuffer;
+  MetaRectangle view_layout;
+  float scale;
+  int x_offset, y_offset;
+  int n_rects, i;
 
-  stage = get_stage (monitor_src);
   monitor = get_monitor (monitor_src);
   logical_monitor = meta_monitor_get_logical_monitor (monitor);
-  clutter_stage_capture_into (stage, FALSE, &logical_monitor->rect, data);
+
+  view = find_view_containing (&logical_monitor->rect);
+  if (!view)
+    {
+      ClutterStage *stage = get_stage (monitor_src);
+
+      clutter_stage_capture_into (stage, FALSE, &logical_monitor->rect, data);
+      return;
+    }
+
+  framebuffer = clutter_stage_view_get_framebuffer (view);
+  clutter_stage_view_get_layout (view, &view_layout);
+  scale = clutter_stage_view_get_scale (view);
+
+  x_offset = (int) roundf ((logical_monitor->rect.x - view_layout.x) * scale);
+  y_offset = (int) roundf ((logical_monitor->rect.y - view_layout.y) * scale);
+
+  /* Only the parts of the buffer that are out of date are read back; the
+   * rest still holds what was recorded into it the last time it was used. */
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      CoglBitmap *bitmap;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      bitmap = cogl_bitmap_new_for_data (cogl_context,
+                                         rect.width, rect.height,
+                                         CLUTTER_CAIRO_FORMAT_ARGB32,
+                                         stride,
+                                         data + rect.y * stride + rect.x * 4);
+      cogl_framebuffer_read_pixels_into_bitmap (framebuffer,
+                                                x_offset + rect.x,
+                                                y_offset + rect.y,
+                                                COGL_READ_PIXELS_COLOR_BUFFER,
+                                                bitmap);
+      cogl_object_unref (bitmap);
+    }
 }
 
 MetaScreenCastMonitorStreamSrc *
@@ -90,6 +90,10 @@ typedef struct _MetaScreenCastStreamSrcPrivate
   MetaSpaType spa_type;
   struct spa_video_info_raw video_format;
 
+  /* Per buffer id, the part of the buffer that is out of date */
+  GHashTable *buffer_damage;
+  gboolean has_pending_damage;
+
   uint64_t last_frame_timestamp_us;
 } MetaScreenCastStreamSrcPrivate;
 
@@ -119,25 +123,90 @@ meta_screen_cast_stream_src_get_specs (MetaScreenCastStreamSrc *src,
 
 static void
 meta_screen_cast_stream_src_record_frame (MetaScreenCastStreamSrc *src,
-                                          uint8_t                 *data)
+                                          uint8_t                 *data,
+                                          int                      stride,
+                                          const cairo_region_t    *region)
 {
   MetaScreenCastStreamSrcClass *klass =
     META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src);
 
-  klass->record_frame (src, data);
+  klass->record_frame (src, data, stride, region);
+}
+
+static cairo_rectangle_int_t
+get_stream_rect (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  return (cairo_rectangle_int_t) {
+    .width = priv->video_format.size.width,
+    .height = priv->video_format.size.height,
+  };
+}
+
+static int
+get_buffer_stride (MetaScreenCastStreamSrc *src,
+                   struct spa_data         *spa_data)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  if (spa_data->chunk->stride != 0)
+    return spa_data->chunk->stride;
+  else
+    return SPA_ROUND_UP_N (priv->video_format.size.width * 4, 4);
+}
+
+static void
+add_damage (MetaScreenCastStreamSrc *src,
+            const cairo_region_t    *damage)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  cairo_rectangle_int_t stream_rect;
+  GHashTableIter iter;
+  cairo_region_t *buffer_damage;
+
+  if (damage && cairo_region_is_empty (damage))
+    return;
+
+  stream_rect = get_stream_rect (src);
+
+  g_hash_table_iter_init (&iter, priv->buffer_damage);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &buffer_damage))
+    {
+      if (damage)
+        cairo_region_union (buffer_damage, damage);
+      else
+        cairo_region_union_rectangle (buffer_damage, &stream_rect);
+    }
+
+  priv->has_pending_damage = TRUE;
 }
 
 void
-meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc *src)
+meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc *src,
+                                                const cairo_region_t    *damage)
 {
   MetaScreenCastStreamSrcPrivate *priv =
     meta_screen_cast_stream_src_get_instance_private (src);
   uint32_t buffer_id;
   struct spa_buffer *buffer;
+  cairo_region_t *buffer_damage;
+  cairo_region_t *full_damage = NULL;
   uint8_t *map = NULL;
   uint8_t *data;
   uint64_t now_us;
 
+  /* Buffers are handed back to us with whatever they contained when they
+   * were last recorded, so each of them accumulates the damage it missed
+   * in the meantime, including that of frames skipped below. */
+  add_damage (src, damage);
+
+  if (!priv->has_pending_damage)
+    return;
+
   now_us = g_get_monotonic_time ();
   if (priv->last_frame_timestamp_us != 0 &&
       (now_us - priv->last_frame_timestamp_us <
@@ -177,7 +246,28 @@ meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc *src)
       return;
     }
 
-  meta_screen_cast_stream_src_record_frame (src, data);
+  buffer_damage = g_hash_table_lookup (priv->buffer_damage,
+                                       GUINT_TO_POINTER (buffer_id));
+
+  if (!buffer_damage)
+    {
+      cairo_rectangle_int_t stream_rect = get_stream_rect (src);
+
+      full_damage = cairo_region_create_rectangle (&stream_rect);
+    }
+
+  meta_screen_cast_stream_src_record_frame (src, data,
+                                            get_buffer_stride (src, &buffer->datas[0]),
+                                            buffer_damage ? buffer_damage
+                                                          : full_damage);
+
+  g_clear_pointer (&full_damage, cairo_region_destroy);
+
+  if (buffer_damage)
+    g_hash_table_insert (priv->buffer_damage,
+                         GUINT_TO_POINTER (buffer_id),
+                         cairo_region_create ());
+  priv->has_pending_damage = FALSE;
   priv->last_frame_timestamp_us = now_us;
 
   if (map)
@@ -274,6 +364,8 @@ on_stream_format_changed (void           *data,
   struct spa_pod *params[1];
   const int bpp = 4;
 
+  g_hash_table_remove_all (priv->buffer_damage);
+
   if (!format)
     {
       pw_stream_finish_format (priv->pipewire_stream, 0, NULL, 0);
@@ -303,10 +395,38 @@ on_stream_format_changed (void           *data,
                            params, G_N_ELEMENTS (params));
 }
 
+static void
+on_stream_add_buffer (void     *data,
+                      uint32_t  id)
+{
+  MetaScreenCastStreamSrc *src = data;
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  cairo_rectangle_int_t stream_rect;
+
+  stream_rect = get_stream_rect (src);
+  g_hash_table_insert (priv->buffer_damage,
+                       GUINT_TO_POINTER (id),
+                       cairo_region_create_rectangle (&stream_rect));
+}
+
+static void
+on_stream_remove_buffer (void     *data,
+                         uint32_t  id)
+{
+  MetaScreenCastStreamSrc *src = data;
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  g_hash_table_remove (priv->buffer_damage, GUINT_TO_POINTER (id));
+}
+
 static const struct pw_stream_events stream_events = {
   PW_VERSION_STREAM_EVENTS,
   .state_changed = on_stream_state_changed,
   .format_changed = on_stream_format_changed,
+  .add_buffer = on_stream_add_buffer,
+  .remove_buffer = on_stream_remove_buffer,
 };
 
 static struct pw_stream *
@@ -555,6 +675,7 @@ meta_screen_cast_stream_src_finalize (GObject *object)
   g_clear_pointer (&priv->pipewire_remote, (GDestroyNotify) pw_remote_destroy);
   g_clear_pointer (&priv->pipewire_core, (GDestroyNotify) pw_core_destroy);
   g_source_destroy (&priv->pipewire_source->base);
+  g_hash_table_destroy (priv->buffer_damage);
 
   G_OBJECT_CLASS (meta_screen_cast_stream_src_parent_class)->finalize (object);
 }
@@ -602,6 +723,12 @@ meta_screen_cast_stream_src_get_property (GObject    *object,
 static void
 meta_screen_cast_stream_src_init (MetaScreenCastStreamSrc *src)
 {
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  priv->buffer_damage =
+    g_hash_table_new_full (NULL, NULL, NULL,
+                           (GDestroyNotify) cairo_region_destroy);
 }
 
 static void
@@ -46,10 +46,13 @@ struct _MetaScreenCastStreamSrcClass
   void (* enable) (MetaScreenCastStreamSrc *src);
   void (* disable) (MetaScreenCastStreamSrc *src);
   void (* record_frame) (MetaScreenCastStreamSrc *src,
-                         uint8_t                 *data);
+                         uint8_t                 *data,
+                         int                      stride,
+                         const cairo_region_t    *region);
 };
 
-void meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc *src);
+void meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc *src,
+                                                     const cairo_region_t    *damage);
 
 MetaScreenCastStream * meta_screen_cast_stream_src_get_stream (MetaScreenCastStreamSrc *src);
 
@@ -267,6 +267,10 @@ experimental_features_handler (GVariant *features_variant,
         features |= META_EXPERIMENTAL_FEATURE_SCREEN_CAST;
       else if (g_str_equal (feature, "remote-desktop"))
         features |= META_EXPERIMENTAL_FEATURE_REMOTE_DESKTOP;
+      else if (g_str_equal (feature, "shm-upload-thread"))
+        features |= META_EXPERIMENTAL_FEATURE_SHM_UPLOAD_THREAD;
+      else if (g_str_equal (feature, "gpu-shadows"))
+        features |= META_EXPERIMENTAL_FEATURE_GPU_SHADOWS;
       else
         g_info ("Unknown experimental feature '%s'\n", feature);
     }
@@ -64,9 +64,20 @@ struct _MetaBackendNativePrivate
   guint sleep_signal_id;
   GCancellable *cancellable;
   GDBusConnection *system_bus;
+
+  /* Copy of the monitor layout used from the input thread */
+  GMutex pointer_layout_lock;
+  GArray *pointer_layout;
+  gboolean pointer_layout_scaled;
 };
 typedef struct _MetaBackendNativePrivate MetaBackendNativePrivate;
 
+typedef struct _MetaPointerLayoutMonitor
+{
+  MetaRectangle rect;
+  float scale;
+} MetaPointerLayoutMonitor;
+
 static GInitableIface *initable_parent_iface;
 
 static void
@@ -92,6 +103,9 @@ meta_backend_native_finalize (GObject *object)
   g_clear_object (&priv->cancellable);
   g_clear_object (&priv->system_bus);
 
+  g_array_free (priv->pointer_layout, TRUE);
+  g_mutex_clear (&priv->pointer_layout_lock);
+
   G_OBJECT_CLASS (meta_backend_native_parent_class)->finalize (object);
 }
 
@@ -379,6 +393,146 @@ relative_motion_filter (ClutterInputDevice *device,
   *dy = new_dy;
 }
 
+static void
+update_pointer_layout (MetaBackendNative *native)
+{
+  MetaBackendNativePrivate *priv =
+    meta_backend_native_get_instance_private (native);
+  MetaBackend *backend = META_BACKEND (native);
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
+  GList *logical_monitors, *l;
+
+  g_mutex_lock (&priv->pointer_layout_lock);
+
+  g_array_set_size (priv->pointer_layout, 0);
+
+  logical_monitors =
+    meta_monitor_manager_get_logical_monitors (monitor_manager);
+  for (l = logical_monitors; l; l = l->next)
+    {
+      MetaLogicalMonitor *logical_monitor = l->data;
+      MetaPointerLayoutMonitor layout_monitor;
+
+      layout_monitor = (MetaPointerLayoutMonitor) {
+        .rect = logical_monitor->rect,
+        .scale = logical_monitor->scale
+      };
+      g_array_append_val (priv->pointer_layout, layout_monitor);
+    }
+
+  priv->pointer_layout_scaled = meta_is_stage_views_scaled ();
+
+  g_mutex_unlock (&priv->pointer_layout_lock);
+}
+
+static MetaPointerLayoutMonitor *
+find_pointer_layout_monitor_at (MetaBackendNative *native,
+                                float              x,
+                                float              y)
+{
+  MetaBackendNativePrivate *priv =
+    meta_backend_native_get_instance_private (native);
+  unsigned int i;
+
+  for (i = 0; i < priv->pointer_layout->len; i++)
+    {
+      MetaPointerLayoutMonitor *layout_monitor =
+        &g_array_index (priv->pointer_layout, MetaPointerLayoutMonitor, i);
+      MetaRectangle *rect = &layout_monitor->rect;
+
+      if (x >= rect->x && x < rect->x + rect->width &&
+          y >= rect->y && y < rect->y + rect->height)
+        return layout_monitor;
+    }
+
+  return NULL;
+}
+
+/*
+ * Called from the clutter input thread. This is a simplified version of
+ * relative_motion_filter() and pointer_constrain_callback() working on a
+ * copy of the monitor layout; whenever those would need anything else
+ * (barriers, client pointer constraints, crossing into a monitor with a
+ * different scale), the motion is left to the main thread.
+ */
+static gboolean
+pointer_motion_callback (float     prev_x,
+                         float     prev_y,
+                         float     dx,
+                         float     dy,
+                         float    *x,
+                         float    *y,
+                         gpointer  user_data)
+{
+  MetaBackendNative *native = user_data;
+  MetaBackendNativePrivate *priv =
+    meta_backend_native_get_instance_private (native);
+  MetaBackend *backend = META_BACKEND (native);
+  MetaPointerLayoutMonitor *current, *dest;
+  MetaCursorRenderer *cursor_renderer;
+  float new_x, new_y;
+  gboolean handled = FALSE;
+
+  if (meta_barrier_manager_native_has_barriers (priv->barrier_manager) ||
+      meta_backend_has_client_pointer_constraint (backend))
+    return FALSE;
+
+  g_mutex_lock (&priv->pointer_layout_lock);
+
+  current = find_pointer_layout_monitor_at (native, prev_x, prev_y);
+  if (!current)
+    goto out;
+
+  if (!priv->pointer_layout_scaled)
+    {
+      dx *= current->scale;
+      dy *= current->scale;
+    }
+
+  new_x = prev_x + dx;
+  new_y = prev_y + dy;
+
+  dest = find_pointer_layout_monitor_at (native, new_x, new_y);
+  if (!dest)
+    {
+      MetaRectangle *rect = &current->rect;
+
+      new_x = CLAMP (new_x, rect->x, rect->x + rect->width - 1);
+      new_y = CLAMP (new_y, rect->y, rect->y + rect->height - 1);
+    }
+  else if (dest != current &&
+           !priv->pointer_layout_scaled &&
+           dest->scale != current->scale)
+    {
+      goto out;
+    }
+
+  *x = new_x;
+  *y = new_y;
+  handled = TRUE;
+
+out:
+  g_mutex_unlock (&priv->pointer_layout_lock);
+
+  if (!handled)
+    return FALSE;
+
+  cursor_renderer = meta_backend_get_cursor_renderer (backend);
+  if (cursor_renderer)
+    meta_cursor_renderer_native_move_hw_cursor (META_CURSOR_RENDERER_NATIVE (cursor_renderer),
+                                                *x, *y);
+
+  return TRUE;
+}
+
+static void
+on_monitors_changed (MetaMonitorManager *monitor_manager,
+                     MetaBackendNative  *native)
+{
+  update_pointer_layout (native);
+}
+
 static ClutterBackend *
 meta_backend_native_create_clutter_backend (MetaBackend *backend)
 {
@@ -396,6 +550,14 @@ meta_backend_native_post_init (MetaBackend *backend)
                                                 NULL, NULL);
   clutter_evdev_set_relative_motion_filter (manager, relative_motion_filter,
                                             meta_backend_get_monitor_manager (backend));
+
+  update_pointer_layout (META_BACKEND_NATIVE (backend));
+  g_signal_connect_object (meta_backend_get_monitor_manager (backend),
+                           "monitors-changed-internal",
+                           G_CALLBACK (on_monitors_changed),
+                           backend, 0);
+  clutter_evdev_set_pointer_motion_callback (manager, pointer_motion_callback,
+                                             backend, NULL);
 }
 
 static MetaIdleMonitor *
@@ -638,6 +800,10 @@ meta_backend_native_init (MetaBackendNative *native)
 
   priv->barrier_manager = meta_barrier_manager_native_new ();
 
+  g_mutex_init (&priv->pointer_layout_lock);
+  priv->pointer_layout = g_array_new (FALSE, FALSE,
+                                      sizeof (MetaPointerLayoutMonitor));
+
   priv->up_client = up_client_new ();
   g_signal_connect (priv->up_client, "notify::lid-is-closed",
                     G_CALLBACK (lid_is_closed_changed_cb), NULL);
@@ -43,6 +43,9 @@
 struct _MetaBarrierManagerNative
 {
   GHashTable *barriers;
+
+  /* Number of barriers, readable from the input thread */
+  int n_barriers;
 };
 
 typedef enum {
@@ -563,7 +566,8 @@ _meta_barrier_impl_native_destroy (MetaBarrierImpl *impl)
   MetaBarrierImplNativePrivate *priv =
     meta_barrier_impl_native_get_instance_private (self);
 
-  g_hash_table_remove (priv->manager->barriers, self);
+  if (g_hash_table_remove (priv->manager->barriers, self))
+    g_atomic_int_add (&priv->manager->n_barriers, -1);
   priv->is_active = FALSE;
 }
 
@@ -585,6 +589,7 @@ meta_barrier_impl_native_new (MetaBarrier *barrier)
   manager = meta_backend_native_get_barrier_manager (native);
   priv->manager = manager;
   g_hash_table_add (manager->barriers, self);
+  g_atomic_int_inc (&manager->n_barriers);
 
   return META_BARRIER_IMPL (self);
 }
@@ -615,3 +620,12 @@ meta_barrier_manager_native_new (void)
 
   return manager;
 }
+
+/*
+ * Can be called from any thread.
+ */
+gboolean
+meta_barrier_manager_native_has_barriers (MetaBarrierManagerNative *manager)
+{
+  return g_atomic_int_get (&manager->n_barriers) > 0;
+}
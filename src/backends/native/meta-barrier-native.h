@@ -62,6 +62,7 @@ void meta_barrier_manager_native_process (MetaBarrierManagerNative *manager,
                                           guint32                   time,
                                           float                    *x,
                                           float                    *y);
+gboolean meta_barrier_manager_native_has_barriers (MetaBarrierManagerNative *manager);
 
 G_END_DECLS
 
@@ -25,6 +25,7 @@
 
 #include <drm_fourcc.h>
 #include <drm_mode.h>
+#include <strings.h>
 
 #include "backends/meta-backend-private.h"
 #include "backends/native/meta-gpu-kms.h"
@@ -34,18 +35,83 @@
 #define ALL_TRANSFORMS (META_MONITOR_TRANSFORM_FLIPPED_270 + 1)
 #define ALL_TRANSFORMS_MASK ((1 << ALL_TRANSFORMS) - 1)
 
+/* Property ids of a plane, only known when atomic modesetting is enabled */
+typedef struct _MetaKmsPlaneProps
+{
+  uint32_t fb_id;
+  uint32_t crtc_id;
+  uint32_t src_x;
+  uint32_t src_y;
+  uint32_t src_w;
+  uint32_t src_h;
+  uint32_t crtc_x;
+  uint32_t crtc_y;
+  uint32_t crtc_w;
+  uint32_t crtc_h;
+} MetaKmsPlaneProps;
+
+/*
+ * An overlay plane and the life cycle of the framebuffers shown on it. Each
+ * framebuffer comes with a closure, invoked when it is first scanned out and
+ * released once it no longer is.
+ */
+typedef struct _MetaKmsOverlayPlane
+{
+  uint32_t plane_id;
+  MetaKmsPlaneProps props;
+
+  /* State to be committed with the next atomic update */
+  gboolean dirty;
+  uint32_t fb_id;
+  MetaRectangle src_rect;
+  MetaRectangle dst_rect;
+  GClosure *pending_closure;
+
+  /* Committed, waiting for the page flip event */
+  gboolean in_flight;
+  GClosure *in_flight_closure;
+
+  /* Being scanned out */
+  GClosure *current_closure;
+} MetaKmsOverlayPlane;
+
 typedef struct _MetaCrtcKms
 {
   unsigned int index;
   uint32_t underscan_prop_id;
   uint32_t underscan_hborder_prop_id;
   uint32_t underscan_vborder_prop_id;
+  uint32_t mode_id_prop_id;
+  uint32_t active_prop_id;
+  uint32_t vrr_enabled_prop_id;
   uint32_t primary_plane_id;
+  MetaKmsPlaneProps primary_plane_props;
   uint32_t formats_prop_id;
   uint32_t rotation_prop_id;
   uint32_t rotation_map[ALL_TRANSFORMS];
   uint32_t all_hw_transforms;
 
+  uint32_t cursor_plane_id;
+  MetaKmsPlaneProps cursor_plane_props;
+
+  /* Cursor plane state to be committed with the next atomic update */
+  struct {
+    gboolean dirty;
+    uint32_t fb_id;
+    int x;
+    int y;
+    int width;
+    int height;
+  } cursor;
+
+  GPtrArray *overlay_planes;
+
+  /* Variable refresh rate state to be committed with the next atomic update */
+  struct {
+    gboolean dirty;
+    gboolean enabled;
+  } vrr;
+
   GArray *modifiers_xrgb8888;
 } MetaCrtcKms;
 
@@ -80,6 +146,10 @@ meta_crtc_kms_apply_transform (MetaCrtc *crtc)
   if (!meta_crtc_kms_is_transform_handled (crtc, META_MONITOR_TRANSFORM_NORMAL))
     return;
 
+  /* With atomic modesetting, the rotation is part of the mode set commit */
+  if (meta_gpu_kms_is_atomic (gpu_kms))
+    return;
+
   if (drmModeObjectSetProperty (kms_fd,
                                 crtc_kms->primary_plane_id,
                                 DRM_MODE_OBJECT_PLANE,
@@ -188,6 +258,575 @@ meta_crtc_kms_get_modifiers (MetaCrtc *crtc,
   return crtc_kms->modifiers_xrgb8888;
 }
 
+static MetaMonitorTransform
+get_hw_transform (MetaCrtc             *crtc,
+                  MetaMonitorTransform  transform)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+
+  if (crtc_kms->all_hw_transforms & (1 << transform))
+    return transform;
+  else
+    return META_MONITOR_TRANSFORM_NORMAL;
+}
+
+static gboolean
+add_property (drmModeAtomicReq *req,
+              uint32_t          object_id,
+              uint32_t          prop_id,
+              uint64_t          value)
+{
+  if (prop_id == 0)
+    return FALSE;
+
+  return drmModeAtomicAddProperty (req, object_id, prop_id, value) >= 0;
+}
+
+static gboolean
+add_plane_to_request (drmModeAtomicReq        *req,
+                      uint32_t                 plane_id,
+                      const MetaKmsPlaneProps *props,
+                      uint32_t                 crtc_id,
+                      uint32_t                 fb_id,
+                      int                      src_x,
+                      int                      src_y,
+                      int                      src_width,
+                      int                      src_height,
+                      int                      crtc_x,
+                      int                      crtc_y,
+                      int                      crtc_width,
+                      int                      crtc_height)
+{
+  if (fb_id == 0)
+    {
+      return (add_property (req, plane_id, props->fb_id, 0) &&
+              add_property (req, plane_id, props->crtc_id, 0));
+    }
+
+  /* Source coordinates are in 16.16 fixed point */
+  return (add_property (req, plane_id, props->fb_id, fb_id) &&
+          add_property (req, plane_id, props->crtc_id, crtc_id) &&
+          add_property (req, plane_id, props->src_x, (uint64_t) src_x << 16) &&
+          add_property (req, plane_id, props->src_y, (uint64_t) src_y << 16) &&
+          add_property (req, plane_id, props->src_w, (uint64_t) src_width << 16) &&
+          add_property (req, plane_id, props->src_h, (uint64_t) src_height << 16) &&
+          add_property (req, plane_id, props->crtc_x, (uint64_t) crtc_x) &&
+          add_property (req, plane_id, props->crtc_y, (uint64_t) crtc_y) &&
+          add_property (req, plane_id, props->crtc_w, crtc_width) &&
+          add_property (req, plane_id, props->crtc_h, crtc_height));
+}
+
+/*
+ * Adds the mode of @crtc to an atomic request. A @mode_blob_id of 0 disables
+ * the CRTC.
+ */
+gboolean
+meta_crtc_kms_add_mode_to_request (MetaCrtc         *crtc,
+                                   drmModeAtomicReq *req,
+                                   uint32_t          mode_blob_id)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+
+  return (add_property (req, crtc->crtc_id,
+                        crtc_kms->mode_id_prop_id, mode_blob_id) &&
+          add_property (req, crtc->crtc_id,
+                        crtc_kms->active_prop_id, mode_blob_id != 0));
+}
+
+/*
+ * Adds the full primary plane state of @crtc to an atomic request, positioning
+ * the plane to cover @mode like drmModeSetCrtc() would. A NULL @mode or an
+ * @fb_id of 0 disables the plane.
+ */
+gboolean
+meta_crtc_kms_add_primary_plane_to_request (MetaCrtc             *crtc,
+                                            drmModeAtomicReq     *req,
+                                            MetaCrtcMode         *mode,
+                                            MetaMonitorTransform  transform,
+                                            uint32_t              fb_id,
+                                            int                   x,
+                                            int                   y)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+  MetaMonitorTransform hw_transform;
+  int src_width, src_height;
+
+  if (!crtc_kms->primary_plane_id)
+    return FALSE;
+
+  if (!mode || fb_id == 0)
+    {
+      return add_plane_to_request (req,
+                                   crtc_kms->primary_plane_id,
+                                   &crtc_kms->primary_plane_props,
+                                   0, 0,
+                                   0, 0, 0, 0,
+                                   0, 0, 0, 0);
+    }
+
+  hw_transform = get_hw_transform (crtc, transform);
+  if (crtc_kms->rotation_prop_id &&
+      !add_property (req, crtc_kms->primary_plane_id,
+                     crtc_kms->rotation_prop_id,
+                     crtc_kms->rotation_map[hw_transform]))
+    return FALSE;
+
+  if (meta_monitor_transform_is_rotated (hw_transform))
+    {
+      src_width = mode->height;
+      src_height = mode->width;
+    }
+  else
+    {
+      src_width = mode->width;
+      src_height = mode->height;
+    }
+
+  return add_plane_to_request (req,
+                               crtc_kms->primary_plane_id,
+                               &crtc_kms->primary_plane_props,
+                               crtc->crtc_id,
+                               fb_id,
+                               x, y,
+                               src_width, src_height,
+                               0, 0,
+                               mode->width, mode->height);
+}
+
+/*
+ * Adds a new framebuffer for the primary plane of @crtc to an atomic request,
+ * leaving the rest of the plane state as it is; i.e. a page flip.
+ */
+gboolean
+meta_crtc_kms_add_fb_to_request (MetaCrtc         *crtc,
+                                 drmModeAtomicReq *req,
+                                 uint32_t          fb_id)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+
+  if (!crtc_kms->primary_plane_id)
+    return FALSE;
+
+  return add_property (req, crtc_kms->primary_plane_id,
+                       crtc_kms->primary_plane_props.fb_id, fb_id);
+}
+
+static void
+invoke_overlay_closure (GClosure *closure,
+                        MetaCrtc *crtc)
+{
+  GValue params[] = {
+    G_VALUE_INIT,
+    G_VALUE_INIT
+  };
+
+  g_value_init (&params[0], G_TYPE_POINTER);
+  g_value_set_pointer (&params[0], closure);
+  g_value_init (&params[1], G_TYPE_OBJECT);
+  g_value_set_object (&params[1], meta_crtc_get_gpu (crtc));
+  g_closure_invoke (closure, NULL, 2, params, NULL);
+
+  g_value_unset (&params[1]);
+}
+
+static void
+set_overlay_plane (MetaKmsOverlayPlane *plane,
+                   uint32_t             fb_id,
+                   const MetaRectangle *src_rect,
+                   const MetaRectangle *dst_rect,
+                   GClosure            *closure)
+{
+  /* Replaced before it was ever committed */
+  g_clear_pointer (&plane->pending_closure, g_closure_unref);
+
+  plane->fb_id = fb_id;
+  plane->src_rect = src_rect ? *src_rect : (MetaRectangle) { 0 };
+  plane->dst_rect = dst_rect ? *dst_rect : (MetaRectangle) { 0 };
+  plane->pending_closure = closure ? g_closure_ref (closure) : NULL;
+  plane->dirty = TRUE;
+}
+
+static gboolean
+add_overlay_state_to_request (MetaCrtc            *crtc,
+                              MetaKmsOverlayPlane *plane,
+                              drmModeAtomicReq    *req,
+                              uint32_t             fb_id,
+                              const MetaRectangle *src_rect,
+                              const MetaRectangle *dst_rect)
+{
+  return add_plane_to_request (req,
+                               plane->plane_id,
+                               &plane->props,
+                               crtc->crtc_id,
+                               fb_id,
+                               src_rect->x, src_rect->y,
+                               src_rect->width, src_rect->height,
+                               dst_rect->x, dst_rect->y,
+                               dst_rect->width, dst_rect->height);
+}
+
+static gboolean
+add_overlay_plane_to_request (MetaCrtc            *crtc,
+                              MetaKmsOverlayPlane *plane,
+                              drmModeAtomicReq    *req)
+{
+  if (!crtc->current_mode)
+    set_overlay_plane (plane, 0, NULL, NULL, NULL);
+
+  if (plane->dirty)
+    {
+      /* Replaced before we learnt whether it was ever scanned out */
+      g_clear_pointer (&plane->in_flight_closure, g_closure_unref);
+
+      plane->in_flight = TRUE;
+      plane->in_flight_closure = g_steal_pointer (&plane->pending_closure);
+      plane->dirty = FALSE;
+    }
+
+  return add_overlay_state_to_request (crtc, plane, req,
+                                       plane->fb_id,
+                                       &plane->src_rect,
+                                       &plane->dst_rect);
+}
+
+/*
+ * Adds the state needed to turn off @crtc and all its planes to an atomic
+ * request.
+ */
+gboolean
+meta_crtc_kms_add_disable_to_request (MetaCrtc         *crtc,
+                                      drmModeAtomicReq *req)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+  unsigned int i;
+
+  if (!meta_crtc_kms_add_mode_to_request (crtc, req, 0))
+    return FALSE;
+
+  if (crtc_kms->primary_plane_id &&
+      !add_plane_to_request (req,
+                             crtc_kms->primary_plane_id,
+                             &crtc_kms->primary_plane_props,
+                             0, 0,
+                             0, 0, 0, 0,
+                             0, 0, 0, 0))
+    return FALSE;
+
+  if (crtc_kms->cursor_plane_id &&
+      !add_plane_to_request (req,
+                             crtc_kms->cursor_plane_id,
+                             &crtc_kms->cursor_plane_props,
+                             0, 0,
+                             0, 0, 0, 0,
+                             0, 0, 0, 0))
+    return FALSE;
+
+  for (i = 0; i < crtc_kms->overlay_planes->len; i++)
+    {
+      MetaKmsOverlayPlane *plane =
+        g_ptr_array_index (crtc_kms->overlay_planes, i);
+
+      set_overlay_plane (plane, 0, NULL, NULL, NULL);
+      if (!add_overlay_plane_to_request (crtc, plane, req))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+gboolean
+meta_crtc_kms_has_cursor_plane (MetaCrtc *crtc)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+
+  return crtc_kms->cursor_plane_id != 0;
+}
+
+/*
+ * Sets the cursor plane state to be committed with the next atomic update of
+ * the GPU. An @fb_id of 0 hides the cursor.
+ */
+void
+meta_crtc_kms_set_cursor (MetaCrtc *crtc,
+                          uint32_t  fb_id,
+                          int       x,
+                          int       y,
+                          int       width,
+                          int       height)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+
+  if (crtc_kms->cursor.fb_id == fb_id &&
+      (fb_id == 0 ||
+       (crtc_kms->cursor.x == x &&
+        crtc_kms->cursor.y == y &&
+        crtc_kms->cursor.width == width &&
+        crtc_kms->cursor.height == height)))
+    return;
+
+  crtc_kms->cursor.fb_id = fb_id;
+  crtc_kms->cursor.x = x;
+  crtc_kms->cursor.y = y;
+  crtc_kms->cursor.width = width;
+  crtc_kms->cursor.height = height;
+  crtc_kms->cursor.dirty = TRUE;
+}
+
+
+/*
+ * Adds the cursor plane state of @crtc to an atomic request if it changed
+ * since it was last added, or unconditionally if @force is set.
+ */
+gboolean
+meta_crtc_kms_add_cursor_to_request (MetaCrtc         *crtc,
+                                     drmModeAtomicReq *req,
+                                     gboolean          force)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+
+  if (!crtc_kms->cursor_plane_id)
+    return TRUE;
+
+  if (!crtc_kms->cursor.dirty && !force)
+    return TRUE;
+
+  crtc_kms->cursor.dirty = FALSE;
+
+  if (!crtc->current_mode)
+    crtc_kms->cursor.fb_id = 0;
+
+  return add_plane_to_request (req,
+                               crtc_kms->cursor_plane_id,
+                               &crtc_kms->cursor_plane_props,
+                               crtc->crtc_id,
+                               crtc_kms->cursor.fb_id,
+                               0, 0,
+                               crtc_kms->cursor.width,
+                               crtc_kms->cursor.height,
+                               crtc_kms->cursor.x,
+                               crtc_kms->cursor.y,
+                               crtc_kms->cursor.width,
+                               crtc_kms->cursor.height);
+}
+
+gboolean
+meta_crtc_kms_supports_vrr (MetaCrtc *crtc)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+
+  return crtc_kms->vrr_enabled_prop_id != 0;
+}
+
+/*
+ * Enables or disables variable refresh rate scanout on @crtc. With atomic
+ * modesetting, the change goes out with the next atomic update of the GPU.
+ */
+void
+meta_crtc_kms_set_vrr_enabled (MetaCrtc *crtc,
+                               gboolean  enabled)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+  MetaGpu *gpu = meta_crtc_get_gpu (crtc);
+  MetaGpuKms *gpu_kms = META_GPU_KMS (gpu);
+  int kms_fd;
+
+  if (!crtc_kms->vrr_enabled_prop_id)
+    return;
+
+  if (crtc_kms->vrr.enabled == enabled)
+    return;
+
+  crtc_kms->vrr.enabled = enabled;
+
+  if (meta_gpu_kms_is_atomic (gpu_kms))
+    {
+      crtc_kms->vrr.dirty = TRUE;
+      return;
+    }
+
+  kms_fd = meta_gpu_kms_get_fd (gpu_kms);
+  drmModeObjectSetProperty (kms_fd, crtc->crtc_id,
+                            DRM_MODE_OBJECT_CRTC,
+                            crtc_kms->vrr_enabled_prop_id,
+                            (uint64_t) enabled);
+}
+
+/*
+ * Adds the variable refresh rate state of @crtc to an atomic request if it
+ * changed since it was last added, or unconditionally if @force is set.
+ */
+gboolean
+meta_crtc_kms_add_vrr_to_request (MetaCrtc         *crtc,
+                                  drmModeAtomicReq *req,
+                                  gboolean          force)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+
+  if (!crtc_kms->vrr_enabled_prop_id)
+    return TRUE;
+
+  if (!crtc_kms->vrr.dirty && !force)
+    return TRUE;
+
+  crtc_kms->vrr.dirty = FALSE;
+
+  return add_property (req, crtc->crtc_id,
+                       crtc_kms->vrr_enabled_prop_id,
+                       (uint64_t) crtc_kms->vrr.enabled);
+}
+
+unsigned int
+meta_crtc_kms_get_n_overlay_planes (MetaCrtc *crtc)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+
+  return crtc_kms->overlay_planes->len;
+}
+
+/*
+ * Sets the state of an overlay plane to be committed with the next atomic
+ * update of the GPU, showing the @src_rect part of @fb_id at @dst_rect of
+ * the CRTC. An @fb_id of 0 turns the plane off.
+ *
+ * @closure, if any, is invoked when @fb_id is first scanned out, and
+ * unreferenced once it is not anymore; only then may @fb_id be removed.
+ */
+void
+meta_crtc_kms_set_overlay (MetaCrtc            *crtc,
+                           unsigned int         index,
+                           uint32_t             fb_id,
+                           const MetaRectangle *src_rect,
+                           const MetaRectangle *dst_rect,
+                           GClosure            *closure)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+  MetaKmsOverlayPlane *plane;
+
+  g_return_if_fail (index < crtc_kms->overlay_planes->len);
+
+  plane = g_ptr_array_index (crtc_kms->overlay_planes, index);
+  set_overlay_plane (plane, fb_id, src_rect, dst_rect, closure);
+}
+
+/*
+ * Adds the state of overlay plane @index to an atomic request without
+ * touching the pending state of the plane; for testing whether a
+ * configuration would work.
+ */
+gboolean
+meta_crtc_kms_add_overlay_test_to_request (MetaCrtc            *crtc,
+                                           drmModeAtomicReq    *req,
+                                           unsigned int         index,
+                                           uint32_t             fb_id,
+                                           const MetaRectangle *src_rect,
+                                           const MetaRectangle *dst_rect)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+
+  g_return_val_if_fail (index < crtc_kms->overlay_planes->len, FALSE);
+
+  return add_overlay_state_to_request (crtc,
+                                       g_ptr_array_index (crtc_kms->overlay_planes,
+                                                          index),
+                                       req,
+                                       fb_id,
+                                       src_rect,
+                                       dst_rect);
+}
+
+/*
+ * Adds the overlay planes of @crtc to an atomic request if they changed since
+ * they were last added, or unconditionally if @force is set.
+ */
+gboolean
+meta_crtc_kms_add_overlays_to_request (MetaCrtc         *crtc,
+                                       drmModeAtomicReq *req,
+                                       gboolean          force)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+  unsigned int i;
+
+  for (i = 0; i < crtc_kms->overlay_planes->len; i++)
+    {
+      MetaKmsOverlayPlane *plane =
+        g_ptr_array_index (crtc_kms->overlay_planes, i);
+
+      if (!plane->dirty && !force)
+        continue;
+
+      if (!add_overlay_plane_to_request (crtc, plane, req))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*
+ * Called when an atomic update including the planes of @crtc completed;
+ * @presented tells whether it was actually committed. Framebuffers that got
+ * scanned out have their closures invoked, and the ones they replaced are
+ * released.
+ */
+void
+meta_crtc_kms_planes_flipped (MetaCrtc *crtc,
+                              gboolean  presented)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+  unsigned int i;
+
+  for (i = 0; i < crtc_kms->overlay_planes->len; i++)
+    {
+      MetaKmsOverlayPlane *plane =
+        g_ptr_array_index (crtc_kms->overlay_planes, i);
+      GClosure *closure;
+
+      if (!plane->in_flight)
+        continue;
+
+      plane->in_flight = FALSE;
+      closure = g_steal_pointer (&plane->in_flight_closure);
+
+      if (!presented)
+        {
+          if (closure)
+            g_closure_unref (closure);
+          continue;
+        }
+
+      if (closure)
+        invoke_overlay_closure (closure, crtc);
+
+      if (plane->current_closure)
+        g_closure_unref (plane->current_closure);
+      plane->current_closure = closure;
+    }
+}
+
+/*
+ * Whether @crtc has plane or variable refresh rate state that was changed but
+ * not yet added to an atomic request.
+ */
+gboolean
+meta_crtc_kms_has_dirty_planes (MetaCrtc *crtc)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+  unsigned int i;
+
+  if (crtc_kms->cursor.dirty || crtc_kms->vrr.dirty)
+    return TRUE;
+
+  for (i = 0; i < crtc_kms->overlay_planes->len; i++)
+    {
+      MetaKmsOverlayPlane *plane =
+        g_ptr_array_index (crtc_kms->overlay_planes, i);
+
+      if (plane->dirty)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
 static inline uint32_t *
 formats_ptr (struct drm_format_modifier_blob *blob)
 {
@@ -299,24 +938,91 @@ parse_transforms (MetaCrtc          *crtc,
     }
 }
 
-static gboolean
-is_primary_plane (MetaGpu                   *gpu,
-                  drmModeObjectPropertiesPtr props)
+static int
+get_plane_type (MetaGpu                   *gpu,
+                drmModeObjectPropertiesPtr props)
 {
   drmModePropertyPtr prop;
   int idx;
 
   idx = find_property_index (gpu, props, "type", &prop);
   if (idx < 0)
-    return FALSE;
+    return -1;
+
+  drmModeFreeProperty (prop);
+  return props->prop_values[idx];
+}
+
+static uint32_t
+find_property_id (MetaGpu                    *gpu,
+                  drmModeObjectPropertiesPtr  props,
+                  const char                 *prop_name)
+{
+  drmModePropertyPtr prop;
+  int idx;
+
+  idx = find_property_index (gpu, props, prop_name, &prop);
+  if (idx < 0)
+    return 0;
 
   drmModeFreeProperty (prop);
-  return props->prop_values[idx] == DRM_PLANE_TYPE_PRIMARY;
+  return props->props[idx];
 }
 
 static void
-init_crtc_rotations (MetaCrtc *crtc,
-                     MetaGpu  *gpu)
+find_plane_properties (MetaGpu                    *gpu,
+                       drmModeObjectPropertiesPtr  props,
+                       MetaKmsPlaneProps          *plane_props)
+{
+  *plane_props = (MetaKmsPlaneProps) {
+    .fb_id = find_property_id (gpu, props, "FB_ID"),
+    .crtc_id = find_property_id (gpu, props, "CRTC_ID"),
+    .src_x = find_property_id (gpu, props, "SRC_X"),
+    .src_y = find_property_id (gpu, props, "SRC_Y"),
+    .src_w = find_property_id (gpu, props, "SRC_W"),
+    .src_h = find_property_id (gpu, props, "SRC_H"),
+    .crtc_x = find_property_id (gpu, props, "CRTC_X"),
+    .crtc_y = find_property_id (gpu, props, "CRTC_Y"),
+    .crtc_w = find_property_id (gpu, props, "CRTC_W"),
+    .crtc_h = find_property_id (gpu, props, "CRTC_H"),
+  };
+}
+
+/*
+ * Overlay planes are handed out to the first CRTC they can be used with, so
+ * that no two CRTCs ever try to use the same plane.
+ */
+static gboolean
+is_overlay_plane_usable (MetaCrtc     *crtc,
+                         drmModePlane *drm_plane)
+{
+  MetaCrtcKms *crtc_kms = crtc->driver_private;
+  unsigned int i;
+
+  if (ffs (drm_plane->possible_crtcs) - 1 != (int) crtc_kms->index)
+    return FALSE;
+
+  for (i = 0; i < drm_plane->count_formats; i++)
+    {
+      if (drm_plane->formats[i] == DRM_FORMAT_XRGB8888)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+free_overlay_plane (MetaKmsOverlayPlane *plane)
+{
+  g_clear_pointer (&plane->pending_closure, g_closure_unref);
+  g_clear_pointer (&plane->in_flight_closure, g_closure_unref);
+  g_clear_pointer (&plane->current_closure, g_closure_unref);
+  g_free (plane);
+}
+
+static void
+init_crtc_planes (MetaCrtc *crtc,
+                  MetaGpu  *gpu)
 {
   MetaCrtcKms *crtc_kms = crtc->driver_private;
   MetaGpuKms *gpu_kms = META_GPU_KMS (gpu);
@@ -343,15 +1049,40 @@ init_crtc_rotations (MetaCrtc *crtc,
 
       if ((drm_plane->possible_crtcs & (1 << crtc_kms->index)))
         {
+          int plane_type;
+
           props = drmModeObjectGetProperties (kms_fd,
                                               drm_plane->plane_id,
                                               DRM_MODE_OBJECT_PLANE);
 
-          if (props && is_primary_plane (gpu, props))
+          plane_type = props ? get_plane_type (gpu, props) : -1;
+
+          if (plane_type == DRM_PLANE_TYPE_CURSOR &&
+              !crtc_kms->cursor_plane_id &&
+              meta_gpu_kms_is_atomic (gpu_kms))
+            {
+              crtc_kms->cursor_plane_id = drm_plane->plane_id;
+              find_plane_properties (gpu, props,
+                                     &crtc_kms->cursor_plane_props);
+            }
+          else if (plane_type == DRM_PLANE_TYPE_OVERLAY &&
+                   is_overlay_plane_usable (crtc, drm_plane) &&
+                   meta_gpu_kms_is_atomic (gpu_kms))
+            {
+              MetaKmsOverlayPlane *plane;
+
+              plane = g_new0 (MetaKmsOverlayPlane, 1);
+              plane->plane_id = drm_plane->plane_id;
+              find_plane_properties (gpu, props, &plane->props);
+              g_ptr_array_add (crtc_kms->overlay_planes, plane);
+            }
+          else if (plane_type == DRM_PLANE_TYPE_PRIMARY)
             {
               int rotation_idx, fmts_idx;
 
               crtc_kms->primary_plane_id = drm_plane->plane_id;
+              find_plane_properties (gpu, props,
+                                     &crtc_kms->primary_plane_props);
               rotation_idx = find_property_index (gpu, props,
                                                   "rotation", &prop);
               if (rotation_idx >= 0)
@@ -413,6 +1144,13 @@ find_crtc_properties (MetaCrtc   *crtc,
       else if ((prop->flags & DRM_MODE_PROP_RANGE) &&
                strcmp (prop->name, "underscan vborder") == 0)
         crtc_kms->underscan_vborder_prop_id = prop->prop_id;
+      else if (strcmp (prop->name, "MODE_ID") == 0)
+        crtc_kms->mode_id_prop_id = prop->prop_id;
+      else if (strcmp (prop->name, "ACTIVE") == 0)
+        crtc_kms->active_prop_id = prop->prop_id;
+      else if ((prop->flags & DRM_MODE_PROP_RANGE) &&
+               strcmp (prop->name, "VRR_ENABLED") == 0)
+        crtc_kms->vrr_enabled_prop_id = prop->prop_id;
 
       drmModeFreeProperty (prop);
     }
@@ -427,6 +1165,7 @@ meta_crtc_destroy_notify (MetaCrtc *crtc)
 
   if (crtc_kms->modifiers_xrgb8888)
     g_array_free (crtc_kms->modifiers_xrgb8888, TRUE);
+  g_ptr_array_free (crtc_kms->overlay_planes, TRUE);
   g_free (crtc->driver_private);
 }
 
@@ -470,12 +1209,14 @@ meta_create_kms_crtc (MetaGpuKms   *gpu_kms,
 
   crtc_kms = g_new0 (MetaCrtcKms, 1);
   crtc_kms->index = crtc_index;
+  crtc_kms->overlay_planes =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) free_overlay_plane);
 
   crtc->driver_private = crtc_kms;
   crtc->driver_notify = (GDestroyNotify) meta_crtc_destroy_notify;
 
   find_crtc_properties (crtc, gpu_kms);
-  init_crtc_rotations (crtc, gpu);
+  init_crtc_planes (crtc, gpu);
 
   return crtc;
 }
@@ -40,6 +40,72 @@ void meta_crtc_kms_set_underscan (MetaCrtc *crtc,
 GArray * meta_crtc_kms_get_modifiers (MetaCrtc *crtc,
                                       uint32_t  format);
 
+gboolean meta_crtc_kms_add_mode_to_request (MetaCrtc         *crtc,
+                                            drmModeAtomicReq *req,
+                                            uint32_t          mode_blob_id);
+
+gboolean meta_crtc_kms_add_primary_plane_to_request (MetaCrtc             *crtc,
+                                                     drmModeAtomicReq     *req,
+                                                     MetaCrtcMode         *mode,
+                                                     MetaMonitorTransform  transform,
+                                                     uint32_t              fb_id,
+                                                     int                   x,
+                                                     int                   y);
+
+gboolean meta_crtc_kms_add_fb_to_request (MetaCrtc         *crtc,
+                                          drmModeAtomicReq *req,
+                                          uint32_t          fb_id);
+
+gboolean meta_crtc_kms_add_disable_to_request (MetaCrtc         *crtc,
+                                               drmModeAtomicReq *req);
+
+gboolean meta_crtc_kms_has_cursor_plane (MetaCrtc *crtc);
+
+void meta_crtc_kms_set_cursor (MetaCrtc *crtc,
+                               uint32_t  fb_id,
+                               int       x,
+                               int       y,
+                               int       width,
+                               int       height);
+
+gboolean meta_crtc_kms_add_cursor_to_request (MetaCrtc         *crtc,
+                                              drmModeAtomicReq *req,
+                                              gboolean          force);
+
+gboolean meta_crtc_kms_supports_vrr (MetaCrtc *crtc);
+
+void meta_crtc_kms_set_vrr_enabled (MetaCrtc *crtc,
+                                    gboolean  enabled);
+
+gboolean meta_crtc_kms_add_vrr_to_request (MetaCrtc         *crtc,
+                                           drmModeAtomicReq *req,
+                                           gboolean          force);
+
+unsigned int meta_crtc_kms_get_n_overlay_planes (MetaCrtc *crtc);
+
+void meta_crtc_kms_set_overlay (MetaCrtc            *crtc,
+                                unsigned int         index,
+                                uint32_t             fb_id,
+                                const MetaRectangle *src_rect,
+                                const MetaRectangle *dst_rect,
+                                GClosure            *closure);
+
+gboolean meta_crtc_kms_add_overlay_test_to_request (MetaCrtc            *crtc,
+                                                    drmModeAtomicReq    *req,
+                                                    unsigned int         index,
+                                                    uint32_t             fb_id,
+                                                    const MetaRectangle *src_rect,
+                                                    const MetaRectangle *dst_rect);
+
+gboolean meta_crtc_kms_add_overlays_to_request (MetaCrtc         *crtc,
+                                                drmModeAtomicReq *req,
+                                                gboolean          force);
+
+void meta_crtc_kms_planes_flipped (MetaCrtc *crtc,
+                                   gboolean  presented);
+
+gboolean meta_crtc_kms_has_dirty_planes (MetaCrtc *crtc);
+
 MetaCrtc * meta_create_kms_crtc (MetaGpuKms   *gpu_kms,
                                  drmModeCrtc  *drm_crtc,
                                  unsigned int  crtc_index);
@@ -29,16 +29,19 @@
 #include <string.h>
 #include <gbm.h>
 #include <xf86drm.h>
+#include <xf86drmMode.h>
 #include <errno.h>
 
 #include <meta/util.h>
 #include <meta/meta-backend.h>
+#include <clutter/evdev/clutter-evdev.h>
 
 #include "backends/meta-backend-private.h"
 #include "backends/meta-logical-monitor.h"
 #include "backends/meta-monitor.h"
 #include "backends/meta-monitor-manager-private.h"
 #include "backends/meta-output.h"
+#include "backends/native/meta-crtc-kms.h"
 #include "backends/native/meta-renderer-native.h"
 #include "core/boxes-private.h"
 #include "meta/boxes.h"
@@ -79,6 +82,19 @@ struct _MetaCursorRendererNativePrivate
 
   MetaCursorSprite *last_cursor;
   guint animation_timeout_id;
+
+  /*
+   * The CRTCs the hardware cursor can be shown on, so that the input thread
+   * can move it without going through the main loop; see
+   * meta_cursor_renderer_native_move_hw_cursor().
+   */
+  GMutex hw_cursor_lock;
+  GArray *hw_cursor_crtcs;
+  ClutterPoint hw_cursor_offset;
+  ClutterSize hw_cursor_size;
+  gboolean hw_cursor_moved;
+  gboolean hw_cursor_invalidated;
+  guint hw_cursor_update_id;
 };
 typedef struct _MetaCursorRendererNativePrivate MetaCursorRendererNativePrivate;
 
@@ -157,6 +173,12 @@ meta_cursor_renderer_native_finalize (GObject *object)
   if (priv->animation_timeout_id)
     g_source_remove (priv->animation_timeout_id);
 
+  if (priv->hw_cursor_update_id)
+    g_source_remove (priv->hw_cursor_update_id);
+
+  g_array_free (priv->hw_cursor_crtcs, TRUE);
+  g_mutex_clear (&priv->hw_cursor_lock);
+
   G_OBJECT_CLASS (meta_cursor_renderer_native_parent_class)->finalize (object);
 }
 
@@ -198,6 +220,27 @@ set_pending_cursor_sprite_gbm_bo (MetaCursorSprite *cursor_sprite,
   cursor_gpu_state->pending_bo_state = META_CURSOR_GBM_BO_STATE_SET;
 }
 
+static struct gbm_bo *
+get_cursor_sprite_gbm_bo (MetaCursorSprite *cursor_sprite,
+                          MetaGpuKms       *gpu_kms)
+{
+  MetaCursorNativePrivate *cursor_priv;
+  MetaCursorNativeGpuState *cursor_gpu_state;
+
+  cursor_priv = get_cursor_priv (cursor_sprite);
+  if (!cursor_priv)
+    return NULL;
+
+  cursor_gpu_state = get_cursor_gpu_state (cursor_priv, gpu_kms);
+  if (!cursor_gpu_state)
+    return NULL;
+
+  if (cursor_gpu_state->pending_bo_state == META_CURSOR_GBM_BO_STATE_SET)
+    return get_pending_cursor_sprite_gbm_bo (cursor_gpu_state);
+  else
+    return get_active_cursor_sprite_gbm_bo (cursor_gpu_state);
+}
+
 static void
 set_crtc_cursor (MetaCursorRendererNative *native,
                  MetaCrtc                 *crtc,
@@ -229,7 +272,9 @@ set_crtc_cursor (MetaCursorRendererNative *native,
       else
         bo = get_active_cursor_sprite_gbm_bo (cursor_gpu_state);
 
-      if (!priv->hw_state_invalidated && bo == crtc->cursor_renderer_private)
+      if (!priv->hw_state_invalidated &&
+          !priv->hw_cursor_invalidated &&
+          bo == crtc->cursor_renderer_private)
         return;
 
       crtc->cursor_renderer_private = bo;
@@ -261,7 +306,9 @@ set_crtc_cursor (MetaCursorRendererNative *native,
     }
   else
     {
-      if (priv->hw_state_invalidated || crtc->cursor_renderer_private != NULL)
+      if (priv->hw_state_invalidated ||
+          priv->hw_cursor_invalidated ||
+          crtc->cursor_renderer_private != NULL)
         {
           drmModeSetCursor2 (kms_fd, crtc->crtc_id, 0, 0, 0, 0, 0);
           crtc->cursor_renderer_private = NULL;
@@ -269,6 +316,107 @@ set_crtc_cursor (MetaCursorRendererNative *native,
     }
 }
 
+static void
+destroy_cursor_fb (struct gbm_bo *bo,
+                   void          *user_data)
+{
+  struct gbm_device *gbm_device = gbm_bo_get_device (bo);
+
+  drmModeRmFB (gbm_device_get_fd (gbm_device), GPOINTER_TO_UINT (user_data));
+}
+
+static uint32_t
+ensure_cursor_fb (struct gbm_bo *bo)
+{
+  struct gbm_device *gbm_device = gbm_bo_get_device (bo);
+  uint32_t handles[4] = { gbm_bo_get_handle (bo).u32, };
+  uint32_t pitches[4] = { gbm_bo_get_stride (bo), };
+  uint32_t offsets[4] = { 0 };
+  uint32_t fb_id;
+
+  fb_id = GPOINTER_TO_UINT (gbm_bo_get_user_data (bo));
+  if (fb_id)
+    return fb_id;
+
+  if (drmModeAddFB2 (gbm_device_get_fd (gbm_device),
+                     gbm_bo_get_width (bo),
+                     gbm_bo_get_height (bo),
+                     GBM_FORMAT_ARGB8888,
+                     handles, pitches, offsets,
+                     &fb_id, 0) != 0)
+    return 0;
+
+  gbm_bo_set_user_data (bo, GUINT_TO_POINTER (fb_id), destroy_cursor_fb);
+
+  return fb_id;
+}
+
+/*
+ * With atomic modesetting, the cursor is a plane like any other: the cursor
+ * buffer gets a framebuffer and the plane state is committed along with the
+ * next update of the GPU.
+ */
+static void
+set_crtc_cursor_plane (MetaCursorRendererNative *native,
+                       MetaCrtc                 *crtc,
+                       MetaCursorSprite         *cursor_sprite,
+                       int                       x,
+                       int                       y)
+{
+  MetaCursorRendererNativePrivate *priv = meta_cursor_renderer_native_get_instance_private (native);
+  MetaCursorRendererNativeGpuData *cursor_renderer_gpu_data;
+  MetaCursorNativePrivate *cursor_priv;
+  MetaCursorNativeGpuState *cursor_gpu_state;
+  MetaGpuKms *gpu_kms;
+  struct gbm_bo *bo;
+  uint32_t fb_id;
+
+  if (!cursor_sprite)
+    {
+      meta_crtc_kms_set_cursor (crtc, 0, 0, 0, 0, 0);
+      crtc->cursor_renderer_private = NULL;
+      return;
+    }
+
+  gpu_kms = META_GPU_KMS (meta_crtc_get_gpu (crtc));
+  cursor_renderer_gpu_data =
+    meta_cursor_renderer_native_gpu_data_from_gpu (gpu_kms);
+
+  cursor_priv = get_cursor_priv (cursor_sprite);
+  cursor_gpu_state = get_cursor_gpu_state (cursor_priv, gpu_kms);
+
+  if (cursor_gpu_state->pending_bo_state == META_CURSOR_GBM_BO_STATE_SET)
+    bo = get_pending_cursor_sprite_gbm_bo (cursor_gpu_state);
+  else
+    bo = get_active_cursor_sprite_gbm_bo (cursor_gpu_state);
+
+  fb_id = ensure_cursor_fb (bo);
+  if (!fb_id)
+    {
+      if (errno != EACCES)
+        {
+          g_warning ("drmModeAddFB2 for cursor failed with (%s), "
+                     "drawing cursor with OpenGL from now on",
+                     strerror (errno));
+          priv->has_hw_cursor = FALSE;
+          cursor_renderer_gpu_data->hw_cursor_broken = TRUE;
+        }
+      return;
+    }
+
+  crtc->cursor_renderer_private = bo;
+  meta_crtc_kms_set_cursor (crtc, fb_id, x, y,
+                            cursor_renderer_gpu_data->cursor_width,
+                            cursor_renderer_gpu_data->cursor_height);
+
+  if (cursor_gpu_state->pending_bo_state == META_CURSOR_GBM_BO_STATE_SET)
+    {
+      cursor_gpu_state->active_bo =
+        (cursor_gpu_state->active_bo + 1) % HW_CURSOR_BUFFER_COUNT;
+      cursor_gpu_state->pending_bo_state = META_CURSOR_GBM_BO_STATE_NONE;
+    }
+}
+
 typedef struct
 {
   MetaCursorRendererNative *in_cursor_renderer_native;
@@ -277,6 +425,7 @@ typedef struct
   MetaCursorSprite *in_cursor_sprite;
 
   gboolean out_painted;
+  GArray *out_hw_cursor_crtcs;
 } UpdateCrtcCursorData;
 
 static gboolean
@@ -291,9 +440,14 @@ update_monitor_crtc_cursor (MetaMonitor         *monitor,
     data->in_cursor_renderer_native;
   MetaCursorRendererNativePrivate *priv =
     meta_cursor_renderer_native_get_instance_private (cursor_renderer_native);
+  MetaCrtc *crtc = monitor_crtc_mode->output->crtc;
+  MetaGpuKms *gpu_kms = META_GPU_KMS (meta_crtc_get_gpu (crtc));
+  int kms_fd = meta_gpu_kms_get_fd (gpu_kms);
   ClutterRect scaled_crtc_rect;
   float scale;
   int crtc_x, crtc_y;
+  float crtc_cursor_x, crtc_cursor_y;
+  gboolean shown;
 
   if (meta_is_stage_views_scaled ())
     scale = meta_logical_monitor_get_scale (data->in_logical_monitor);
@@ -316,36 +470,87 @@ update_monitor_crtc_cursor (MetaMonitor         *monitor,
     },
   };
 
-  if (priv->has_hw_cursor &&
-      clutter_rect_intersection (&scaled_crtc_rect,
-                                 &data->in_local_cursor_rect,
-                                 NULL))
-    {
-      MetaGpuKms *gpu_kms;
-      int kms_fd;
-      float crtc_cursor_x, crtc_cursor_y;
+  shown = (priv->has_hw_cursor &&
+           clutter_rect_intersection (&scaled_crtc_rect,
+                                      &data->in_local_cursor_rect,
+                                      NULL));
 
-      set_crtc_cursor (data->in_cursor_renderer_native,
-                       monitor_crtc_mode->output->crtc,
-                       data->in_cursor_sprite);
+  crtc_cursor_x = (data->in_local_cursor_rect.origin.x -
+                   scaled_crtc_rect.origin.x) * scale;
+  crtc_cursor_y = (data->in_local_cursor_rect.origin.y -
+                   scaled_crtc_rect.origin.y) * scale;
 
-      gpu_kms = META_GPU_KMS (meta_monitor_get_gpu (monitor));
-      kms_fd = meta_gpu_kms_get_fd (gpu_kms);
-      crtc_cursor_x = (data->in_local_cursor_rect.origin.x -
-                       scaled_crtc_rect.origin.x) * scale;
-      crtc_cursor_y = (data->in_local_cursor_rect.origin.y -
-                       scaled_crtc_rect.origin.y) * scale;
-      drmModeMoveCursor (kms_fd,
-                         monitor_crtc_mode->output->crtc->crtc_id,
-                         roundf (crtc_cursor_x),
-                         roundf (crtc_cursor_y));
+  if (shown)
+    {
+      if (meta_crtc_kms_has_cursor_plane (crtc))
+        {
+          set_crtc_cursor_plane (data->in_cursor_renderer_native,
+                                 crtc,
+                                 data->in_cursor_sprite,
+                                 roundf (crtc_cursor_x),
+                                 roundf (crtc_cursor_y));
+        }
+      else
+        {
+          set_crtc_cursor (data->in_cursor_renderer_native,
+                           crtc,
+                           data->in_cursor_sprite);
+
+          drmModeMoveCursor (kms_fd,
+                             crtc->crtc_id,
+                             roundf (crtc_cursor_x),
+                             roundf (crtc_cursor_y));
+        }
 
       data->out_painted = data->out_painted || TRUE;
     }
   else
     {
-      set_crtc_cursor (data->in_cursor_renderer_native,
-                       monitor_crtc_mode->output->crtc, NULL);
+      if (meta_crtc_kms_has_cursor_plane (crtc))
+        set_crtc_cursor_plane (data->in_cursor_renderer_native,
+                               crtc, NULL, 0, 0);
+      else
+        set_crtc_cursor (data->in_cursor_renderer_native, crtc, NULL);
+    }
+
+  /*
+   * Let the input thread know about every CRTC, not only the ones showing
+   * the cursor right now, so that it can move the cursor from one to the
+   * other while the main thread is busy.
+   */
+  if (priv->has_hw_cursor && data->in_cursor_sprite)
+    {
+      MetaCursorRendererNativeGpuData *cursor_renderer_gpu_data =
+        meta_cursor_renderer_native_gpu_data_from_gpu (gpu_kms);
+      MetaHwCursorCrtc hw_cursor_crtc;
+      struct gbm_bo *bo;
+      int hot_x, hot_y;
+
+      bo = get_cursor_sprite_gbm_bo (data->in_cursor_sprite, gpu_kms);
+      meta_cursor_sprite_get_hotspot (data->in_cursor_sprite, &hot_x, &hot_y);
+
+      hw_cursor_crtc = (MetaHwCursorCrtc) {
+        .kms_fd = kms_fd,
+        .crtc_id = crtc->crtc_id,
+        .rect = {
+          .origin = {
+            .x = data->in_logical_monitor->rect.x + scaled_crtc_rect.origin.x,
+            .y = data->in_logical_monitor->rect.y + scaled_crtc_rect.origin.y
+          },
+          .size = scaled_crtc_rect.size
+        },
+        .scale = scale,
+        .has_cursor_plane = meta_crtc_kms_has_cursor_plane (crtc),
+        .handle = bo ? gbm_bo_get_handle (bo).u32 : 0,
+        .width = cursor_renderer_gpu_data->cursor_width,
+        .height = cursor_renderer_gpu_data->cursor_height,
+        .hot_x = hot_x,
+        .hot_y = hot_y,
+        .shown = shown,
+        .x = roundf (crtc_cursor_x),
+        .y = roundf (crtc_cursor_y)
+      };
+      g_array_append_val (data->out_hw_cursor_crtcs, hw_cursor_crtc);
     }
 
   return TRUE;
@@ -358,15 +563,53 @@ update_hw_cursor (MetaCursorRendererNative *native,
   MetaCursorRendererNativePrivate *priv = meta_cursor_renderer_native_get_instance_private (native);
   MetaCursorRenderer *renderer = META_CURSOR_RENDERER (native);
   MetaMonitorManager *monitor_manager = priv->monitor_manager;
+  ClutterDeviceManager *device_manager = clutter_device_manager_get_default ();
   GList *logical_monitors;
   GList *l;
   ClutterRect rect;
+  ClutterPoint offset = { 0 };
+  GArray *hw_cursor_crtcs;
   gboolean painted = FALSE;
 
+  /*
+   * The input thread may have moved the pointer further than the main thread
+   * knows of yet; place the cursor where the input thread put it, and keep it
+   * from moving the cursor again until the CRTCs are updated, so the update
+   * never takes the cursor back to an older position.
+   */
+  clutter_evdev_lock_libinput (device_manager);
+  g_mutex_lock (&priv->hw_cursor_lock);
+
   if (cursor_sprite)
-    rect = meta_cursor_renderer_calculate_rect (renderer, cursor_sprite);
+    {
+      int hot_x, hot_y;
+      float texture_scale;
+      float x, y;
+
+      rect = meta_cursor_renderer_calculate_rect (renderer, cursor_sprite);
+
+      meta_cursor_sprite_get_hotspot (cursor_sprite, &hot_x, &hot_y);
+      texture_scale = meta_cursor_sprite_get_texture_scale (cursor_sprite);
+      offset.x = -(hot_x * texture_scale);
+      offset.y = -(hot_y * texture_scale);
+
+      if (clutter_evdev_get_predicted_pointer_position (device_manager,
+                                                        &x, &y))
+        {
+          rect.origin.x = x + offset.x;
+          rect.origin.y = y + offset.y;
+        }
+    }
   else
-    rect = (ClutterRect) { 0 };
+    {
+      rect = (ClutterRect) { 0 };
+    }
+
+  /* Cursors shown, hidden or moved by the input thread need to be set again */
+  priv->hw_cursor_invalidated = priv->hw_cursor_moved;
+  priv->hw_cursor_moved = FALSE;
+
+  hw_cursor_crtcs = g_array_new (FALSE, FALSE, sizeof (MetaHwCursorCrtc));
 
   logical_monitors =
     meta_monitor_manager_get_logical_monitors (monitor_manager);
@@ -387,7 +630,8 @@ update_hw_cursor (MetaCursorRendererNative *native,
           },
           .size = rect.size
         },
-        .in_cursor_sprite = cursor_sprite
+        .in_cursor_sprite = cursor_sprite,
+        .out_hw_cursor_crtcs = hw_cursor_crtcs
       };
 
       monitors = meta_logical_monitor_get_monitors (logical_monitor);
@@ -407,6 +651,22 @@ update_hw_cursor (MetaCursorRendererNative *native,
     }
 
   priv->hw_state_invalidated = FALSE;
+  priv->hw_cursor_invalidated = FALSE;
+
+  g_array_free (priv->hw_cursor_crtcs, TRUE);
+  priv->hw_cursor_crtcs = hw_cursor_crtcs;
+  priv->hw_cursor_offset = offset;
+  priv->hw_cursor_size = rect.size;
+
+  for (l = meta_monitor_manager_get_gpus (monitor_manager); l; l = l->next)
+    {
+      MetaGpuKms *gpu_kms = META_GPU_KMS (l->data);
+
+      meta_gpu_kms_update_planes (gpu_kms);
+    }
+
+  g_mutex_unlock (&priv->hw_cursor_lock);
+  clutter_evdev_unlock_libinput (device_manager);
 
   if (painted)
     meta_cursor_renderer_emit_painted (renderer, cursor_sprite);
@@ -1095,6 +1355,11 @@ meta_cursor_renderer_native_new (MetaBackend *backend)
 static void
 meta_cursor_renderer_native_init (MetaCursorRendererNative *native)
 {
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+
+  g_mutex_init (&priv->hw_cursor_lock);
+  priv->hw_cursor_crtcs = g_array_new (FALSE, FALSE, sizeof (MetaHwCursorCrtc));
 }
 
 void
@@ -1102,3 +1367,149 @@ meta_cursor_renderer_native_force_update (MetaCursorRendererNative *native)
 {
   force_update_hw_cursor (native);
 }
+
+/*
+ * Decides what to do with the hardware cursor on @hw_cursor_crtc for it to
+ * cover @cursor_rect, given in stage coordinates, and updates the state of
+ * @hw_cursor_crtc accordingly.
+ */
+MetaHwCursorUpdate
+meta_hw_cursor_crtc_update (MetaHwCursorCrtc *hw_cursor_crtc,
+                            ClutterRect      *cursor_rect)
+{
+  int x, y;
+
+  if (!clutter_rect_intersection (&hw_cursor_crtc->rect, cursor_rect, NULL))
+    {
+      if (!hw_cursor_crtc->shown)
+        return META_HW_CURSOR_UPDATE_NONE;
+
+      hw_cursor_crtc->shown = FALSE;
+      return META_HW_CURSOR_UPDATE_HIDE;
+    }
+
+  x = roundf ((cursor_rect->origin.x - hw_cursor_crtc->rect.origin.x) *
+              hw_cursor_crtc->scale);
+  y = roundf ((cursor_rect->origin.y - hw_cursor_crtc->rect.origin.y) *
+              hw_cursor_crtc->scale);
+
+  if (hw_cursor_crtc->shown &&
+      hw_cursor_crtc->x == x &&
+      hw_cursor_crtc->y == y)
+    return META_HW_CURSOR_UPDATE_NONE;
+
+  hw_cursor_crtc->x = x;
+  hw_cursor_crtc->y = y;
+
+  if (!hw_cursor_crtc->shown)
+    {
+      hw_cursor_crtc->shown = TRUE;
+      return META_HW_CURSOR_UPDATE_SHOW;
+    }
+
+  return META_HW_CURSOR_UPDATE_MOVE;
+}
+
+static gboolean
+update_hw_cursor_idle (gpointer user_data)
+{
+  MetaCursorRendererNative *native = user_data;
+  MetaCursorRenderer *renderer = META_CURSOR_RENDERER (native);
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+
+  g_mutex_lock (&priv->hw_cursor_lock);
+  priv->hw_cursor_update_id = 0;
+  g_mutex_unlock (&priv->hw_cursor_lock);
+
+  update_hw_cursor (native, meta_cursor_renderer_get_cursor (renderer));
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Moves the hardware cursor to the pointer position (@x, @y). This is meant
+ * to be called from the input thread, so the cursor keeps up with the pointer
+ * even when the main loop is busy.
+ *
+ * Cursors set with the legacy cursor API are shown, moved and hidden right
+ * away, on every CRTC the main thread last told about. Cursor planes are only
+ * ever committed by the main thread, together with the rest of the atomic
+ * state; it gets woken up to do so, and picks up the predicted pointer
+ * position when it does.
+ */
+void
+meta_cursor_renderer_native_move_hw_cursor (MetaCursorRendererNative *native,
+                                            float                     x,
+                                            float                     y)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  ClutterRect cursor_rect;
+  gboolean needs_plane_update = FALSE;
+  unsigned int i;
+
+  g_mutex_lock (&priv->hw_cursor_lock);
+
+  cursor_rect = (ClutterRect) {
+    .origin = {
+      .x = x + priv->hw_cursor_offset.x,
+      .y = y + priv->hw_cursor_offset.y
+    },
+    .size = priv->hw_cursor_size
+  };
+
+  for (i = 0; i < priv->hw_cursor_crtcs->len; i++)
+    {
+      MetaHwCursorCrtc *hw_cursor_crtc =
+        &g_array_index (priv->hw_cursor_crtcs, MetaHwCursorCrtc, i);
+      MetaHwCursorUpdate update;
+
+      update = meta_hw_cursor_crtc_update (hw_cursor_crtc, &cursor_rect);
+      if (update == META_HW_CURSOR_UPDATE_NONE)
+        continue;
+
+      if (hw_cursor_crtc->has_cursor_plane)
+        {
+          needs_plane_update = TRUE;
+          continue;
+        }
+
+      switch (update)
+        {
+        case META_HW_CURSOR_UPDATE_SHOW:
+          drmModeSetCursor2 (hw_cursor_crtc->kms_fd,
+                             hw_cursor_crtc->crtc_id,
+                             hw_cursor_crtc->handle,
+                             hw_cursor_crtc->width,
+                             hw_cursor_crtc->height,
+                             hw_cursor_crtc->hot_x,
+                             hw_cursor_crtc->hot_y);
+          /* fall through */
+        case META_HW_CURSOR_UPDATE_MOVE:
+          drmModeMoveCursor (hw_cursor_crtc->kms_fd,
+                             hw_cursor_crtc->crtc_id,
+                             hw_cursor_crtc->x,
+                             hw_cursor_crtc->y);
+          break;
+        case META_HW_CURSOR_UPDATE_HIDE:
+          drmModeSetCursor2 (hw_cursor_crtc->kms_fd,
+                             hw_cursor_crtc->crtc_id,
+                             0, 0, 0, 0, 0);
+          break;
+        case META_HW_CURSOR_UPDATE_NONE:
+          break;
+        }
+
+      priv->hw_cursor_moved = TRUE;
+    }
+
+  if (needs_plane_update && !priv->hw_cursor_update_id)
+    {
+      priv->hw_cursor_update_id = g_idle_add (update_hw_cursor_idle, native);
+      g_source_set_name_by_id (priv->hw_cursor_update_id,
+                               "[mutter] update_hw_cursor_idle");
+    }
+
+  g_mutex_unlock (&priv->hw_cursor_lock);
+}
@@ -25,8 +25,44 @@
 #ifndef META_CURSOR_RENDERER_NATIVE_H
 #define META_CURSOR_RENDERER_NATIVE_H
 
+#include <stdint.h>
+
 #include "meta-cursor-renderer.h"
 
+/*
+ * A CRTC the hardware cursor can be shown on, as seen by the input thread.
+ * @rect is the area of the CRTC in stage coordinates, and (@x, @y) is the
+ * position of the cursor within the CRTC, valid if @shown is TRUE. @handle,
+ * @width, @height, @hot_x and @hot_y describe the cursor buffer to use
+ * with the legacy cursor API.
+ */
+typedef struct _MetaHwCursorCrtc
+{
+  int kms_fd;
+  uint32_t crtc_id;
+  ClutterRect rect;
+  float scale;
+  gboolean has_cursor_plane;
+
+  uint32_t handle;
+  int width;
+  int height;
+  int hot_x;
+  int hot_y;
+
+  gboolean shown;
+  int x;
+  int y;
+} MetaHwCursorCrtc;
+
+typedef enum _MetaHwCursorUpdate
+{
+  META_HW_CURSOR_UPDATE_NONE,
+  META_HW_CURSOR_UPDATE_SHOW,
+  META_HW_CURSOR_UPDATE_MOVE,
+  META_HW_CURSOR_UPDATE_HIDE,
+} MetaHwCursorUpdate;
+
 #define META_TYPE_CURSOR_RENDERER_NATIVE (meta_cursor_renderer_native_get_type ())
 G_DECLARE_FINAL_TYPE (MetaCursorRendererNative, meta_cursor_renderer_native,
                       META, CURSOR_RENDERER_NATIVE,
@@ -36,4 +72,11 @@ void meta_cursor_renderer_native_force_update (MetaCursorRendererNative *rendere
 
 MetaCursorRendererNative * meta_cursor_renderer_native_new (MetaBackend *backend);
 
+void meta_cursor_renderer_native_move_hw_cursor (MetaCursorRendererNative *native,
+                                                 float                     x,
+                                                 float                     y);
+
+MetaHwCursorUpdate meta_hw_cursor_crtc_update (MetaHwCursorCrtc *hw_cursor_crtc,
+                                               ClutterRect      *cursor_rect);
+
 #endif /* META_CURSOR_RENDERER_NATIVE_H */
@@ -47,6 +47,28 @@ typedef struct _MetaKmsSource
   MetaGpuKms *gpu_kms;
 } MetaKmsSource;
 
+typedef struct _MetaKmsFlipEntry
+{
+  uint32_t crtc_id;
+  GClosure *flip_closure;
+} MetaKmsFlipEntry;
+
+/*
+ * The CRTCs updated by a page flip or an atomic commit, each waiting for its
+ * page flip event. Passed as the user data of the kernel events.
+ */
+typedef struct _MetaKmsPageFlip
+{
+  MetaGpuKms *gpu_kms;
+  GArray *entries;
+} MetaKmsPageFlip;
+
+typedef struct _MetaKmsDumbFb
+{
+  uint32_t fb_id;
+  uint32_t handle;
+} MetaKmsDumbFb;
+
 struct _MetaGpuKms
 {
   MetaGpu parent;
@@ -62,6 +84,22 @@ struct _MetaGpuKms
   int max_buffer_height;
 
   gboolean page_flips_not_supported;
+
+  gboolean atomic;
+
+  /* The atomic update being built for the current frame */
+  drmModeAtomicReq *atomic_req;
+  uint32_t atomic_flags;
+  MetaKmsPageFlip *pending_page_flip;
+  GArray *pending_mode_blobs;
+
+  /* Whether the update waits for a page flip event to be committed */
+  gboolean atomic_update_deferred;
+
+  /* Page flips waiting for their events */
+  GList *page_flips;
+
+  guint plane_update_id;
 };
 
 G_DEFINE_TYPE (MetaGpuKms, meta_gpu_kms, META_TYPE_GPU)
@@ -113,6 +151,282 @@ get_crtc_drm_connectors (MetaGpu       *gpu,
   *connectors = (uint32_t *) g_array_free (connectors_array, FALSE);
 }
 
+static MetaKmsPageFlip *
+meta_kms_page_flip_new (MetaGpuKms *gpu_kms)
+{
+  MetaKmsPageFlip *page_flip;
+
+  page_flip = g_new0 (MetaKmsPageFlip, 1);
+  page_flip->gpu_kms = gpu_kms;
+  page_flip->entries = g_array_new (FALSE, FALSE, sizeof (MetaKmsFlipEntry));
+
+  return page_flip;
+}
+
+static void
+meta_kms_page_flip_free (MetaKmsPageFlip *page_flip)
+{
+  unsigned int i;
+
+  for (i = 0; i < page_flip->entries->len; i++)
+    {
+      MetaKmsFlipEntry *entry =
+        &g_array_index (page_flip->entries, MetaKmsFlipEntry, i);
+
+      if (entry->flip_closure)
+        g_closure_unref (entry->flip_closure);
+    }
+
+  g_array_free (page_flip->entries, TRUE);
+  g_free (page_flip);
+}
+
+static gboolean
+meta_kms_page_flip_has_crtc (MetaKmsPageFlip *page_flip,
+                             uint32_t         crtc_id)
+{
+  unsigned int i;
+
+  for (i = 0; i < page_flip->entries->len; i++)
+    {
+      MetaKmsFlipEntry *entry =
+        &g_array_index (page_flip->entries, MetaKmsFlipEntry, i);
+
+      if (entry->crtc_id == crtc_id)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Adds @crtc_id to the CRTCs waiting for a page flip event; @flip_closure,
+ * which may be NULL, is invoked when the event arrives. A CRTC is only ever
+ * added once, as there is only one event per CRTC.
+ */
+static void
+meta_kms_page_flip_add_crtc (MetaKmsPageFlip *page_flip,
+                             uint32_t         crtc_id,
+                             GClosure        *flip_closure)
+{
+  MetaKmsFlipEntry entry = {
+    .crtc_id = crtc_id,
+    .flip_closure = flip_closure ? g_closure_ref (flip_closure) : NULL
+  };
+  unsigned int i;
+
+  for (i = 0; i < page_flip->entries->len; i++)
+    {
+      MetaKmsFlipEntry *other_entry =
+        &g_array_index (page_flip->entries, MetaKmsFlipEntry, i);
+
+      if (other_entry->crtc_id != crtc_id)
+        continue;
+
+      g_warn_if_fail (!(other_entry->flip_closure && entry.flip_closure));
+      if (!other_entry->flip_closure)
+        other_entry->flip_closure = entry.flip_closure;
+      else if (entry.flip_closure)
+        g_closure_unref (entry.flip_closure);
+
+      return;
+    }
+
+  g_array_append_val (page_flip->entries, entry);
+}
+
+static MetaCrtc *
+find_crtc_by_id (MetaGpuKms *gpu_kms,
+                 uint32_t    crtc_id)
+{
+  GList *l;
+
+  for (l = meta_gpu_get_crtcs (META_GPU (gpu_kms)); l; l = l->next)
+    {
+      MetaCrtc *crtc = l->data;
+
+      if (crtc->crtc_id == crtc_id)
+        return crtc;
+    }
+
+  return NULL;
+}
+
+static gboolean
+is_crtc_flip_pending (MetaGpuKms *gpu_kms,
+                      uint32_t    crtc_id)
+{
+  GList *l;
+
+  for (l = gpu_kms->page_flips; l; l = l->next)
+    {
+      MetaKmsPageFlip *page_flip = l->data;
+
+      if (meta_kms_page_flip_has_crtc (page_flip, crtc_id))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Whether a CRTC of the update being built is still waiting for the page flip
+ * event of an earlier commit; committing it without blocking would fail.
+ */
+static gboolean
+is_atomic_update_blocked (MetaGpuKms *gpu_kms)
+{
+  MetaKmsPageFlip *page_flip = gpu_kms->pending_page_flip;
+  unsigned int i;
+
+  if (gpu_kms->atomic_flags & DRM_MODE_ATOMIC_ALLOW_MODESET)
+    return FALSE;
+
+  for (i = 0; i < page_flip->entries->len; i++)
+    {
+      MetaKmsFlipEntry *entry =
+        &g_array_index (page_flip->entries, MetaKmsFlipEntry, i);
+
+      if (is_crtc_flip_pending (gpu_kms, entry->crtc_id))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static drmModeAtomicReq *
+ensure_atomic_req (MetaGpuKms *gpu_kms)
+{
+  if (!gpu_kms->atomic_req)
+    {
+      gpu_kms->atomic_req = drmModeAtomicAlloc ();
+      gpu_kms->atomic_flags = 0;
+      gpu_kms->pending_page_flip = meta_kms_page_flip_new (gpu_kms);
+      gpu_kms->pending_mode_blobs = g_array_new (FALSE, FALSE,
+                                                 sizeof (uint32_t));
+    }
+
+  return gpu_kms->atomic_req;
+}
+
+static void
+free_mode_blobs (MetaGpuKms *gpu_kms,
+                 GArray     *mode_blobs)
+{
+  unsigned int i;
+
+  for (i = 0; i < mode_blobs->len; i++)
+    {
+      drmModeDestroyPropertyBlob (gpu_kms->fd,
+                                  g_array_index (mode_blobs, uint32_t, i));
+    }
+
+  g_array_free (mode_blobs, TRUE);
+}
+
+static uint32_t
+create_mode_blob (MetaGpuKms    *gpu_kms,
+                  MetaCrtcMode  *mode,
+                  GArray        *mode_blobs,
+                  GError       **error)
+{
+  uint32_t blob_id;
+  int ret;
+
+  ret = drmModeCreatePropertyBlob (gpu_kms->fd,
+                                   mode->driver_private,
+                                   sizeof (drmModeModeInfo),
+                                   &blob_id);
+  if (ret != 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Failed to create mode blob for %s: %s",
+                   mode->name, g_strerror (-ret));
+      return 0;
+    }
+
+  g_array_append_val (mode_blobs, blob_id);
+
+  return blob_id;
+}
+
+static gboolean
+apply_crtc_mode_atomic (MetaGpuKms *gpu_kms,
+                        MetaCrtc   *crtc,
+                        int         x,
+                        int         y,
+                        uint32_t    fb_id)
+{
+  MetaGpu *gpu = META_GPU (gpu_kms);
+  drmModeAtomicReq *req;
+  gboolean has_connectors = FALSE;
+  uint32_t mode_blob_id;
+  GError *error = NULL;
+  GList *l;
+
+  req = ensure_atomic_req (gpu_kms);
+  gpu_kms->atomic_flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+
+  for (l = meta_gpu_get_outputs (gpu); l; l = l->next)
+    {
+      MetaOutput *output = l->data;
+
+      if (output->crtc == crtc)
+        {
+          meta_output_kms_add_crtc_to_request (output, req, crtc->crtc_id);
+          has_connectors = TRUE;
+        }
+      else if (!output->crtc)
+        {
+          meta_output_kms_add_crtc_to_request (output, req, 0);
+        }
+    }
+
+  /* Lets the planes of the CRTC know when the mode set is done */
+  meta_kms_page_flip_add_crtc (gpu_kms->pending_page_flip,
+                               crtc->crtc_id,
+                               NULL);
+
+  if (!has_connectors || !crtc->current_mode || fb_id == 0)
+    {
+      if (!meta_crtc_kms_add_disable_to_request (crtc, req))
+        {
+          g_warning ("Failed to add disabling CRTC %u to atomic request",
+                     (unsigned int) crtc->crtc_id);
+          return FALSE;
+        }
+
+      return TRUE;
+    }
+
+  mode_blob_id = create_mode_blob (gpu_kms, crtc->current_mode,
+                                   gpu_kms->pending_mode_blobs,
+                                   &error);
+  if (!mode_blob_id)
+    {
+      g_warning ("Failed to set CRTC mode %s: %s",
+                 crtc->current_mode->name, error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  if (!meta_crtc_kms_add_mode_to_request (crtc, req, mode_blob_id) ||
+      !meta_crtc_kms_add_primary_plane_to_request (crtc, req,
+                                                   crtc->current_mode,
+                                                   crtc->transform,
+                                                   fb_id, x, y) ||
+      !meta_crtc_kms_add_cursor_to_request (crtc, req, TRUE) ||
+      !meta_crtc_kms_add_overlays_to_request (crtc, req, TRUE) ||
+      !meta_crtc_kms_add_vrr_to_request (crtc, req, TRUE))
+    {
+      g_warning ("Failed to add CRTC mode %s to atomic request",
+                 crtc->current_mode->name);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
 gboolean
 meta_gpu_kms_apply_crtc_mode (MetaGpuKms *gpu_kms,
                               MetaCrtc   *crtc,
@@ -126,6 +440,10 @@ meta_gpu_kms_apply_crtc_mode (MetaGpuKms *gpu_kms,
   unsigned int n_connectors;
   drmModeModeInfo *mode;
 
+  /* Mode changes go out with the atomic update of the frame */
+  if (gpu_kms->atomic)
+    return apply_crtc_mode_atomic (gpu_kms, crtc, x, y, fb_id);
+
   get_crtc_drm_connectors (gpu, crtc, &connectors, &n_connectors);
 
   if (connectors)
@@ -199,12 +517,6 @@ meta_gpu_kms_is_crtc_active (MetaGpuKms *gpu_kms,
   return TRUE;
 }
 
-typedef struct _GpuClosureContainer
-{
-  GClosure *flip_closure;
-  MetaGpuKms *gpu_kms;
-} GpuClosureContainer;
-
 gboolean
 meta_gpu_kms_flip_crtc (MetaGpuKms *gpu_kms,
                         MetaCrtc   *crtc,
@@ -227,25 +539,55 @@ meta_gpu_kms_flip_crtc (MetaGpuKms *gpu_kms,
   g_assert (n_connectors > 0);
   g_free (connectors);
 
+  /*
+   * With atomic modesetting, the flip is only added to the update of the
+   * frame; the closure is invoked once meta_gpu_kms_commit_update() committed
+   * it and the page flip event arrived.
+   */
+  if (gpu_kms->atomic)
+    {
+      drmModeAtomicReq *req;
+
+      req = ensure_atomic_req (gpu_kms);
+      if (!meta_crtc_kms_add_fb_to_request (crtc, req, fb_id))
+        {
+          g_warning ("Failed to add page flip of CRTC %u to atomic request",
+                     (unsigned int) crtc->crtc_id);
+          return FALSE;
+        }
+
+      meta_kms_page_flip_add_crtc (gpu_kms->pending_page_flip,
+                                   crtc->crtc_id,
+                                   flip_closure);
+      *fb_in_use = TRUE;
+
+      return TRUE;
+    }
+
   if (!gpu_kms->page_flips_not_supported)
     {
-      GpuClosureContainer *closure_container;
+      MetaKmsPageFlip *page_flip;
       int kms_fd = meta_gpu_kms_get_fd (gpu_kms);
 
-      closure_container = g_new0 (GpuClosureContainer, 1);
-      *closure_container = (GpuClosureContainer) {
-        .flip_closure = flip_closure,
-        .gpu_kms = gpu_kms
-      };
+      page_flip = meta_kms_page_flip_new (gpu_kms);
 
       ret = drmModePageFlip (kms_fd,
                              crtc->crtc_id,
                              fb_id,
                              DRM_MODE_PAGE_FLIP_EVENT,
-                             closure_container);
+                             page_flip);
+      if (ret == 0)
+        {
+          meta_kms_page_flip_add_crtc (page_flip, crtc->crtc_id, flip_closure);
+          gpu_kms->page_flips = g_list_append (gpu_kms->page_flips, page_flip);
+        }
+      else
+        {
+          meta_kms_page_flip_free (page_flip);
+        }
+
       if (ret != 0 && ret != -EACCES)
         {
-          g_free (closure_container);
           g_warning ("Failed to flip: %s", strerror (-ret));
           gpu_kms->page_flips_not_supported = TRUE;
         }
@@ -264,29 +606,98 @@ meta_gpu_kms_flip_crtc (MetaGpuKms *gpu_kms,
     return FALSE;
 
   *fb_in_use = TRUE;
-  g_closure_ref (flip_closure);
 
   return TRUE;
 }
 
+static gboolean
+has_dirty_planes (MetaGpuKms *gpu_kms)
+{
+  GList *l;
+
+  for (l = meta_gpu_get_crtcs (META_GPU (gpu_kms)); l; l = l->next)
+    {
+      MetaCrtc *crtc = l->data;
+
+      if (meta_crtc_kms_has_dirty_planes (crtc))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+update_planes_idle (gpointer user_data)
+{
+  MetaGpuKms *gpu_kms = user_data;
+
+  gpu_kms->plane_update_id = 0;
+  meta_gpu_kms_update_planes (gpu_kms);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 page_flip_handler (int           fd,
                    unsigned int  frame,
                    unsigned int  sec,
                    unsigned int  usec,
+                   unsigned int  crtc_id,
                    void         *user_data)
 {
-  GpuClosureContainer *closure_container = user_data;
-  GClosure *flip_closure = closure_container->flip_closure;
-  MetaGpuKms *gpu_kms = closure_container->gpu_kms;
+  MetaKmsPageFlip *page_flip = user_data;
+  MetaGpuKms *gpu_kms = page_flip->gpu_kms;
+  GClosure *flip_closure = NULL;
+  uint32_t flipped_crtc_id = 0;
+  MetaCrtc *crtc;
+  unsigned int i;
+
+  for (i = 0; i < page_flip->entries->len; i++)
+    {
+      MetaKmsFlipEntry *entry =
+        &g_array_index (page_flip->entries, MetaKmsFlipEntry, i);
 
-  invoke_flip_closure (flip_closure, gpu_kms);
-  g_free (closure_container);
+      /* Kernels predating atomic modesetting don't report the CRTC */
+      if (entry->crtc_id == crtc_id || crtc_id == 0)
+        {
+          flipped_crtc_id = entry->crtc_id;
+          flip_closure = entry->flip_closure;
+          g_array_remove_index_fast (page_flip->entries, i);
+          break;
+        }
+    }
+
+  if (page_flip->entries->len == 0)
+    {
+      gpu_kms->page_flips = g_list_remove (gpu_kms->page_flips, page_flip);
+      meta_kms_page_flip_free (page_flip);
+    }
+
+  crtc = find_crtc_by_id (gpu_kms, flipped_crtc_id);
+  if (crtc)
+    meta_crtc_kms_planes_flipped (crtc, TRUE);
+
+  if (flip_closure)
+    invoke_flip_closure (flip_closure, gpu_kms);
+
+  if (gpu_kms->atomic_req &&
+      gpu_kms->atomic_update_deferred &&
+      !is_atomic_update_blocked (gpu_kms))
+    meta_gpu_kms_commit_update (gpu_kms);
+
+  /*
+   * Plane changes of CRTCs that were busy flipping were held back; send them
+   * now, unless a frame picks them up first.
+   */
+  if (gpu_kms->atomic &&
+      !gpu_kms->plane_update_id &&
+      has_dirty_planes (gpu_kms))
+    gpu_kms->plane_update_id = g_idle_add (update_planes_idle, gpu_kms);
 }
 
-gboolean
-meta_gpu_kms_wait_for_flip (MetaGpuKms *gpu_kms,
-                            GError    **error)
+static gboolean
+dispatch_kms_events (MetaGpuKms *gpu_kms,
+                     GError    **error)
 {
   drmEventContext evctx;
 
@@ -299,7 +710,7 @@ meta_gpu_kms_wait_for_flip (MetaGpuKms *gpu_kms,
 
   memset (&evctx, 0, sizeof evctx);
   evctx.version = DRM_EVENT_CONTEXT_VERSION;
-  evctx.page_flip_handler = page_flip_handler;
+  evctx.page_flip_handler2 = page_flip_handler;
 
   while (TRUE)
     {
@@ -332,6 +743,491 @@ meta_gpu_kms_wait_for_flip (MetaGpuKms *gpu_kms,
   return TRUE;
 }
 
+gboolean
+meta_gpu_kms_wait_for_flip (MetaGpuKms *gpu_kms,
+                            GError    **error)
+{
+  /*
+   * Flips still part of an uncommitted update would never complete; commit it
+   * and let the caller check again whether there is anything to wait for. An
+   * update deferred until an earlier flip completed is committed once its page
+   * flip event is dispatched.
+   */
+  if (gpu_kms->atomic_req && !is_atomic_update_blocked (gpu_kms))
+    {
+      meta_gpu_kms_commit_update (gpu_kms);
+      return TRUE;
+    }
+
+  return dispatch_kms_events (gpu_kms, error);
+}
+
+gboolean
+meta_gpu_kms_is_atomic (MetaGpuKms *gpu_kms)
+{
+  return gpu_kms->atomic;
+}
+
+/*
+ * Adds the changed cursor and overlay planes, and variable refresh rate state,
+ * of CRTCs that are not waiting for a page flip to the update; committing a
+ * busy CRTC without blocking would fail.
+ */
+static void
+add_dirty_planes (MetaGpuKms *gpu_kms)
+{
+  GList *l;
+
+  for (l = meta_gpu_get_crtcs (META_GPU (gpu_kms)); l; l = l->next)
+    {
+      MetaCrtc *crtc = l->data;
+      drmModeAtomicReq *req;
+
+      if (!meta_crtc_kms_has_dirty_planes (crtc))
+        continue;
+
+      if (!meta_gpu_kms_is_crtc_active (gpu_kms, crtc) ||
+          is_crtc_flip_pending (gpu_kms, crtc->crtc_id))
+        continue;
+
+      req = ensure_atomic_req (gpu_kms);
+      meta_crtc_kms_add_cursor_to_request (crtc, req, FALSE);
+      meta_crtc_kms_add_overlays_to_request (crtc, req, FALSE);
+      meta_crtc_kms_add_vrr_to_request (crtc, req, FALSE);
+
+      if (!meta_kms_page_flip_has_crtc (gpu_kms->pending_page_flip,
+                                        crtc->crtc_id))
+        meta_kms_page_flip_add_crtc (gpu_kms->pending_page_flip,
+                                     crtc->crtc_id,
+                                     NULL);
+    }
+}
+
+static void
+complete_page_flip (MetaKmsPageFlip *page_flip,
+                    gboolean         presented)
+{
+  MetaGpuKms *gpu_kms = page_flip->gpu_kms;
+  unsigned int i;
+
+  for (i = 0; i < page_flip->entries->len; i++)
+    {
+      MetaKmsFlipEntry *entry =
+        &g_array_index (page_flip->entries, MetaKmsFlipEntry, i);
+      GClosure *flip_closure = entry->flip_closure;
+      MetaCrtc *crtc;
+
+      crtc = find_crtc_by_id (gpu_kms, entry->crtc_id);
+      if (crtc)
+        meta_crtc_kms_planes_flipped (crtc, presented);
+
+      entry->flip_closure = NULL;
+      if (flip_closure)
+        invoke_flip_closure (flip_closure, gpu_kms);
+    }
+
+  meta_kms_page_flip_free (page_flip);
+}
+
+/*
+ * Commits the atomic update built up since the last commit: page flips,
+ * cursor and overlay plane changes and mode changes of all CRTCs of the GPU,
+ * in one request.
+ * Page flips complete asynchronously, as with drmModePageFlip(), while mode
+ * changes are committed blocking, as with drmModeSetCrtc().
+ *
+ * If a CRTC of the update is still busy with an earlier commit, such as a
+ * cursor move, the update is left pending instead of waiting for it; it is
+ * committed when the page flip event of that commit arrives, together with
+ * anything added to it in the meantime.
+ */
+void
+meta_gpu_kms_commit_update (MetaGpuKms *gpu_kms)
+{
+  drmModeAtomicReq *req;
+  MetaKmsPageFlip *page_flip;
+  GArray *mode_blobs;
+  uint32_t flags;
+  int ret;
+
+  if (!gpu_kms->atomic)
+    return;
+
+  add_dirty_planes (gpu_kms);
+
+  if (!gpu_kms->atomic_req)
+    return;
+
+  if (is_atomic_update_blocked (gpu_kms))
+    {
+      gpu_kms->atomic_update_deferred = TRUE;
+      return;
+    }
+
+  req = g_steal_pointer (&gpu_kms->atomic_req);
+  page_flip = g_steal_pointer (&gpu_kms->pending_page_flip);
+  mode_blobs = g_steal_pointer (&gpu_kms->pending_mode_blobs);
+  flags = gpu_kms->atomic_flags;
+  gpu_kms->atomic_flags = 0;
+  gpu_kms->atomic_update_deferred = FALSE;
+
+  if (!(flags & DRM_MODE_ATOMIC_ALLOW_MODESET) &&
+      page_flip->entries->len > 0)
+    flags |= DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT;
+
+  ret = drmModeAtomicCommit (gpu_kms->fd, req, flags, page_flip);
+  if (ret != 0 && ret != -EACCES && (flags & DRM_MODE_ATOMIC_NONBLOCK))
+    {
+      g_warning ("Failed to commit atomic update without blocking: %s",
+                 strerror (-ret));
+
+      flags &= ~(DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT);
+      ret = drmModeAtomicCommit (gpu_kms->fd, req, flags, NULL);
+    }
+
+  if (ret != 0 && ret != -EACCES)
+    g_warning ("Failed to commit atomic update: %s", strerror (-ret));
+
+  drmModeAtomicFree (req);
+  free_mode_blobs (gpu_kms, mode_blobs);
+
+  /*
+   * Without page flip events to wait for, the update is as complete as it will
+   * get; let the flip closures know right away.
+   */
+  if (ret == 0 && (flags & DRM_MODE_PAGE_FLIP_EVENT))
+    gpu_kms->page_flips = g_list_append (gpu_kms->page_flips, page_flip);
+  else
+    complete_page_flip (page_flip, ret == 0);
+}
+
+/*
+ * Commits changed cursor and overlay planes outside of a frame. While a frame
+ * is being built, the plane changes are left for its update to pick up.
+ */
+void
+meta_gpu_kms_update_planes (MetaGpuKms *gpu_kms)
+{
+  if (!gpu_kms->atomic || gpu_kms->atomic_req)
+    return;
+
+  add_dirty_planes (gpu_kms);
+
+  if (gpu_kms->atomic_req)
+    meta_gpu_kms_commit_update (gpu_kms);
+}
+
+static gboolean
+create_dumb_fb (MetaGpuKms     *gpu_kms,
+                int             width,
+                int             height,
+                MetaKmsDumbFb  *dumb_fb,
+                GError        **error)
+{
+  struct drm_mode_create_dumb create_arg;
+  struct drm_mode_destroy_dumb destroy_arg;
+  uint32_t fb_id;
+
+  create_arg = (struct drm_mode_create_dumb) {
+    .bpp = 32, /* RGBX8888 */
+    .width = width,
+    .height = height
+  };
+  if (drmIoctl (gpu_kms->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create_arg) != 0)
+    {
+      g_set_error (error, G_IO_ERROR,
+                   G_IO_ERROR_FAILED,
+                   "Failed to create dumb drm buffer: %s",
+                   g_strerror (errno));
+      return FALSE;
+    }
+
+  if (drmModeAddFB (gpu_kms->fd, width, height,
+                    24 /* depth of RGBX8888 */,
+                    32 /* bpp of RGBX8888 */,
+                    create_arg.pitch,
+                    create_arg.handle,
+                    &fb_id) != 0)
+    {
+      g_set_error (error, G_IO_ERROR,
+                   G_IO_ERROR_FAILED,
+                   "drmModeAddFB failed: %s",
+                   g_strerror (errno));
+
+      destroy_arg = (struct drm_mode_destroy_dumb) {
+        .handle = create_arg.handle
+      };
+      drmIoctl (gpu_kms->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy_arg);
+      return FALSE;
+    }
+
+  dumb_fb->fb_id = fb_id;
+  dumb_fb->handle = create_arg.handle;
+
+  return TRUE;
+}
+
+static void
+free_dumb_fbs (MetaGpuKms *gpu_kms,
+               GArray     *dumb_fbs)
+{
+  unsigned int i;
+
+  for (i = 0; i < dumb_fbs->len; i++)
+    {
+      MetaKmsDumbFb *dumb_fb = &g_array_index (dumb_fbs, MetaKmsDumbFb, i);
+      struct drm_mode_destroy_dumb destroy_arg;
+
+      drmModeRmFB (gpu_kms->fd, dumb_fb->fb_id);
+
+      destroy_arg = (struct drm_mode_destroy_dumb) {
+        .handle = dumb_fb->handle
+      };
+      drmIoctl (gpu_kms->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy_arg);
+    }
+
+  g_array_free (dumb_fbs, TRUE);
+}
+
+static MetaCrtcInfo *
+find_crtc_info (MetaCrtc      *crtc,
+                MetaCrtcInfo **crtc_infos,
+                unsigned int   n_crtc_infos)
+{
+  unsigned int i;
+
+  for (i = 0; i < n_crtc_infos; i++)
+    {
+      if (crtc_infos[i]->crtc == crtc)
+        return crtc_infos[i];
+    }
+
+  return NULL;
+}
+
+static gboolean
+is_output_assigned (MetaOutput    *output,
+                    MetaCrtcInfo **crtc_infos,
+                    unsigned int   n_crtc_infos)
+{
+  unsigned int i, j;
+
+  for (i = 0; i < n_crtc_infos; i++)
+    {
+      MetaCrtcInfo *crtc_info = crtc_infos[i];
+
+      for (j = 0; j < crtc_info->outputs->len; j++)
+        {
+          if (g_ptr_array_index (crtc_info->outputs, j) == output)
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static gboolean
+add_crtc_info_to_request (MetaGpuKms        *gpu_kms,
+                          drmModeAtomicReq  *req,
+                          MetaCrtc          *crtc,
+                          MetaCrtcInfo      *crtc_info,
+                          GArray            *mode_blobs,
+                          GArray            *dumb_fbs,
+                          GError           **error)
+{
+  MetaCrtcMode *mode;
+  MetaKmsDumbFb dumb_fb;
+  uint32_t mode_blob_id;
+  int fb_width, fb_height;
+  unsigned int i;
+
+  if (!crtc_info || !crtc_info->mode)
+    {
+      if (!meta_crtc_kms_add_disable_to_request (crtc, req))
+        goto err_add;
+
+      return TRUE;
+    }
+
+  mode = crtc_info->mode;
+
+  for (i = 0; i < crtc_info->outputs->len; i++)
+    {
+      MetaOutput *output = g_ptr_array_index (crtc_info->outputs, i);
+
+      if (!meta_output_kms_add_crtc_to_request (output, req, crtc->crtc_id))
+        goto err_add;
+    }
+
+  mode_blob_id = create_mode_blob (gpu_kms, mode, mode_blobs, error);
+  if (!mode_blob_id)
+    return FALSE;
+
+  if (meta_monitor_transform_is_rotated (crtc_info->transform) &&
+      meta_crtc_kms_is_transform_handled (crtc, crtc_info->transform))
+    {
+      fb_width = mode->height;
+      fb_height = mode->width;
+    }
+  else
+    {
+      fb_width = mode->width;
+      fb_height = mode->height;
+    }
+
+  if (!create_dumb_fb (gpu_kms, fb_width, fb_height, &dumb_fb, error))
+    return FALSE;
+  g_array_append_val (dumb_fbs, dumb_fb);
+
+  if (!meta_crtc_kms_add_mode_to_request (crtc, req, mode_blob_id) ||
+      !meta_crtc_kms_add_primary_plane_to_request (crtc, req,
+                                                   mode,
+                                                   crtc_info->transform,
+                                                   dumb_fb.fb_id,
+                                                   0, 0))
+    goto err_add;
+
+  return TRUE;
+
+err_add:
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+               "Failed to add CRTC %u to atomic request",
+               (unsigned int) crtc->crtc_id);
+  return FALSE;
+}
+
+/*
+ * Commits @req with DRM_MODE_ATOMIC_TEST_ONLY added to @flags, translating the
+ * verdict of the driver. Lacking DRM master, e.g. while VT switched away, is
+ * reported as G_IO_ERROR_PERMISSION_DENIED, as nothing could be tested.
+ */
+gboolean
+meta_kms_atomic_test_commit (int                fd,
+                             drmModeAtomicReq  *req,
+                             uint32_t           flags,
+                             GError           **error)
+{
+  int ret;
+
+  ret = drmModeAtomicCommit (fd, req, flags | DRM_MODE_ATOMIC_TEST_ONLY, NULL);
+  if (ret == 0)
+    return TRUE;
+
+  g_set_error (error, G_IO_ERROR,
+               ret == -EACCES ? G_IO_ERROR_PERMISSION_DENIED
+                              : G_IO_ERROR_FAILED,
+               "Rejected by the driver: %s", strerror (-ret));
+  return FALSE;
+}
+
+/*
+ * Asks the kernel whether the CRTC assignments could be applied, without
+ * applying them. Each enabled CRTC is given a dumb buffer of the mode size to
+ * scan out, so that plane and bandwidth constraints are checked as well.
+ */
+gboolean
+meta_gpu_kms_test_crtc_assignments (MetaGpuKms    *gpu_kms,
+                                    MetaCrtcInfo **crtc_infos,
+                                    unsigned int   n_crtc_infos,
+                                    GError       **error)
+{
+  MetaGpu *gpu = META_GPU (gpu_kms);
+  drmModeAtomicReq *req;
+  GArray *mode_blobs;
+  GArray *dumb_fbs;
+  gboolean ret = FALSE;
+  GError *local_error = NULL;
+  GList *l;
+
+  if (!gpu_kms->atomic)
+    return TRUE;
+
+  req = drmModeAtomicAlloc ();
+  mode_blobs = g_array_new (FALSE, FALSE, sizeof (uint32_t));
+  dumb_fbs = g_array_new (FALSE, FALSE, sizeof (MetaKmsDumbFb));
+
+  for (l = meta_gpu_get_crtcs (gpu); l; l = l->next)
+    {
+      MetaCrtc *crtc = l->data;
+      MetaCrtcInfo *crtc_info;
+
+      crtc_info = find_crtc_info (crtc, crtc_infos, n_crtc_infos);
+      if (!add_crtc_info_to_request (gpu_kms, req, crtc, crtc_info,
+                                     mode_blobs, dumb_fbs,
+                                     error))
+        goto out;
+    }
+
+  for (l = meta_gpu_get_outputs (gpu); l; l = l->next)
+    {
+      MetaOutput *output = l->data;
+
+      if (!is_output_assigned (output, crtc_infos, n_crtc_infos))
+        meta_output_kms_add_crtc_to_request (output, req, 0);
+    }
+
+  /* Without DRM master nothing can be tested; let the configuration pass */
+  if (!meta_kms_atomic_test_commit (gpu_kms->fd, req,
+                                    DRM_MODE_ATOMIC_ALLOW_MODESET,
+                                    &local_error) &&
+      !g_error_matches (local_error,
+                        G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED))
+    {
+      g_propagate_error (error, local_error);
+      goto out;
+    }
+
+  g_clear_error (&local_error);
+
+  ret = TRUE;
+
+out:
+  drmModeAtomicFree (req);
+  free_mode_blobs (gpu_kms, mode_blobs);
+  free_dumb_fbs (gpu_kms, dumb_fbs);
+
+  return ret;
+}
+
+/*
+ * Asks the kernel whether overlay plane @index of @crtc could show the
+ * @src_rect part of @fb_id at @dst_rect, without changing anything.
+ */
+gboolean
+meta_gpu_kms_test_overlay (MetaGpuKms          *gpu_kms,
+                           MetaCrtc            *crtc,
+                           unsigned int         index,
+                           uint32_t             fb_id,
+                           const MetaRectangle *src_rect,
+                           const MetaRectangle *dst_rect,
+                           GError             **error)
+{
+  drmModeAtomicReq *req;
+  gboolean ret;
+
+  if (!gpu_kms->atomic)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   "Overlay planes need atomic modesetting");
+      return FALSE;
+    }
+
+  req = drmModeAtomicAlloc ();
+  if (!meta_crtc_kms_add_overlay_test_to_request (crtc, req, index, fb_id,
+                                                  src_rect, dst_rect))
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Failed to add overlay plane to atomic request");
+      drmModeAtomicFree (req);
+      return FALSE;
+    }
+
+  ret = meta_kms_atomic_test_commit (gpu_kms->fd, req, 0, error);
+  drmModeAtomicFree (req);
+
+  return ret;
+}
+
 void
 meta_gpu_kms_get_max_buffer_size (MetaGpuKms *gpu_kms,
                                   int        *max_width,
@@ -789,6 +1685,10 @@ meta_gpu_kms_new (MetaMonitorManagerKms  *monitor_manager_kms,
 
   drmSetClientCap (gpu_kms->fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1);
 
+  if (!g_getenv ("MUTTER_DEBUG_DISABLE_ATOMIC_KMS") &&
+      drmSetClientCap (gpu_kms->fd, DRM_CLIENT_CAP_ATOMIC, 1) == 0)
+    gpu_kms->atomic = TRUE;
+
   source = g_source_new (&kms_event_funcs, sizeof (MetaKmsSource));
   kms_source = (MetaKmsSource *) source;
   kms_source->fd_tag = g_source_add_unix_fd (source,
@@ -812,6 +1712,16 @@ meta_gpu_kms_finalize (GObject *object)
   MetaBackendNative *backend_native = META_BACKEND_NATIVE (backend);
   MetaLauncher *launcher = meta_backend_native_get_launcher (backend_native);
 
+  if (gpu_kms->plane_update_id)
+    g_source_remove (gpu_kms->plane_update_id);
+
+  g_clear_pointer (&gpu_kms->atomic_req, drmModeAtomicFree);
+  g_clear_pointer (&gpu_kms->pending_page_flip, meta_kms_page_flip_free);
+  if (gpu_kms->pending_mode_blobs)
+    free_mode_blobs (gpu_kms, gpu_kms->pending_mode_blobs);
+  g_list_free_full (gpu_kms->page_flips,
+                    (GDestroyNotify) meta_kms_page_flip_free);
+
   if (gpu_kms->fd != -1)
     meta_launcher_close_restricted (launcher, gpu_kms->fd);
   g_clear_pointer (&gpu_kms->file_path, g_free);
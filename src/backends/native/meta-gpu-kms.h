@@ -65,6 +65,30 @@ gboolean meta_gpu_kms_flip_crtc (MetaGpuKms *gpu_kms,
 gboolean meta_gpu_kms_wait_for_flip (MetaGpuKms *gpu_kms,
                                      GError    **error);
 
+gboolean meta_gpu_kms_is_atomic (MetaGpuKms *gpu_kms);
+
+void meta_gpu_kms_commit_update (MetaGpuKms *gpu_kms);
+
+void meta_gpu_kms_update_planes (MetaGpuKms *gpu_kms);
+
+gboolean meta_kms_atomic_test_commit (int                fd,
+                                      drmModeAtomicReq  *req,
+                                      uint32_t           flags,
+                                      GError           **error);
+
+gboolean meta_gpu_kms_test_crtc_assignments (MetaGpuKms    *gpu_kms,
+                                             MetaCrtcInfo **crtc_infos,
+                                             unsigned int   n_crtc_infos,
+                                             GError       **error);
+
+gboolean meta_gpu_kms_test_overlay (MetaGpuKms          *gpu_kms,
+                                    MetaCrtc            *crtc,
+                                    unsigned int         index,
+                                    uint32_t             fb_id,
+                                    const MetaRectangle *src_rect,
+                                    const MetaRectangle *dst_rect,
+                                    GError             **error);
+
 int meta_gpu_kms_get_fd (MetaGpuKms *gpu_kms);
 
 const char * meta_gpu_kms_get_file_path (MetaGpuKms *gpu_kms);
@@ -33,6 +33,22 @@
 
 G_DEFINE_TYPE (MetaInputSettingsNative, meta_input_settings_native, META_TYPE_INPUT_SETTINGS)
 
+/*
+ * libinput is read from the clutter input thread, so device configuration
+ * changes must be done with the libinput lock held.
+ */
+static void
+lock_libinput (void)
+{
+  clutter_evdev_lock_libinput (clutter_device_manager_get_default ());
+}
+
+static void
+unlock_libinput (void)
+{
+  clutter_evdev_unlock_libinput (clutter_device_manager_get_default ());
+}
+
 static void
 meta_input_settings_native_set_send_events (MetaInputSettings        *settings,
                                             ClutterInputDevice       *device,
@@ -59,7 +75,9 @@ meta_input_settings_native_set_send_events (MetaInputSettings        *settings,
   libinput_device = clutter_evdev_input_device_get_libinput_device (device);
   if (!libinput_device)
     return;
+  lock_libinput ();
   libinput_device_config_send_events_set_mode (libinput_device, libinput_mode);
+  unlock_libinput ();
 }
 
 static void
@@ -84,8 +102,10 @@ meta_input_settings_native_set_speed (MetaInputSettings  *settings,
   libinput_device = clutter_evdev_input_device_get_libinput_device (device);
   if (!libinput_device)
     return;
+  lock_libinput ();
   libinput_device_config_accel_set_speed (libinput_device,
                                           CLAMP (speed, -1, 1));
+  unlock_libinput ();
 }
 
 static void
@@ -99,8 +119,10 @@ meta_input_settings_native_set_left_handed (MetaInputSettings  *settings,
   if (!libinput_device)
     return;
 
+  lock_libinput ();
   if (libinput_device_config_left_handed_is_available (libinput_device))
     libinput_device_config_left_handed_set (libinput_device, enabled);
+  unlock_libinput ();
 }
 
 static void
@@ -114,11 +136,13 @@ meta_input_settings_native_set_tap_enabled (MetaInputSettings  *settings,
   if (!libinput_device)
     return;
 
+  lock_libinput ();
   if (libinput_device_config_tap_get_finger_count (libinput_device) > 0)
     libinput_device_config_tap_set_enabled (libinput_device,
                                             enabled ?
                                             LIBINPUT_CONFIG_TAP_ENABLED :
                                             LIBINPUT_CONFIG_TAP_DISABLED);
+  unlock_libinput ();
 }
 
 static void
@@ -132,11 +156,13 @@ meta_input_settings_native_set_tap_and_drag_enabled (MetaInputSettings  *setting
   if (!libinput_device)
     return;
 
+  lock_libinput ();
   if (libinput_device_config_tap_get_finger_count (libinput_device) > 0)
     libinput_device_config_tap_set_drag_enabled (libinput_device,
                                                  enabled ?
                                                  LIBINPUT_CONFIG_DRAG_ENABLED :
                                                  LIBINPUT_CONFIG_DRAG_DISABLED);
+  unlock_libinput ();
 }
 
 static void
@@ -151,11 +177,13 @@ meta_input_settings_native_set_disable_while_typing (MetaInputSettings  *setting
   if (!libinput_device)
     return;
 
+  lock_libinput ();
   if (libinput_device_config_dwt_is_available (libinput_device))
     libinput_device_config_dwt_set_enabled (libinput_device,
                                             enabled ?
                                             LIBINPUT_CONFIG_DWT_ENABLED :
                                             LIBINPUT_CONFIG_DWT_DISABLED);
+  unlock_libinput ();
 }
 
 static void
@@ -169,17 +197,23 @@ meta_input_settings_native_set_invert_scroll (MetaInputSettings  *settings,
   if (!libinput_device)
     return;
 
+  lock_libinput ();
   if (libinput_device_config_scroll_has_natural_scroll (libinput_device))
     libinput_device_config_scroll_set_natural_scroll_enabled (libinput_device,
                                                               inverted);
+  unlock_libinput ();
 }
 
 static gboolean
 device_set_scroll_method (struct libinput_device             *libinput_device,
                           enum libinput_config_scroll_method  method)
 {
-  enum libinput_config_status status =
-    libinput_device_config_scroll_set_method (libinput_device, method);
+  enum libinput_config_status status;
+
+  lock_libinput ();
+  status = libinput_device_config_scroll_set_method (libinput_device, method);
+  unlock_libinput ();
+
   return status == LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
 
@@ -187,8 +221,12 @@ static gboolean
 device_set_click_method (struct libinput_device            *libinput_device,
                          enum libinput_config_click_method  method)
 {
-  enum libinput_config_status status =
-    libinput_device_config_click_set_method (libinput_device, method);
+  enum libinput_config_status status;
+
+  lock_libinput ();
+  status = libinput_device_config_click_set_method (libinput_device, method);
+  unlock_libinput ();
+
   return status == LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
 
@@ -271,7 +309,9 @@ meta_input_settings_native_set_scroll_button (MetaInputSettings  *settings,
   if (!device_set_scroll_method (libinput_device, method))
     return;
 
+  lock_libinput ();
   libinput_device_config_scroll_set_button (libinput_device, evcode);
+  unlock_libinput ();
 }
 
 static void
@@ -351,8 +391,10 @@ set_device_accel_profile (ClutterInputDevice         *device,
         libinput_device_config_accel_get_default_profile (libinput_device);
     }
 
+  lock_libinput ();
   libinput_device_config_accel_set_profile (libinput_device,
                                             libinput_profile);
+  unlock_libinput ();
 }
 
 static gboolean
@@ -504,7 +546,9 @@ meta_input_settings_native_set_tablet_area (MetaInputSettings  *settings,
       !libinput_device_config_calibration_has_matrix (libinput_device))
     return;
 
+  lock_libinput ();
   libinput_device_config_calibration_set_matrix (libinput_device, matrix);
+  unlock_libinput ();
 }
 
 static void
@@ -28,9 +28,11 @@
 #include "meta-backend-native.h"
 #include "meta-crtc.h"
 #include "meta-launcher.h"
+#include "meta-logical-monitor.h"
 #include "meta-output.h"
 #include "meta-backend-private.h"
 #include "meta-renderer-native.h"
+#include "meta-renderer-view.h"
 #include "meta-crtc-kms.h"
 #include "meta-gpu-kms.h"
 #include "meta-output-kms.h"
@@ -132,6 +134,25 @@ meta_monitor_manager_kms_ensure_initial_config (MetaMonitorManager *manager)
   meta_monitor_manager_update_logical_state (manager, config);
 }
 
+static gboolean
+meta_monitor_manager_kms_verify_crtc_assignments (MetaMonitorManager *manager,
+                                                  MetaCrtcInfo      **crtcs,
+                                                  unsigned int        n_crtcs,
+                                                  GError            **error)
+{
+  GList *l;
+
+  for (l = meta_monitor_manager_get_gpus (manager); l; l = l->next)
+    {
+      MetaGpuKms *gpu_kms = META_GPU_KMS (l->data);
+
+      if (!meta_gpu_kms_test_crtc_assignments (gpu_kms, crtcs, n_crtcs, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 static void
 apply_crtc_assignments (MetaMonitorManager *manager,
                         MetaCrtcInfo       **crtcs,
@@ -193,6 +214,10 @@ apply_crtc_assignments (MetaMonitorManager *manager,
         }
 
       meta_crtc_kms_apply_transform (crtc);
+
+      /* Re-enabled once the new monitors are found to show a fullscreen
+       * window */
+      meta_crtc_kms_set_vrr_enabled (crtc, FALSE);
     }
   /* Disable CRTCs not mentioned in the list (they have is_dirty == FALSE,
      because they weren't seen in the first loop) */
@@ -306,6 +331,16 @@ meta_monitor_manager_kms_apply_monitors_config (MetaMonitorManager      *manager
                                            error))
     return FALSE;
 
+  if (!meta_monitor_manager_verify_crtc_assignments (manager,
+                                                     (MetaCrtcInfo **) crtc_infos->pdata,
+                                                     crtc_infos->len,
+                                                     error))
+    {
+      g_ptr_array_free (crtc_infos, TRUE);
+      g_ptr_array_free (output_infos, TRUE);
+      return FALSE;
+    }
+
   if (method == META_MONITORS_CONFIG_METHOD_VERIFY)
     {
       g_ptr_array_free (crtc_infos, TRUE);
@@ -481,6 +516,59 @@ meta_monitor_manager_kms_get_capabilities (MetaMonitorManager *manager)
   return capabilities;
 }
 
+static gboolean
+is_logical_monitor_vrr_enabled (MetaLogicalMonitor *logical_monitor)
+{
+  GList *l;
+
+  for (l = meta_logical_monitor_get_monitors (logical_monitor); l; l = l->next)
+    {
+      MetaMonitor *monitor = l->data;
+
+      if (!meta_monitor_is_vrr_enabled (monitor))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+meta_monitor_manager_kms_set_vrr_enabled (MetaMonitorManager *manager,
+                                          MetaMonitor        *monitor,
+                                          gboolean            enabled)
+{
+  MetaBackend *backend = meta_monitor_manager_get_backend (manager);
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  MetaLogicalMonitor *logical_monitor;
+  GList *l;
+
+  for (l = meta_monitor_get_outputs (monitor); l; l = l->next)
+    {
+      MetaOutput *output = l->data;
+
+      if (output->crtc)
+        meta_crtc_kms_set_vrr_enabled (output->crtc, enabled);
+    }
+
+  logical_monitor = meta_monitor_get_logical_monitor (monitor);
+  if (!logical_monitor)
+    return;
+
+  /* Mirrored monitors share a view, which can only be updated as soon as
+   * its frames are ready if none of them refreshes at a fixed rate. */
+  for (l = meta_renderer_get_views (renderer); l; l = l->next)
+    {
+      MetaRendererView *view = l->data;
+
+      if (meta_renderer_view_get_logical_monitor (view) != logical_monitor)
+        continue;
+
+      clutter_stage_view_cogl_set_variable_refresh_rate (
+        CLUTTER_STAGE_VIEW_COGL (view),
+        is_logical_monitor_vrr_enabled (logical_monitor));
+    }
+}
+
 static gboolean
 meta_monitor_manager_kms_get_max_screen_size (MetaMonitorManager *manager,
                                               int                *max_width,
@@ -726,6 +814,7 @@ meta_monitor_manager_kms_class_init (MetaMonitorManagerKmsClass *klass)
   manager_class->read_edid = meta_monitor_manager_kms_read_edid;
   manager_class->ensure_initial_config = meta_monitor_manager_kms_ensure_initial_config;
   manager_class->apply_monitors_config = meta_monitor_manager_kms_apply_monitors_config;
+  manager_class->verify_crtc_assignments = meta_monitor_manager_kms_verify_crtc_assignments;
   manager_class->set_power_save_mode = meta_monitor_manager_kms_set_power_save_mode;
   manager_class->get_crtc_gamma = meta_monitor_manager_kms_get_crtc_gamma;
   manager_class->set_crtc_gamma = meta_monitor_manager_kms_set_crtc_gamma;
@@ -735,4 +824,5 @@ meta_monitor_manager_kms_class_init (MetaMonitorManagerKmsClass *klass)
   manager_class->get_capabilities = meta_monitor_manager_kms_get_capabilities;
   manager_class->get_max_screen_size = meta_monitor_manager_kms_get_max_screen_size;
   manager_class->get_default_layout_mode = meta_monitor_manager_kms_get_default_layout_mode;
+  manager_class->set_vrr_enabled = meta_monitor_manager_kms_set_vrr_enabled;
 }
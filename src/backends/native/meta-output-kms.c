@@ -51,6 +51,7 @@ typedef struct _MetaOutputKms
   uint32_t enc_clone_mask;
 
   uint32_t dpms_prop_id;
+  uint32_t crtc_id_prop_id;
   uint32_t edid_blob_id;
   uint32_t tile_blob_id;
 
@@ -92,6 +93,25 @@ meta_output_kms_set_power_save_mode (MetaOutput *output,
     }
 }
 
+/*
+ * Routes the connector of @output to the CRTC @crtc_id, or disconnects it if
+ * @crtc_id is 0, as part of an atomic request.
+ */
+gboolean
+meta_output_kms_add_crtc_to_request (MetaOutput       *output,
+                                     drmModeAtomicReq *req,
+                                     uint32_t          crtc_id)
+{
+  MetaOutputKms *output_kms = output->driver_private;
+
+  if (output_kms->crtc_id_prop_id == 0)
+    return FALSE;
+
+  return drmModeAtomicAddProperty (req, output->winsys_id,
+                                   output_kms->crtc_id_prop_id,
+                                   crtc_id) >= 0;
+}
+
 gboolean
 meta_output_kms_can_clone (MetaOutput *output,
                            MetaOutput *other_output)
@@ -279,6 +299,8 @@ find_connector_properties (MetaGpuKms    *gpu_kms,
       if ((prop->flags & DRM_MODE_PROP_ENUM) &&
           strcmp (prop->name, "DPMS") == 0)
         output_kms->dpms_prop_id = prop->prop_id;
+      else if (strcmp (prop->name, "CRTC_ID") == 0)
+        output_kms->crtc_id_prop_id = prop->prop_id;
       else if ((prop->flags & DRM_MODE_PROP_BLOB) &&
                strcmp (prop->name, "EDID") == 0)
         output_kms->edid_blob_id = connector->prop_values[i];
@@ -300,6 +322,9 @@ find_connector_properties (MetaGpuKms    *gpu_kms,
                strcmp (prop->name, "panel orientation") == 0)
         handle_panel_orientation (output, prop,
                                   output_kms->connector->prop_values[i]);
+      else if ((prop->flags & DRM_MODE_PROP_RANGE) &&
+               strcmp (prop->name, "vrr_capable") == 0)
+        output->is_vrr_capable = connector->prop_values[i] != 0;
 
       drmModeFreeProperty (prop);
     }
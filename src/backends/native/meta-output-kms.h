@@ -35,6 +35,10 @@ gboolean meta_output_kms_can_clone (MetaOutput *output,
 
 GBytes * meta_output_kms_read_edid (MetaOutput *output);
 
+gboolean meta_output_kms_add_crtc_to_request (MetaOutput       *output,
+                                              drmModeAtomicReq *req,
+                                              uint32_t          crtc_id);
+
 MetaOutput * meta_create_kms_output (MetaGpuKms        *gpu_kms,
                                      drmModeConnector  *connector,
                                      MetaKmsResources  *resources,
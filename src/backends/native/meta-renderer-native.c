@@ -41,6 +41,7 @@
 #include <gbm.h>
 #include <gio/gio.h>
 #include <glib-object.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
@@ -63,6 +64,7 @@
 #include "backends/native/meta-renderer-native-gles3.h"
 #include "cogl/cogl.h"
 #include "core/boxes-private.h"
+#include "meta/util.h"
 
 #ifndef EGL_DRM_MASTER_FD_EXT
 #define EGL_DRM_MASTER_FD_EXT 0x333C
@@ -164,6 +166,17 @@ typedef struct _MetaOnscreenNative
     uint32_t next_fb_id;
     struct gbm_bo *current_bo;
     struct gbm_bo *next_bo;
+
+    /* Client buffers assigned for direct scanout. When set, they back
+     * current_fb_id/next_fb_id instead of a buffer from the surface; the
+     * framebuffer then belongs to the client buffer's import, and the
+     * client buffer is held until it has been flipped away from. */
+    MetaWaylandBuffer *current_scanout_buffer;
+    MetaWaylandBuffer *next_scanout_buffer;
+
+    /* Assigned for the next swap, but not yet flipped to */
+    MetaWaylandBuffer *pending_scanout_buffer;
+    uint32_t pending_scanout_fb_id;
   } gbm;
 
 #ifdef HAVE_EGL_DEVICE
@@ -199,8 +212,59 @@ struct _MetaRendererNative
 
   int64_t frame_counter;
   gboolean pending_unset_disabled_crtcs;
+
+  GList *overlays;
+};
+
+struct _MetaRendererNativeOverlay
+{
+  MetaRendererView *view;
+  MetaGpuKms *gpu_kms;
+  MetaCrtc *crtc;
+  unsigned int plane_index;
+
+  /* In stage coordinates, and in CRTC coordinates */
+  MetaRectangle rect;
+  MetaRectangle dst_rect;
+
+  int buffer_width;
+  int buffer_height;
+
+  /* Buffers still held by the CRTC */
+  GList *buffers;
+
+  MetaRendererNativeOverlayFunc presented_func;
+  gpointer user_data;
 };
 
+/*
+ * A client buffer imported for an overlay plane. It is owned by the closure
+ * handed to the CRTC, and destroyed once it is no longer scanned out. Until
+ * then, the client buffer is not released.
+ */
+typedef struct _MetaOverlayBuffer
+{
+  MetaRendererNativeOverlay *overlay;
+  MetaWaylandBuffer *wayland_buffer;
+  MetaWaylandDmaBufBuffer *dma_buf;
+  struct gbm_bo *bo;
+  uint32_t fb_id;
+} MetaOverlayBuffer;
+
+/*
+ * The gbm bo and framebuffer a client buffer was imported as for scanout.
+ * It is attached to the MetaWaylandDmaBufBuffer, so that a buffer a client
+ * keeps reusing is only imported once.
+ */
+typedef struct _MetaDmaBufScanout
+{
+  MetaGpuKms *gpu_kms;
+  struct gbm_bo *bo;
+  uint32_t fb_id;
+} MetaDmaBufScanout;
+
+static GQuark quark_dma_buf_scanout = 0;
+
 static void
 initable_iface_init (GInitableIface *initable_iface);
 
@@ -581,6 +645,12 @@ free_current_bo (CoglOnscreen *onscreen)
 
   kms_fd = meta_gpu_kms_get_fd (render_gpu);
 
+  if (onscreen_native->gbm.current_scanout_buffer)
+    {
+      g_clear_pointer (&onscreen_native->gbm.current_scanout_buffer,
+                       meta_wayland_buffer_unref_scanout);
+      onscreen_native->gbm.current_fb_id = 0;
+    }
   if (onscreen_native->gbm.current_fb_id)
     {
       drmModeRmFB (kms_fd, onscreen_native->gbm.current_fb_id);
@@ -598,6 +668,14 @@ free_current_bo (CoglOnscreen *onscreen)
                         NULL);
 }
 
+static void
+free_pending_scanout (MetaOnscreenNative *onscreen_native)
+{
+  g_clear_pointer (&onscreen_native->gbm.pending_scanout_buffer,
+                   meta_wayland_buffer_unref_scanout);
+  onscreen_native->gbm.pending_scanout_fb_id = 0;
+}
+
 static void
 meta_onscreen_native_queue_swap_notify (CoglOnscreen *onscreen)
 {
@@ -824,6 +902,10 @@ meta_onscreen_native_swap_drm_fb (CoglOnscreen *onscreen)
   onscreen_native->gbm.current_bo = onscreen_native->gbm.next_bo;
   onscreen_native->gbm.next_bo = NULL;
 
+  onscreen_native->gbm.current_scanout_buffer =
+    onscreen_native->gbm.next_scanout_buffer;
+  onscreen_native->gbm.next_scanout_buffer = NULL;
+
   g_hash_table_foreach (onscreen_native->secondary_gpu_states,
                         (GHFunc) swap_secondary_drm_fb,
                         NULL);
@@ -843,6 +925,8 @@ on_crtc_flipped (GClosure         *closure,
   MetaRendererNative *renderer_native = onscreen_native->renderer_native;
   MetaGpuKms *render_gpu = onscreen_native->render_gpu;
 
+  cogl_trace_add_mark ("Page flip completed", g_get_monotonic_time ());
+
   if (gpu_kms != render_gpu)
     {
       MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state;
@@ -921,14 +1005,21 @@ flip_closure_destroyed (MetaRendererView *view)
   switch (renderer_gpu_data->mode)
     {
     case META_RENDERER_NATIVE_MODE_GBM:
-      if (onscreen_native->gbm.next_fb_id)
+      if (onscreen_native->gbm.next_scanout_buffer)
+        {
+          g_clear_pointer (&onscreen_native->gbm.next_scanout_buffer,
+                           meta_wayland_buffer_unref_scanout);
+          onscreen_native->gbm.next_fb_id = 0;
+        }
+      else if (onscreen_native->gbm.next_fb_id)
         {
           int kms_fd;
 
           kms_fd = meta_gpu_kms_get_fd (render_gpu);
           drmModeRmFB (kms_fd, onscreen_native->gbm.next_fb_id);
-          gbm_surface_release_buffer (onscreen_native->gbm.surface,
-                                      onscreen_native->gbm.next_bo);
+          if (onscreen_native->gbm.next_bo)
+            gbm_surface_release_buffer (onscreen_native->gbm.surface,
+                                        onscreen_native->gbm.next_bo);
           onscreen_native->gbm.next_bo = NULL;
           onscreen_native->gbm.next_fb_id = 0;
         }
@@ -1273,13 +1364,12 @@ meta_onscreen_native_flip_crtcs (CoglOnscreen *onscreen)
 }
 
 static gboolean
-gbm_get_next_fb_id (MetaGpuKms         *gpu_kms,
-                    struct gbm_surface *gbm_surface,
-                    struct gbm_bo     **out_next_bo,
-                    uint32_t           *out_next_fb_id)
+add_fb_for_bo (MetaGpuKms     *gpu_kms,
+               struct gbm_bo  *bo,
+               uint32_t       *out_fb_id,
+               GError        **error)
 {
-  struct gbm_bo *next_bo;
-  uint32_t next_fb_id;
+  uint32_t fb_id;
   int kms_fd;
   uint32_t handles[4] = { 0, };
   uint32_t strides[4] = { 0, };
@@ -1287,15 +1377,12 @@ gbm_get_next_fb_id (MetaGpuKms         *gpu_kms,
   uint64_t modifiers[4] = { 0, };
   int i;
 
-  /* Now we need to set the CRTC to whatever is the front buffer */
-  next_bo = gbm_surface_lock_front_buffer (gbm_surface);
-
-  for (i = 0; i < gbm_bo_get_plane_count (next_bo); i++)
+  for (i = 0; i < gbm_bo_get_plane_count (bo); i++)
     {
-      strides[i] = gbm_bo_get_stride_for_plane (next_bo, i);
-      handles[i] = gbm_bo_get_handle_for_plane (next_bo, i).u32;
-      offsets[i] = gbm_bo_get_offset (next_bo, i);
-      modifiers[i] = gbm_bo_get_modifier (next_bo);
+      strides[i] = gbm_bo_get_stride_for_plane (bo, i);
+      handles[i] = gbm_bo_get_handle_for_plane (bo, i).u32;
+      offsets[i] = gbm_bo_get_offset (bo, i);
+      modifiers[i] = gbm_bo_get_modifier (bo);
     }
 
   kms_fd = meta_gpu_kms_get_fd (gpu_kms);
@@ -1303,46 +1390,76 @@ gbm_get_next_fb_id (MetaGpuKms         *gpu_kms,
   if (modifiers[0] != DRM_FORMAT_MOD_INVALID)
     {
       if (drmModeAddFB2WithModifiers (kms_fd,
-                                      gbm_bo_get_width (next_bo),
-                                      gbm_bo_get_height (next_bo),
-                                      gbm_bo_get_format (next_bo),
+                                      gbm_bo_get_width (bo),
+                                      gbm_bo_get_height (bo),
+                                      gbm_bo_get_format (bo),
                                       handles,
                                       strides,
                                       offsets,
                                       modifiers,
-                                      &next_fb_id,
+                                      &fb_id,
                                       DRM_MODE_FB_MODIFIERS))
         {
-          g_warning ("Failed to create new back buffer handle: %m");
-          gbm_surface_release_buffer (gbm_surface, next_bo);
+          g_set_error (error, G_IO_ERROR,
+                       g_io_error_from_errno (errno),
+                       "drmModeAddFB2WithModifiers failed: %s",
+                       g_strerror (errno));
           return FALSE;
         }
     }
   else if (drmModeAddFB2 (kms_fd,
-                          gbm_bo_get_width (next_bo),
-                          gbm_bo_get_height (next_bo),
-                          gbm_bo_get_format (next_bo),
+                          gbm_bo_get_width (bo),
+                          gbm_bo_get_height (bo),
+                          gbm_bo_get_format (bo),
                           handles,
                           strides,
                           offsets,
-                          &next_fb_id,
+                          &fb_id,
                           0))
     {
       if (drmModeAddFB (kms_fd,
-                        gbm_bo_get_width (next_bo),
-                        gbm_bo_get_height (next_bo),
+                        gbm_bo_get_width (bo),
+                        gbm_bo_get_height (bo),
                         24, /* depth */
                         32, /* bpp */
                         strides[0],
                         handles[0],
-                        &next_fb_id))
+                        &fb_id))
         {
-          g_warning ("Failed to create new back buffer handle: %m");
-          gbm_surface_release_buffer (gbm_surface, next_bo);
+          g_set_error (error, G_IO_ERROR,
+                       g_io_error_from_errno (errno),
+                       "drmModeAddFB failed: %s",
+                       g_strerror (errno));
           return FALSE;
         }
     }
 
+  *out_fb_id = fb_id;
+  return TRUE;
+}
+
+static gboolean
+gbm_get_next_fb_id (MetaGpuKms         *gpu_kms,
+                    struct gbm_surface *gbm_surface,
+                    struct gbm_bo     **out_next_bo,
+                    uint32_t           *out_next_fb_id)
+{
+  struct gbm_bo *next_bo;
+  uint32_t next_fb_id;
+  GError *error = NULL;
+
+  /* Now we need to set the CRTC to whatever is the front buffer */
+  next_bo = gbm_surface_lock_front_buffer (gbm_surface);
+
+  if (!add_fb_for_bo (gpu_kms, next_bo, &next_fb_id, &error))
+    {
+      g_warning ("Failed to create new back buffer handle: %s",
+                 error->message);
+      g_error_free (error);
+      gbm_surface_release_buffer (gbm_surface, next_bo);
+      return FALSE;
+    }
+
   *out_next_bo = next_bo;
   *out_next_fb_id = next_fb_id;
   return TRUE;
@@ -1542,6 +1659,8 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen *onscreen,
   MetaGpuKms *render_gpu = onscreen_native->render_gpu;
   CoglFrameInfo *frame_info;
   gboolean egl_context_changed = FALSE;
+  COGL_TRACE_BEGIN_SCOPED (MetaRendererNativeSwapBuffers,
+                           "Onscreen swap buffers");
 
   frame_info = g_queue_peek_tail (&onscreen->pending_frame_infos);
   frame_info->global_frame_counter = renderer_native->frame_counter;
@@ -1550,36 +1669,59 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen *onscreen,
    * Wait for the flip callback before continuing, as we might have started the
    * animation earlier due to the animation being driven by some other monitor.
    */
-  wait_for_pending_flips (onscreen);
+  {
+    COGL_TRACE_BEGIN_SCOPED (MetaRendererNativeWaitForFlips,
+                             "Wait for pending flips");
 
-  update_secondary_gpu_state_pre_swap_buffers (onscreen);
+    wait_for_pending_flips (onscreen);
+  }
 
-  parent_vtable->onscreen_swap_buffers_with_damage (onscreen,
-                                                    rectangles,
-                                                    n_rectangles);
-
-  renderer_gpu_data = meta_renderer_native_get_gpu_data (renderer_native,
-                                                         render_gpu);
-  switch (renderer_gpu_data->mode)
+  if (onscreen_native->gbm.pending_scanout_buffer)
     {
-    case META_RENDERER_NATIVE_MODE_GBM:
+      /* The stage didn't paint anything; flip to the client buffer that
+       * was assigned for direct scanout instead of our own back buffer. */
       g_warn_if_fail (onscreen_native->gbm.next_bo == NULL &&
                       onscreen_native->gbm.next_fb_id == 0);
 
-      if (!gbm_get_next_fb_id (render_gpu,
-                               onscreen_native->gbm.surface,
-                               &onscreen_native->gbm.next_bo,
-                               &onscreen_native->gbm.next_fb_id))
-        return;
+      onscreen_native->gbm.next_scanout_buffer =
+        onscreen_native->gbm.pending_scanout_buffer;
+      onscreen_native->gbm.next_fb_id =
+        onscreen_native->gbm.pending_scanout_fb_id;
+      onscreen_native->gbm.pending_scanout_buffer = NULL;
+      onscreen_native->gbm.pending_scanout_fb_id = 0;
+    }
+  else
+    {
+      update_secondary_gpu_state_pre_swap_buffers (onscreen);
 
-      break;
+      parent_vtable->onscreen_swap_buffers_with_damage (onscreen,
+                                                        rectangles,
+                                                        n_rectangles);
+
+      renderer_gpu_data = meta_renderer_native_get_gpu_data (renderer_native,
+                                                             render_gpu);
+      switch (renderer_gpu_data->mode)
+        {
+        case META_RENDERER_NATIVE_MODE_GBM:
+          g_warn_if_fail (onscreen_native->gbm.next_bo == NULL &&
+                          onscreen_native->gbm.next_fb_id == 0);
+
+          if (!gbm_get_next_fb_id (render_gpu,
+                                   onscreen_native->gbm.surface,
+                                   &onscreen_native->gbm.next_bo,
+                                   &onscreen_native->gbm.next_fb_id))
+            return;
+
+          break;
 #ifdef HAVE_EGL_DEVICE
-    case META_RENDERER_NATIVE_MODE_EGL_DEVICE:
-      break;
+        case META_RENDERER_NATIVE_MODE_EGL_DEVICE:
+          break;
 #endif
-    }
+        }
 
-  update_secondary_gpu_state_post_swap_buffers (onscreen, &egl_context_changed);
+      update_secondary_gpu_state_post_swap_buffers (onscreen,
+                                                    &egl_context_changed);
+    }
 
   /* If this is the first framebuffer to be presented then we now setup the
    * crtc modes, else we flip from the previous buffer */
@@ -2272,6 +2414,7 @@ meta_renderer_native_release_onscreen (CoglOnscreen *onscreen)
       g_return_if_fail (onscreen_native->gbm.next_fb_id == 0);
 
       free_current_bo (onscreen);
+      free_pending_scanout (onscreen_native);
 
       if (onscreen_native->gbm.surface)
         {
@@ -2655,14 +2798,14 @@ meta_renderer_native_create_view (MetaRenderer       *renderer,
 void
 meta_renderer_native_finish_frame (MetaRendererNative *renderer_native)
 {
+  MetaMonitorManager *monitor_manager =
+    META_MONITOR_MANAGER (renderer_native->monitor_manager_kms);
+  GList *l;
+
   renderer_native->frame_counter++;
 
   if (renderer_native->pending_unset_disabled_crtcs)
     {
-      MetaMonitorManager *monitor_manager =
-        META_MONITOR_MANAGER (renderer_native->monitor_manager_kms);
-      GList *l;
-
       for (l = meta_monitor_manager_get_gpus (monitor_manager); l; l = l->next)
         {
           MetaGpu *gpu = l->data;
@@ -2682,6 +2825,17 @@ meta_renderer_native_finish_frame (MetaRendererNative *renderer_native)
 
       renderer_native->pending_unset_disabled_crtcs = FALSE;
     }
+
+  /*
+   * With atomic modesetting, the flips and mode changes of all views sharing
+   * a GPU go out together, as one update per GPU.
+   */
+  for (l = meta_monitor_manager_get_gpus (monitor_manager); l; l = l->next)
+    {
+      MetaGpuKms *gpu_kms = META_GPU_KMS (l->data);
+
+      meta_gpu_kms_commit_update (gpu_kms);
+    }
 }
 
 int64_t
@@ -2690,6 +2844,620 @@ meta_renderer_native_get_frame_counter (MetaRendererNative *renderer_native)
   return renderer_native->frame_counter;
 }
 
+static void
+free_dma_buf_scanout (MetaDmaBufScanout *scanout)
+{
+  drmModeRmFB (meta_gpu_kms_get_fd (scanout->gpu_kms), scanout->fb_id);
+  gbm_bo_destroy (scanout->bo);
+  g_free (scanout);
+}
+
+/*
+ * Returns the scanout import of @dma_buf on @gpu_kms, importing it the
+ * first time. The import lives as long as @dma_buf does, so callers scanning
+ * it out must keep @dma_buf alive until they are done with it.
+ */
+static MetaDmaBufScanout *
+ensure_dma_buf_scanout (MetaRendererNative       *renderer_native,
+                        MetaGpuKms               *gpu_kms,
+                        MetaWaylandDmaBufBuffer  *dma_buf,
+                        GError                  **error)
+{
+  MetaRendererNativeGpuData *renderer_gpu_data;
+  MetaDmaBufScanout *scanout;
+  struct gbm_bo *bo;
+  uint32_t fb_id;
+
+  scanout = g_object_get_qdata (G_OBJECT (dma_buf), quark_dma_buf_scanout);
+  if (scanout)
+    {
+      if (scanout->gpu_kms != gpu_kms)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                       "Buffer already imported on another GPU");
+          return NULL;
+        }
+
+      return scanout;
+    }
+
+  renderer_gpu_data = meta_renderer_native_get_gpu_data (renderer_native,
+                                                         gpu_kms);
+  bo = meta_wayland_dma_buf_import_scanout_bo (dma_buf,
+                                               renderer_gpu_data->gbm.device,
+                                               error);
+  if (!bo)
+    return NULL;
+
+  if (!add_fb_for_bo (gpu_kms, bo, &fb_id, error))
+    {
+      gbm_bo_destroy (bo);
+      return NULL;
+    }
+
+  scanout = g_new0 (MetaDmaBufScanout, 1);
+  scanout->gpu_kms = gpu_kms;
+  scanout->bo = bo;
+  scanout->fb_id = fb_id;
+
+  g_object_set_qdata_full (G_OBJECT (dma_buf), quark_dma_buf_scanout,
+                           scanout,
+                           (GDestroyNotify) free_dma_buf_scanout);
+
+  return scanout;
+}
+
+typedef struct _ScanoutCrtcData
+{
+  MetaGpuKms *render_gpu;
+  struct gbm_bo *bo;
+  int n_crtcs;
+  gboolean can_scanout;
+} ScanoutCrtcData;
+
+static void
+check_scanout_crtc (MetaLogicalMonitor *logical_monitor,
+                    MetaCrtc           *crtc,
+                    gpointer            user_data)
+{
+  ScanoutCrtcData *data = user_data;
+  uint64_t modifier;
+
+  data->n_crtcs++;
+
+  if (meta_crtc_get_gpu (crtc) != META_GPU (data->render_gpu))
+    {
+      data->can_scanout = FALSE;
+      return;
+    }
+
+  if (!crtc->current_mode ||
+      crtc->current_mode->width != (int) gbm_bo_get_width (data->bo) ||
+      crtc->current_mode->height != (int) gbm_bo_get_height (data->bo) ||
+      crtc->transform != META_MONITOR_TRANSFORM_NORMAL)
+    {
+      data->can_scanout = FALSE;
+      return;
+    }
+
+  modifier = gbm_bo_get_modifier (data->bo);
+  if (modifier != DRM_FORMAT_MOD_INVALID)
+    {
+      GArray *crtc_mods;
+      unsigned int i;
+
+      crtc_mods = meta_crtc_kms_get_modifiers (crtc, gbm_bo_get_format (data->bo));
+      if (!crtc_mods)
+        {
+          data->can_scanout = FALSE;
+          return;
+        }
+
+      for (i = 0; i < crtc_mods->len; i++)
+        {
+          if (g_array_index (crtc_mods, uint64_t, i) == modifier)
+            return;
+        }
+
+      data->can_scanout = FALSE;
+    }
+}
+
+/**
+ * meta_renderer_native_try_direct_scanout:
+ * @renderer_native: a #MetaRendererNative
+ * @view: the view covered by the client buffer
+ * @buffer: the client buffer
+ *
+ * Tries to assign @buffer to be flipped to directly at the next swap of
+ * @view, instead of painting the stage into it. This only succeeds if the
+ * buffer exactly matches the single CRTC driving the view, so that the
+ * result is identical to what compositing would have produced.
+ *
+ * On success, @buffer is held, and its release to the client held back,
+ * until @view has flipped away from it again.
+ *
+ * Returns: %TRUE if the next frame of @view will scan out @buffer
+ */
+gboolean
+meta_renderer_native_try_direct_scanout (MetaRendererNative *renderer_native,
+                                         MetaRendererView   *view,
+                                         MetaWaylandBuffer  *buffer)
+{
+  ClutterStageView *stage_view = CLUTTER_STAGE_VIEW (view);
+  CoglFramebuffer *framebuffer;
+  CoglOnscreen *onscreen;
+  CoglOnscreenEGL *onscreen_egl;
+  MetaOnscreenNative *onscreen_native;
+  MetaRendererNativeGpuData *renderer_gpu_data;
+  MetaLogicalMonitor *logical_monitor;
+  MetaWaylandDmaBufBuffer *dma_buf;
+  MetaDmaBufScanout *scanout;
+  ScanoutCrtcData data;
+  GError *error = NULL;
+
+  meta_renderer_native_clear_direct_scanout (renderer_native, view);
+
+  dma_buf = meta_wayland_dma_buf_from_buffer (buffer);
+  if (!dma_buf)
+    return FALSE;
+
+  /* Offscreen views need the stage to apply their transform. */
+  framebuffer = clutter_stage_view_get_onscreen (stage_view);
+  if (framebuffer != clutter_stage_view_get_framebuffer (stage_view))
+    return FALSE;
+
+  onscreen = COGL_ONSCREEN (framebuffer);
+  onscreen_egl = onscreen->winsys;
+  onscreen_native = onscreen_egl->platform;
+
+  renderer_gpu_data =
+    meta_renderer_native_get_gpu_data (renderer_native,
+                                       onscreen_native->render_gpu);
+  if (renderer_gpu_data->mode != META_RENDERER_NATIVE_MODE_GBM)
+    return FALSE;
+
+  /* Secondary GPUs copy from our own back buffer, and a mode set is done
+   * from the stage's buffer as well. */
+  if (g_hash_table_size (onscreen_native->secondary_gpu_states) > 0 ||
+      onscreen_native->pending_set_crtc)
+    return FALSE;
+
+  logical_monitor = meta_renderer_view_get_logical_monitor (view);
+  if (!logical_monitor)
+    return FALSE;
+
+  scanout = ensure_dma_buf_scanout (renderer_native,
+                                    onscreen_native->render_gpu,
+                                    dma_buf,
+                                    &error);
+  if (!scanout)
+    {
+      meta_topic (META_DEBUG_COMPOSITOR,
+                  "Not scanning out client buffer: %s\n", error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  data = (ScanoutCrtcData) {
+    .render_gpu = onscreen_native->render_gpu,
+    .bo = scanout->bo,
+    .can_scanout = TRUE,
+  };
+  meta_logical_monitor_foreach_crtc (logical_monitor,
+                                     check_scanout_crtc,
+                                     &data);
+  if (data.n_crtcs != 1 || !data.can_scanout)
+    return FALSE;
+
+  meta_wayland_buffer_ref_scanout (buffer);
+  onscreen_native->gbm.pending_scanout_buffer = buffer;
+  onscreen_native->gbm.pending_scanout_fb_id = scanout->fb_id;
+  clutter_stage_view_assign_next_scanout (stage_view);
+
+  return TRUE;
+}
+
+void
+meta_renderer_native_clear_direct_scanout (MetaRendererNative *renderer_native,
+                                           MetaRendererView   *view)
+{
+  ClutterStageView *stage_view = CLUTTER_STAGE_VIEW (view);
+  CoglFramebuffer *framebuffer = clutter_stage_view_get_onscreen (stage_view);
+  CoglOnscreen *onscreen = COGL_ONSCREEN (framebuffer);
+  CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+  MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
+
+  free_pending_scanout (onscreen_native);
+  clutter_stage_view_take_next_scanout (stage_view);
+}
+
+static MetaOverlayBuffer *
+import_overlay_buffer (MetaRendererNative       *renderer_native,
+                       MetaGpuKms               *gpu_kms,
+                       MetaWaylandBuffer        *wayland_buffer,
+                       GError                  **error)
+{
+  MetaWaylandDmaBufBuffer *dma_buf;
+  MetaDmaBufScanout *scanout;
+  MetaOverlayBuffer *buffer;
+
+  dma_buf = meta_wayland_dma_buf_from_buffer (wayland_buffer);
+  if (!dma_buf)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   "Not a dma-buf buffer");
+      return NULL;
+    }
+
+  scanout = ensure_dma_buf_scanout (renderer_native, gpu_kms, dma_buf, error);
+  if (!scanout)
+    return NULL;
+
+  buffer = g_new0 (MetaOverlayBuffer, 1);
+  buffer->wayland_buffer = wayland_buffer;
+  meta_wayland_buffer_ref_scanout (wayland_buffer);
+  buffer->dma_buf = g_object_ref (dma_buf);
+  buffer->bo = scanout->bo;
+  buffer->fb_id = scanout->fb_id;
+
+  return buffer;
+}
+
+static void
+free_overlay_buffer (MetaOverlayBuffer *buffer)
+{
+  if (buffer->overlay)
+    buffer->overlay->buffers = g_list_remove (buffer->overlay->buffers,
+                                              buffer);
+
+  g_object_unref (buffer->dma_buf);
+  meta_wayland_buffer_unref_scanout (buffer->wayland_buffer);
+  g_free (buffer);
+}
+
+static void
+overlay_buffer_destroyed (gpointer  data,
+                          GClosure *closure)
+{
+  free_overlay_buffer (data);
+}
+
+static void
+on_overlay_buffer_presented (GClosure          *closure,
+                             MetaGpuKms        *gpu_kms,
+                             MetaOverlayBuffer *buffer)
+{
+  MetaRendererNativeOverlay *overlay = buffer->overlay;
+
+  if (overlay && overlay->presented_func)
+    overlay->presented_func (overlay, overlay->user_data);
+}
+
+static void
+get_overlay_buffer_rect (MetaOverlayBuffer *buffer,
+                         MetaRectangle     *rect)
+{
+  *rect = (MetaRectangle) {
+    .width = gbm_bo_get_width (buffer->bo),
+    .height = gbm_bo_get_height (buffer->bo),
+  };
+}
+
+static void
+show_overlay_buffer (MetaRendererNativeOverlay *overlay,
+                     MetaOverlayBuffer         *buffer)
+{
+  MetaRectangle src_rect;
+  GClosure *closure;
+
+  buffer->overlay = overlay;
+  overlay->buffers = g_list_prepend (overlay->buffers, buffer);
+
+  closure = g_cclosure_new (G_CALLBACK (on_overlay_buffer_presented),
+                            buffer,
+                            overlay_buffer_destroyed);
+  g_closure_set_marshal (closure, g_cclosure_marshal_VOID__OBJECT);
+
+  get_overlay_buffer_rect (buffer, &src_rect);
+  meta_crtc_kms_set_overlay (overlay->crtc,
+                             overlay->plane_index,
+                             buffer->fb_id,
+                             &src_rect,
+                             &overlay->dst_rect,
+                             closure);
+  g_closure_unref (closure);
+}
+
+static gboolean
+find_free_overlay_plane (MetaRendererNative *renderer_native,
+                         MetaCrtc           *crtc,
+                         unsigned int       *out_plane_index)
+{
+  unsigned int n_planes;
+  unsigned int i;
+
+  n_planes = meta_crtc_kms_get_n_overlay_planes (crtc);
+  for (i = 0; i < n_planes; i++)
+    {
+      gboolean is_used = FALSE;
+      GList *l;
+
+      for (l = renderer_native->overlays; l; l = l->next)
+        {
+          MetaRendererNativeOverlay *overlay = l->data;
+
+          if (overlay->crtc == crtc && overlay->plane_index == i)
+            {
+              is_used = TRUE;
+              break;
+            }
+        }
+
+      if (!is_used)
+        {
+          *out_plane_index = i;
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+typedef struct _OverlayCrtcData
+{
+  MetaCrtc *crtc;
+  int n_crtcs;
+} OverlayCrtcData;
+
+static void
+get_overlay_crtc (MetaLogicalMonitor *logical_monitor,
+                  MetaCrtc           *crtc,
+                  gpointer            user_data)
+{
+  OverlayCrtcData *data = user_data;
+
+  data->crtc = crtc;
+  data->n_crtcs++;
+}
+
+/**
+ * meta_renderer_native_assign_overlay:
+ * @renderer_native: a #MetaRendererNative
+ * @view: the view @rect lies within
+ * @wayland_buffer: the client buffer, a dma-buf
+ * @rect: where the buffer is shown, in stage coordinates
+ * @presented_func: called whenever a buffer of the overlay is first scanned out
+ * @user_data: user data for @presented_func
+ *
+ * Tries to show @wayland_buffer at @rect using a free overlay plane of the CRTC
+ * driving @view, so that it does not have to be composited. The plane change
+ * is committed with the next frame of @view, which should not paint the
+ * buffer anymore.
+ *
+ * Returns: (transfer none): the overlay, or %NULL if no plane could be used
+ */
+MetaRendererNativeOverlay *
+meta_renderer_native_assign_overlay (MetaRendererNative            *renderer_native,
+                                     MetaRendererView              *view,
+                                     MetaWaylandBuffer             *wayland_buffer,
+                                     const MetaRectangle           *rect,
+                                     MetaRendererNativeOverlayFunc  presented_func,
+                                     gpointer                       user_data)
+{
+  ClutterStageView *stage_view = CLUTTER_STAGE_VIEW (view);
+  CoglFramebuffer *framebuffer;
+  CoglOnscreen *onscreen;
+  CoglOnscreenEGL *onscreen_egl;
+  MetaOnscreenNative *onscreen_native;
+  MetaRendererNativeGpuData *renderer_gpu_data;
+  MetaLogicalMonitor *logical_monitor;
+  MetaRendererNativeOverlay *overlay;
+  MetaOverlayBuffer *buffer;
+  OverlayCrtcData data = { 0 };
+  MetaGpuKms *gpu_kms;
+  MetaCrtc *crtc;
+  unsigned int plane_index;
+  cairo_rectangle_int_t layout;
+  MetaRectangle src_rect;
+  MetaRectangle dst_rect;
+  float scale;
+  GError *error = NULL;
+
+  /* Offscreen views need the stage to apply their transform. */
+  framebuffer = clutter_stage_view_get_onscreen (stage_view);
+  if (framebuffer != clutter_stage_view_get_framebuffer (stage_view))
+    return NULL;
+
+  onscreen = COGL_ONSCREEN (framebuffer);
+  onscreen_egl = onscreen->winsys;
+  onscreen_native = onscreen_egl->platform;
+
+  renderer_gpu_data =
+    meta_renderer_native_get_gpu_data (renderer_native,
+                                       onscreen_native->render_gpu);
+  if (renderer_gpu_data->mode != META_RENDERER_NATIVE_MODE_GBM)
+    return NULL;
+
+  /* Secondary GPUs only get copies of our own back buffer. */
+  if (g_hash_table_size (onscreen_native->secondary_gpu_states) > 0 ||
+      onscreen_native->pending_set_crtc)
+    return NULL;
+
+  logical_monitor = meta_renderer_view_get_logical_monitor (view);
+  if (!logical_monitor)
+    return NULL;
+
+  meta_logical_monitor_foreach_crtc (logical_monitor,
+                                     get_overlay_crtc,
+                                     &data);
+  if (data.n_crtcs != 1)
+    return NULL;
+
+  crtc = data.crtc;
+  gpu_kms = META_GPU_KMS (meta_crtc_get_gpu (crtc));
+  if (gpu_kms != onscreen_native->render_gpu ||
+      !crtc->current_mode ||
+      crtc->transform != META_MONITOR_TRANSFORM_NORMAL)
+    return NULL;
+
+  if (!find_free_overlay_plane (renderer_native, crtc, &plane_index))
+    return NULL;
+
+  clutter_stage_view_get_layout (stage_view, &layout);
+  scale = clutter_stage_view_get_scale (stage_view);
+  dst_rect = (MetaRectangle) {
+    .x = roundf ((rect->x - layout.x) * scale),
+    .y = roundf ((rect->y - layout.y) * scale),
+    .width = roundf (rect->width * scale),
+    .height = roundf (rect->height * scale),
+  };
+  if (dst_rect.x < 0 || dst_rect.y < 0 ||
+      dst_rect.x + dst_rect.width > crtc->current_mode->width ||
+      dst_rect.y + dst_rect.height > crtc->current_mode->height)
+    return NULL;
+
+  buffer = import_overlay_buffer (renderer_native, gpu_kms, wayland_buffer,
+                                  &error);
+  if (!buffer)
+    {
+      meta_topic (META_DEBUG_COMPOSITOR,
+                  "Not using overlay plane for client buffer: %s\n",
+                  error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  get_overlay_buffer_rect (buffer, &src_rect);
+  if (!meta_gpu_kms_test_overlay (gpu_kms, crtc, plane_index,
+                                  buffer->fb_id,
+                                  &src_rect, &dst_rect,
+                                  &error))
+    {
+      meta_topic (META_DEBUG_COMPOSITOR,
+                  "Not using overlay plane for client buffer: %s\n",
+                  error->message);
+      g_error_free (error);
+      free_overlay_buffer (buffer);
+      return NULL;
+    }
+
+  overlay = g_new0 (MetaRendererNativeOverlay, 1);
+  overlay->view = view;
+  overlay->gpu_kms = gpu_kms;
+  overlay->crtc = g_object_ref (crtc);
+  overlay->plane_index = plane_index;
+  overlay->rect = *rect;
+  overlay->dst_rect = dst_rect;
+  overlay->buffer_width = src_rect.width;
+  overlay->buffer_height = src_rect.height;
+  overlay->presented_func = presented_func;
+  overlay->user_data = user_data;
+  renderer_native->overlays = g_list_prepend (renderer_native->overlays,
+                                              overlay);
+
+  show_overlay_buffer (overlay, buffer);
+
+  return overlay;
+}
+
+/**
+ * meta_renderer_native_overlay_matches:
+ * @overlay: a #MetaRendererNativeOverlay
+ * @view: a #MetaRendererView
+ * @rect: a rectangle in stage coordinates
+ *
+ * Returns: %TRUE if @overlay was assigned for showing a buffer at @rect
+ *   of @view
+ */
+gboolean
+meta_renderer_native_overlay_matches (MetaRendererNativeOverlay *overlay,
+                                      MetaRendererView          *view,
+                                      const MetaRectangle       *rect)
+{
+  return (overlay->view == view &&
+          meta_rectangle_equal (&overlay->rect, rect));
+}
+
+/**
+ * meta_renderer_native_update_overlay:
+ * @renderer_native: a #MetaRendererNative
+ * @overlay: a #MetaRendererNativeOverlay
+ * @wayland_buffer: the new client buffer
+ *
+ * Replaces the buffer shown by @overlay, committing the change right away
+ * unless a frame is being built. This does not involve the stage at all.
+ *
+ * Returns: %TRUE if @wayland_buffer will be shown; if not, the overlay should be
+ *   released and the buffer composited instead
+ */
+gboolean
+meta_renderer_native_update_overlay (MetaRendererNative        *renderer_native,
+                                     MetaRendererNativeOverlay *overlay,
+                                     MetaWaylandBuffer         *wayland_buffer)
+{
+  MetaOverlayBuffer *buffer;
+  MetaRectangle src_rect;
+  GError *error = NULL;
+
+  buffer = import_overlay_buffer (renderer_native, overlay->gpu_kms,
+                                  wayland_buffer, &error);
+  if (!buffer)
+    {
+      meta_topic (META_DEBUG_COMPOSITOR,
+                  "Not using overlay plane for client buffer: %s\n",
+                  error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  /* Only the configuration assigned in the first place was tested. */
+  get_overlay_buffer_rect (buffer, &src_rect);
+  if (src_rect.width != overlay->buffer_width ||
+      src_rect.height != overlay->buffer_height)
+    {
+      free_overlay_buffer (buffer);
+      return FALSE;
+    }
+
+  show_overlay_buffer (overlay, buffer);
+  meta_gpu_kms_update_planes (overlay->gpu_kms);
+
+  return TRUE;
+}
+
+/**
+ * meta_renderer_native_release_overlay:
+ * @renderer_native: a #MetaRendererNative
+ * @overlay: a #MetaRendererNativeOverlay
+ *
+ * Turns off the plane used by @overlay with the next frame, and frees
+ * @overlay. The buffer should be composited again in that frame.
+ */
+void
+meta_renderer_native_release_overlay (MetaRendererNative        *renderer_native,
+                                      MetaRendererNativeOverlay *overlay)
+{
+  GList *l;
+
+  meta_crtc_kms_set_overlay (overlay->crtc, overlay->plane_index,
+                             0, NULL, NULL, NULL);
+
+  /* The buffers still in use by the CRTC go away on their own. */
+  for (l = overlay->buffers; l; l = l->next)
+    {
+      MetaOverlayBuffer *buffer = l->data;
+
+      buffer->overlay = NULL;
+    }
+  g_list_free (overlay->buffers);
+
+  renderer_native->overlays = g_list_remove (renderer_native->overlays,
+                                             overlay);
+  g_object_unref (overlay->crtc);
+  g_free (overlay);
+}
+
 static void
 meta_renderer_native_get_property (GObject    *object,
                                    guint       prop_id,
@@ -3250,6 +4018,9 @@ meta_renderer_native_class_init (MetaRendererNativeClass *klass)
                          G_PARAM_CONSTRUCT_ONLY |
                          G_PARAM_STATIC_STRINGS);
   g_object_class_install_properties (object_class, PROP_LAST, obj_props);
+
+  quark_dma_buf_scanout =
+    g_quark_from_static_string ("-meta-renderer-native-dma-buf-scanout");
 }
 
 MetaRendererNative *
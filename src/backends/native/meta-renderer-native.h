@@ -32,12 +32,19 @@
 #include "backends/meta-renderer.h"
 #include "backends/native/meta-gpu-kms.h"
 #include "backends/native/meta-monitor-manager-kms.h"
+#include "wayland/meta-wayland-buffer.h"
+#include "wayland/meta-wayland-dma-buf.h"
 
 #define META_TYPE_RENDERER_NATIVE (meta_renderer_native_get_type ())
 G_DECLARE_FINAL_TYPE (MetaRendererNative, meta_renderer_native,
                       META, RENDERER_NATIVE,
                       MetaRenderer)
 
+typedef struct _MetaRendererNativeOverlay MetaRendererNativeOverlay;
+
+typedef void (* MetaRendererNativeOverlayFunc) (MetaRendererNativeOverlay *overlay,
+                                                gpointer                   user_data);
+
 typedef enum _MetaRendererNativeMode
 {
   META_RENDERER_NATIVE_MODE_GBM,
@@ -71,4 +78,29 @@ void meta_renderer_native_finish_frame (MetaRendererNative *renderer_native);
 
 int64_t meta_renderer_native_get_frame_counter (MetaRendererNative *renderer_native);
 
+gboolean meta_renderer_native_try_direct_scanout (MetaRendererNative *renderer_native,
+                                                  MetaRendererView   *view,
+                                                  MetaWaylandBuffer  *buffer);
+
+void meta_renderer_native_clear_direct_scanout (MetaRendererNative *renderer_native,
+                                                MetaRendererView   *view);
+
+MetaRendererNativeOverlay * meta_renderer_native_assign_overlay (MetaRendererNative            *renderer_native,
+                                                                 MetaRendererView              *view,
+                                                                 MetaWaylandBuffer             *buffer,
+                                                                 const MetaRectangle           *rect,
+                                                                 MetaRendererNativeOverlayFunc  presented_func,
+                                                                 gpointer                       user_data);
+
+gboolean meta_renderer_native_overlay_matches (MetaRendererNativeOverlay *overlay,
+                                               MetaRendererView          *view,
+                                               const MetaRectangle       *rect);
+
+gboolean meta_renderer_native_update_overlay (MetaRendererNative        *renderer_native,
+                                              MetaRendererNativeOverlay *overlay,
+                                              MetaWaylandBuffer         *buffer);
+
+void meta_renderer_native_release_overlay (MetaRendererNative        *renderer_native,
+                                           MetaRendererNativeOverlay *overlay);
+
 #endif /* META_RENDERER_NATIVE_H */
@@ -39,9 +39,6 @@ struct _MetaStageNative
   ClutterStageCogl parent;
 
   CoglClosure *frame_closure;
-
-  int64_t presented_frame_counter_sync;
-  int64_t presented_frame_counter_complete;
 };
 
 static void
@@ -52,6 +49,25 @@ G_DEFINE_TYPE_WITH_CODE (MetaStageNative, meta_stage_native,
                          G_IMPLEMENT_INTERFACE (CLUTTER_TYPE_STAGE_WINDOW,
                                                 clutter_stage_window_iface_init))
 
+static ClutterStageView *
+find_view_for_onscreen (CoglOnscreen *onscreen)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  GList *l;
+
+  for (l = meta_renderer_get_views (renderer); l; l = l->next)
+    {
+      ClutterStageView *stage_view = l->data;
+
+      if (clutter_stage_view_get_onscreen (stage_view) ==
+          COGL_FRAMEBUFFER (onscreen))
+        return stage_view;
+    }
+
+  return NULL;
+}
+
 static void
 frame_cb (CoglOnscreen  *onscreen,
           CoglFrameEvent frame_event,
@@ -61,36 +77,24 @@ frame_cb (CoglOnscreen  *onscreen,
 {
   MetaStageNative *stage_native = user_data;
   ClutterStageCogl *stage_cogl = CLUTTER_STAGE_COGL (stage_native);
+  ClutterStageView *stage_view;
   int64_t global_frame_counter;
-  int64_t presented_frame_counter;
   ClutterFrameInfo clutter_frame_info;
 
-  global_frame_counter = cogl_frame_info_get_global_frame_counter (frame_info);
-
-  switch (frame_event)
-    {
-    case COGL_FRAME_EVENT_SYNC:
-      presented_frame_counter = stage_native->presented_frame_counter_sync;
-      stage_native->presented_frame_counter_sync = global_frame_counter;
-      break;
-    case COGL_FRAME_EVENT_COMPLETE:
-      presented_frame_counter = stage_native->presented_frame_counter_complete;
-      stage_native->presented_frame_counter_complete = global_frame_counter;
-      break;
-    default:
-      g_assert_not_reached ();
-    }
-
-  if (global_frame_counter <= presented_frame_counter)
+  stage_view = find_view_for_onscreen (onscreen);
+  if (!stage_view)
     return;
 
+  global_frame_counter = cogl_frame_info_get_global_frame_counter (frame_info);
+
   clutter_frame_info = (ClutterFrameInfo) {
     .frame_counter = global_frame_counter,
     .refresh_rate = cogl_frame_info_get_refresh_rate (frame_info),
     .presentation_time = cogl_frame_info_get_presentation_time (frame_info)
   };
 
-  _clutter_stage_cogl_presented (stage_cogl, frame_event, &clutter_frame_info);
+  _clutter_stage_cogl_view_presented (stage_cogl, stage_view,
+                                      frame_event, &clutter_frame_info);
 }
 
 static void
@@ -207,8 +211,6 @@ meta_stage_native_finish_frame (ClutterStageWindow *stage_window)
 static void
 meta_stage_native_init (MetaStageNative *stage_native)
 {
-  stage_native->presented_frame_counter_sync = -1;
-  stage_native->presented_frame_counter_complete = -1;
 }
 
 static void
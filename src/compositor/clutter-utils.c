@@ -124,6 +124,53 @@ meta_actor_is_untransformed (ClutterActor *actor,
   return meta_actor_vertices_are_untransformed (verts, widthf, heightf, x_origin, y_origin);
 }
 
+/**
+ * meta_actor_get_scale_and_offset:
+ * @actor: a #ClutterActor
+ * @x_scale: (out): horizontal scale of @actor relative to its parent
+ * @y_scale: (out): vertical scale of @actor relative to its parent
+ * @x_offset: (out): horizontal position of @actor's origin in its parent
+ * @y_offset: (out): vertical position of @actor's origin in its parent
+ *
+ * Checks if the transformation from @actor's coordinate space to its
+ * parent's is (according to our fixed point precision) only a scale
+ * along the axes followed by a translation, which need not be integral.
+ * Unlike meta_actor_is_untransformed(), this looks at @actor's own
+ * transformation, not at the one into screen space.
+ */
+gboolean
+meta_actor_get_scale_and_offset (ClutterActor *actor,
+                                 float        *x_scale,
+                                 float        *y_scale,
+                                 float        *x_offset,
+                                 float        *y_offset)
+{
+  ClutterMatrix matrix;
+
+  clutter_actor_get_transform (actor, &matrix);
+
+  /* Not rotated/skewed? */
+  if (round_to_fixed (matrix.xy) != 0 || round_to_fixed (matrix.yx) != 0)
+    return FALSE;
+
+  /* Not moved in depth, where the perspective would scale it further? */
+  if (round_to_fixed (matrix.zx) != 0 || round_to_fixed (matrix.zy) != 0 ||
+      round_to_fixed (matrix.zw) != 0)
+    return FALSE;
+
+  /* No projective part? */
+  if (round_to_fixed (matrix.wx) != 0 || round_to_fixed (matrix.wy) != 0 ||
+      round_to_fixed (matrix.ww) != 256)
+    return FALSE;
+
+  *x_scale = matrix.xx;
+  *y_scale = matrix.yy;
+  *x_offset = matrix.xw;
+  *y_offset = matrix.yw;
+
+  return TRUE;
+}
+
 /**
  * meta_actor_painting_untransformed:
  * @paint_width: the width of the painted area
@@ -30,6 +30,11 @@ gboolean meta_actor_vertices_are_untransformed (ClutterVertex *verts,
 gboolean meta_actor_is_untransformed (ClutterActor *actor,
                                       int          *x_origin,
                                       int          *y_origin);
+gboolean meta_actor_get_scale_and_offset (ClutterActor *actor,
+                                          float        *x_scale,
+                                          float        *y_scale,
+                                          float        *x_offset,
+                                          float        *y_offset);
 
 gboolean meta_actor_painting_untransformed (int         paint_width,
                                             int         paint_height,
@@ -72,6 +72,7 @@
 #include "display-private.h" /* for meta_display_lookup_x_window() and meta_display_cancel_touch() */
 #include "util-private.h"
 #include "backends/meta-dnd-private.h"
+#include "backends/meta-monitor-manager-private.h"
 #include "frame.h"
 #include <X11/extensions/shape.h>
 #include <X11/extensions/Xcomposite.h>
@@ -81,6 +82,7 @@
 #include "clutter/clutter-mutter.h"
 
 #ifdef HAVE_WAYLAND
+#include "compositor/meta-surface-actor-wayland.h"
 #include "wayland/meta-wayland-private.h"
 #endif
 
@@ -643,7 +645,8 @@ set_unredirected_window (MetaCompositor *compositor,
       meta_window_actor_set_unredirected (window_actor, FALSE);
     }
 
-  meta_shape_cow_for_window (compositor, window);
+  if (!meta_is_wayland_compositor ())
+    meta_shape_cow_for_window (compositor, window);
   compositor->unredirected_window = window;
 
   if (compositor->unredirected_window != NULL)
@@ -1114,12 +1117,61 @@ on_presented (ClutterStage     *stage,
     }
 }
 
+#ifdef HAVE_WAYLAND
+static void
+assign_overlay_planes (MetaCompositor *compositor)
+{
+  GList *l;
+
+  /* Overlay planes bypass the stage just like unredirection does, so the
+   * same conditions apply: only the monitor sized window on top may use
+   * them, and only when nothing asked for the compositor to stay in the
+   * loop. */
+  for (l = compositor->windows; l; l = l->next)
+    {
+      MetaWindowActor *window_actor = l->data;
+      MetaWindow *window = meta_window_actor_get_meta_window (window_actor);
+      MetaSurfaceActor *surface_actor;
+      gboolean allowed;
+
+      surface_actor = meta_window_actor_get_surface (window_actor);
+      if (!META_IS_SURFACE_ACTOR_WAYLAND (surface_actor))
+        continue;
+
+      allowed = (window_actor == compositor->top_window_actor &&
+                 compositor->disable_unredirect_count == 0 &&
+                 meta_window_is_monitor_sized (window) &&
+                 !meta_window_requested_dont_bypass_compositor (window));
+
+      meta_surface_actor_wayland_assign_overlays (META_SURFACE_ACTOR_WAYLAND (surface_actor),
+                                                  allowed);
+    }
+}
+
+static void
+update_variable_refresh_rate (MetaCompositor *compositor)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
+  MetaWindow *focus_window = compositor->display->focus_window;
+  MetaLogicalMonitor *fullscreen_logical_monitor = NULL;
+
+  if (focus_window && focus_window->fullscreen)
+    fullscreen_logical_monitor = focus_window->monitor;
+
+  meta_monitor_manager_update_vrr (monitor_manager,
+                                   fullscreen_logical_monitor);
+}
+#endif
+
 static gboolean
 meta_pre_paint_func (gpointer data)
 {
   GList *l;
   MetaWindowActor *top_window_actor;
   MetaCompositor *compositor = data;
+  COGL_TRACE_BEGIN_SCOPED (MetaCompositorPrePaint, "Compositor pre-paint");
 
   if (compositor->windows == NULL)
     return TRUE;
@@ -1139,6 +1191,15 @@ meta_pre_paint_func (gpointer data)
       set_unredirected_window (compositor, NULL);
     }
 
+#ifdef HAVE_WAYLAND
+  if (meta_is_wayland_compositor ())
+    {
+      meta_wayland_compositor_pre_paint (meta_wayland_compositor_get_default ());
+      assign_overlay_planes (compositor);
+      update_variable_refresh_rate (compositor);
+    }
+#endif
+
   for (l = compositor->windows; l; l = l->next)
     meta_window_actor_pre_paint (l->data);
 
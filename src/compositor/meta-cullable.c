@@ -23,7 +23,11 @@
 
 #include "config.h"
 #include "meta-cullable.h"
+
+#include <math.h>
+
 #include "clutter-utils.h"
+#include "region-utils.h"
 
 G_DEFINE_INTERFACE (MetaCullable, meta_cullable, CLUTTER_TYPE_ACTOR);
 
@@ -44,8 +48,123 @@ G_DEFINE_INTERFACE (MetaCullable, meta_cullable, CLUTTER_TYPE_ACTOR);
  * and ask each actor to "cull itself out". We pass in a region it can copy
  * to clip its drawing to, and the actor can subtract its fully opaque pixels
  * so that actors underneath know not to draw there as well.
+ *
+ * Children that are scaled or positioned at fractional offsets get the
+ * regions transformed into their coordinate space. Everything that might
+ * be visible stays in the regions they get, and only the pixels they are
+ * guaranteed to cover completely with opaque pixels are taken out of the
+ * regions of the actors underneath.
  */
 
+/* Filtering blends the texels at the edges of an opaque area with the
+ * ones next to it, so when a child isn't painted pixel-aligned, we don't
+ * trust the outermost texels of its opaque area. When it is scaled down,
+ * it is also painted from scaled down textures, where a texel averages
+ * up to two pixels' worth of texels in each direction. */
+static int
+get_filter_margin (float scale)
+{
+  scale = fabsf (scale);
+
+  if (scale >= 1.0f)
+    return 1;
+  else
+    return ceilf (3.0f / scale);
+}
+
+static cairo_region_t *
+transform_region_to_child (cairo_region_t *region,
+                           float           x_scale,
+                           float           y_scale,
+                           float           x_offset,
+                           float           y_offset)
+{
+  /* Everything the child may have to draw into */
+  return meta_region_transform (region,
+                                1.0 / x_scale, 1.0 / y_scale,
+                                - x_offset / x_scale, - y_offset / y_scale,
+                                META_REGION_ROUND_OUT);
+}
+
+static void
+subtract_child_obscured_region (cairo_region_t *region,
+                                cairo_region_t *child_region_before,
+                                cairo_region_t *child_region_after,
+                                float           x_scale,
+                                float           y_scale,
+                                float           x_offset,
+                                float           y_offset)
+{
+  cairo_region_t *obscured_region;
+  cairo_region_t *eroded_region;
+  cairo_region_t *parent_obscured_region;
+
+  /* What the child subtracted is what it paints opaquely */
+  obscured_region = cairo_region_copy (child_region_before);
+  cairo_region_subtract (obscured_region, child_region_after);
+
+  if (cairo_region_is_empty (obscured_region))
+    {
+      cairo_region_destroy (obscured_region);
+      return;
+    }
+
+  eroded_region = meta_region_erode (obscured_region,
+                                     get_filter_margin (x_scale),
+                                     get_filter_margin (y_scale));
+  parent_obscured_region = meta_region_transform (eroded_region,
+                                                  x_scale, y_scale,
+                                                  x_offset, y_offset,
+                                                  META_REGION_ROUND_IN);
+
+  cairo_region_subtract (region, parent_obscured_region);
+
+  cairo_region_destroy (parent_obscured_region);
+  cairo_region_destroy (eroded_region);
+  cairo_region_destroy (obscured_region);
+}
+
+static void
+cull_out_transformed_child (MetaCullable   *child,
+                            cairo_region_t *unobscured_region,
+                            cairo_region_t *clip_region,
+                            float           x_scale,
+                            float           y_scale,
+                            float           x_offset,
+                            float           y_offset)
+{
+  cairo_region_t *child_unobscured_region;
+  cairo_region_t *child_clip_region;
+  cairo_region_t *child_unobscured_region_before;
+  cairo_region_t *child_clip_region_before;
+
+  child_unobscured_region = transform_region_to_child (unobscured_region,
+                                                       x_scale, y_scale,
+                                                       x_offset, y_offset);
+  child_clip_region = transform_region_to_child (clip_region,
+                                                 x_scale, y_scale,
+                                                 x_offset, y_offset);
+
+  child_unobscured_region_before = cairo_region_copy (child_unobscured_region);
+  child_clip_region_before = cairo_region_copy (child_clip_region);
+
+  meta_cullable_cull_out (child, child_unobscured_region, child_clip_region);
+
+  subtract_child_obscured_region (unobscured_region,
+                                  child_unobscured_region_before,
+                                  child_unobscured_region,
+                                  x_scale, y_scale, x_offset, y_offset);
+  subtract_child_obscured_region (clip_region,
+                                  child_clip_region_before,
+                                  child_clip_region,
+                                  x_scale, y_scale, x_offset, y_offset);
+
+  cairo_region_destroy (child_clip_region_before);
+  cairo_region_destroy (child_unobscured_region_before);
+  cairo_region_destroy (child_clip_region);
+  cairo_region_destroy (child_unobscured_region);
+}
+
 /**
  * meta_cullable_cull_out_children:
  * @cullable: The #MetaCullable
@@ -69,6 +188,7 @@ meta_cullable_cull_out_children (MetaCullable   *cullable,
   clutter_actor_iter_init (&iter, actor);
   while (clutter_actor_iter_prev (&iter, &child))
     {
+      float x_scale, y_scale;
       float x, y;
       gboolean needs_culling;
 
@@ -99,13 +219,24 @@ meta_cullable_cull_out_children (MetaCullable   *cullable,
       if (needs_culling && clutter_actor_has_effects (child))
         needs_culling = FALSE;
 
-      if (needs_culling && !meta_actor_is_untransformed (child, NULL, NULL))
+      if (needs_culling &&
+          !meta_actor_get_scale_and_offset (child, &x_scale, &y_scale, &x, &y))
         needs_culling = FALSE;
 
-      if (needs_culling)
-        {
-          clutter_actor_get_position (child, &x, &y);
+      /* Scaled to nothing */
+      if (needs_culling && (x_scale == 0.0f || y_scale == 0.0f))
+        needs_culling = FALSE;
 
+      if (needs_culling &&
+          (x_scale != 1.0f || y_scale != 1.0f ||
+           x != floorf (x) || y != floorf (y)))
+        {
+          cull_out_transformed_child (META_CULLABLE (child),
+                                      unobscured_region, clip_region,
+                                      x_scale, y_scale, x, y);
+        }
+      else if (needs_culling)
+        {
           /* Temporarily move to the coordinate system of the actor */
           cairo_region_translate (unobscured_region, - x, - y);
           cairo_region_translate (clip_region, - x, - y);
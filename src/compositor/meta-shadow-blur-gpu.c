@@ -0,0 +1,328 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright 2017 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "meta-shadow-blur-gpu.h"
+
+#include "meta-shadow-blur.h"
+
+/* This renders the same shadows as meta_shadow_blur_region(), but on the
+ * GPU:
+ *
+ * - The shape is drawn as white rectangles into an offscreen, padded by
+ *   the spread of the blur on each side.
+ *
+ * - The three box blurs of the CPU implementation add up to a single
+ *   filter, which is applied to the rows and then to the columns by two
+ *   passes of a texture lookup snippet, each rendering into a new
+ *   offscreen. The weights are baked into the shader source, so there is
+ *   one set of shaders per blur radius; there are only a few radii in use.
+ *
+ * - The second pass also fades out the top, if requested, and renders only
+ *   the part of the blurred image that ends up in the shadow texture.
+ *
+ * The shape is surrounded by at least one pixel of padding, so clamping
+ * lookups to the edge of the texture is the same as the CPU implementation
+ * treating pixels outside of its buffer as transparent.
+ *
+ * Like the texture created from the CPU blur, the resulting texture only
+ * has meaningful alpha; its color components are black.
+ */
+
+typedef struct _MetaShadowBlurPipelines
+{
+  CoglPipeline *blur;
+  CoglPipeline *blur_and_fade;
+} MetaShadowBlurPipelines;
+
+#define BLUR_SHADER_DECLARATIONS                                        \
+  "uniform vec2 blur_step;\n"
+
+#define FADE_SHADER_DECLARATIONS                                        \
+  "uniform vec2 fade;\n"
+
+/* fade.x is the texture coordinate where the fade starts and fade.y the
+ * inverse of its length in texture coordinates, which matches
+ * fade_bytes() in meta-shadow-factory.c at the centers of the texels. */
+#define FADE_SHADER_CODE                                                \
+  "cogl_texel.a *= clamp ((cogl_tex_coord.t - fade.x) * fade.y,\n"      \
+  "                       0.0, 1.0);\n"
+
+/* radius => MetaShadowBlurPipelines; Cogl caches the shader of every
+ * pipeline it sees with no eviction policy, so the templates are kept for
+ * the lifetime of the process and only copied for drawing. */
+static GHashTable *blur_pipelines;
+
+static char *
+generate_blur_shader_code (int radius)
+{
+  GString *code;
+  double *kernel;
+  int spread;
+  int i;
+
+  kernel = meta_shadow_blur_get_kernel (radius, &spread);
+
+  code = g_string_new ("float alpha = 0.0;\n");
+
+  for (i = 0; i < 2 * spread + 1; i++)
+    {
+      char weight[G_ASCII_DTOSTR_BUF_SIZE];
+
+      /* Shader source must not depend on the locale */
+      g_ascii_formatd (weight, sizeof (weight), "%.9f", kernel[i]);
+      g_string_append_printf (code,
+                              "alpha += texture2D (cogl_sampler,\n"
+                              "                    cogl_tex_coord.st + "
+                              "blur_step * %d.0).a * %s;\n",
+                              i - spread, weight);
+    }
+
+  g_string_append (code, "cogl_texel = vec4 (0.0, 0.0, 0.0, alpha);\n");
+
+  g_free (kernel);
+
+  return g_string_free (code, FALSE);
+}
+
+static MetaShadowBlurPipelines *
+get_blur_pipelines (CoglContext *ctx,
+                    int          radius)
+{
+  MetaShadowBlurPipelines *pipelines;
+  CoglSnippet *snippet;
+  char *code;
+
+  if (!blur_pipelines)
+    blur_pipelines = g_hash_table_new (NULL, NULL);
+
+  pipelines = g_hash_table_lookup (blur_pipelines, GINT_TO_POINTER (radius));
+  if (pipelines)
+    return pipelines;
+
+  pipelines = g_new0 (MetaShadowBlurPipelines, 1);
+
+  pipelines->blur = cogl_pipeline_new (ctx);
+  cogl_pipeline_set_layer_null_texture (pipelines->blur, 0,
+                                        COGL_TEXTURE_TYPE_2D);
+  cogl_pipeline_set_layer_filters (pipelines->blur, 0,
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+  cogl_pipeline_set_layer_wrap_mode (pipelines->blur, 0,
+                                     COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
+  cogl_pipeline_set_blend (pipelines->blur, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+
+  code = generate_blur_shader_code (radius);
+  snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                              BLUR_SHADER_DECLARATIONS,
+                              NULL);
+  cogl_snippet_set_replace (snippet, code);
+  cogl_pipeline_add_layer_snippet (pipelines->blur, 0, snippet);
+  cogl_object_unref (snippet);
+  g_free (code);
+
+  pipelines->blur_and_fade = cogl_pipeline_copy (pipelines->blur);
+
+  snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                              FADE_SHADER_DECLARATIONS,
+                              FADE_SHADER_CODE);
+  cogl_pipeline_add_layer_snippet (pipelines->blur_and_fade, 0, snippet);
+  cogl_object_unref (snippet);
+
+  g_hash_table_insert (blur_pipelines, GINT_TO_POINTER (radius), pipelines);
+
+  return pipelines;
+}
+
+static CoglFramebuffer *
+create_offscreen (CoglContext  *ctx,
+                  int           width,
+                  int           height,
+                  CoglTexture **texture,
+                  CoglError   **error)
+{
+  CoglFramebuffer *framebuffer;
+
+  *texture = COGL_TEXTURE (cogl_texture_2d_new_with_size (ctx, width, height));
+  cogl_texture_set_components (*texture, COGL_TEXTURE_COMPONENTS_RGBA);
+
+  framebuffer = COGL_FRAMEBUFFER (cogl_offscreen_new_with_texture (*texture));
+  if (!cogl_framebuffer_allocate (framebuffer, error))
+    {
+      cogl_object_unref (framebuffer);
+      cogl_object_unref (*texture);
+      *texture = NULL;
+      return NULL;
+    }
+
+  cogl_framebuffer_orthographic (framebuffer, 0, 0, width, height, -1., 1.);
+
+  return framebuffer;
+}
+
+static void
+set_uniform_vec2 (CoglPipeline *pipeline,
+                  const char   *name,
+                  float         x,
+                  float         y)
+{
+  float value[2] = { x, y };
+
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline,
+                                                                       name),
+                                   2, 1, value);
+}
+
+gboolean
+meta_shadow_blur_gpu_is_supported (CoglContext *ctx)
+{
+  /* The shaders use normalized texture coordinates, which rectangle
+   * textures don't have */
+  return (cogl_has_feature (ctx, COGL_FEATURE_ID_GLSL) &&
+          cogl_has_feature (ctx, COGL_FEATURE_ID_OFFSCREEN) &&
+          cogl_has_feature (ctx, COGL_FEATURE_ID_TEXTURE_NPOT));
+}
+
+/**
+ * meta_shadow_blur_region_gpu:
+ * @ctx: a #CoglContext
+ * @region: the shape to blur
+ * @radius: the radius of the blur, greater than 0
+ * @top_fade: if >= 0, the number of rows below the top of @region over
+ *   which the shadow fades in
+ * @crop: the part of the blurred image to return, in the coordinates of
+ *   the buffer meta_shadow_blur_region() would return
+ * @error: return location for a #CoglError
+ *
+ * Renders the shadow of @region on the GPU; see meta_shadow_blur_region().
+ *
+ * Returns: (transfer full): a texture with the size of @crop, or %NULL
+ *   if the offscreens could not be allocated.
+ */
+CoglTexture *
+meta_shadow_blur_region_gpu (CoglContext                 *ctx,
+                             cairo_region_t              *region,
+                             int                          radius,
+                             int                          top_fade,
+                             const cairo_rectangle_int_t *crop,
+                             CoglError                  **error)
+{
+  MetaShadowBlurPipelines *pipelines;
+  CoglFramebuffer *mask_fb = NULL;
+  CoglFramebuffer *rows_fb = NULL;
+  CoglFramebuffer *shadow_fb = NULL;
+  CoglTexture *mask_texture = NULL;
+  CoglTexture *rows_texture = NULL;
+  CoglTexture *shadow_texture = NULL;
+  CoglTexture *texture = NULL;
+  CoglPipeline *pipeline;
+  cairo_rectangle_int_t extents;
+  float *rectangles;
+  int spread;
+  int width, height;
+  int n_rectangles, i;
+
+  g_return_val_if_fail (radius > 0, NULL);
+
+  spread = meta_shadow_blur_get_spread (radius);
+  pipelines = get_blur_pipelines (ctx, radius);
+
+  cairo_region_get_extents (region, &extents);
+  width = extents.width + 2 * spread;
+  height = extents.height + 2 * spread;
+
+  mask_fb = create_offscreen (ctx, width, height, &mask_texture, error);
+  if (!mask_fb)
+    goto out;
+
+  rows_fb = create_offscreen (ctx, width, height, &rows_texture, error);
+  if (!rows_fb)
+    goto out;
+
+  shadow_fb = create_offscreen (ctx, crop->width, crop->height,
+                                &shadow_texture, error);
+  if (!shadow_fb)
+    goto out;
+
+  /* Step 1: unblurred image */
+  cogl_framebuffer_clear4f (mask_fb, COGL_BUFFER_BIT_COLOR, 0, 0, 0, 0);
+
+  n_rectangles = cairo_region_num_rectangles (region);
+  rectangles = g_new (float, n_rectangles * 4);
+  for (i = 0; i < n_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      rectangles[i * 4 + 0] = spread + rect.x - extents.x;
+      rectangles[i * 4 + 1] = spread + rect.y - extents.y;
+      rectangles[i * 4 + 2] = spread + rect.x - extents.x + rect.width;
+      rectangles[i * 4 + 3] = spread + rect.y - extents.y + rect.height;
+    }
+
+  pipeline = cogl_pipeline_new (ctx);
+  cogl_framebuffer_draw_rectangles (mask_fb, pipeline,
+                                    rectangles, n_rectangles);
+  cogl_object_unref (pipeline);
+  g_free (rectangles);
+
+  /* Step 2: blur rows */
+  pipeline = cogl_pipeline_copy (pipelines->blur);
+  cogl_pipeline_set_layer_texture (pipeline, 0, mask_texture);
+  set_uniform_vec2 (pipeline, "blur_step", 1.0f / width, 0.0f);
+  cogl_framebuffer_draw_rectangle (rows_fb, pipeline, 0, 0, width, height);
+  cogl_object_unref (pipeline);
+
+  /* Step 3: blur columns, fading out the top and cropping */
+  pipeline = cogl_pipeline_copy (pipelines->blur_and_fade);
+  cogl_pipeline_set_layer_texture (pipeline, 0, rows_texture);
+  set_uniform_vec2 (pipeline, "blur_step", 0.0f, 1.0f / height);
+  if (top_fade > 0)
+    set_uniform_vec2 (pipeline, "fade",
+                      (float) spread / height, (float) height / top_fade);
+  else
+    set_uniform_vec2 (pipeline, "fade", -1.0f, 1.0f);
+
+  cogl_framebuffer_draw_textured_rectangle (shadow_fb, pipeline,
+                                            0, 0, crop->width, crop->height,
+                                            (float) crop->x / width,
+                                            (float) crop->y / height,
+                                            (float) (crop->x + crop->width) / width,
+                                            (float) (crop->y + crop->height) / height);
+  cogl_object_unref (pipeline);
+
+  texture = g_steal_pointer (&shadow_texture);
+
+out:
+  if (shadow_fb)
+    cogl_object_unref (shadow_fb);
+  if (shadow_texture)
+    cogl_object_unref (shadow_texture);
+  if (rows_fb)
+    cogl_object_unref (rows_fb);
+  if (rows_texture)
+    cogl_object_unref (rows_texture);
+  if (mask_fb)
+    cogl_object_unref (mask_fb);
+  if (mask_texture)
+    cogl_object_unref (mask_texture);
+
+  return texture;
+}
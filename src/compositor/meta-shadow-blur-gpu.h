@@ -0,0 +1,34 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright 2017 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_SHADOW_BLUR_GPU_H
+#define META_SHADOW_BLUR_GPU_H
+
+#include <cairo.h>
+#include <cogl/cogl.h>
+
+gboolean      meta_shadow_blur_gpu_is_supported (CoglContext *ctx);
+
+CoglTexture * meta_shadow_blur_region_gpu (CoglContext                 *ctx,
+                                           cairo_region_t              *region,
+                                           int                          radius,
+                                           int                          top_fade,
+                                           const cairo_rectangle_int_t *crop,
+                                           CoglError                  **error);
+
+#endif /* META_SHADOW_BLUR_GPU_H */
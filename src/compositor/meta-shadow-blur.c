@@ -0,0 +1,844 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright 2010 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "meta-shadow-blur.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "region-utils.h"
+
+#if (defined (__x86_64__) || defined (__i386__)) && \
+    (defined (__clang__) || \
+     (defined (__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define HAVE_X86_BLUR 1
+#include <immintrin.h>
+#endif
+
+/* Columns are blurred in strips, a strip being as many adjacent columns as
+ * fit in a vector register: the box filter slides down all columns of the
+ * strip at once. Strips narrower than a register are handled by the scalar
+ * implementation, which can take up to MAX_STRIP_WIDTH columns. */
+#define MAX_STRIP_WIDTH 32
+
+/* Transposing is done in blocks, which increases cache efficiency compared
+ * to reading or writing an entire column at once; full blocks are
+ * transposed in registers. */
+#define BLOCK_SIZE 16
+
+typedef void (* BlurStripFunc) (guchar *strip,
+                                int     n_columns,
+                                int     stride,
+                                int     height,
+                                int     y0,
+                                int     y1,
+                                int     d,
+                                int     shift,
+                                guchar *tmp_buffer);
+
+typedef void (* SwapBlocksFunc) (guchar *block_a,
+                                 guchar *block_b,
+                                 int     stride);
+
+typedef void (* CopyBlockFunc) (const guchar *src,
+                                int           src_stride,
+                                guchar       *dst,
+                                int           dst_stride);
+
+static struct
+{
+  MetaShadowBlurImpl impl;
+  BlurStripFunc blur_strip;
+  int strip_width;
+  SwapBlocksFunc swap_transposed_blocks;
+  CopyBlockFunc copy_transposed_block;
+} blur_vtable;
+
+/* We emulate a 1D Gaussian blur by using 3 consecutive box blurs;
+ * this produces a result that's within 3% of the original and can be
+ * implemented much faster for large filter sizes because of the
+ * efficiency of implementation of a box blur. Idea and formula
+ * for choosing the box blur size come from:
+ *
+ * http://www.w3.org/TR/SVG/filters.html#feGaussianBlurElement
+ *
+ * The 2D blur is then done by blurring the columns, flipping the
+ * image and blurring the columns again. (This is possible because the
+ * Gaussian kernel is separable - it's the product of a horizontal
+ * blur and a vertical blur.)
+ */
+static int
+get_box_filter_size (int radius)
+{
+  return (int)(0.5 + radius * (0.75 * sqrt(2*M_PI)));
+}
+
+/* The "spread" of the filter is the number of pixels from an original
+ * pixel that it's blurred image extends. (A no-op blur that doesn't
+ * blur would have a spread of 0.) See comment in blur_strip_passes() for
+ * why the odd and even cases are different
+ */
+int
+meta_shadow_blur_get_spread (int radius)
+{
+  int d;
+
+  if (radius == 0)
+    return 0;
+
+  d = get_box_filter_size (radius);
+
+  if (d % 2 == 1)
+    return 3 * (d / 2);
+  else
+    return 3 * (d / 2) - 1;
+}
+
+/**
+ * meta_shadow_blur_get_kernel:
+ * @radius: the radius of the blur
+ * @spread: (out): return location for the spread of the blur
+ *
+ * Computes the weights of the 1D filter that the three box blur passes
+ * of meta_shadow_blur_region() add up to, for use by implementations
+ * that apply the filter in a single pass.
+ *
+ * Returns: (transfer full): 2 * @spread + 1 weights; the weight at
+ *   index @spread is the one of the pixel itself.
+ */
+double *
+meta_shadow_blur_get_kernel (int  radius,
+                             int *spread)
+{
+  int d = get_box_filter_size (radius);
+  int box_start[3], box_width[3];
+  double *kernel, *tmp;
+  int n_taps, start, len;
+  int box, i, j;
+
+  *spread = meta_shadow_blur_get_spread (radius);
+  n_taps = 2 * *spread + 1;
+
+  kernel = g_new0 (double, n_taps);
+  kernel[0] = 1.0;
+
+  if (*spread == 0)
+    return kernel;
+
+  /* See blur_strip_passes() and get_box_offset() for the boxes */
+  if (d % 2 == 1)
+    {
+      for (box = 0; box < 3; box++)
+        {
+          box_start[box] = -(d / 2);
+          box_width[box] = d;
+        }
+    }
+  else
+    {
+      box_start[0] = -(d / 2);
+      box_width[0] = d;
+      box_start[1] = -(d / 2) + 1;
+      box_width[1] = d;
+      box_start[2] = -(d / 2);
+      box_width[2] = d + 1;
+    }
+
+  tmp = g_new (double, n_taps);
+  start = 0;
+  len = 1;
+
+  for (box = 0; box < 3; box++)
+    {
+      memset (tmp, 0, n_taps * sizeof (double));
+
+      for (i = 0; i < len; i++)
+        for (j = 0; j < box_width[box]; j++)
+          tmp[i + j] += kernel[i] / box_width[box];
+
+      memcpy (kernel, tmp, n_taps * sizeof (double));
+      start += box_start[box];
+      len += box_width[box] - 1;
+    }
+
+  g_free (tmp);
+
+  g_assert (start == -*spread && len == n_taps);
+
+  return kernel;
+}
+
+/* d is the filter width; for even d shift indicates how the blurred
+ * result is aligned with the original - does ' x ' go to ' yy' (shift=1)
+ * or 'yy ' (shift=-1)
+ */
+static inline int
+get_box_offset (int d,
+                int shift)
+{
+  if (d % 2 == 1)
+    return d / 2;
+  else
+    return (d - shift) / 2;
+}
+
+/* Dividing the sum of a box by its width is done by multiplying with the
+ * 16 bit fixed point reciprocal instead, which vector units can do for
+ * many pixels at once. The result may be one more than the rounded
+ * quotient; that is invisible, and all implementations agree on it.
+ * Sums of boxes up to 256 pixels wide fit in 16 bits.
+ */
+#define MAX_FIXED_POINT_BOX 256
+
+static inline guint16
+get_box_multiplier (int d)
+{
+  return (0x10000 + d - 1) / d;
+}
+
+/* This applies a single box blur pass to a strip of columns; since the
+ * box blur has the same weight for all pixels, we can implement an
+ * efficient sliding window algorithm where we add in pixels coming
+ * into the window from the bottom and remove them when they leave
+ * the window at the top.
+ */
+static void
+blur_strip_scalar (guchar *strip,
+                   int     n_columns,
+                   int     stride,
+                   int     height,
+                   int     y0,
+                   int     y1,
+                   int     d,
+                   int     shift,
+                   guchar *tmp_buffer)
+{
+  guint32 multiplier = get_box_multiplier (d);
+  guint32 sums[MAX_STRIP_WIDTH] = { 0 };
+  int offset = get_box_offset (d, shift);
+  int i, k;
+
+  for (i = y0 - d + offset; i < y1 + offset; i++)
+    {
+      if (i >= 0 && i < height)
+        {
+          for (k = 0; k < n_columns; k++)
+            sums[k] += strip[i * stride + k];
+        }
+
+      if (i >= y0 + offset)
+        {
+          guchar *dst = tmp_buffer + (i - offset) * n_columns;
+
+          if (i >= d)
+            {
+              for (k = 0; k < n_columns; k++)
+                sums[k] -= strip[(i - d) * stride + k];
+            }
+
+          if (d <= MAX_FIXED_POINT_BOX)
+            {
+              for (k = 0; k < n_columns; k++)
+                dst[k] = MIN (255, ((sums[k] + d / 2) * multiplier) >> 16);
+            }
+          else
+            {
+              for (k = 0; k < n_columns; k++)
+                dst[k] = (sums[k] + d / 2) / d;
+            }
+        }
+    }
+
+  for (i = y0; i < y1; i++)
+    memcpy (strip + i * stride, tmp_buffer + i * n_columns, n_columns);
+}
+
+static void
+swap_transposed_blocks_scalar (guchar *block_a,
+                               guchar *block_b,
+                               int     stride)
+{
+  int i, j;
+
+  if (block_a == block_b)
+    {
+      for (j = 0; j < BLOCK_SIZE; j++)
+        for (i = 0; i < j; i++)
+          {
+            guchar tmp = block_a[j * stride + i];
+            block_a[j * stride + i] = block_a[i * stride + j];
+            block_a[i * stride + j] = tmp;
+          }
+    }
+  else
+    {
+      for (j = 0; j < BLOCK_SIZE; j++)
+        for (i = 0; i < BLOCK_SIZE; i++)
+          {
+            guchar tmp = block_a[j * stride + i];
+            block_a[j * stride + i] = block_b[i * stride + j];
+            block_b[i * stride + j] = tmp;
+          }
+    }
+}
+
+static void
+copy_transposed_block_scalar (const guchar *src,
+                              int           src_stride,
+                              guchar       *dst,
+                              int           dst_stride)
+{
+  int i, j;
+
+  for (i = 0; i < BLOCK_SIZE; i++)
+    for (j = 0; j < BLOCK_SIZE; j++)
+      dst[i * dst_stride + j] = src[j * src_stride + i];
+}
+
+#ifdef HAVE_X86_BLUR
+__attribute__ ((target ("sse2")))
+static void
+blur_strip_sse2 (guchar *strip,
+                 int     n_columns,
+                 int     stride,
+                 int     height,
+                 int     y0,
+                 int     y1,
+                 int     d,
+                 int     shift,
+                 guchar *tmp_buffer)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i multiplier = _mm_set1_epi16 ((short) get_box_multiplier (d));
+  const __m128i rounding = _mm_set1_epi16 (d / 2);
+  __m128i sum_lo = zero;
+  __m128i sum_hi = zero;
+  int offset = get_box_offset (d, shift);
+  int i;
+
+  for (i = y0 - d + offset; i < y1 + offset; i++)
+    {
+      if (i >= 0 && i < height)
+        {
+          __m128i row = _mm_loadu_si128 ((const __m128i *) (strip + i * stride));
+
+          sum_lo = _mm_add_epi16 (sum_lo, _mm_unpacklo_epi8 (row, zero));
+          sum_hi = _mm_add_epi16 (sum_hi, _mm_unpackhi_epi8 (row, zero));
+        }
+
+      if (i >= y0 + offset)
+        {
+          __m128i lo, hi;
+
+          if (i >= d)
+            {
+              __m128i row =
+                _mm_loadu_si128 ((const __m128i *) (strip + (i - d) * stride));
+
+              sum_lo = _mm_sub_epi16 (sum_lo, _mm_unpacklo_epi8 (row, zero));
+              sum_hi = _mm_sub_epi16 (sum_hi, _mm_unpackhi_epi8 (row, zero));
+            }
+
+          lo = _mm_mulhi_epu16 (_mm_add_epi16 (sum_lo, rounding), multiplier);
+          hi = _mm_mulhi_epu16 (_mm_add_epi16 (sum_hi, rounding), multiplier);
+          _mm_storeu_si128 ((__m128i *) (tmp_buffer + (i - offset) * 16),
+                            _mm_packus_epi16 (lo, hi));
+        }
+    }
+
+  for (i = y0; i < y1; i++)
+    _mm_storeu_si128 ((__m128i *) (strip + i * stride),
+                      _mm_loadu_si128 ((const __m128i *) (tmp_buffer + i * 16)));
+}
+
+__attribute__ ((target ("avx2")))
+static void
+blur_strip_avx2 (guchar *strip,
+                 int     n_columns,
+                 int     stride,
+                 int     height,
+                 int     y0,
+                 int     y1,
+                 int     d,
+                 int     shift,
+                 guchar *tmp_buffer)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i multiplier = _mm256_set1_epi16 ((short) get_box_multiplier (d));
+  const __m256i rounding = _mm256_set1_epi16 (d / 2);
+  __m256i sum_lo = zero;
+  __m256i sum_hi = zero;
+  int offset = get_box_offset (d, shift);
+  int i;
+
+  /* Unpacking and packing both work within 128 bit lanes, so the pixels
+   * end up back in their original order. */
+  for (i = y0 - d + offset; i < y1 + offset; i++)
+    {
+      if (i >= 0 && i < height)
+        {
+          __m256i row =
+            _mm256_loadu_si256 ((const __m256i *) (strip + i * stride));
+
+          sum_lo = _mm256_add_epi16 (sum_lo, _mm256_unpacklo_epi8 (row, zero));
+          sum_hi = _mm256_add_epi16 (sum_hi, _mm256_unpackhi_epi8 (row, zero));
+        }
+
+      if (i >= y0 + offset)
+        {
+          __m256i lo, hi;
+
+          if (i >= d)
+            {
+              __m256i row =
+                _mm256_loadu_si256 ((const __m256i *) (strip + (i - d) * stride));
+
+              sum_lo = _mm256_sub_epi16 (sum_lo, _mm256_unpacklo_epi8 (row, zero));
+              sum_hi = _mm256_sub_epi16 (sum_hi, _mm256_unpackhi_epi8 (row, zero));
+            }
+
+          lo = _mm256_mulhi_epu16 (_mm256_add_epi16 (sum_lo, rounding),
+                                   multiplier);
+          hi = _mm256_mulhi_epu16 (_mm256_add_epi16 (sum_hi, rounding),
+                                   multiplier);
+          _mm256_storeu_si256 ((__m256i *) (tmp_buffer + (i - offset) * 32),
+                               _mm256_packus_epi16 (lo, hi));
+        }
+    }
+
+  for (i = y0; i < y1; i++)
+    _mm256_storeu_si256 ((__m256i *) (strip + i * stride),
+                         _mm256_loadu_si256 ((const __m256i *) (tmp_buffer + i * 32)));
+}
+
+/* Interleaving the first half of the rows with the second half four times
+ * over transposes a 16x16 block. */
+__attribute__ ((target ("sse2")))
+static inline void
+load_transposed_block_sse2 (const guchar *block,
+                            int           stride,
+                            __m128i      *rows)
+{
+  __m128i tmp[BLOCK_SIZE];
+  int round, i;
+
+  for (i = 0; i < BLOCK_SIZE; i++)
+    rows[i] = _mm_loadu_si128 ((const __m128i *) (block + i * stride));
+
+  for (round = 0; round < 4; round++)
+    {
+      for (i = 0; i < BLOCK_SIZE / 2; i++)
+        {
+          tmp[2 * i] = _mm_unpacklo_epi8 (rows[i], rows[i + BLOCK_SIZE / 2]);
+          tmp[2 * i + 1] = _mm_unpackhi_epi8 (rows[i], rows[i + BLOCK_SIZE / 2]);
+        }
+
+      memcpy (rows, tmp, sizeof (tmp));
+    }
+}
+
+__attribute__ ((target ("sse2")))
+static inline void
+store_block_sse2 (guchar        *block,
+                  int            stride,
+                  const __m128i *rows)
+{
+  int i;
+
+  for (i = 0; i < BLOCK_SIZE; i++)
+    _mm_storeu_si128 ((__m128i *) (block + i * stride), rows[i]);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+swap_transposed_blocks_sse2 (guchar *block_a,
+                             guchar *block_b,
+                             int     stride)
+{
+  __m128i rows_a[BLOCK_SIZE];
+  __m128i rows_b[BLOCK_SIZE];
+
+  load_transposed_block_sse2 (block_a, stride, rows_a);
+  load_transposed_block_sse2 (block_b, stride, rows_b);
+  store_block_sse2 (block_b, stride, rows_a);
+  store_block_sse2 (block_a, stride, rows_b);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+copy_transposed_block_sse2 (const guchar *src,
+                            int           src_stride,
+                            guchar       *dst,
+                            int           dst_stride)
+{
+  __m128i rows[BLOCK_SIZE];
+
+  load_transposed_block_sse2 (src, src_stride, rows);
+  store_block_sse2 (dst, dst_stride, rows);
+}
+#endif /* HAVE_X86_BLUR */
+
+gboolean
+meta_shadow_blur_impl_is_supported (MetaShadowBlurImpl impl)
+{
+  switch (impl)
+    {
+    case META_SHADOW_BLUR_IMPL_SCALAR:
+      return TRUE;
+#ifdef HAVE_X86_BLUR
+    case META_SHADOW_BLUR_IMPL_SSE2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("sse2") != 0;
+    case META_SHADOW_BLUR_IMPL_AVX2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("avx2") != 0;
+#endif
+    default:
+      return FALSE;
+    }
+}
+
+void
+meta_shadow_blur_set_impl (MetaShadowBlurImpl impl)
+{
+  g_return_if_fail (meta_shadow_blur_impl_is_supported (impl));
+
+  blur_vtable.impl = impl;
+  blur_vtable.blur_strip = blur_strip_scalar;
+  blur_vtable.strip_width = MAX_STRIP_WIDTH;
+  blur_vtable.swap_transposed_blocks = swap_transposed_blocks_scalar;
+  blur_vtable.copy_transposed_block = copy_transposed_block_scalar;
+
+#ifdef HAVE_X86_BLUR
+  switch (impl)
+    {
+    case META_SHADOW_BLUR_IMPL_SCALAR:
+      break;
+    case META_SHADOW_BLUR_IMPL_SSE2:
+      blur_vtable.blur_strip = blur_strip_sse2;
+      blur_vtable.strip_width = 16;
+      blur_vtable.swap_transposed_blocks = swap_transposed_blocks_sse2;
+      blur_vtable.copy_transposed_block = copy_transposed_block_sse2;
+      break;
+    case META_SHADOW_BLUR_IMPL_AVX2:
+      blur_vtable.blur_strip = blur_strip_avx2;
+      blur_vtable.strip_width = 32;
+      blur_vtable.swap_transposed_blocks = swap_transposed_blocks_sse2;
+      blur_vtable.copy_transposed_block = copy_transposed_block_sse2;
+      break;
+    }
+#endif
+}
+
+static void
+ensure_blur_impl (void)
+{
+  if (blur_vtable.blur_strip)
+    return;
+
+  if (meta_shadow_blur_impl_is_supported (META_SHADOW_BLUR_IMPL_AVX2))
+    meta_shadow_blur_set_impl (META_SHADOW_BLUR_IMPL_AVX2);
+  else if (meta_shadow_blur_impl_is_supported (META_SHADOW_BLUR_IMPL_SSE2))
+    meta_shadow_blur_set_impl (META_SHADOW_BLUR_IMPL_SSE2);
+  else
+    meta_shadow_blur_set_impl (META_SHADOW_BLUR_IMPL_SCALAR);
+}
+
+MetaShadowBlurImpl
+meta_shadow_blur_get_impl (void)
+{
+  ensure_blur_impl ();
+
+  return blur_vtable.impl;
+}
+
+static void
+blur_strip_passes (BlurStripFunc  blur_strip,
+                   guchar        *strip,
+                   int            n_columns,
+                   int            stride,
+                   int            height,
+                   int            y0,
+                   int            y1,
+                   int            d,
+                   guchar        *tmp_buffer)
+{
+  /* We want to produce a symmetric blur that spreads a pixel
+   * equally far up and down. If d is odd that happens
+   * naturally, but for d even, we approximate by using a blur
+   * on either side and then a centered blur of size d + 1.
+   * (technique also from the SVG specification)
+   */
+  if (d % 2 == 1)
+    {
+      blur_strip (strip, n_columns, stride, height, y0, y1, d, 0, tmp_buffer);
+      blur_strip (strip, n_columns, stride, height, y0, y1, d, 0, tmp_buffer);
+      blur_strip (strip, n_columns, stride, height, y0, y1, d, 0, tmp_buffer);
+    }
+  else
+    {
+      blur_strip (strip, n_columns, stride, height, y0, y1, d, 1, tmp_buffer);
+      blur_strip (strip, n_columns, stride, height, y0, y1, d, -1, tmp_buffer);
+      blur_strip (strip, n_columns, stride, height, y0, y1, d + 1, 0, tmp_buffer);
+    }
+}
+
+/* The rectangles of convolve_region are transposed: x and width are the
+ * rows to blur over, y and height the columns to blur. */
+static void
+blur_columns (cairo_region_t *convolve_region,
+              int             x_offset,
+              int             y_offset,
+              guchar         *buffer,
+              int             buffer_width,
+              int             buffer_height,
+              int             d)
+{
+  guchar *tmp_buffer;
+  int n_rectangles;
+  int i;
+
+  tmp_buffer = g_malloc (buffer_height * MAX_STRIP_WIDTH);
+
+  n_rectangles = cairo_region_num_rectangles (convolve_region);
+  for (i = 0; i < n_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int x0, x1, y0, y1;
+      int x;
+
+      cairo_region_get_rectangle (convolve_region, i, &rect);
+
+      x0 = x_offset + rect.y;
+      x1 = x0 + rect.height;
+      y0 = y_offset + rect.x;
+      y1 = y0 + rect.width;
+
+      for (x = x0; x < x1; )
+        {
+          BlurStripFunc blur_strip;
+          int n_columns = x1 - x;
+
+          if (n_columns >= blur_vtable.strip_width &&
+              d + 1 <= MAX_FIXED_POINT_BOX)
+            {
+              blur_strip = blur_vtable.blur_strip;
+              n_columns = blur_vtable.strip_width;
+            }
+          else
+            {
+              blur_strip = blur_strip_scalar;
+              n_columns = MIN (n_columns, MAX_STRIP_WIDTH);
+            }
+
+          blur_strip_passes (blur_strip, buffer + x, n_columns,
+                             buffer_width, buffer_height,
+                             y0, y1, d, tmp_buffer);
+
+          x += n_columns;
+        }
+    }
+
+  g_free (tmp_buffer);
+}
+
+/* Swaps width and height. Either swaps in-place and returns the original
+ * buffer or allocates a new buffer, frees the original buffer and returns
+ * the new buffer.
+ */
+static guchar *
+flip_buffer (guchar *buffer,
+             int     width,
+             int     height)
+{
+  if (width == height)
+    {
+      int i0, j0;
+
+      for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
+        for (i0 = 0; i0 <= j0; i0 += BLOCK_SIZE)
+          {
+            int max_j = MIN(j0 + BLOCK_SIZE, height);
+            int max_i = MIN(i0 + BLOCK_SIZE, width);
+            int i, j;
+
+            if (max_j - j0 == BLOCK_SIZE && max_i - i0 == BLOCK_SIZE)
+              {
+                blur_vtable.swap_transposed_blocks (buffer + j0 * width + i0,
+                                                    buffer + i0 * width + j0,
+                                                    width);
+              }
+            else if (i0 == j0)
+              {
+                for (j = j0; j < max_j; j++)
+                  for (i = i0; i < j; i++)
+                    {
+                      guchar tmp = buffer[j * width + i];
+                      buffer[j * width + i] = buffer[i * width + j];
+                      buffer[i * width + j] = tmp;
+                    }
+              }
+            else
+              {
+                for (j = j0; j < max_j; j++)
+                  for (i = i0; i < max_i; i++)
+                    {
+                      guchar tmp = buffer[j * width + i];
+                      buffer[j * width + i] = buffer[i * width + j];
+                      buffer[i * width + j] = tmp;
+                    }
+              }
+          }
+
+      return buffer;
+    }
+  else
+    {
+      guchar *new_buffer = g_malloc (height * width);
+      int i0, j0;
+
+      for (i0 = 0; i0 < width; i0 += BLOCK_SIZE)
+        for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
+          {
+            int max_j = MIN(j0 + BLOCK_SIZE, height);
+            int max_i = MIN(i0 + BLOCK_SIZE, width);
+            int i, j;
+
+            if (max_j - j0 == BLOCK_SIZE && max_i - i0 == BLOCK_SIZE)
+              {
+                blur_vtable.copy_transposed_block (buffer + j0 * width + i0,
+                                                   width,
+                                                   new_buffer + i0 * height + j0,
+                                                   height);
+                continue;
+              }
+
+            for (i = i0; i < max_i; i++)
+              for (j = j0; j < max_j; j++)
+                new_buffer[i * height + j] = buffer[j * width + i];
+          }
+
+      g_free (buffer);
+
+      return new_buffer;
+    }
+}
+
+/**
+ * meta_shadow_blur_region:
+ * @region: the shape to blur
+ * @radius: the radius of the blur
+ * @buffer_width: (out): return location for the width of the result
+ * @buffer_height: (out): return location for the height of the result
+ *
+ * Renders @region as an alpha mask, surrounded by meta_shadow_blur_get_spread()
+ * pixels of padding on each side, and blurs it.
+ *
+ * Returns: (transfer full): the blurred alpha mask, with a stride of
+ *   @buffer_width
+ */
+guchar *
+meta_shadow_blur_region (cairo_region_t *region,
+                         int             radius,
+                         int            *buffer_width,
+                         int            *buffer_height)
+{
+  int d = get_box_filter_size (radius);
+  int spread = meta_shadow_blur_get_spread (radius);
+  cairo_rectangle_int_t extents;
+  cairo_region_t *row_convolve_region;
+  cairo_region_t *column_convolve_region;
+  guchar *buffer;
+  int width;
+  int height;
+  int x_offset;
+  int y_offset;
+  int n_rectangles, j, k;
+
+  ensure_blur_impl ();
+
+  cairo_region_get_extents (region, &extents);
+
+  width = extents.width + 2 * spread;
+  height = extents.height + 2 * spread;
+
+  /* Round up so we have aligned rows/columns */
+  width = (width + 3) & ~3;
+  height = (height + 3) & ~3;
+
+  /* Square buffer allows in-place swaps, which are roughly 70% faster, but we
+   * don't want to over-allocate too much memory.
+   */
+  if (height < width && height > (3 * width) / 4)
+    height = width;
+  if (width < height && width > (3 * height) / 4)
+    width = height;
+
+  buffer = g_malloc0 (width * height);
+
+  /* Blurring with multiple box-blur passes is fast, but (especially for
+   * large shadow sizes) we can improve efficiency by restricting the blur
+   * to the region that actually needs to be blurred.
+   */
+  row_convolve_region = meta_make_border_region (region, spread, spread, FALSE);
+  column_convolve_region = meta_make_border_region (region, 0, spread, TRUE);
+
+  /* Offsets between coordinates of the regions and coordinates in the buffer */
+  x_offset = spread;
+  y_offset = spread;
+
+  /* Step 1: unblurred image */
+  n_rectangles = cairo_region_num_rectangles (region);
+  for (k = 0; k < n_rectangles; k++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, k, &rect);
+      for (j = y_offset + rect.y; j < y_offset + rect.y + rect.height; j++)
+        memset (buffer + width * j + x_offset + rect.x, 255, rect.width);
+    }
+
+  if (d > 0)
+    {
+      /* Step 2: blur columns */
+      blur_columns (column_convolve_region, x_offset, y_offset,
+                    buffer, width, height,
+                    d);
+
+      /* Step 3: swap rows and columns */
+      buffer = flip_buffer (buffer, width, height);
+
+      /* Step 4: blur columns (really rows) */
+      blur_columns (row_convolve_region, y_offset, x_offset,
+                    buffer, height, width,
+                    d);
+
+      /* Step 5: swap rows and columns */
+      buffer = flip_buffer (buffer, height, width);
+    }
+
+  cairo_region_destroy (row_convolve_region);
+  cairo_region_destroy (column_convolve_region);
+
+  *buffer_width = width;
+  *buffer_height = height;
+
+  return buffer;
+}
@@ -0,0 +1,46 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright 2010 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_SHADOW_BLUR_H
+#define META_SHADOW_BLUR_H
+
+#include <cairo.h>
+#include <glib.h>
+
+typedef enum _MetaShadowBlurImpl
+{
+  META_SHADOW_BLUR_IMPL_SCALAR,
+  META_SHADOW_BLUR_IMPL_SSE2,
+  META_SHADOW_BLUR_IMPL_AVX2,
+} MetaShadowBlurImpl;
+
+gboolean           meta_shadow_blur_impl_is_supported (MetaShadowBlurImpl impl);
+void               meta_shadow_blur_set_impl          (MetaShadowBlurImpl impl);
+MetaShadowBlurImpl meta_shadow_blur_get_impl          (void);
+
+int      meta_shadow_blur_get_spread (int radius);
+
+double * meta_shadow_blur_get_kernel (int  radius,
+                                      int *spread);
+
+guchar * meta_shadow_blur_region (cairo_region_t *region,
+                                  int             radius,
+                                  int            *buffer_width,
+                                  int            *buffer_height);
+
+#endif /* META_SHADOW_BLUR_H */
@@ -30,7 +30,10 @@
 #include <meta/util.h>
 
 #include "cogl-utils.h"
-#include "region-utils.h"
+#include "meta-shadow-blur.h"
+#include "meta-shadow-blur-gpu.h"
+#include "backends/meta-backend-private.h"
+#include "backends/meta-settings-private.h"
 
 /* This file implements blurring the shape of a window to produce a
  * shadow texture. The details are discussed below; a quick summary
@@ -43,13 +46,20 @@
  *   size.
  *
  * - We use the fact that a Gaussian blur is separable to do a
- *   2D blur as 1D blur of the rows followed by a 1D blur of the
- *   columns.
+ *   2D blur as 1D blur of the columns followed by a 1D blur of the
+ *   rows.
  *
- * - For better cache efficiency, we blur rows, transpose the image
- *   in blocks, blur rows again, and then transpose back.
+ * - Columns are blurred many at a time with vector instructions, so
+ *   we blur columns, transpose the image in blocks, blur columns again,
+ *   and then transpose back. See meta-shadow-blur.c.
  *
  * - We approximate the 1D gaussian blur as 3 successive box filters.
+ *
+ * - With the "gpu-shadows" experimental feature, the same blur is done
+ *   with shaders instead. See meta-shadow-blur-gpu.c.
+ *
+ * - Recently released shadows are kept around for a while, since
+ *   windows of the same shape tend to come and go.
  */
 
 typedef struct _MetaShadowCacheKey  MetaShadowCacheKey;
@@ -85,6 +95,7 @@ struct _MetaShadow
 
   guint scale_width : 1;
   guint scale_height : 1;
+  guint is_cached : 1;
 };
 
 struct _MetaShadowClassInfo
@@ -102,6 +113,10 @@ struct _MetaShadowFactory
    * by the factory, they are simply removed from the table when freed */
   GHashTable *shadows;
 
+  /* Cached shadows whose last reference was dropped, most recently
+   * released first; they stay in the table until evicted from here */
+  GQueue recent_shadows;
+
   /* class name => MetaShadowClassInfo */
   GHashTable *shadow_classes;
 };
@@ -136,6 +151,10 @@ MetaShadowClassInfo default_shadow_classes[] = {
   { "attached",      { 0, -1, 0, 0, 0 }, { 0, -1, 0, 0, 0 } }
 };
 
+/* How many released shadows to keep around; a handful covers a window
+ * closing and another one of the same kind opening shortly after. */
+#define MAX_RECENT_SHADOWS 16
+
 G_DEFINE_TYPE (MetaShadowFactory, meta_shadow_factory, G_TYPE_OBJECT);
 
 static guint
@@ -165,23 +184,43 @@ meta_shadow_ref (MetaShadow *shadow)
   return shadow;
 }
 
+static void
+meta_shadow_free (MetaShadow *shadow)
+{
+  if (shadow->factory && shadow->is_cached)
+    {
+      g_hash_table_remove (shadow->factory->shadows,
+                           &shadow->key);
+    }
+
+  meta_window_shape_unref (shadow->key.shape);
+  cogl_object_unref (shadow->texture);
+  cogl_object_unref (shadow->pipeline);
+
+  g_slice_free (MetaShadow, shadow);
+}
+
 void
 meta_shadow_unref (MetaShadow *shadow)
 {
+  MetaShadowFactory *factory = shadow->factory;
+
   shadow->ref_count--;
-  if (shadow->ref_count == 0)
-    {
-      if (shadow->factory)
-        {
-          g_hash_table_remove (shadow->factory->shadows,
-                               &shadow->key);
-        }
+  if (shadow->ref_count > 0)
+    return;
 
-      meta_window_shape_unref (shadow->key.shape);
-      cogl_object_unref (shadow->texture);
-      cogl_object_unref (shadow->pipeline);
+  if (factory && shadow->is_cached)
+    {
+      /* Keep the shadow in the table so that it can be picked up again;
+       * once too many have piled up, drop the one released longest ago */
+      g_queue_push_head (&factory->recent_shadows, shadow);
 
-      g_slice_free (MetaShadow, shadow);
+      if (factory->recent_shadows.length > MAX_RECENT_SHADOWS)
+        meta_shadow_free (g_queue_pop_tail (&factory->recent_shadows));
+    }
+  else
+    {
+      meta_shadow_free (shadow);
     }
 }
 
@@ -393,6 +432,7 @@ meta_shadow_factory_init (MetaShadowFactory *factory)
 
   factory->shadows = g_hash_table_new (meta_shadow_cache_key_hash,
                                        meta_shadow_cache_key_equal);
+  g_queue_init (&factory->recent_shadows);
 
   factory->shadow_classes = g_hash_table_new_full (g_str_hash,
                                                    g_str_equal,
@@ -416,17 +456,21 @@ meta_shadow_factory_finalize (GObject *object)
 {
   MetaShadowFactory *factory = META_SHADOW_FACTORY (object);
   GHashTableIter iter;
-  gpointer key, value;
+  gpointer value;
 
   /* Detach from the shadows in the table so we won't try to
-   * remove them when they're freed. */
+   * remove them when they're freed; the released ones are only
+   * referenced by us and go away with the factory. */
   g_hash_table_iter_init (&iter, factory->shadows);
-  while (g_hash_table_iter_next (&iter, &key, &value))
+  while (g_hash_table_iter_next (&iter, NULL, &value))
     {
-      MetaShadow *shadow = key;
+      MetaShadow *shadow = value;
       shadow->factory = NULL;
     }
 
+  g_queue_foreach (&factory->recent_shadows, (GFunc) meta_shadow_free, NULL);
+  g_queue_clear (&factory->recent_shadows);
+
   g_hash_table_destroy (factory->shadows);
   g_hash_table_destroy (factory->shadow_classes);
 
@@ -471,152 +515,6 @@ meta_shadow_factory_get_default (void)
   return factory;
 }
 
-/* We emulate a 1D Gaussian blur by using 3 consecutive box blurs;
- * this produces a result that's within 3% of the original and can be
- * implemented much faster for large filter sizes because of the
- * efficiency of implementation of a box blur. Idea and formula
- * for choosing the box blur size come from:
- *
- * http://www.w3.org/TR/SVG/filters.html#feGaussianBlurElement
- *
- * The 2D blur is then done by blurring the rows, flipping the
- * image and blurring the columns. (This is possible because the
- * Gaussian kernel is separable - it's the product of a horizontal
- * blur and a vertical blur.)
- */
-static int
-get_box_filter_size (int radius)
-{
-  return (int)(0.5 + radius * (0.75 * sqrt(2*M_PI)));
-}
-
-/* The "spread" of the filter is the number of pixels from an original
- * pixel that it's blurred image extends. (A no-op blur that doesn't
- * blur would have a spread of 0.) See comment in blur_rows() for why the
- * odd and even cases are different
- */
-static int
-get_shadow_spread (int radius)
-{
-  int d;
-
-  if (radius == 0)
-    return 0;
-
-  d = get_box_filter_size (radius);
-
-  if (d % 2 == 1)
-    return 3 * (d / 2);
-  else
-    return 3 * (d / 2) - 1;
-}
-
-/* This applies a single box blur pass to a horizontal range of pixels;
- * since the box blur has the same weight for all pixels, we can
- * implement an efficient sliding window algorithm where we add
- * in pixels coming into the window from the right and remove
- * them when they leave the windw to the left.
- *
- * d is the filter width; for even d shift indicates how the blurred
- * result is aligned with the original - does ' x ' go to ' yy' (shift=1)
- * or 'yy ' (shift=-1)
- */
-static void
-blur_xspan (guchar *row,
-            guchar *tmp_buffer,
-            int     row_width,
-            int     x0,
-            int     x1,
-            int     d,
-            int     shift)
-{
-  int offset;
-  int sum = 0;
-  int i;
-
-  if (d % 2 == 1)
-    offset = d / 2;
-  else
-    offset = (d - shift) / 2;
-
-  /* All the conditionals in here look slow, but the branches will
-   * be well predicted and there are enough different possibilities
-   * that trying to write this as a series of unconditional loops
-   * is hard and not an obvious win. The main slow down here seems
-   * to be the integer division per pixel; one possible optimization
-   * would be to accumulate into two 16-bit integer buffers and
-   * only divide down after all three passes. (SSE parallel implementation
-   * of the divide step is possible.)
-   */
-  for (i = x0 - d + offset; i < x1 + offset; i++)
-    {
-      if (i >= 0 && i < row_width)
-        sum += row[i];
-
-      if (i >= x0 + offset)
-        {
-          if (i >= d)
-            sum -= row[i - d];
-
-          tmp_buffer[i - offset] = (sum + d / 2) / d;
-        }
-    }
-
-  memcpy (row + x0, tmp_buffer + x0, x1 - x0);
-}
-
-static void
-blur_rows (cairo_region_t   *convolve_region,
-           int               x_offset,
-           int               y_offset,
-           guchar           *buffer,
-           int               buffer_width,
-           int               buffer_height,
-           int               d)
-{
-  int i, j;
-  int n_rectangles;
-  guchar *tmp_buffer;
-
-  tmp_buffer = g_malloc (buffer_width);
-
-  n_rectangles = cairo_region_num_rectangles (convolve_region);
-  for (i = 0; i < n_rectangles; i++)
-    {
-      cairo_rectangle_int_t rect;
-
-      cairo_region_get_rectangle (convolve_region, i, &rect);
-
-      for (j = y_offset + rect.y; j < y_offset + rect.y + rect.height; j++)
-        {
-          guchar *row = buffer + j * buffer_width;
-          int x0 = x_offset + rect.x;
-          int x1 = x0 + rect.width;
-
-          /* We want to produce a symmetric blur that spreads a pixel
-           * equally far to the left and right. If d is odd that happens
-           * naturally, but for d even, we approximate by using a blur
-           * on either side and then a centered blur of size d + 1.
-           * (technique also from the SVG specification)
-           */
-          if (d % 2 == 1)
-            {
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 0);
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 0);
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 0);
-            }
-          else
-            {
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 1);
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, -1);
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d + 1, 0);
-            }
-        }
-    }
-
-  g_free (tmp_buffer);
-}
-
 static void
 fade_bytes (guchar *bytes,
             int     width,
@@ -630,76 +528,51 @@ fade_bytes (guchar *bytes,
     bytes[i] = (bytes[i] * multiplier) >> 16;
 }
 
-/* Swaps width and height. Either swaps in-place and returns the original
- * buffer or allocates a new buffer, frees the original buffer and returns
- * the new buffer.
- */
-static guchar *
-flip_buffer (guchar *buffer,
-             int     width,
-             int     height)
+static gboolean
+should_use_gpu_blur (CoglContext *ctx)
 {
-  /* Working in blocks increases cache efficiency, compared to reading
-   * or writing an entire column at once */
-#define BLOCK_SIZE 16
-
-  if (width == height)
-    {
-      int i0, j0;
-
-      for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
-        for (i0 = 0; i0 <= j0; i0 += BLOCK_SIZE)
-          {
-            int max_j = MIN(j0 + BLOCK_SIZE, height);
-            int max_i = MIN(i0 + BLOCK_SIZE, width);
-            int i, j;
-
-            if (i0 == j0)
-              {
-                for (j = j0; j < max_j; j++)
-                  for (i = i0; i < j; i++)
-                    {
-                      guchar tmp = buffer[j * width + i];
-                      buffer[j * width + i] = buffer[i * width + j];
-                      buffer[i * width + j] = tmp;
-                    }
-              }
-            else
-              {
-                for (j = j0; j < max_j; j++)
-                  for (i = i0; i < max_i; i++)
-                    {
-                      guchar tmp = buffer[j * width + i];
-                      buffer[j * width + i] = buffer[i * width + j];
-                      buffer[i * width + j] = tmp;
-                    }
-              }
-          }
-
-      return buffer;
-    }
-  else
-    {
-      guchar *new_buffer = g_malloc (height * width);
-      int i0, j0;
+  MetaBackend *backend = meta_get_backend ();
+  MetaSettings *settings = meta_backend_get_settings (backend);
 
-      for (i0 = 0; i0 < width; i0 += BLOCK_SIZE)
-        for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
-          {
-            int max_j = MIN(j0 + BLOCK_SIZE, height);
-            int max_i = MIN(i0 + BLOCK_SIZE, width);
-            int i, j;
+  return (meta_settings_is_experimental_feature_enabled (
+            settings, META_EXPERIMENTAL_FEATURE_GPU_SHADOWS) &&
+          meta_shadow_blur_gpu_is_supported (ctx));
+}
 
-            for (i = i0; i < max_i; i++)
-              for (j = j0; j < max_j; j++)
-                new_buffer[i * height + j] = buffer[j * width + i];
-          }
+static gboolean
+make_shadow_gpu (MetaShadow     *shadow,
+                 CoglContext    *ctx,
+                 cairo_region_t *region)
+{
+  int spread = meta_shadow_blur_get_spread (shadow->key.radius);
+  cairo_rectangle_int_t extents;
+  cairo_rectangle_int_t crop;
+  CoglError *error = NULL;
 
-      g_free (buffer);
+  cairo_region_get_extents (region, &extents);
 
-      return new_buffer;
+  /* The same part of the blurred image as make_shadow() crops out */
+  crop.x = spread - shadow->outer_border_left;
+  crop.y = spread - shadow->outer_border_top;
+  crop.width = shadow->outer_border_left + extents.width + shadow->outer_border_right;
+  crop.height = shadow->outer_border_top + extents.height + shadow->outer_border_bottom;
+
+  shadow->texture = meta_shadow_blur_region_gpu (ctx, region,
+                                                 shadow->key.radius,
+                                                 shadow->key.top_fade,
+                                                 &crop,
+                                                 &error);
+  if (!shadow->texture)
+    {
+      meta_warning ("Failed to render shadow on the GPU, falling back to the CPU: %s\n",
+                    error->message);
+      cogl_error_free (error);
+      return FALSE;
     }
-#undef BLOCK_SIZE
+
+  shadow->pipeline = meta_create_texture_pipeline (shadow->texture);
+
+  return TRUE;
 }
 
 static void
@@ -709,17 +582,18 @@ make_shadow (MetaShadow     *shadow,
   ClutterBackend *backend = clutter_get_default_backend ();
   CoglContext *ctx = clutter_backend_get_cogl_context (backend);
   CoglError *error = NULL;
-  int d = get_box_filter_size (shadow->key.radius);
-  int spread = get_shadow_spread (shadow->key.radius);
+  int spread = meta_shadow_blur_get_spread (shadow->key.radius);
   cairo_rectangle_int_t extents;
-  cairo_region_t *row_convolve_region;
-  cairo_region_t *column_convolve_region;
   guchar *buffer;
   int buffer_width;
   int buffer_height;
   int x_offset;
   int y_offset;
-  int n_rectangles, j, k;
+  int j;
+
+  if (shadow->key.radius > 0 && should_use_gpu_blur (ctx) &&
+      make_shadow_gpu (shadow, ctx, region))
+    return;
 
   cairo_region_get_extents (region, &extents);
 
@@ -731,63 +605,14 @@ make_shadow (MetaShadow     *shadow,
    * for the top pixels, so we create a buffer as if we weren't cropping
    * and only crop when creating the CoglTexture.
    */
+  buffer = meta_shadow_blur_region (region, shadow->key.radius,
+                                    &buffer_width, &buffer_height);
 
-  buffer_width = extents.width + 2 * spread;
-  buffer_height = extents.height + 2 * spread;
-
-  /* Round up so we have aligned rows/columns */
-  buffer_width = (buffer_width + 3) & ~3;
-  buffer_height = (buffer_height + 3) & ~3;
-
-  /* Square buffer allows in-place swaps, which are roughly 70% faster, but we
-   * don't want to over-allocate too much memory.
-   */
-  if (buffer_height < buffer_width && buffer_height > (3 * buffer_width) / 4)
-    buffer_height = buffer_width;
-  if (buffer_width < buffer_height && buffer_width > (3 * buffer_height) / 4)
-    buffer_width = buffer_height;
-
-  buffer = g_malloc0 (buffer_width * buffer_height);
-
-  /* Blurring with multiple box-blur passes is fast, but (especially for
-   * large shadow sizes) we can improve efficiency by restricting the blur
-   * to the region that actually needs to be blurred.
-   */
-  row_convolve_region = meta_make_border_region (region, spread, spread, FALSE);
-  column_convolve_region = meta_make_border_region (region, 0, spread, TRUE);
-
-  /* Offsets between coordinates of the regions and coordinates in the buffer */
+  /* Offsets between coordinates of the region and coordinates in the buffer */
   x_offset = spread;
   y_offset = spread;
 
-  /* Step 1: unblurred image */
-  n_rectangles = cairo_region_num_rectangles (region);
-  for (k = 0; k < n_rectangles; k++)
-    {
-      cairo_rectangle_int_t rect;
-
-      cairo_region_get_rectangle (region, k, &rect);
-      for (j = y_offset + rect.y; j < y_offset + rect.y + rect.height; j++)
-        memset (buffer + buffer_width * j + x_offset + rect.x, 255, rect.width);
-    }
-
-  /* Step 2: swap rows and columns */
-  buffer = flip_buffer (buffer, buffer_width, buffer_height);
-
-  /* Step 3: blur rows (really columns) */
-  blur_rows (column_convolve_region, y_offset, x_offset,
-             buffer, buffer_height, buffer_width,
-             d);
-
-  /* Step 4: swap rows and columns */
-  buffer = flip_buffer (buffer, buffer_height, buffer_width);
-
-  /* Step 5: blur rows */
-  blur_rows (row_convolve_region, x_offset, y_offset,
-             buffer, buffer_width, buffer_height,
-             d);
-
-  /* Step 6: fade out the top, if applicable */
+  /* Fade out the top, if applicable */
   if (shadow->key.top_fade >= 0)
     {
       for (j = y_offset; j < y_offset + MIN (shadow->key.top_fade, extents.height + shadow->outer_border_bottom); j++)
@@ -814,8 +639,6 @@ make_shadow (MetaShadow     *shadow,
       cogl_error_free (error);
     }
 
-  cairo_region_destroy (row_convolve_region);
-  cairo_region_destroy (column_convolve_region);
   g_free (buffer);
 
   shadow->pipeline = meta_create_texture_pipeline (shadow->texture);
@@ -908,10 +731,9 @@ meta_shadow_factory_get_shadow (MetaShadowFactory *factory,
    *
    * For smaller sizes, we create a separate shadow image for each size;
    * since we assume that there will be little reuse, we don't try to
-   * cache such images but just recreate them. (Since the current cache
-   * policy is to only keep around referenced shadows, there wouldn't
-   * be any harm in caching them, it would just make the book-keeping
-   * a bit tricker.)
+   * cache such images but just recreate them; keeping them around
+   * after they are released would only push useful shadows out of the
+   * cache.
    *
    * In the case where we are fading a the top, that also has to fit
    * within the top unscaled border.
@@ -919,7 +741,7 @@ meta_shadow_factory_get_shadow (MetaShadowFactory *factory,
 
   params = get_shadow_params (factory, class_name, focused, FALSE);
 
-  spread = get_shadow_spread (params->radius);
+  spread = meta_shadow_blur_get_spread (params->radius);
   meta_window_shape_get_borders (shape,
                                  &shape_border_top,
                                  &shape_border_right,
@@ -947,7 +769,12 @@ meta_shadow_factory_get_shadow (MetaShadowFactory *factory,
 
       shadow = g_hash_table_lookup (factory->shadows, &key);
       if (shadow)
-        return meta_shadow_ref (shadow);
+        {
+          if (shadow->ref_count == 0)
+            g_queue_remove (&factory->recent_shadows, shadow);
+
+          return meta_shadow_ref (shadow);
+        }
     }
 
   shadow = g_slice_new0 (MetaShadow);
@@ -987,7 +814,10 @@ meta_shadow_factory_get_shadow (MetaShadowFactory *factory,
   cairo_region_destroy (region);
 
   if (cacheable)
-    g_hash_table_insert (factory->shadows, &shadow->key, shadow);
+    {
+      g_hash_table_insert (factory->shadows, &shadow->key, shadow);
+      shadow->is_cached = TRUE;
+    }
 
   return shadow;
 }
@@ -71,6 +71,29 @@ enum {
 
 static guint signals[LAST_SIGNAL];
 
+typedef enum
+{
+  PIPELINE_UNMASKED,
+  PIPELINE_MASKED,
+  PIPELINE_UNBLENDED,
+
+  N_PIPELINES
+} PipelineType;
+
+/* Pipeline templates are shared by all shaped textures, so that windows
+ * painted the same way, and a window that keeps swapping buffers, use
+ * the same GLSL program and GL state instead of having Cogl work out
+ * that their freshly made pipelines are equivalent. The per-window
+ * pipelines are copies of these, differing only in texture, color and
+ * filters. */
+typedef struct
+{
+  CoglSnippet *snippet;
+  CoglPipeline *templates[2][N_PIPELINES]; /* [is_y_inverted][type] */
+} PipelineTemplates;
+
+static GHashTable *pipeline_templates;
+
 struct _MetaShapedTexturePrivate
 {
   MetaTextureTower *paint_tower;
@@ -79,9 +102,7 @@ struct _MetaShapedTexturePrivate
   CoglTexture *mask_texture;
   CoglSnippet *snippet;
 
-  CoglPipeline *base_pipeline;
-  CoglPipeline *masked_pipeline;
-  CoglPipeline *unblended_pipeline;
+  CoglPipeline *pipelines[N_PIPELINES];
 
   gboolean is_y_inverted;
 
@@ -179,10 +200,10 @@ static void
 meta_shaped_texture_reset_pipelines (MetaShapedTexture *stex)
 {
   MetaShapedTexturePrivate *priv = stex->priv;
+  int i;
 
-  g_clear_pointer (&priv->base_pipeline, cogl_object_unref);
-  g_clear_pointer (&priv->masked_pipeline, cogl_object_unref);
-  g_clear_pointer (&priv->unblended_pipeline, cogl_object_unref);
+  for (i = 0; i < N_PIPELINES; i++)
+    g_clear_pointer (&priv->pipelines[i], cogl_object_unref);
 }
 
 static void
@@ -210,15 +231,12 @@ meta_shaped_texture_dispose (GObject *object)
 }
 
 static CoglPipeline *
-get_base_pipeline (MetaShapedTexture *stex,
-                   CoglContext       *ctx)
+create_base_pipeline_template (CoglContext *ctx,
+                               CoglSnippet *snippet,
+                               gboolean     is_y_inverted)
 {
-  MetaShapedTexturePrivate *priv = stex->priv;
   CoglPipeline *pipeline;
 
-  if (priv->base_pipeline)
-    return priv->base_pipeline;
-
   pipeline = cogl_pipeline_new (ctx);
   cogl_pipeline_set_layer_wrap_mode_s (pipeline, 0,
                                        COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
@@ -228,7 +246,7 @@ get_base_pipeline (MetaShapedTexture *stex,
                                        COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
   cogl_pipeline_set_layer_wrap_mode_t (pipeline, 1,
                                        COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
-  if (!priv->is_y_inverted)
+  if (!is_y_inverted)
     {
       CoglMatrix matrix;
 
@@ -238,62 +256,125 @@ get_base_pipeline (MetaShapedTexture *stex,
       cogl_pipeline_set_layer_matrix (pipeline, 0, &matrix);
     }
 
-  if (priv->snippet)
-    cogl_pipeline_add_layer_snippet (pipeline, 0, priv->snippet);
-
-  priv->base_pipeline = pipeline;
+  if (snippet)
+    cogl_pipeline_add_layer_snippet (pipeline, 0, snippet);
 
-  return priv->base_pipeline;
+  return pipeline;
 }
 
-static CoglPipeline *
-get_unmasked_pipeline (MetaShapedTexture *stex,
-                       CoglContext       *ctx)
+static void
+pipeline_templates_free (PipelineTemplates *templates)
 {
-  return get_base_pipeline (stex, ctx);
+  int i, j;
+
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < N_PIPELINES; j++)
+      g_clear_pointer (&templates->templates[i][j], cogl_object_unref);
+
+  g_clear_pointer (&templates->snippet, cogl_object_unref);
+  g_slice_free (PipelineTemplates, templates);
 }
 
 static CoglPipeline *
-get_masked_pipeline (MetaShapedTexture *stex,
-                     CoglContext       *ctx)
+get_pipeline_template (CoglContext  *ctx,
+                       CoglSnippet  *snippet,
+                       gboolean      is_y_inverted,
+                       PipelineType  type)
 {
-  MetaShapedTexturePrivate *priv = stex->priv;
+  PipelineTemplates *templates;
+  CoglPipeline **template_location;
+  CoglPipeline *base;
   CoglPipeline *pipeline;
+  CoglColor color;
+
+  if (G_UNLIKELY (pipeline_templates == NULL))
+    pipeline_templates =
+      g_hash_table_new_full (NULL, NULL, NULL,
+                             (GDestroyNotify) pipeline_templates_free);
 
-  if (priv->masked_pipeline)
-    return priv->masked_pipeline;
+  templates = g_hash_table_lookup (pipeline_templates, snippet);
+  if (!templates)
+    {
+      templates = g_slice_new0 (PipelineTemplates);
+      if (snippet)
+        templates->snippet = cogl_object_ref (snippet);
+      g_hash_table_insert (pipeline_templates, snippet, templates);
+    }
 
-  pipeline = cogl_pipeline_copy (get_base_pipeline (stex, ctx));
-  cogl_pipeline_set_layer_combine (pipeline, 1,
-                                   "RGBA = MODULATE (PREVIOUS, TEXTURE[A])",
-                                   NULL);
+  template_location = &templates->templates[is_y_inverted ? 1 : 0][type];
+  if (*template_location)
+    return *template_location;
 
-  priv->masked_pipeline = pipeline;
+  if (type == PIPELINE_UNMASKED)
+    {
+      *template_location = create_base_pipeline_template (ctx, snippet,
+                                                          is_y_inverted);
+      return *template_location;
+    }
+
+  base = get_pipeline_template (ctx, snippet, is_y_inverted, PIPELINE_UNMASKED);
+  pipeline = cogl_pipeline_copy (base);
+
+  switch (type)
+    {
+    case PIPELINE_MASKED:
+      cogl_pipeline_set_layer_combine (pipeline, 1,
+                                       "RGBA = MODULATE (PREVIOUS, TEXTURE[A])",
+                                       NULL);
+      break;
+    case PIPELINE_UNBLENDED:
+      cogl_color_init_from_4ub (&color, 255, 255, 255, 255);
+      cogl_pipeline_set_blend (pipeline,
+                               "RGBA = ADD (SRC_COLOR, 0)",
+                               NULL);
+      cogl_pipeline_set_color (pipeline, &color);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  *template_location = pipeline;
 
   return pipeline;
 }
 
 static CoglPipeline *
-get_unblended_pipeline (MetaShapedTexture *stex,
-                        CoglContext       *ctx)
+get_pipeline (MetaShapedTexture *stex,
+              CoglContext       *ctx,
+              PipelineType       type)
 {
   MetaShapedTexturePrivate *priv = stex->priv;
-  CoglPipeline *pipeline;
-  CoglColor color;
+  CoglPipeline *template;
 
-  if (priv->unblended_pipeline)
-    return priv->unblended_pipeline;
+  if (priv->pipelines[type])
+    return priv->pipelines[type];
 
-  pipeline = cogl_pipeline_copy (get_base_pipeline (stex, ctx));
-  cogl_color_init_from_4ub (&color, 255, 255, 255, 255);
-  cogl_pipeline_set_blend (pipeline,
-                           "RGBA = ADD (SRC_COLOR, 0)",
-                           NULL);
-  cogl_pipeline_set_color (pipeline, &color);
+  template = get_pipeline_template (ctx, priv->snippet, priv->is_y_inverted,
+                                    type);
+  priv->pipelines[type] = cogl_pipeline_copy (template);
 
-  priv->unblended_pipeline = pipeline;
+  return priv->pipelines[type];
+}
 
-  return pipeline;
+static CoglPipeline *
+get_unmasked_pipeline (MetaShapedTexture *stex,
+                       CoglContext       *ctx)
+{
+  return get_pipeline (stex, ctx, PIPELINE_UNMASKED);
+}
+
+static CoglPipeline *
+get_masked_pipeline (MetaShapedTexture *stex,
+                     CoglContext       *ctx)
+{
+  return get_pipeline (stex, ctx, PIPELINE_MASKED);
+}
+
+static CoglPipeline *
+get_unblended_pipeline (MetaShapedTexture *stex,
+                        CoglContext       *ctx)
+{
+  return get_pipeline (stex, ctx, PIPELINE_UNBLENDED);
 }
 
 static void
@@ -383,7 +464,7 @@ meta_shaped_texture_paint (ClutterActor *actor)
   CoglFramebuffer *fb;
   CoglTexture *paint_tex;
   ClutterActorBox alloc;
-  CoglPipelineFilter filter;
+  CoglPipelineFilter filter, min_filter;
 
   if (priv->clip_region && cairo_region_is_empty (priv->clip_region))
     return;
@@ -405,6 +486,9 @@ meta_shaped_texture_paint (ClutterActor *actor)
    * if that was the case, set the clutter texture quality to HIGH.
    * Setting the texture quality to high without SGIS_generate_mipmap
    * support for TFP textures will result in fallbacks to XGetImage.
+   *
+   * The tower itself may hand us a copy of the texture with GPU
+   * generated mipmaps though, which we then paint with a mipmap filter.
    */
   if (priv->create_mipmaps)
     paint_tex = meta_texture_tower_get_paint_texture (priv->paint_tower);
@@ -431,6 +515,12 @@ meta_shaped_texture_paint (ClutterActor *actor)
   if (meta_actor_painting_untransformed (tex_width, tex_height, NULL, NULL))
     filter = COGL_PIPELINE_FILTER_NEAREST;
 
+  min_filter = filter;
+
+  if (priv->create_mipmaps &&
+      meta_texture_tower_is_mipmapped (priv->paint_tower, paint_tex))
+    min_filter = COGL_PIPELINE_FILTER_LINEAR_MIPMAP_NEAREST;
+
   ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
   fb = cogl_get_draw_framebuffer ();
 
@@ -496,7 +586,7 @@ meta_shaped_texture_paint (ClutterActor *actor)
         {
           opaque_pipeline = get_unblended_pipeline (stex, ctx);
           cogl_pipeline_set_layer_texture (opaque_pipeline, 0, paint_tex);
-          cogl_pipeline_set_layer_filters (opaque_pipeline, 0, filter, filter);
+          cogl_pipeline_set_layer_filters (opaque_pipeline, 0, min_filter, filter);
 
           n_rects = cairo_region_num_rectangles (region);
           for (i = 0; i < n_rects; i++)
@@ -536,7 +626,7 @@ meta_shaped_texture_paint (ClutterActor *actor)
         }
 
       cogl_pipeline_set_layer_texture (blended_pipeline, 0, paint_tex);
-      cogl_pipeline_set_layer_filters (blended_pipeline, 0, filter, filter);
+      cogl_pipeline_set_layer_filters (blended_pipeline, 0, min_filter, filter);
 
       CoglColor color;
       cogl_color_init_from_4ub (&color, opacity, opacity, opacity, opacity);
@@ -36,12 +36,30 @@
 #include "wayland/meta-window-wayland.h"
 
 #include "backends/meta-backend-private.h"
+#include "compositor/clutter-utils.h"
+#include "compositor/meta-window-actor-private.h"
 #include "compositor/region-utils.h"
 
+#ifdef HAVE_NATIVE_BACKEND
+#include "backends/meta-cursor-renderer.h"
+#include "backends/meta-renderer-view.h"
+#include "backends/native/meta-backend-native.h"
+#include "backends/native/meta-renderer-native.h"
+#include "wayland/meta-wayland-dma-buf.h"
+#endif
+
 struct _MetaSurfaceActorWaylandPrivate
 {
   MetaWaylandSurface *surface;
   struct wl_list frame_callback_list;
+
+  gboolean unredirected;
+
+#ifdef HAVE_NATIVE_BACKEND
+  MetaRendererNativeOverlay *overlay;
+  gboolean overlay_failed;
+  MetaRectangle overlay_failed_rect;
+#endif
 };
 typedef struct _MetaSurfaceActorWaylandPrivate MetaSurfaceActorWaylandPrivate;
 
@@ -53,9 +71,393 @@ meta_surface_actor_wayland_process_damage (MetaSurfaceActor *actor,
 {
 }
 
+static void
+queue_frame_callbacks (MetaSurfaceActorWayland *self)
+{
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+
+  if (priv->surface)
+    {
+      MetaWaylandCompositor *compositor = priv->surface->compositor;
+
+      wl_list_insert_list (&compositor->frame_callbacks, &priv->frame_callback_list);
+      wl_list_init (&priv->frame_callback_list);
+    }
+}
+
+#ifdef HAVE_NATIVE_BACKEND
+static MetaRendererView *
+get_view_for_logical_monitor (MetaRenderer       *renderer,
+                              MetaLogicalMonitor *logical_monitor)
+{
+  GList *l;
+
+  for (l = meta_renderer_get_views (renderer); l; l = l->next)
+    {
+      MetaRendererView *view = l->data;
+
+      if (meta_renderer_view_get_logical_monitor (view) == logical_monitor)
+        return view;
+    }
+
+  return NULL;
+}
+
+static void
+clear_direct_scanout (MetaSurfaceActorWayland *self)
+{
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  MetaWindow *window;
+  MetaRendererView *view;
+
+  if (!priv->surface)
+    return;
+
+  window = priv->surface->window;
+  if (!window || !window->monitor)
+    return;
+
+  view = get_view_for_logical_monitor (renderer, window->monitor);
+  if (view)
+    meta_renderer_native_clear_direct_scanout (META_RENDERER_NATIVE (renderer),
+                                               view);
+}
+#endif
+
+#ifdef HAVE_NATIVE_BACKEND
+static void
+send_frame_callbacks (MetaSurfaceActorWayland *self)
+{
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+  guint32 time = (guint32) (g_get_monotonic_time () / 1000);
+
+  while (!wl_list_empty (&priv->frame_callback_list))
+    {
+      MetaWaylandFrameCallback *callback =
+        wl_container_of (priv->frame_callback_list.next, callback, link);
+
+      wl_callback_send_done (callback->resource, time);
+      wl_resource_destroy (callback->resource);
+    }
+}
+
+static void
+on_overlay_presented (MetaRendererNativeOverlay *overlay,
+                      gpointer                   user_data)
+{
+  MetaSurfaceActorWayland *self = user_data;
+
+  /* The stage never paints us while on an overlay plane, so the frame
+   * callbacks are sent when the plane shows the new buffer instead. */
+  send_frame_callbacks (self);
+}
+
+static void
+release_overlay (MetaSurfaceActorWayland *self)
+{
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+
+  meta_renderer_native_release_overlay (META_RENDERER_NATIVE (renderer),
+                                        priv->overlay);
+  priv->overlay = NULL;
+
+  /* Damage was not tracked while on the plane */
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+}
+
+static gboolean
+is_overlapped_by_siblings (ClutterActor        *actor,
+                           const MetaRectangle *rect)
+{
+  ClutterActor *sibling;
+
+  for (sibling = clutter_actor_get_next_sibling (actor);
+       sibling;
+       sibling = clutter_actor_get_next_sibling (sibling))
+    {
+      MetaRectangle sibling_rect;
+      float x, y, width, height;
+
+      if (!CLUTTER_ACTOR_IS_VISIBLE (sibling))
+        continue;
+
+      clutter_actor_get_transformed_position (sibling, &x, &y);
+      clutter_actor_get_transformed_size (sibling, &width, &height);
+      sibling_rect = (MetaRectangle) {
+        .x = floorf (x),
+        .y = floorf (y),
+        .width = ceilf (x + width) - floorf (x),
+        .height = ceilf (y + height) - floorf (y),
+      };
+
+      if (meta_rectangle_overlap (&sibling_rect, rect))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Checks whether the surface could be shown on an overlay plane without
+ * changing what ends up on screen: an opaque buffer, drawn unscaled, with
+ * nothing of its window drawn on top of it.
+ */
+static gboolean
+get_overlay_placement (MetaSurfaceActorWayland  *self,
+                       MetaWaylandBuffer       **out_buffer,
+                       MetaRendererView        **out_view,
+                       MetaRectangle            *out_rect)
+{
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+  MetaSurfaceActor *surface_actor = META_SURFACE_ACTOR (self);
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  MetaCursorRenderer *cursor_renderer;
+  MetaShapedTexture *stex;
+  MetaWaylandBuffer *buffer;
+  MetaRectangle rect;
+  ClutterActor *actor;
+  float width, height;
+  GList *l;
+
+  if (!priv->surface || !priv->surface->sub.parent)
+    return FALSE;
+
+  /* Anything drawn on top of the buffer would be lost. */
+  if (priv->surface->subsurfaces)
+    return FALSE;
+
+  cursor_renderer = meta_backend_get_cursor_renderer (backend);
+  if (meta_cursor_renderer_is_overlay_visible (cursor_renderer))
+    return FALSE;
+
+  buffer = meta_wayland_surface_get_buffer (priv->surface);
+  if (!buffer || buffer->type != META_WAYLAND_BUFFER_TYPE_DMA_BUF)
+    return FALSE;
+
+  if (meta_surface_actor_is_argb32 (surface_actor))
+    return FALSE;
+
+  if (!clutter_actor_is_mapped (CLUTTER_ACTOR (self)) ||
+      clutter_actor_get_paint_opacity (CLUTTER_ACTOR (self)) != 0xff)
+    return FALSE;
+
+  if (!meta_wayland_dma_buf_from_buffer (buffer))
+    return FALSE;
+
+  /* One buffer pixel per stage pixel */
+  stex = meta_surface_actor_get_texture (surface_actor);
+  if (!meta_actor_is_untransformed (CLUTTER_ACTOR (stex), &rect.x, &rect.y))
+    return FALSE;
+
+  clutter_actor_get_size (CLUTTER_ACTOR (stex), &width, &height);
+  rect.width = cogl_texture_get_width (buffer->texture);
+  rect.height = cogl_texture_get_height (buffer->texture);
+  if ((int) width != rect.width || (int) height != rect.height)
+    return FALSE;
+
+  for (actor = CLUTTER_ACTOR (self);
+       actor && !META_IS_WINDOW_ACTOR (actor);
+       actor = clutter_actor_get_parent (actor))
+    {
+      if (is_overlapped_by_siblings (actor, &rect))
+        return FALSE;
+    }
+
+  for (l = meta_renderer_get_views (renderer); l; l = l->next)
+    {
+      ClutterStageView *stage_view = l->data;
+      cairo_rectangle_int_t layout;
+
+      clutter_stage_view_get_layout (stage_view, &layout);
+      if (meta_rectangle_contains_rect (&layout, &rect))
+        {
+          *out_buffer = buffer;
+          *out_view = META_RENDERER_VIEW (stage_view);
+          *out_rect = rect;
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static void
+update_overlay_assignment (MetaSurfaceActorWayland *self,
+                           gboolean                 allowed)
+{
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  MetaWaylandBuffer *buffer = NULL;
+  MetaRendererView *view = NULL;
+  MetaRectangle rect;
+  gboolean can_use_overlay;
+
+  can_use_overlay = (allowed &&
+                     get_overlay_placement (self, &buffer, &view, &rect));
+
+  if (priv->overlay &&
+      (!can_use_overlay ||
+       !meta_renderer_native_overlay_matches (priv->overlay, view, &rect)))
+    release_overlay (self);
+
+  if (!can_use_overlay || priv->overlay)
+    {
+      priv->overlay_failed = FALSE;
+      return;
+    }
+
+  /* Don't retry a rejected configuration every frame. */
+  if (priv->overlay_failed &&
+      meta_rectangle_equal (&priv->overlay_failed_rect, &rect))
+    return;
+
+  priv->overlay = meta_renderer_native_assign_overlay (META_RENDERER_NATIVE (renderer),
+                                                       view,
+                                                       buffer,
+                                                       &rect,
+                                                       on_overlay_presented,
+                                                       self);
+  if (priv->overlay)
+    {
+      priv->overlay_failed = FALSE;
+
+      /* Paint what is below without us */
+      clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+    }
+  else
+    {
+      priv->overlay_failed = TRUE;
+      priv->overlay_failed_rect = rect;
+    }
+}
+#endif
+
+/**
+ * meta_surface_actor_wayland_assign_overlays:
+ * @self: the main surface actor of a window
+ * @allowed: whether the window may use overlay planes at all
+ *
+ * Decides, for the next frame, which subsurfaces are shown on overlay planes
+ * instead of being composited. Called before painting each frame.
+ */
+void
+meta_surface_actor_wayland_assign_overlays (MetaSurfaceActorWayland *self,
+                                            gboolean                 allowed)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+  GList *l;
+
+  if (!META_IS_BACKEND_NATIVE (meta_get_backend ()))
+    return;
+
+  if (priv->surface && priv->surface->sub.parent)
+    update_overlay_assignment (self, allowed);
+
+  if (!priv->surface)
+    return;
+
+  for (l = priv->surface->subsurfaces; l; l = l->next)
+    {
+      MetaWaylandSurface *subsurface = l->data;
+
+      if (!subsurface->surface_actor)
+        continue;
+
+      meta_surface_actor_wayland_assign_overlays (
+        META_SURFACE_ACTOR_WAYLAND (subsurface->surface_actor), allowed);
+    }
+#endif
+}
+
+gboolean
+meta_surface_actor_wayland_is_on_overlay (MetaSurfaceActorWayland *self)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+
+  return priv->overlay != NULL;
+#else
+  return FALSE;
+#endif
+}
+
+/**
+ * meta_surface_actor_wayland_update_overlay:
+ * @self: a #MetaSurfaceActorWayland
+ *
+ * Hands a newly attached buffer over to the overlay plane the surface is
+ * shown on, if any. Falls back to compositing if the plane can't take it.
+ */
+void
+meta_surface_actor_wayland_update_overlay (MetaSurfaceActorWayland *self)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  MetaWaylandBuffer *buffer;
+
+  if (!priv->overlay || !priv->surface)
+    return;
+
+  buffer = meta_wayland_surface_get_buffer (priv->surface);
+
+  if (!buffer ||
+      meta_surface_actor_is_argb32 (META_SURFACE_ACTOR (self)) ||
+      !meta_renderer_native_update_overlay (META_RENDERER_NATIVE (renderer),
+                                            priv->overlay,
+                                            buffer))
+    release_overlay (self);
+#endif
+}
+
 static void
 meta_surface_actor_wayland_pre_paint (MetaSurfaceActor *actor)
 {
+#ifdef HAVE_NATIVE_BACKEND
+  MetaSurfaceActorWayland *self = META_SURFACE_ACTOR_WAYLAND (actor);
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  MetaWaylandBuffer *buffer;
+  MetaWindow *window;
+  MetaRendererView *view;
+
+  if (!priv->unredirected || !priv->surface)
+    return;
+
+  window = priv->surface->window;
+  buffer = meta_wayland_surface_get_buffer (priv->surface);
+  if (!window || !window->monitor || !buffer)
+    return;
+
+  view = get_view_for_logical_monitor (renderer, window->monitor);
+  if (!view)
+    return;
+
+  /* If this fails, the stage is painted as usual, and the surface's frame
+   * callbacks are dispatched when it is painted. */
+  if (meta_renderer_native_try_direct_scanout (META_RENDERER_NATIVE (renderer),
+                                               view, buffer))
+    queue_frame_callbacks (self);
+#endif
 }
 
 static gboolean
@@ -69,21 +471,99 @@ meta_surface_actor_wayland_is_visible (MetaSurfaceActor *actor)
 static gboolean
 meta_surface_actor_wayland_should_unredirect (MetaSurfaceActor *actor)
 {
+#ifdef HAVE_NATIVE_BACKEND
+  MetaSurfaceActorWayland *self = META_SURFACE_ACTOR_WAYLAND (actor);
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+  MetaBackend *backend = meta_get_backend ();
+  MetaCursorRenderer *cursor_renderer;
+  MetaWaylandBuffer *buffer;
+  MetaWindow *window;
+  MetaLogicalMonitor *logical_monitor;
+  float x, y, width, height;
+
+  if (!META_IS_BACKEND_NATIVE (backend))
+    return FALSE;
+
+  if (!priv->surface)
+    return FALSE;
+
+  window = priv->surface->window;
+  if (!window || !window->monitor)
+    return FALSE;
+
+  if (meta_window_requested_dont_bypass_compositor (window))
+    return FALSE;
+
+  if (window->opacity != 0xFF)
+    return FALSE;
+
+  if (!meta_window_is_monitor_sized (window))
+    return FALSE;
+
+  buffer = meta_wayland_surface_get_buffer (priv->surface);
+  if (!buffer || buffer->type != META_WAYLAND_BUFFER_TYPE_DMA_BUF)
+    return FALSE;
+
+  if (meta_surface_actor_is_argb32 (actor))
+    return FALSE;
+
+  /* Anything drawn on top of the buffer would be lost. */
+  if (priv->surface->subsurfaces)
+    return FALSE;
+
+  cursor_renderer = meta_backend_get_cursor_renderer (backend);
+  if (meta_cursor_renderer_is_overlay_visible (cursor_renderer))
+    return FALSE;
+
+  if (clutter_actor_get_paint_opacity (CLUTTER_ACTOR (self)) != 0xff)
+    return FALSE;
+
+  /* The buffer must cover the monitor exactly, unscaled */
+  logical_monitor = window->monitor;
+  clutter_actor_get_transformed_position (CLUTTER_ACTOR (self), &x, &y);
+  clutter_actor_get_transformed_size (CLUTTER_ACTOR (self), &width, &height);
+  if ((int) roundf (x) != logical_monitor->rect.x ||
+      (int) roundf (y) != logical_monitor->rect.y ||
+      (int) roundf (width) != logical_monitor->rect.width ||
+      (int) roundf (height) != logical_monitor->rect.height)
+    return FALSE;
+
+  return TRUE;
+#else
   return FALSE;
+#endif
 }
 
 static void
 meta_surface_actor_wayland_set_unredirected (MetaSurfaceActor *actor,
                                              gboolean          unredirected)
 {
-  /* Do nothing. In the future, we'll use KMS to set this
-   * up as a hardware overlay or something. */
+  MetaSurfaceActorWayland *self = META_SURFACE_ACTOR_WAYLAND (actor);
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+
+  if (priv->unredirected == unredirected)
+    return;
+
+  priv->unredirected = unredirected;
+
+  /* The buffer is handed to KMS for direct scanout in pre_paint(); make
+   * sure nothing assigned there outlives the unredirection. */
+#ifdef HAVE_NATIVE_BACKEND
+  if (!unredirected)
+    clear_direct_scanout (self);
+#endif
 }
 
 static gboolean
 meta_surface_actor_wayland_is_unredirected (MetaSurfaceActor *actor)
 {
-  return FALSE;
+  MetaSurfaceActorWayland *self = META_SURFACE_ACTOR_WAYLAND (actor);
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+
+  return priv->unredirected;
 }
 
 double
@@ -379,16 +859,17 @@ static void
 meta_surface_actor_wayland_paint (ClutterActor *actor)
 {
   MetaSurfaceActorWayland *self = META_SURFACE_ACTOR_WAYLAND (actor);
+
+#ifdef HAVE_NATIVE_BACKEND
   MetaSurfaceActorWaylandPrivate *priv =
     meta_surface_actor_wayland_get_instance_private (self);
 
-  if (priv->surface)
-    {
-      MetaWaylandCompositor *compositor = priv->surface->compositor;
+  /* Shown by an overlay plane, unless painted somewhere else */
+  if (priv->overlay && !clutter_actor_is_in_clone_paint (actor))
+    return;
+#endif
 
-      wl_list_insert_list (&compositor->frame_callbacks, &priv->frame_callback_list);
-      wl_list_init (&priv->frame_callback_list);
-    }
+  queue_frame_callbacks (self);
 
   CLUTTER_ACTOR_CLASS (meta_surface_actor_wayland_parent_class)->paint (actor);
 }
@@ -403,6 +884,17 @@ meta_surface_actor_wayland_dispose (GObject *object)
   MetaShapedTexture *stex =
     meta_surface_actor_get_texture (META_SURFACE_ACTOR (self));
 
+#ifdef HAVE_NATIVE_BACKEND
+  if (priv->unredirected)
+    {
+      clear_direct_scanout (self);
+      priv->unredirected = FALSE;
+    }
+
+  if (priv->overlay)
+    release_overlay (self);
+#endif
+
   meta_shaped_texture_set_texture (stex, NULL);
   if (priv->surface)
     {
@@ -79,6 +79,13 @@ gboolean meta_surface_actor_wayland_is_on_monitor (MetaSurfaceActorWayland *self
 void meta_surface_actor_wayland_add_frame_callbacks (MetaSurfaceActorWayland *self,
                                                      struct wl_list *frame_callbacks);
 
+void meta_surface_actor_wayland_assign_overlays (MetaSurfaceActorWayland *self,
+                                                 gboolean                 allowed);
+
+gboolean meta_surface_actor_wayland_is_on_overlay (MetaSurfaceActorWayland *self);
+
+void meta_surface_actor_wayland_update_overlay (MetaSurfaceActorWayland *self);
+
 G_END_DECLS
 
 #endif /* __META_SURFACE_ACTOR_WAYLAND_H__ */
@@ -14,6 +14,7 @@
 #include "meta-surface-actor.h"
 
 #include <clutter/clutter.h>
+#include "clutter/clutter-mutter.h"
 #include <meta/meta-shaped-texture.h>
 #include "meta-cullable.h"
 #include "meta-shaped-texture-private.h"
@@ -44,8 +45,7 @@ enum {
 static guint signals[LAST_SIGNAL];
 
 static void
-meta_surface_actor_pick (ClutterActor       *actor,
-                         const ClutterColor *color)
+meta_surface_actor_pick (ClutterActor *actor)
 {
   MetaSurfaceActor *self = META_SURFACE_ACTOR (actor);
   MetaSurfaceActorPrivate *priv = self->priv;
@@ -57,42 +57,27 @@ meta_surface_actor_pick (ClutterActor       *actor,
 
   /* If there is no region then use the regular pick */
   if (priv->input_region == NULL)
-    CLUTTER_ACTOR_CLASS (meta_surface_actor_parent_class)->pick (actor, color);
+    CLUTTER_ACTOR_CLASS (meta_surface_actor_parent_class)->pick (actor);
   else
     {
       int n_rects;
-      float *rectangles;
       int i;
-      CoglPipeline *pipeline;
-      CoglContext *ctx;
-      CoglFramebuffer *fb;
-      CoglColor cogl_color;
 
       n_rects = cairo_region_num_rectangles (priv->input_region);
-      rectangles = g_alloca (sizeof (float) * 4 * n_rects);
 
       for (i = 0; i < n_rects; i++)
         {
           cairo_rectangle_int_t rect;
-          int pos = i * 4;
+          ClutterActorBox box;
 
           cairo_region_get_rectangle (priv->input_region, i, &rect);
 
-          rectangles[pos + 0] = rect.x;
-          rectangles[pos + 1] = rect.y;
-          rectangles[pos + 2] = rect.x + rect.width;
-          rectangles[pos + 3] = rect.y + rect.height;
+          box.x1 = rect.x;
+          box.y1 = rect.y;
+          box.x2 = rect.x + rect.width;
+          box.y2 = rect.y + rect.height;
+          clutter_actor_pick_box (actor, &box);
         }
-
-      ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
-      fb = cogl_get_draw_framebuffer ();
-
-      cogl_color_init_from_4ub (&cogl_color, color->red, color->green, color->blue, color->alpha);
-
-      pipeline = cogl_pipeline_new (ctx);
-      cogl_pipeline_set_color (pipeline, &cogl_color);
-      cogl_framebuffer_draw_rectangles (fb, pipeline, rectangles, n_rects);
-      cogl_object_unref (pipeline);
     }
 
   clutter_actor_iter_init (&iter, actor);
@@ -217,6 +202,7 @@ meta_surface_actor_set_input_region (MetaSurfaceActor *self,
                                      cairo_region_t   *region)
 {
   MetaSurfaceActorPrivate *priv = self->priv;
+  ClutterActor *stage;
 
   if (priv->input_region)
     cairo_region_destroy (priv->input_region);
@@ -225,6 +211,11 @@ meta_surface_actor_set_input_region (MetaSurfaceActor *self,
     priv->input_region = cairo_region_reference (region);
   else
     priv->input_region = NULL;
+
+  /* Picking uses the geometry logged during the last pick pass */
+  stage = clutter_actor_get_stage (CLUTTER_ACTOR (self));
+  if (stage)
+    clutter_stage_clear_pick_stack (CLUTTER_STAGE (stage));
 }
 
 void
@@ -23,6 +23,8 @@
 #include <math.h>
 #include <string.h>
 
+#include <meta/util.h>
+
 #include "meta-texture-tower.h"
 #include "meta-texture-rectangle.h"
 
@@ -59,10 +61,58 @@ struct _MetaTextureTower
   int n_levels;
   CoglTexture *textures[MAX_TEXTURE_LEVELS];
   CoglOffscreen *fbos[MAX_TEXTURE_LEVELS];
+  CoglPipeline *pipelines[MAX_TEXTURE_LEVELS];
   Box invalid[MAX_TEXTURE_LEVELS];
   CoglPipeline *pipeline_template;
+
+  /* When the driver can mipmap NPOT textures, we keep a single copy of
+   * the base texture and let the GPU generate its mipmaps, instead of
+   * scaling down into textures[1] and up ourselves. */
+  gboolean use_mipmap_texture;
+  CoglTexture *mipmap_texture;
+  CoglOffscreen *mipmap_fbo;
+  CoglPipeline *mipmap_pipeline;
+  Box mipmap_invalid;
+
+  MetaTextureTowerStats stats;
 };
 
+static inline gboolean
+box_is_empty (const Box *box)
+{
+  return box->x1 == box->x2 || box->y1 == box->y2;
+}
+
+static inline void
+box_clear (Box *box)
+{
+  box->x1 = box->x2 = 0;
+  box->y1 = box->y2 = 0;
+}
+
+static void
+box_union (Box       *box,
+           const Box *other)
+{
+  if (box_is_empty (box))
+    {
+      *box = *other;
+    }
+  else
+    {
+      box->x1 = MIN (box->x1, other->x1);
+      box->y1 = MIN (box->y1, other->y1);
+      box->x2 = MAX (box->x2, other->x2);
+      box->y2 = MAX (box->y2, other->y2);
+    }
+}
+
+static CoglContext *
+get_cogl_context (void)
+{
+  return clutter_backend_get_cogl_context (clutter_get_default_backend ());
+}
+
 /**
  * meta_texture_tower_new:
  *
@@ -92,11 +142,11 @@ meta_texture_tower_free (MetaTextureTower *tower)
 {
   g_return_if_fail (tower != NULL);
 
+  meta_texture_tower_set_base_texture (tower, NULL);
+
   if (tower->pipeline_template != NULL)
     cogl_object_unref (tower->pipeline_template);
 
-  meta_texture_tower_set_base_texture (tower, NULL);
-
   g_slice_free (MetaTextureTower, tower);
 }
 
@@ -125,19 +175,17 @@ meta_texture_tower_set_base_texture (MetaTextureTower *tower,
     {
       for (i = 1; i < tower->n_levels; i++)
         {
-          if (tower->textures[i] != NULL)
-            {
-              cogl_object_unref (tower->textures[i]);
-              tower->textures[i] = NULL;
-            }
-
-          if (tower->fbos[i] != NULL)
-            {
-              cogl_object_unref (tower->fbos[i]);
-              tower->fbos[i] = NULL;
-            }
+          g_clear_pointer (&tower->textures[i], cogl_object_unref);
+          g_clear_pointer (&tower->fbos[i], cogl_object_unref);
+          g_clear_pointer (&tower->pipelines[i], cogl_object_unref);
+          box_clear (&tower->invalid[i]);
         }
 
+      g_clear_pointer (&tower->mipmap_texture, cogl_object_unref);
+      g_clear_pointer (&tower->mipmap_fbo, cogl_object_unref);
+      g_clear_pointer (&tower->mipmap_pipeline, cogl_object_unref);
+      box_clear (&tower->mipmap_invalid);
+
       cogl_object_unref (tower->textures[0]);
     }
 
@@ -155,6 +203,11 @@ meta_texture_tower_set_base_texture (MetaTextureTower *tower,
       tower->n_levels = 1 + MAX ((int)(M_LOG2E * log (width)), (int)(M_LOG2E * log (height)));
       tower->n_levels = MIN(tower->n_levels, MAX_TEXTURE_LEVELS);
 
+      tower->use_mipmap_texture =
+        cogl_has_feature (get_cogl_context (), COGL_FEATURE_ID_TEXTURE_NPOT_MIPMAP) &&
+        cogl_has_feature (get_cogl_context (), COGL_FEATURE_ID_OFFSCREEN) &&
+        !meta_texture_rectangle_check (tower->textures[0]);
+
       meta_texture_tower_update_area (tower, 0, 0, width, height);
     }
   else
@@ -194,10 +247,17 @@ meta_texture_tower_update_area (MetaTextureTower *tower,
   texture_width = cogl_texture_get_width (tower->textures[0]);
   texture_height = cogl_texture_get_height (tower->textures[0]);
 
-  invalid.x1 = x;
-  invalid.y1 = y;
-  invalid.x2 = x + width;
-  invalid.y2 = y + height;
+  if (x >= texture_width || y >= texture_height ||
+      x + width <= 0 || y + height <= 0 ||
+      width <= 0 || height <= 0)
+    return;
+
+  invalid.x1 = MAX (x, 0);
+  invalid.y1 = MAX (y, 0);
+  invalid.x2 = MIN (texture_width, x + width);
+  invalid.y2 = MIN (texture_height, y + height);
+
+  box_union (&tower->mipmap_invalid, &invalid);
 
   for (i = 1; i < tower->n_levels; i++)
     {
@@ -209,18 +269,7 @@ meta_texture_tower_update_area (MetaTextureTower *tower,
       invalid.x2 = MIN (texture_width, (invalid.x2 + 1) / 2);
       invalid.y2 = MIN (texture_height, (invalid.y2 + 1) / 2);
 
-      if (tower->invalid[i].x1 == tower->invalid[i].x2 ||
-          tower->invalid[i].y1 == tower->invalid[i].y2)
-        {
-          tower->invalid[i] = invalid;
-        }
-      else
-        {
-          tower->invalid[i].x1 = MIN (tower->invalid[i].x1, invalid.x1);
-          tower->invalid[i].y1 = MIN (tower->invalid[i].y1, invalid.y1);
-          tower->invalid[i].x2 = MAX (tower->invalid[i].x2, invalid.x2);
-          tower->invalid[i].y2 = MAX (tower->invalid[i].y2, invalid.y2);
-        }
+      box_union (&tower->invalid[i], &invalid);
     }
 }
 
@@ -350,6 +399,24 @@ is_power_of_two (int x)
   return (x & (x - 1)) == 0;
 }
 
+static CoglPipeline *
+texture_tower_create_pipeline (MetaTextureTower *tower,
+                               CoglTexture      *source_texture)
+{
+  CoglPipeline *pipeline;
+
+  if (!tower->pipeline_template)
+    {
+      tower->pipeline_template = cogl_pipeline_new (get_cogl_context ());
+      cogl_pipeline_set_blend (tower->pipeline_template, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+    }
+
+  pipeline = cogl_pipeline_copy (tower->pipeline_template);
+  cogl_pipeline_set_layer_texture (pipeline, 0, source_texture);
+
+  return pipeline;
+}
+
 static void
 texture_tower_create_texture (MetaTextureTower *tower,
                               int               level,
@@ -359,11 +426,9 @@ texture_tower_create_texture (MetaTextureTower *tower,
   if ((!is_power_of_two (width) || !is_power_of_two (height)) &&
       meta_texture_rectangle_check (tower->textures[level - 1]))
     {
-      ClutterBackend *backend = clutter_get_default_backend ();
-      CoglContext *context = clutter_backend_get_cogl_context (backend);
       CoglTextureRectangle *texture_rectangle;
 
-      texture_rectangle = cogl_texture_rectangle_new_with_size (context, width, height);
+      texture_rectangle = cogl_texture_rectangle_new_with_size (get_cogl_context (), width, height);
       tower->textures[level] = COGL_TEXTURE (texture_rectangle);
     }
   else
@@ -373,6 +438,11 @@ texture_tower_create_texture (MetaTextureTower *tower,
                                                            TEXTURE_FORMAT);
     }
 
+  /* The source of a level never changes while the level exists, so the
+   * pipeline drawing it can be kept around rather than copied each time
+   * the level is revalidated. */
+  tower->pipelines[level] = texture_tower_create_pipeline (tower, tower->textures[level - 1]);
+
   tower->invalid[level].x1 = 0;
   tower->invalid[level].y1 = 0;
   tower->invalid[level].x2 = width;
@@ -392,44 +462,118 @@ texture_tower_revalidate (MetaTextureTower *tower,
   Box *invalid = &tower->invalid[level];
   CoglFramebuffer *fb;
   CoglError *catch_error = NULL;
-  CoglPipeline *pipeline;
 
   if (tower->fbos[level] == NULL)
-    tower->fbos[level] = cogl_offscreen_new_with_texture (dest_texture);
+    {
+      tower->fbos[level] = cogl_offscreen_new_with_texture (dest_texture);
+
+      fb = COGL_FRAMEBUFFER (tower->fbos[level]);
+
+      if (!cogl_framebuffer_allocate (fb, &catch_error))
+        {
+          cogl_error_free (catch_error);
+          g_clear_pointer (&tower->fbos[level], cogl_object_unref);
+          return;
+        }
+
+      cogl_framebuffer_orthographic (fb, 0, 0, dest_texture_width, dest_texture_height, -1., 1.);
+    }
 
   fb = COGL_FRAMEBUFFER (tower->fbos[level]);
 
+  cogl_framebuffer_draw_textured_rectangle (fb, tower->pipelines[level],
+                                            invalid->x1, invalid->y1,
+                                            invalid->x2, invalid->y2,
+                                            (2. * invalid->x1) / source_texture_width,
+                                            (2. * invalid->y1) / source_texture_height,
+                                            (2. * invalid->x2) / source_texture_width,
+                                            (2. * invalid->y2) / source_texture_height);
+
+  tower->stats.levels_rebuilt++;
+  tower->stats.pixels_touched += (invalid->x2 - invalid->x1) * (invalid->y2 - invalid->y1);
+
+  box_clear (invalid);
+}
+
+static gboolean
+texture_tower_create_mipmap_texture (MetaTextureTower *tower)
+{
+  CoglTexture *base_texture = tower->textures[0];
+  int width = cogl_texture_get_width (base_texture);
+  int height = cogl_texture_get_height (base_texture);
+  CoglFramebuffer *fb;
+  CoglError *catch_error = NULL;
+
+  /* Mipmaps are generated automatically when the texture is painted with
+   * a mipmap filter after it has been rendered to. */
+  tower->mipmap_texture =
+    COGL_TEXTURE (cogl_texture_2d_new_with_size (get_cogl_context (), width, height));
+  tower->mipmap_fbo = cogl_offscreen_new_with_texture (tower->mipmap_texture);
+
+  fb = COGL_FRAMEBUFFER (tower->mipmap_fbo);
+
   if (!cogl_framebuffer_allocate (fb, &catch_error))
     {
+      meta_verbose ("Failed to allocate mipmapped window texture: %s\n",
+                    catch_error->message);
       cogl_error_free (catch_error);
-      return;
+      g_clear_pointer (&tower->mipmap_fbo, cogl_object_unref);
+      g_clear_pointer (&tower->mipmap_texture, cogl_object_unref);
+      return FALSE;
     }
 
-  cogl_framebuffer_orthographic (fb, 0, 0, dest_texture_width, dest_texture_height, -1., 1.);
+  cogl_framebuffer_orthographic (fb, 0, 0, width, height, -1., 1.);
 
-  if (!tower->pipeline_template)
-    {
-      CoglContext *ctx =
-        clutter_backend_get_cogl_context (clutter_get_default_backend ());
-      tower->pipeline_template = cogl_pipeline_new (ctx);
-      cogl_pipeline_set_blend (tower->pipeline_template, "RGBA = ADD (SRC_COLOR, 0)", NULL);
-    }
+  tower->mipmap_pipeline = texture_tower_create_pipeline (tower, base_texture);
+  cogl_pipeline_set_layer_filters (tower->mipmap_pipeline, 0,
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
 
-  pipeline = cogl_pipeline_copy (tower->pipeline_template);
-  cogl_pipeline_set_layer_texture (pipeline, 0, tower->textures[level - 1]);
+  tower->mipmap_invalid.x1 = 0;
+  tower->mipmap_invalid.y1 = 0;
+  tower->mipmap_invalid.x2 = width;
+  tower->mipmap_invalid.y2 = height;
+
+  return TRUE;
+}
 
-  cogl_framebuffer_draw_textured_rectangle (fb, pipeline,
+static gboolean
+texture_tower_revalidate_mipmap_texture (MetaTextureTower *tower)
+{
+  CoglTexture *base_texture = tower->textures[0];
+  int width = cogl_texture_get_width (base_texture);
+  int height = cogl_texture_get_height (base_texture);
+  Box *invalid = &tower->mipmap_invalid;
+  CoglFramebuffer *fb;
+
+  if (tower->mipmap_texture == NULL &&
+      !texture_tower_create_mipmap_texture (tower))
+    return FALSE;
+
+  if (box_is_empty (invalid))
+    return TRUE;
+
+  fb = COGL_FRAMEBUFFER (tower->mipmap_fbo);
+
+  cogl_framebuffer_draw_textured_rectangle (fb, tower->mipmap_pipeline,
                                             invalid->x1, invalid->y1,
                                             invalid->x2, invalid->y2,
-                                            (2. * invalid->x1) / source_texture_width,
-                                            (2. * invalid->y1) / source_texture_height,
-                                            (2. * invalid->x2) / source_texture_width,
-                                            (2. * invalid->y2) / source_texture_height);
+                                            (float) invalid->x1 / width,
+                                            (float) invalid->y1 / height,
+                                            (float) invalid->x2 / width,
+                                            (float) invalid->y2 / height);
+
+  /* The mipmaps are generated as soon as the texture is used for
+   * painting, which happens before the journal of the texture's
+   * framebuffer would otherwise be flushed. */
+  cogl_framebuffer_flush (fb);
 
-  cogl_object_unref (pipeline);
+  tower->stats.mipmap_updates++;
+  tower->stats.pixels_touched += (invalid->x2 - invalid->x1) * (invalid->y2 - invalid->y1);
 
-  tower->invalid[level].x1 = tower->invalid[level].x2 = 0;
-  tower->invalid[level].y1 = tower->invalid[level].y2 = 0;
+  box_clear (invalid);
+
+  return TRUE;
 }
 
 /**
@@ -464,9 +608,19 @@ meta_texture_tower_get_paint_texture (MetaTextureTower *tower)
     return NULL;
   level = MIN (level, tower->n_levels - 1);
 
-  if (tower->textures[level] == NULL ||
-      (tower->invalid[level].x2 != tower->invalid[level].x1 &&
-       tower->invalid[level].y2 != tower->invalid[level].y1))
+  if (level == 0)
+    return tower->textures[0];
+
+  if (tower->use_mipmap_texture)
+    {
+      if (texture_tower_revalidate_mipmap_texture (tower))
+        return tower->mipmap_texture;
+
+      /* Fall back to scaling down the levels ourselves */
+      tower->use_mipmap_texture = FALSE;
+    }
+
+  if (tower->textures[level] == NULL || !box_is_empty (&tower->invalid[level]))
     {
       int i;
 
@@ -480,13 +634,68 @@ meta_texture_tower_get_paint_texture (MetaTextureTower *tower)
            texture_tower_create_texture (tower, i, texture_width, texture_height);
        }
 
+      /* Bring all the levels we need up to date in one go; each one is
+       * drawn from the one above it, so the draws are queued in order
+       * and submitted together. */
       for (i = 1; i <= level; i++)
        {
-         if (tower->invalid[level].x2 != tower->invalid[level].x1 &&
-             tower->invalid[level].y2 != tower->invalid[level].y1)
+         if (!box_is_empty (&tower->invalid[i]))
            texture_tower_revalidate (tower, i);
        }
    }
 
   return tower->textures[level];
 }
+
+/**
+ * meta_texture_tower_is_mipmapped:
+ * @tower: a #MetaTextureTower
+ * @texture: a texture returned by meta_texture_tower_get_paint_texture()
+ *
+ * Checks whether @texture has GPU generated mipmaps, in which case it
+ * should be painted with a mipmap minification filter instead of being
+ * used as a single scaled down level.
+ *
+ * Return value: %TRUE if @texture is mipmapped
+ */
+gboolean
+meta_texture_tower_is_mipmapped (MetaTextureTower *tower,
+                                 CoglTexture      *texture)
+{
+  g_return_val_if_fail (tower != NULL, FALSE);
+
+  return texture != NULL && texture == tower->mipmap_texture;
+}
+
+/**
+ * meta_texture_tower_get_stats:
+ * @tower: a #MetaTextureTower
+ * @stats: (out): return location for the statistics
+ *
+ * Retrieves how much work the tower did keeping its scaled down
+ * textures up to date since it was created or the statistics were
+ * last reset with meta_texture_tower_reset_stats().
+ */
+void
+meta_texture_tower_get_stats (MetaTextureTower      *tower,
+                              MetaTextureTowerStats *stats)
+{
+  g_return_if_fail (tower != NULL);
+  g_return_if_fail (stats != NULL);
+
+  *stats = tower->stats;
+}
+
+/**
+ * meta_texture_tower_reset_stats:
+ * @tower: a #MetaTextureTower
+ *
+ * Resets the statistics returned by meta_texture_tower_get_stats().
+ */
+void
+meta_texture_tower_reset_stats (MetaTextureTower *tower)
+{
+  g_return_if_fail (tower != NULL);
+
+  memset (&tower->stats, 0, sizeof (tower->stats));
+}
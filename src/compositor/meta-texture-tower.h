@@ -47,10 +47,27 @@ G_BEGIN_DECLS
  * that best matches the scale we are rendering at. (Since we aren't
  * typically using perspective transforms, we'll frequently have a single
  * scale for the entire texture.)
+ *
+ * When the driver does support mipmapping NPOT textures, the tower
+ * instead keeps a single copy of the base texture up to date and lets
+ * the GPU generate its mipmaps; see meta_texture_tower_is_mipmapped().
  */
 
 typedef struct _MetaTextureTower MetaTextureTower;
 
+/**
+ * MetaTextureTowerStats:
+ * @levels_rebuilt: number of times a scaled down level was redrawn
+ * @mipmap_updates: number of times the mipmapped copy was updated
+ * @pixels_touched: number of pixels drawn doing either
+ */
+typedef struct _MetaTextureTowerStats
+{
+  guint levels_rebuilt;
+  guint mipmap_updates;
+  guint64 pixels_touched;
+} MetaTextureTowerStats;
+
 MetaTextureTower *meta_texture_tower_new               (void);
 void              meta_texture_tower_free              (MetaTextureTower *tower);
 void              meta_texture_tower_set_base_texture  (MetaTextureTower *tower,
@@ -61,6 +78,12 @@ void              meta_texture_tower_update_area       (MetaTextureTower *tower,
                                                         int               width,
                                                         int               height);
 CoglTexture      *meta_texture_tower_get_paint_texture (MetaTextureTower *tower);
+gboolean          meta_texture_tower_is_mipmapped      (MetaTextureTower *tower,
+                                                        CoglTexture      *texture);
+
+void              meta_texture_tower_get_stats         (MetaTextureTower      *tower,
+                                                        MetaTextureTowerStats *stats);
+void              meta_texture_tower_reset_stats       (MetaTextureTower      *tower);
 
 G_END_DECLS
 
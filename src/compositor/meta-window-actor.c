@@ -71,6 +71,8 @@ struct _MetaWindowActorPrivate
 
   /* A region that matches the shape of the window, including frame bounds */
   cairo_region_t   *shape_region;
+  /* The part of the frame that the theme paints fully opaque */
+  cairo_region_t   *frame_opaque_region;
   /* The region we should clip to when painting the shadow */
   cairo_region_t   *shadow_clip;
 
@@ -481,6 +483,7 @@ meta_window_actor_dispose (GObject *object)
     }
 
   g_clear_pointer (&priv->shape_region, cairo_region_destroy);
+  g_clear_pointer (&priv->frame_opaque_region, cairo_region_destroy);
   g_clear_pointer (&priv->shadow_clip, cairo_region_destroy);
 
   g_clear_pointer (&priv->shadow_class, g_free);
@@ -1647,41 +1650,73 @@ meta_window_actor_sync_visibility (MetaWindowActor *self)
     }
 }
 
-static cairo_region_t *
-scan_visible_region (guchar         *mask_data,
-                     int             stride,
-                     cairo_region_t *scan_area)
+/* Opaque regions of recently scanned frame masks; resizing a window back
+ * and forth, or windows of the same size and kind, produce the same frame
+ * mask over and over. Most recently used first. */
+typedef struct _FrameMaskScan
 {
-  int i, n_rects = cairo_region_num_rectangles (scan_area);
-  MetaRegionBuilder builder;
+  struct {
+    MetaFrameMaskKey frame;
+    int width;
+    int height;
+    cairo_rectangle_int_t client_area;
+  } key;
 
-  meta_region_builder_init (&builder);
+  cairo_region_t *opaque_region;
+} FrameMaskScan;
 
-  for (i = 0; i < n_rects; i++)
-    {
-      int x, y;
-      cairo_rectangle_int_t rect;
+#define MAX_FRAME_MASK_SCANS 8
+
+static GQueue frame_mask_scans = G_QUEUE_INIT;
+
+static void
+frame_mask_scan_free (FrameMaskScan *scan)
+{
+  cairo_region_destroy (scan->opaque_region);
+  g_slice_free (FrameMaskScan, scan);
+}
+
+static cairo_region_t *
+scan_frame_mask (MetaFrame             *frame,
+                 guchar                *mask_data,
+                 int                    stride,
+                 int                    width,
+                 int                    height,
+                 cairo_rectangle_int_t *client_area,
+                 cairo_region_t        *frame_paint_region)
+{
+  FrameMaskScan *scan;
+  GList *l;
+
+  scan = g_slice_new0 (FrameMaskScan);
+  meta_frame_get_mask_key (frame, &scan->key.frame);
+  scan->key.width = width;
+  scan->key.height = height;
+  scan->key.client_area = *client_area;
 
-      cairo_region_get_rectangle (scan_area, i, &rect);
+  for (l = frame_mask_scans.head; l; l = l->next)
+    {
+      FrameMaskScan *cached_scan = l->data;
 
-      for (y = rect.y; y < (rect.y + rect.height); y++)
+      if (memcmp (&cached_scan->key, &scan->key, sizeof (scan->key)) == 0)
         {
-          for (x = rect.x; x < (rect.x + rect.width); x++)
-            {
-              int x2 = x;
-              while (mask_data[y * stride + x2] == 255 && x2 < (rect.x + rect.width))
-                x2++;
-
-              if (x2 > x)
-                {
-                  meta_region_builder_add_rectangle (&builder, x, y, x2 - x, 1);
-                  x = x2;
-                }
-            }
+          g_slice_free (FrameMaskScan, scan);
+
+          g_queue_unlink (&frame_mask_scans, l);
+          g_queue_push_head_link (&frame_mask_scans, l);
+
+          return cairo_region_reference (cached_scan->opaque_region);
         }
     }
 
-  return meta_region_builder_finish (&builder);
+  scan->opaque_region = meta_make_opaque_region (mask_data, stride,
+                                                 frame_paint_region);
+
+  g_queue_push_head (&frame_mask_scans, scan);
+  if (frame_mask_scans.length > MAX_FRAME_MASK_SCANS)
+    frame_mask_scan_free (g_queue_pop_tail (&frame_mask_scans));
+
+  return cairo_region_reference (scan->opaque_region);
 }
 
 static void
@@ -1742,9 +1777,13 @@ build_and_scan_frame_mask (MetaWindowActor       *self,
       meta_frame_get_mask (priv->window->frame, cr);
 
       cairo_surface_flush (surface);
-      scanned_region = scan_visible_region (mask_data, stride, frame_paint_region);
+      scanned_region = scan_frame_mask (priv->window->frame,
+                                        mask_data, stride,
+                                        tex_width, tex_height,
+                                        client_area,
+                                        frame_paint_region);
       cairo_region_union (shape_region, scanned_region);
-      cairo_region_destroy (scanned_region);
+      priv->frame_opaque_region = scanned_region;
       cairo_region_destroy (frame_paint_region);
     }
 
@@ -1794,6 +1833,8 @@ meta_window_actor_update_shape_region (MetaWindowActor *self)
 
   meta_window_get_client_area_rect (priv->window, &client_area);
 
+  g_clear_pointer (&priv->frame_opaque_region, cairo_region_destroy);
+
   if (priv->window->frame != NULL && priv->window->shape_region != NULL)
     {
       region = cairo_region_copy (priv->window->shape_region);
@@ -1870,6 +1911,16 @@ meta_window_actor_update_opaque_region (MetaWindowActor *self)
        */
       opaque_region = cairo_region_copy (priv->window->opaque_region);
       cairo_region_translate (opaque_region, client_area.x, client_area.y);
+      if (priv->frame_opaque_region)
+        cairo_region_union (opaque_region, priv->frame_opaque_region);
+      cairo_region_intersect (opaque_region, priv->shape_region);
+    }
+  else if (argb32 && priv->frame_opaque_region != NULL)
+    {
+      /* Even if the client doesn't tell us what it paints opaquely,
+       * the frame around it is drawn by us, so windows and shadows
+       * beneath it can still be culled there. */
+      opaque_region = cairo_region_copy (priv->frame_opaque_region);
       cairo_region_intersect (opaque_region, priv->shape_region);
     }
   else if (argb32)
@@ -1926,7 +1977,15 @@ meta_window_actor_handle_updates (MetaWindowActor *self)
     }
 
   if (meta_surface_actor_is_unredirected (priv->surface))
-    return;
+    {
+#ifdef HAVE_WAYLAND
+      /* Unredirected Wayland surfaces hand their current buffer over for
+       * direct scanout every frame. */
+      if (META_IS_SURFACE_ACTOR_WAYLAND (priv->surface))
+        meta_surface_actor_pre_paint (priv->surface);
+#endif
+      return;
+    }
 
   meta_surface_actor_pre_paint (priv->surface);
 
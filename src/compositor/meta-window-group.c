@@ -93,8 +93,13 @@ meta_window_group_paint (ClutterActor *actor)
     }
   else
     {
-      paint_x_origin = 0;
-      paint_y_origin = 0;
+      /* Our children are culled in our coordinate space, see
+       * meta_cullable_cull_out_children() */
+      if (!meta_actor_is_untransformed (actor, &paint_x_origin, &paint_y_origin))
+        {
+          CLUTTER_ACTOR_CLASS (meta_window_group_parent_class)->paint (actor);
+          return;
+        }
     }
 
   visible_rect.x = visible_rect.y = 0;
@@ -21,6 +21,7 @@
 #include "region-utils.h"
 
 #include <math.h>
+#include <string.h>
 
 /* MetaRegionBuilder */
 
@@ -338,3 +339,270 @@ meta_make_border_region (cairo_region_t *region,
 
   return border_region;
 }
+
+/**
+ * meta_region_erode:
+ * @region: a #cairo_region_t
+ * @x_amount: distance to shrink the region by horizontally
+ * @y_amount: distance to shrink the region by vertically
+ *
+ * Computes the set of points of @region that are further than the
+ * given distances from its boundary; the opposite of growing the
+ * region as described for meta_make_border_region().
+ *
+ * Return value: a new region
+ */
+cairo_region_t *
+meta_region_erode (cairo_region_t *region,
+                   int             x_amount,
+                   int             y_amount)
+{
+  cairo_region_t *eroded_region;
+  cairo_region_t *inverse_region;
+
+  eroded_region = cairo_region_copy (region);
+
+  if ((x_amount == 0 && y_amount == 0) || cairo_region_is_empty (region))
+    return eroded_region;
+
+  inverse_region = expand_region_inverse (region, x_amount, y_amount, FALSE);
+  cairo_region_subtract (eroded_region, inverse_region);
+  cairo_region_destroy (inverse_region);
+
+  return eroded_region;
+}
+
+/**
+ * meta_region_transform:
+ * @region: a #cairo_region_t
+ * @x_scale: horizontal scale factor
+ * @y_scale: vertical scale factor
+ * @x_offset: horizontal offset, applied after scaling
+ * @y_offset: vertical offset, applied after scaling
+ * @rounding: how to round the transformed rectangles to the pixel grid
+ *
+ * Transforms @region by an axis-aligned scale and a translation that
+ * need not be integral. With %META_REGION_ROUND_OUT the result covers
+ * every pixel the transformed region touches, with
+ * %META_REGION_ROUND_IN it only contains pixels the transformed region
+ * covers completely.
+ *
+ * Return value: a new region
+ */
+cairo_region_t *
+meta_region_transform (cairo_region_t     *region,
+                       double              x_scale,
+                       double              y_scale,
+                       double              x_offset,
+                       double              y_offset,
+                       MetaRegionRounding  rounding)
+{
+  MetaRegionBuilder builder;
+  int n_rects, i;
+
+  meta_region_builder_init (&builder);
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      double x1, y1, x2, y2;
+      int ix1, iy1, ix2, iy2;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      x1 = rect.x * x_scale + x_offset;
+      x2 = (rect.x + rect.width) * x_scale + x_offset;
+      y1 = rect.y * y_scale + y_offset;
+      y2 = (rect.y + rect.height) * y_scale + y_offset;
+
+      if (rounding == META_REGION_ROUND_OUT)
+        {
+          ix1 = floor (MIN (x1, x2));
+          iy1 = floor (MIN (y1, y2));
+          ix2 = ceil (MAX (x1, x2));
+          iy2 = ceil (MAX (y1, y2));
+        }
+      else
+        {
+          ix1 = ceil (MIN (x1, x2));
+          iy1 = ceil (MIN (y1, y2));
+          ix2 = floor (MAX (x1, x2));
+          iy2 = floor (MAX (y1, y2));
+        }
+
+      if (ix2 > ix1 && iy2 > iy1)
+        meta_region_builder_add_rectangle (&builder,
+                                           ix1, iy1, ix2 - ix1, iy2 - iy1);
+    }
+
+  return meta_region_builder_finish (&builder);
+}
+
+/* The mask is scanned a 64 bit word at a time while looking for the
+ * start or the end of a run of opaque pixels; frame masks are mostly
+ * long runs of either. */
+#define OPAQUE_WORD G_GUINT64_CONSTANT (0xffffffffffffffff)
+#define ONES_WORD G_GUINT64_CONSTANT (0x0101010101010101)
+#define HIGH_BITS_WORD G_GUINT64_CONSTANT (0x8080808080808080)
+
+static inline guint64
+load_word (const guchar *data)
+{
+  guint64 word;
+
+  memcpy (&word, data, sizeof (word));
+
+  return word;
+}
+
+/* Whether any byte of @word is 0xff, i.e. any byte of ~@word is zero */
+static inline gboolean
+word_has_opaque_byte (guint64 word)
+{
+  guint64 inverted = ~word;
+
+  return ((inverted - ONES_WORD) & ~inverted & HIGH_BITS_WORD) != 0;
+}
+
+static inline int
+find_opaque (const guchar *row,
+             int           x,
+             int           end)
+{
+  while (x + (int) sizeof (guint64) <= end &&
+         !word_has_opaque_byte (load_word (row + x)))
+    x += sizeof (guint64);
+
+  while (x < end && row[x] != 255)
+    x++;
+
+  return x;
+}
+
+static inline int
+find_non_opaque (const guchar *row,
+                 int           x,
+                 int           end)
+{
+  while (x + (int) sizeof (guint64) <= end &&
+         load_word (row + x) == OPAQUE_WORD)
+    x += sizeof (guint64);
+
+  while (x < end && row[x] == 255)
+    x++;
+
+  return x;
+}
+
+/* Finds the runs of opaque pixels in row between x and end, storing the
+ * start and end of each in runs, and returns the number of runs */
+static int
+scan_row (const guchar *row,
+          int           x,
+          int           end,
+          int          *runs)
+{
+  int n_runs = 0;
+
+  while (TRUE)
+    {
+      x = find_opaque (row, x, end);
+      if (x == end)
+        break;
+
+      runs[2 * n_runs] = x;
+      x = find_non_opaque (row, x, end);
+      runs[2 * n_runs + 1] = x;
+      n_runs++;
+    }
+
+  return n_runs;
+}
+
+static void
+add_runs (MetaRegionBuilder *builder,
+          const int         *runs,
+          int                n_runs,
+          int                y,
+          int                height)
+{
+  int i;
+
+  for (i = 0; i < n_runs; i++)
+    meta_region_builder_add_rectangle (builder,
+                                       runs[2 * i], y,
+                                       runs[2 * i + 1] - runs[2 * i], height);
+}
+
+/**
+ * meta_make_opaque_region:
+ * @mask_data: an 8 bit alpha mask
+ * @stride: the stride of @mask_data
+ * @scan_area: the part of the mask to scan
+ *
+ * Computes the region of the pixels in @scan_area that are fully opaque
+ * in @mask_data.
+ *
+ * Rows with the same runs of opaque pixels as the row above them extend
+ * the rectangles of that row instead of adding new ones, so the cost of
+ * building the region mostly depends on the number of distinct rows.
+ *
+ * Returns: (transfer full): a new #cairo_region_t
+ */
+cairo_region_t *
+meta_make_opaque_region (const guchar   *mask_data,
+                         int             stride,
+                         cairo_region_t *scan_area)
+{
+  MetaRegionBuilder builder;
+  int i, n_rects = cairo_region_num_rectangles (scan_area);
+
+  meta_region_builder_init (&builder);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int *runs, *prev_runs, *tmp;
+      int n_runs, n_prev_runs = 0;
+      int prev_y;
+      int y;
+
+      cairo_region_get_rectangle (scan_area, i, &rect);
+      if (rect.width <= 0)
+        continue;
+
+      /* Runs are separated by at least one pixel, so a row has at most
+       * (width + 1) / 2 of them */
+      runs = g_new (int, rect.width + 1);
+      prev_runs = g_new (int, rect.width + 1);
+      prev_y = rect.y;
+
+      for (y = rect.y; y < rect.y + rect.height; y++)
+        {
+          n_runs = scan_row (mask_data + y * stride,
+                             rect.x, rect.x + rect.width,
+                             runs);
+
+          if (n_runs == n_prev_runs &&
+              memcmp (runs, prev_runs, 2 * n_runs * sizeof (int)) == 0)
+            continue;
+
+          add_runs (&builder, prev_runs, n_prev_runs, prev_y, y - prev_y);
+
+          n_prev_runs = n_runs;
+          prev_y = y;
+
+          tmp = prev_runs;
+          prev_runs = runs;
+          runs = tmp;
+        }
+
+      add_runs (&builder, prev_runs, n_prev_runs, prev_y, y - prev_y);
+
+      g_free (runs);
+      g_free (prev_runs);
+    }
+
+  return meta_region_builder_finish (&builder);
+}
@@ -61,6 +61,12 @@ struct _MetaRegionIterator {
   cairo_rectangle_int_t next_rectangle;
 };
 
+typedef enum
+{
+  META_REGION_ROUND_IN,
+  META_REGION_ROUND_OUT,
+} MetaRegionRounding;
+
 typedef struct _MetaRegionBuilder MetaRegionBuilder;
 
 #define META_REGION_BUILDER_MAX_LEVELS 16
@@ -99,4 +105,19 @@ cairo_region_t *meta_make_border_region (cairo_region_t *region,
                                          int             y_amount,
                                          gboolean        flip);
 
+cairo_region_t *meta_region_erode (cairo_region_t *region,
+                                   int             x_amount,
+                                   int             y_amount);
+
+cairo_region_t *meta_region_transform (cairo_region_t     *region,
+                                       double              x_scale,
+                                       double              y_scale,
+                                       double              x_offset,
+                                       double              y_offset,
+                                       MetaRegionRounding  rounding);
+
+cairo_region_t *meta_make_opaque_region (const guchar   *mask_data,
+                                         int             stride,
+                                         cairo_region_t *scan_area);
+
 #endif /* __META_REGION_UTILS_H__ */
@@ -359,6 +359,13 @@ meta_frame_get_mask (MetaFrame                    *frame,
   meta_ui_frame_get_mask (frame->ui_frame, cr);
 }
 
+void
+meta_frame_get_mask_key (MetaFrame        *frame,
+                         MetaFrameMaskKey *key)
+{
+  meta_ui_frame_get_mask_key (frame->ui_frame, key);
+}
+
 void
 meta_frame_queue_draw (MetaFrame *frame)
 {
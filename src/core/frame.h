@@ -77,6 +77,9 @@ cairo_region_t *meta_frame_get_frame_bounds (MetaFrame *frame);
 void meta_frame_get_mask (MetaFrame *frame,
                           cairo_t   *cr);
 
+void meta_frame_get_mask_key (MetaFrame        *frame,
+                              MetaFrameMaskKey *key);
+
 void meta_frame_set_screen_cursor (MetaFrame	*frame,
 				   MetaCursor	cursor);
 
@@ -35,6 +35,7 @@ struct _MetaMonitorManagerTest
 
   gboolean is_lid_closed;
   gboolean handles_transforms;
+  int max_active_crtcs;
 
   int tiled_monitor_count;
 
@@ -97,6 +98,17 @@ meta_monitor_manager_test_set_handles_transforms (MetaMonitorManagerTest *manage
   manager_test->handles_transforms = handles_transforms;
 }
 
+/*
+ * Emulates hardware that can only drive a limited number of CRTCs at once;
+ * 0 means no limit.
+ */
+void
+meta_monitor_manager_test_set_max_active_crtcs (MetaMonitorManagerTest *manager_test,
+                                                int                     max_active_crtcs)
+{
+  manager_test->max_active_crtcs = max_active_crtcs;
+}
+
 int
 meta_monitor_manager_test_get_tiled_monitor_count (MetaMonitorManagerTest *manager_test)
 {
@@ -289,6 +301,35 @@ update_screen_size (MetaMonitorManager *manager,
   manager->screen_height = screen_height;
 }
 
+static gboolean
+meta_monitor_manager_test_verify_crtc_assignments (MetaMonitorManager *manager,
+                                                   MetaCrtcInfo      **crtcs,
+                                                   unsigned int        n_crtcs,
+                                                   GError            **error)
+{
+  MetaMonitorManagerTest *manager_test = META_MONITOR_MANAGER_TEST (manager);
+  int n_active_crtcs = 0;
+  unsigned int i;
+
+  if (!manager_test->max_active_crtcs)
+    return TRUE;
+
+  for (i = 0; i < n_crtcs; i++)
+    {
+      if (crtcs[i]->mode)
+        n_active_crtcs++;
+    }
+
+  if (n_active_crtcs > manager_test->max_active_crtcs)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Can't drive %d CRTCs at once", n_active_crtcs);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
 static gboolean
 meta_monitor_manager_test_apply_monitors_config (MetaMonitorManager      *manager,
                                                  MetaMonitorsConfig      *config,
@@ -317,6 +358,16 @@ meta_monitor_manager_test_apply_monitors_config (MetaMonitorManager      *manage
                                            error))
     return FALSE;
 
+  if (!meta_monitor_manager_verify_crtc_assignments (manager,
+                                                     (MetaCrtcInfo **) crtc_infos->pdata,
+                                                     crtc_infos->len,
+                                                     error))
+    {
+      g_ptr_array_free (crtc_infos, TRUE);
+      g_ptr_array_free (output_infos, TRUE);
+      return FALSE;
+    }
+
   if (method == META_MONITORS_CONFIG_METHOD_VERIFY)
     {
       g_ptr_array_free (crtc_infos, TRUE);
@@ -463,6 +514,14 @@ meta_monitor_manager_test_get_default_layout_mode (MetaMonitorManager *manager)
     return META_LOGICAL_MONITOR_LAYOUT_MODE_PHYSICAL;
 }
 
+static void
+meta_monitor_manager_test_set_vrr_enabled (MetaMonitorManager *manager,
+                                           MetaMonitor        *monitor,
+                                           gboolean            enabled)
+{
+  /* There is no hardware to reconfigure; the monitor keeps the state */
+}
+
 static void
 meta_monitor_manager_test_dispose (GObject *object)
 {
@@ -499,6 +558,7 @@ meta_monitor_manager_test_class_init (MetaMonitorManagerTestClass *klass)
   manager_class->is_lid_closed = meta_monitor_manager_test_is_lid_closed;
   manager_class->ensure_initial_config = meta_monitor_manager_test_ensure_initial_config;
   manager_class->apply_monitors_config = meta_monitor_manager_test_apply_monitors_config;
+  manager_class->verify_crtc_assignments = meta_monitor_manager_test_verify_crtc_assignments;
   manager_class->tiled_monitor_added = meta_monitor_manager_test_tiled_monitor_added;
   manager_class->tiled_monitor_removed = meta_monitor_manager_test_tiled_monitor_removed;
   manager_class->is_transform_handled = meta_monitor_manager_test_is_transform_handled;
@@ -506,6 +566,7 @@ meta_monitor_manager_test_class_init (MetaMonitorManagerTestClass *klass)
   manager_class->calculate_supported_scales = meta_monitor_manager_test_calculate_supported_scales;
   manager_class->get_capabilities = meta_monitor_manager_test_get_capabilities;
   manager_class->get_max_screen_size = meta_monitor_manager_test_get_max_screen_size;
+  manager_class->set_vrr_enabled = meta_monitor_manager_test_set_vrr_enabled;
   manager_class->get_default_layout_mode = meta_monitor_manager_test_get_default_layout_mode;
 }
 
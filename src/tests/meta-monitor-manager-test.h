@@ -55,6 +55,9 @@ void meta_monitor_manager_test_set_is_lid_closed (MetaMonitorManagerTest *manage
 void meta_monitor_manager_test_set_handles_transforms (MetaMonitorManagerTest *manager_test,
                                                        gboolean                handles_transforms);
 
+void meta_monitor_manager_test_set_max_active_crtcs (MetaMonitorManagerTest *manager_test,
+                                                    int                     max_active_crtcs);
+
 int meta_monitor_manager_test_get_tiled_monitor_count (MetaMonitorManagerTest *manager_test);
 
 #endif /* META_MONITOR_MANAGER_TEST_H */
@@ -25,6 +25,7 @@
 #include "backends/meta-crtc.h"
 #include "backends/meta-logical-monitor.h"
 #include "backends/meta-monitor.h"
+#include "backends/meta-monitor-config-manager.h"
 #include "backends/meta-monitor-config-migration.h"
 #include "backends/meta-monitor-config-store.h"
 #include "backends/meta-output.h"
@@ -111,6 +112,7 @@ typedef struct _MonitorTestCaseOutput
   float scale;
   gboolean is_laptop_panel;
   gboolean is_underscanning;
+  gboolean is_vrr_capable;
   const char *serial;
   MetaMonitorTransform panel_orientation_transform;
 } MonitorTestCaseOutput;
@@ -1010,6 +1012,7 @@ create_monitor_test_setup (MonitorTestCase *test_case,
                                          : META_CONNECTOR_TYPE_DisplayPort);
       output->tile_info = test_case->setup.outputs[i].tile_info;
       output->is_underscanning = test_case->setup.outputs[i].is_underscanning;
+      output->is_vrr_capable = test_case->setup.outputs[i].is_vrr_capable;
       output->panel_orientation_transform =
         test_case->setup.outputs[i].panel_orientation_transform;
       output->driver_private = output_test;
@@ -3126,6 +3129,125 @@ meta_test_monitor_non_upright_panel (void)
   check_monitor_configuration (&test_case);
 }
 
+static void
+meta_test_monitor_vrr_policy (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
+  MonitorTestCase test_case = initial_test_case;
+  MetaMonitorTestSetup *test_setup;
+  GList *monitors;
+  MetaMonitor *vrr_monitor;
+  MetaMonitor *fixed_monitor;
+  MetaLogicalMonitor *vrr_logical_monitor;
+  MetaLogicalMonitor *fixed_logical_monitor;
+
+  test_case.setup.outputs[0].is_vrr_capable = TRUE;
+
+  test_setup = create_monitor_test_setup (&test_case,
+                                          MONITOR_TEST_FLAG_NO_STORED);
+  emulate_hotplug (test_setup);
+  check_monitor_configuration (&test_case);
+
+  monitors = meta_monitor_manager_get_monitors (monitor_manager);
+  g_assert_cmpint (g_list_length (monitors), ==, 2);
+  vrr_monitor = g_list_nth_data (monitors, 0);
+  fixed_monitor = g_list_nth_data (monitors, 1);
+  if (!meta_monitor_is_vrr_capable (vrr_monitor))
+    {
+      vrr_monitor = g_list_nth_data (monitors, 1);
+      fixed_monitor = g_list_nth_data (monitors, 0);
+    }
+  vrr_logical_monitor = meta_monitor_get_logical_monitor (vrr_monitor);
+  fixed_logical_monitor = meta_monitor_get_logical_monitor (fixed_monitor);
+
+  g_assert (meta_monitor_is_vrr_capable (vrr_monitor));
+  g_assert (!meta_monitor_is_vrr_capable (fixed_monitor));
+  g_assert (vrr_logical_monitor != fixed_logical_monitor);
+
+  /* Nothing fullscreen */
+  meta_monitor_manager_update_vrr (monitor_manager, NULL);
+  g_assert (!meta_monitor_is_vrr_enabled (vrr_monitor));
+  g_assert (!meta_monitor_is_vrr_enabled (fixed_monitor));
+
+  /* Fullscreen on the capable monitor */
+  meta_monitor_manager_update_vrr (monitor_manager, vrr_logical_monitor);
+  g_assert (meta_monitor_is_vrr_enabled (vrr_monitor));
+  g_assert (!meta_monitor_is_vrr_enabled (fixed_monitor));
+
+  /* Fullscreen moved to the monitor that can't do it */
+  meta_monitor_manager_update_vrr (monitor_manager, fixed_logical_monitor);
+  g_assert (!meta_monitor_is_vrr_enabled (vrr_monitor));
+  g_assert (!meta_monitor_is_vrr_enabled (fixed_monitor));
+
+  /* Fullscreen window unfocused */
+  meta_monitor_manager_update_vrr (monitor_manager, vrr_logical_monitor);
+  meta_monitor_manager_update_vrr (monitor_manager, NULL);
+  g_assert (!meta_monitor_is_vrr_enabled (vrr_monitor));
+}
+
+static void
+meta_test_monitor_rejected_crtc_assignment (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
+  MetaMonitorManagerTest *monitor_manager_test =
+    META_MONITOR_MANAGER_TEST (monitor_manager);
+  MetaMonitorManagerClass *manager_class =
+    META_MONITOR_MANAGER_GET_CLASS (monitor_manager);
+  MetaMonitorConfigManager *config_manager = monitor_manager->config_manager;
+  MonitorTestCase test_case = initial_test_case;
+  MetaMonitorTestSetup *test_setup;
+  MetaMonitorsConfig *config;
+  GError *error = NULL;
+
+  /* Only one of the two CRTCs can be driven at once */
+  meta_monitor_manager_test_set_max_active_crtcs (monitor_manager_test, 1);
+
+  test_setup = create_monitor_test_setup (&test_case,
+                                          MONITOR_TEST_FLAG_NO_STORED);
+
+  g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+                         "Failed to use linear *");
+  emulate_hotplug (test_setup);
+  g_test_assert_expected_messages ();
+
+  /* The linear configuration was rejected, and the fallback one applied */
+  config = meta_monitor_config_manager_get_current (config_manager);
+  g_assert_cmpint (g_list_length (config->logical_monitor_configs), ==, 1);
+  g_assert_cmpint (g_list_length (monitor_manager->logical_monitors), ==, 1);
+  g_assert_cmpint (monitor_manager->screen_width, ==, 1024);
+  g_assert_cmpint (monitor_manager->screen_height, ==, 768);
+
+  /* Nor does it pass verification */
+  config = meta_monitor_config_manager_create_linear (config_manager);
+  g_assert (!manager_class->apply_monitors_config (monitor_manager,
+                                                   config,
+                                                   META_MONITORS_CONFIG_METHOD_VERIFY,
+                                                   &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+  g_clear_error (&error);
+
+  meta_monitor_manager_test_set_max_active_crtcs (monitor_manager_test, 0);
+
+  g_assert (manager_class->apply_monitors_config (monitor_manager,
+                                                  config,
+                                                  META_MONITORS_CONFIG_METHOD_VERIFY,
+                                                  &error));
+  g_assert_no_error (error);
+  g_object_unref (config);
+
+  /* Verifying must not have applied anything either */
+  g_assert_cmpint (g_list_length (monitor_manager->logical_monitors), ==, 1);
+
+  test_setup = create_monitor_test_setup (&test_case,
+                                          MONITOR_TEST_FLAG_NO_STORED);
+  emulate_hotplug (test_setup);
+  check_monitor_configuration (&test_case);
+}
+
 static void
 meta_test_monitor_custom_vertical_config (void)
 {
@@ -5922,6 +6044,10 @@ init_monitor_tests (void)
                     meta_test_monitor_preferred_non_first_mode);
   add_monitor_test ("/backends/monitor/non-upright-panel",
                     meta_test_monitor_non_upright_panel);
+  add_monitor_test ("/backends/monitor/vrr-policy",
+                    meta_test_monitor_vrr_policy);
+  add_monitor_test ("/backends/monitor/rejected-crtc-assignment",
+                    meta_test_monitor_rejected_crtc_assignment);
 
   add_monitor_test ("/backends/monitor/custom/vertical-config",
                     meta_test_monitor_custom_vertical_config);
@@ -0,0 +1,153 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "tests/native-unit-tests.h"
+
+#include <errno.h>
+#include <gio/gio.h>
+
+#include "backends/native/meta-cursor-renderer-native.h"
+#include "backends/native/meta-gpu-kms.h"
+
+static int atomic_commit_ret;
+static uint32_t atomic_commit_flags;
+
+/*
+ * Stands in for the libdrm call made by libmutter, so that the handling of
+ * the driver verdict can be tested without a KMS device.
+ */
+int
+drmModeAtomicCommit (int                 fd,
+                     drmModeAtomicReqPtr req,
+                     uint32_t            flags,
+                     void               *user_data)
+{
+  atomic_commit_flags = flags;
+
+  return atomic_commit_ret;
+}
+
+static ClutterRect
+cursor_rect_at (float x,
+                float y)
+{
+  return (ClutterRect) {
+    .origin = { .x = x, .y = y },
+    .size = { .width = 64, .height = 64 }
+  };
+}
+
+static void
+meta_test_native_hw_cursor_crtc_handoff (void)
+{
+  MetaHwCursorCrtc left = {
+    .rect = {
+      .origin = { .x = 0, .y = 0 },
+      .size = { .width = 1024, .height = 768 }
+    },
+    .scale = 1.0,
+    .shown = TRUE,
+    .x = 100,
+    .y = 100
+  };
+  MetaHwCursorCrtc right = {
+    .rect = {
+      .origin = { .x = 1024, .y = 0 },
+      .size = { .width = 640, .height = 400 }
+    },
+    .scale = 2.0,
+    .shown = FALSE
+  };
+  ClutterRect cursor_rect;
+
+  /* Moving within a CRTC only moves the cursor there. */
+  cursor_rect = cursor_rect_at (900, 100);
+  g_assert_cmpint (meta_hw_cursor_crtc_update (&left, &cursor_rect),
+                   ==, META_HW_CURSOR_UPDATE_MOVE);
+  g_assert_cmpint (meta_hw_cursor_crtc_update (&right, &cursor_rect),
+                   ==, META_HW_CURSOR_UPDATE_NONE);
+  g_assert_cmpint (left.x, ==, 900);
+  g_assert_cmpint (left.y, ==, 100);
+
+  /* Straddling both CRTCs shows the cursor on the one it enters. */
+  cursor_rect = cursor_rect_at (1000, 100);
+  g_assert_cmpint (meta_hw_cursor_crtc_update (&left, &cursor_rect),
+                   ==, META_HW_CURSOR_UPDATE_MOVE);
+  g_assert_cmpint (meta_hw_cursor_crtc_update (&right, &cursor_rect),
+                   ==, META_HW_CURSOR_UPDATE_SHOW);
+  g_assert (left.shown);
+  g_assert (right.shown);
+  g_assert_cmpint (right.x, ==, -48);
+  g_assert_cmpint (right.y, ==, 200);
+
+  /* Leaving a CRTC hides the cursor there. */
+  cursor_rect = cursor_rect_at (1100, 100);
+  g_assert_cmpint (meta_hw_cursor_crtc_update (&left, &cursor_rect),
+                   ==, META_HW_CURSOR_UPDATE_HIDE);
+  g_assert_cmpint (meta_hw_cursor_crtc_update (&right, &cursor_rect),
+                   ==, META_HW_CURSOR_UPDATE_MOVE);
+  g_assert (!left.shown);
+  g_assert_cmpint (right.x, ==, 152);
+  g_assert_cmpint (right.y, ==, 200);
+
+  /* Sub-pixel motion that doesn't change the CRTC position is dropped. */
+  cursor_rect = cursor_rect_at (1100.1, 100.1);
+  g_assert_cmpint (meta_hw_cursor_crtc_update (&left, &cursor_rect),
+                   ==, META_HW_CURSOR_UPDATE_NONE);
+  g_assert_cmpint (meta_hw_cursor_crtc_update (&right, &cursor_rect),
+                   ==, META_HW_CURSOR_UPDATE_NONE);
+}
+
+static void
+meta_test_native_kms_atomic_test_commit (void)
+{
+  GError *error = NULL;
+
+  atomic_commit_ret = 0;
+  g_assert (meta_kms_atomic_test_commit (-1, NULL,
+                                         DRM_MODE_ATOMIC_ALLOW_MODESET,
+                                         &error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (atomic_commit_flags, ==,
+                    (DRM_MODE_ATOMIC_TEST_ONLY |
+                     DRM_MODE_ATOMIC_ALLOW_MODESET));
+
+  atomic_commit_ret = -EINVAL;
+  g_assert (!meta_kms_atomic_test_commit (-1, NULL, 0, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+  g_assert_cmpuint (atomic_commit_flags, ==, DRM_MODE_ATOMIC_TEST_ONLY);
+  g_clear_error (&error);
+
+  /* Without DRM master the configuration can't be judged either way. */
+  atomic_commit_ret = -EACCES;
+  g_assert (!meta_kms_atomic_test_commit (-1, NULL, 0, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED);
+  g_clear_error (&error);
+}
+
+void
+init_native_tests (void)
+{
+  g_test_add_func ("/backends/native/hw-cursor/crtc-handoff",
+                   meta_test_native_hw_cursor_crtc_handoff);
+  g_test_add_func ("/backends/native/kms/atomic-test-commit",
+                   meta_test_native_kms_atomic_test_commit);
+}
@@ -0,0 +1,198 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Times the shadow blur for each implementation the CPU supports, over
+ * the range of radii used by the default shadow classes and themes, and
+ * checks that all implementations produce the same shadow.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compositor/meta-shadow-blur.h"
+
+static int n_iterations = 200;
+
+static GOptionEntry entries[] = {
+  {
+    "iterations", 'i',
+    0,
+    G_OPTION_ARG_INT, &n_iterations,
+    "Number of shadows to blur per measurement", "ITERATIONS"
+  },
+  { NULL }
+};
+
+static const char *impl_names[] = {
+  [META_SHADOW_BLUR_IMPL_SCALAR] = "scalar",
+  [META_SHADOW_BLUR_IMPL_SSE2] = "sse2",
+  [META_SHADOW_BLUR_IMPL_AVX2] = "avx2",
+};
+
+/* Approximates the shape of a window with rounded top corners, which is
+ * what the shadow factory usually gets to blur; the corners are cut off
+ * diagonally, the exact curve doesn't matter for timing. */
+static cairo_region_t *
+make_window_region (int width,
+                    int height,
+                    int corner_radius)
+{
+  cairo_region_t *region;
+  cairo_rectangle_int_t rect;
+  int i;
+
+  rect.x = 0;
+  rect.y = corner_radius;
+  rect.width = width;
+  rect.height = height - corner_radius;
+  region = cairo_region_create_rectangle (&rect);
+
+  for (i = 0; i < corner_radius; i++)
+    {
+      int inset = corner_radius - i;
+
+      rect.x = inset;
+      rect.y = i;
+      rect.width = width - 2 * inset;
+      rect.height = 1;
+      cairo_region_union_rectangle (region, &rect);
+    }
+
+  return region;
+}
+
+static guchar *
+run_blur (cairo_region_t *region,
+          int             radius,
+          int            *buffer_width,
+          int            *buffer_height,
+          double         *usec_per_shadow)
+{
+  guchar *buffer;
+  gint64 start, end;
+  int i;
+
+  /* warm up */
+  buffer = meta_shadow_blur_region (region, radius,
+                                    buffer_width, buffer_height);
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_iterations; i++)
+    {
+      g_free (buffer);
+      buffer = meta_shadow_blur_region (region, radius,
+                                        buffer_width, buffer_height);
+    }
+
+  end = g_get_monotonic_time ();
+
+  *usec_per_shadow = (double) (end - start) / n_iterations;
+
+  return buffer;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const int radii[] = { 4, 8, 12, 20, 32, 48 };
+  GOptionContext *context;
+  GError *error = NULL;
+  cairo_region_t *region;
+  gboolean all_equal = TRUE;
+  unsigned int i;
+  int impl;
+
+  context = g_option_context_new ("- benchmark the shadow blur");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  /* A shadow is blurred from the borders of the window shape plus a
+   * small center; see meta_shadow_factory_get_shadow(). */
+  region = make_window_region (64, 64, 8);
+
+  printf ("%-8s", "radius");
+  for (impl = META_SHADOW_BLUR_IMPL_SCALAR; impl <= META_SHADOW_BLUR_IMPL_AVX2; impl++)
+    {
+      if (meta_shadow_blur_impl_is_supported (impl))
+        printf ("%12s", impl_names[impl]);
+    }
+  printf ("   (us per shadow)\n");
+
+  for (i = 0; i < G_N_ELEMENTS (radii); i++)
+    {
+      guchar *reference = NULL;
+      int reference_width = 0, reference_height = 0;
+
+      printf ("%-8d", radii[i]);
+
+      for (impl = META_SHADOW_BLUR_IMPL_SCALAR; impl <= META_SHADOW_BLUR_IMPL_AVX2; impl++)
+        {
+          guchar *buffer;
+          int width, height;
+          double usec;
+
+          if (!meta_shadow_blur_impl_is_supported (impl))
+            continue;
+
+          meta_shadow_blur_set_impl (impl);
+          buffer = run_blur (region, radii[i], &width, &height, &usec);
+
+          printf ("%12.1f", usec);
+
+          if (!reference)
+            {
+              reference = buffer;
+              reference_width = width;
+              reference_height = height;
+              continue;
+            }
+
+          if (width != reference_width || height != reference_height ||
+              memcmp (buffer, reference, width * height) != 0)
+            {
+              g_printerr ("\n%s blur differs from %s blur at radius %d\n",
+                          impl_names[impl],
+                          impl_names[META_SHADOW_BLUR_IMPL_SCALAR],
+                          radii[i]);
+              all_equal = FALSE;
+            }
+
+          g_free (buffer);
+        }
+
+      printf ("\n");
+
+      g_free (reference);
+    }
+
+  cairo_region_destroy (region);
+
+  return all_equal ? EXIT_SUCCESS : EXIT_FAILURE;
+}
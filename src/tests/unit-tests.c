@@ -21,11 +21,13 @@
 
 #include <glib.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <meta/main.h>
 #include <meta/util.h>
 
 #include "compositor/meta-plugin-manager.h"
+#include "compositor/region-utils.h"
 #include "core/boxes-private.h"
 #include "core/main-private.h"
 #include "tests/meta-backend-test.h"
@@ -33,8 +35,13 @@
 #include "tests/monitor-unit-tests.h"
 #include "tests/monitor-store-unit-tests.h"
 #include "tests/test-utils.h"
+#include "tests/wayland-unit-tests.h"
 #include "wayland/meta-wayland.h"
 
+#ifdef HAVE_NATIVE_BACKEND
+#include "tests/native-unit-tests.h"
+#endif
+
 typedef struct _MetaTestLaterOrderCallbackData
 {
   GMainLoop *loop; /* Loop to terminate when done. */
@@ -213,6 +220,129 @@ meta_test_adjecent_to (void)
     g_assert (!meta_rectangle_is_adjecent_to (&base, &not_adjecent[i]));
 }
 
+static void
+meta_test_region_opaque_region (void)
+{
+  cairo_rectangle_int_t scan_rect = { .x = 3, .y = 0, .width = 40, .height = 24 };
+  cairo_region_t *scan_area;
+  cairo_region_t *opaque_region;
+  cairo_region_t *expected_region;
+  guchar mask[24][48];
+  int x, y;
+
+  /* A frame like mask: a rounded top, two semi-transparent rows and
+   * opaque sides around a transparent "client area" */
+  memset (mask, 0, sizeof (mask));
+  expected_region = cairo_region_create ();
+
+  for (y = 0; y < 24; y++)
+    {
+      for (x = 0; x < 48; x++)
+        {
+          gboolean opaque;
+
+          if (y < 4)
+            opaque = x >= 4 - y && x < 44 + y;
+          else if (y < 6)
+            opaque = FALSE;
+          else if (y < 20)
+            opaque = x < 8 || (x >= 40 && x != 42);
+          else
+            opaque = TRUE;
+
+          if (opaque)
+            {
+              mask[y][x] = 255;
+
+              if (x >= scan_rect.x && x < scan_rect.x + scan_rect.width)
+                {
+                  cairo_rectangle_int_t pixel = { x, y, 1, 1 };
+                  cairo_region_union_rectangle (expected_region, &pixel);
+                }
+            }
+          else if (y >= 4 && y < 6)
+            {
+              mask[y][x] = 254;
+            }
+        }
+    }
+
+  scan_area = cairo_region_create_rectangle (&scan_rect);
+  opaque_region = meta_make_opaque_region (&mask[0][0], sizeof (mask[0]),
+                                           scan_area);
+
+  g_assert (cairo_region_equal (opaque_region, expected_region));
+
+  cairo_region_destroy (opaque_region);
+  cairo_region_destroy (expected_region);
+  cairo_region_destroy (scan_area);
+}
+
+static void
+meta_test_region_transform (void)
+{
+  cairo_rectangle_int_t rect = { .x = 10, .y = 20, .width = 30, .height = 40 };
+  cairo_rectangle_int_t grown_rect = { .x = 5, .y = 10, .width = 16, .height = 21 };
+  cairo_rectangle_int_t shrunk_rect = { .x = 6, .y = 11, .width = 14, .height = 19 };
+  cairo_rectangle_int_t extents;
+  cairo_region_t *region;
+  cairo_region_t *transformed_region;
+
+  region = cairo_region_create_rectangle (&rect);
+
+  /* Halving lands on integers; the offset moves the edges off them */
+  transformed_region = meta_region_transform (region, 0.5, 0.5, 0.25, 0.25,
+                                              META_REGION_ROUND_OUT);
+  cairo_region_get_extents (transformed_region, &extents);
+  g_assert_cmpint (cairo_region_num_rectangles (transformed_region), ==, 1);
+  g_assert (memcmp (&extents, &grown_rect, sizeof (extents)) == 0);
+  cairo_region_destroy (transformed_region);
+
+  transformed_region = meta_region_transform (region, 0.5, 0.5, 0.25, 0.25,
+                                              META_REGION_ROUND_IN);
+  cairo_region_get_extents (transformed_region, &extents);
+  g_assert_cmpint (cairo_region_num_rectangles (transformed_region), ==, 1);
+  g_assert (memcmp (&extents, &shrunk_rect, sizeof (extents)) == 0);
+  cairo_region_destroy (transformed_region);
+
+  /* A thin rectangle may not cover any pixel completely */
+  transformed_region = meta_region_transform (region, 0.01, 1.0, 0.5, 0.0,
+                                              META_REGION_ROUND_IN);
+  g_assert (cairo_region_is_empty (transformed_region));
+  cairo_region_destroy (transformed_region);
+
+  cairo_region_destroy (region);
+}
+
+static void
+meta_test_region_erode (void)
+{
+  cairo_rectangle_int_t rects[] = {
+    { .x = 0, .y = 0, .width = 20, .height = 10 },
+    { .x = 0, .y = 10, .width = 10, .height = 10 },
+  };
+  cairo_rectangle_int_t expected_rects[] = {
+    { .x = 2, .y = 1, .width = 16, .height = 8 },
+    { .x = 2, .y = 9, .width = 6, .height = 10 },
+  };
+  cairo_region_t *region;
+  cairo_region_t *eroded_region;
+  cairo_region_t *expected_region;
+
+  /* An L shape; the inner corner must not be eroded where the two
+   * rectangles meet */
+  region = cairo_region_create_rectangles (rects, G_N_ELEMENTS (rects));
+  expected_region = cairo_region_create_rectangles (expected_rects,
+                                                    G_N_ELEMENTS (expected_rects));
+
+  eroded_region = meta_region_erode (region, 2, 1);
+  g_assert (cairo_region_equal (eroded_region, expected_region));
+
+  cairo_region_destroy (eroded_region);
+  cairo_region_destroy (expected_region);
+  cairo_region_destroy (region);
+}
+
 static gboolean
 run_tests (gpointer data)
 {
@@ -249,9 +379,20 @@ init_tests (int argc, char **argv)
 
   g_test_add_func ("/core/boxes/adjecent-to", meta_test_adjecent_to);
 
+  g_test_add_func ("/compositor/region-utils/opaque-region",
+                   meta_test_region_opaque_region);
+  g_test_add_func ("/compositor/region-utils/transform",
+                   meta_test_region_transform);
+  g_test_add_func ("/compositor/region-utils/erode",
+                   meta_test_region_erode);
+
   init_monitor_store_tests ();
   init_monitor_config_migration_tests ();
   init_monitor_tests ();
+  init_wayland_tests ();
+#ifdef HAVE_NATIVE_BACKEND
+  init_native_tests ();
+#endif
 }
 
 int
@@ -0,0 +1,142 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "tests/wayland-unit-tests.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "wayland/meta-wayland-pointer.h"
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-seat.h"
+#include "wayland/meta-wayland-surface.h"
+
+typedef struct _WaylandTestClient
+{
+  struct wl_client *client;
+  int fd;
+  struct wl_resource *compositor_resource;
+} WaylandTestClient;
+
+static void
+wayland_test_client_init (WaylandTestClient *test_client)
+{
+  MetaWaylandCompositor *compositor = meta_wayland_compositor_get_default ();
+  int fds[2];
+
+  g_assert_cmpint (socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds),
+                   ==, 0);
+
+  test_client->client = wl_client_create (compositor->wayland_display, fds[0]);
+  g_assert_nonnull (test_client->client);
+  test_client->fd = fds[1];
+
+  test_client->compositor_resource =
+    wl_resource_create (test_client->client, &wl_compositor_interface, 1, 0);
+}
+
+static void
+wayland_test_client_destroy (WaylandTestClient *test_client)
+{
+  wl_client_destroy (test_client->client);
+  close (test_client->fd);
+}
+
+static MetaWaylandSurface *
+wayland_test_client_create_surface (WaylandTestClient *test_client)
+{
+  MetaWaylandCompositor *compositor = meta_wayland_compositor_get_default ();
+
+  return meta_wayland_surface_create (compositor,
+                                      test_client->client,
+                                      test_client->compositor_resource,
+                                      0);
+}
+
+static void
+emit_pointer_event (MetaWaylandPointer  *pointer,
+                    ClutterEventType     type,
+                    MetaWaylandSurface  *surface,
+                    ClutterModifierType  state)
+{
+  ClutterEvent *event;
+
+  event = clutter_event_new (type);
+  clutter_event_set_device (event, pointer->device);
+  clutter_event_set_source (event, CLUTTER_ACTOR (surface->surface_actor));
+  clutter_event_set_state (event, state);
+  if (type == CLUTTER_BUTTON_PRESS || type == CLUTTER_BUTTON_RELEASE)
+    clutter_event_set_button (event, CLUTTER_BUTTON_PRIMARY);
+
+  meta_wayland_pointer_update (pointer, event);
+  meta_wayland_pointer_handle_event (pointer, event);
+
+  clutter_event_free (event);
+}
+
+static void
+meta_test_wayland_pointer_focus_after_drag (void)
+{
+  MetaWaylandCompositor *compositor = meta_wayland_compositor_get_default ();
+  MetaWaylandSeat *seat = compositor->seat;
+  MetaWaylandPointer *pointer = seat->pointer;
+  WaylandTestClient test_client;
+  MetaWaylandSurface *surface_a;
+  MetaWaylandSurface *surface_b;
+
+  if (!meta_wayland_seat_has_pointer (seat))
+    {
+      g_test_skip ("No pointer device");
+      return;
+    }
+
+  wayland_test_client_init (&test_client);
+  surface_a = wayland_test_client_create_surface (&test_client);
+  surface_b = wayland_test_client_create_surface (&test_client);
+
+  emit_pointer_event (pointer, CLUTTER_MOTION, surface_a, 0);
+  g_assert (pointer->focus_surface == surface_a);
+
+  /* The focus stays on the surface the button was pressed on while it is
+   * held, and moves to the one below the pointer once it is released. */
+  emit_pointer_event (pointer, CLUTTER_BUTTON_PRESS, surface_a,
+                      CLUTTER_BUTTON1_MASK);
+  emit_pointer_event (pointer, CLUTTER_MOTION, surface_b,
+                      CLUTTER_BUTTON1_MASK);
+  g_assert (pointer->focus_surface == surface_a);
+
+  emit_pointer_event (pointer, CLUTTER_BUTTON_RELEASE, surface_b, 0);
+  g_assert (pointer->focus_surface == surface_b);
+
+  /* Moving within the focused surface keeps the focus where it is. */
+  emit_pointer_event (pointer, CLUTTER_MOTION, surface_b, 0);
+  g_assert (pointer->focus_surface == surface_b);
+
+  wayland_test_client_destroy (&test_client);
+  g_assert_null (pointer->focus_surface);
+}
+
+void
+init_wayland_tests (void)
+{
+  g_test_add_func ("/wayland/pointer/focus-after-drag",
+                   meta_test_wayland_pointer_focus_after_drag);
+}
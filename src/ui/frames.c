@@ -1351,6 +1351,27 @@ meta_ui_frame_get_mask (MetaUIFrame *frame,
                          frame_rect.width / scale, borders.total.top / scale);
 }
 
+void
+meta_ui_frame_get_mask_key (MetaUIFrame      *frame,
+                            MetaFrameMaskKey *key)
+{
+  MetaRectangle frame_rect;
+
+  memset (key, 0, sizeof (*key));
+
+  meta_window_get_frame_rect (frame->meta_window, &frame_rect);
+
+  key->flags = meta_frame_get_flags (frame->meta_window->frame);
+
+  meta_style_info_set_flags (frame->style_info, key->flags);
+  meta_ui_frame_get_borders (frame, &key->borders);
+
+  key->style_serial = frame->style_info->serial;
+  key->width = frame_rect.width;
+  key->height = frame_rect.height;
+  key->scale = meta_theme_get_window_scaling_factor ();
+}
+
 /* XXX -- this is disgusting. Find a better approach here.
  * Use multiple widgets? */
 static MetaUIFrame *
@@ -63,6 +63,7 @@ typedef enum
 
 typedef struct _MetaFrames        MetaFrames;
 typedef struct _MetaFramesClass   MetaFramesClass;
+typedef struct _MetaFrameMaskKey  MetaFrameMaskKey;
 
 struct _MetaUIFrame
 {
@@ -101,6 +102,18 @@ struct _MetaFrames
   gdouble grab_y;
 };
 
+/* Everything the mask drawn by meta_ui_frame_get_mask() depends on;
+ * frames with equal keys (compared bytewise) have the same mask. */
+struct _MetaFrameMaskKey
+{
+  guint style_serial;
+  MetaFrameFlags flags;
+  MetaFrameBorders borders;
+  int width;
+  int height;
+  int scale;
+};
+
 struct _MetaFramesClass
 {
   GtkWindowClass parent_class;
@@ -131,6 +144,9 @@ cairo_region_t * meta_ui_frame_get_bounds (MetaUIFrame *frame);
 void meta_ui_frame_get_mask (MetaUIFrame *frame,
                              cairo_t     *cr);
 
+void meta_ui_frame_get_mask_key (MetaUIFrame      *frame,
+                                 MetaFrameMaskKey *key);
+
 void meta_ui_frame_move_resize (MetaUIFrame *frame,
                                 int x, int y, int width, int height);
 
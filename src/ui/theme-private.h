@@ -182,6 +182,9 @@ struct _MetaStyleInfo
 {
   int refcount;
 
+  /* Unique for every style info created, unlike its address */
+  guint serial;
+
   GtkStyleContext *styles[META_STYLE_ELEMENT_LAST];
 };
 
@@ -1042,6 +1042,7 @@ MetaStyleInfo *
 meta_theme_create_style_info (GdkScreen   *screen,
                               const gchar *variant)
 {
+  static guint next_serial = 1;
   MetaStyleInfo *style_info;
   GtkCssProvider *provider;
   char *theme_name;
@@ -1058,6 +1059,7 @@ meta_theme_create_style_info (GdkScreen   *screen,
 
   style_info = g_new0 (MetaStyleInfo, 1);
   style_info->refcount = 1;
+  style_info->serial = next_serial++;
 
   style_info->styles[META_STYLE_ELEMENT_WINDOW] =
     create_style_context (META_TYPE_FRAMES,
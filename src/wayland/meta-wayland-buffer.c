@@ -32,12 +32,25 @@
 #include <meta/util.h>
 
 #include <drm_fourcc.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <string.h>
 
 #ifndef DRM_FORMAT_MOD_INVALID
 #define DRM_FORMAT_MOD_INVALID ((1ULL << 56) - 1)
 #endif
 
 #include "backends/meta-backend-private.h"
+#include "backends/meta-settings-private.h"
+
+/* Number of pixel buffers shm damage is staged in before being uploaded. Using
+ * them in turn gives the GPU time to consume one while the next is filled. */
+#define N_SHM_UPLOAD_BUFFERS 3
+
+/* A damage region is uploaded as its extents when these are at most this many
+ * times larger than the region itself; one larger transfer is cheaper than
+ * many small ones. */
+#define SHM_DAMAGE_COALESCE_RATIO 2
 
 enum
 {
@@ -48,6 +61,41 @@ enum
 
 guint signals[LAST_SIGNAL];
 
+struct _MetaWaylandShmUpload
+{
+  MetaWaylandBuffer *buffer;
+  struct wl_shm_pool *shm_pool;
+  const uint8_t *shm_data;
+  int32_t shm_stride;
+
+  CoglPixelFormat format;
+  int bpp;
+  cairo_rectangle_int_t *rects;
+  size_t *offsets;
+  int n_rects;
+
+  CoglPixelBuffer *upload_buffer;
+  uint8_t *upload_data;
+
+  /* Protected by shm_upload_mutex */
+  gboolean done;
+  gboolean failed;
+  guint finish_idle_id;
+};
+
+static CoglPixelBuffer *shm_upload_buffers[N_SHM_UPLOAD_BUFFERS];
+static int next_shm_upload_buffer;
+
+static GThreadPool *shm_upload_thread_pool;
+static GMutex shm_upload_mutex;
+static GCond shm_upload_cond;
+static GList *pending_shm_uploads;
+
+static struct sigaction old_sigbus_action;
+static GPrivate shm_upload_jmp_env;
+
+static void finish_shm_upload (MetaWaylandBuffer *buffer);
+
 G_DEFINE_TYPE (MetaWaylandBuffer, meta_wayland_buffer, G_TYPE_OBJECT);
 
 static void
@@ -57,6 +105,12 @@ meta_wayland_buffer_destroy_handler (struct wl_listener *listener,
   MetaWaylandBuffer *buffer =
     wl_container_of (listener, buffer, destroy_listener);
 
+  /* The upload thread may still be reading from the shm buffer */
+  buffer->shm.release_pending = FALSE;
+  finish_shm_upload (buffer);
+
+  buffer->scanout.release_pending = FALSE;
+
   buffer->resource = NULL;
   g_signal_emit (buffer, signals[RESOURCE_DESTROYED], 0);
   g_object_unref (buffer);
@@ -177,6 +231,171 @@ shm_buffer_get_cogl_pixel_format (struct wl_shm_buffer  *shm_buffer,
     *components_out = components;
 }
 
+static gboolean
+can_stage_shm_uploads (CoglContext *cogl_context)
+{
+  CoglRenderer *cogl_renderer = cogl_context_get_renderer (cogl_context);
+
+  /* Pixel buffers are only backed by buffer objects with the big GL drivers;
+   * elsewhere staging would only add a copy. */
+  switch (cogl_renderer_get_driver (cogl_renderer))
+    {
+    case COGL_DRIVER_GL:
+    case COGL_DRIVER_GL3:
+      return cogl_has_feature (cogl_context,
+                               COGL_FEATURE_ID_MAP_BUFFER_FOR_WRITE);
+    default:
+      return FALSE;
+    }
+}
+
+static CoglPixelBuffer *
+take_shm_upload_buffer (CoglContext *cogl_context,
+                        size_t       size)
+{
+  CoglPixelBuffer *upload_buffer;
+
+  upload_buffer =
+    g_steal_pointer (&shm_upload_buffers[next_shm_upload_buffer]);
+  next_shm_upload_buffer = (next_shm_upload_buffer + 1) % N_SHM_UPLOAD_BUFFERS;
+
+  if (upload_buffer &&
+      cogl_buffer_get_size (COGL_BUFFER (upload_buffer)) < size)
+    g_clear_pointer (&upload_buffer, cogl_object_unref);
+
+  if (!upload_buffer)
+    {
+      /* Round up, so that buffers growing a little at a time (e.g. while
+       * resizing a window) don't reallocate every frame. */
+      size = (size_t) 1 << g_bit_storage (size - 1);
+
+      upload_buffer = cogl_pixel_buffer_new (cogl_context, size, NULL);
+      cogl_buffer_set_update_hint (COGL_BUFFER (upload_buffer),
+                                   COGL_BUFFER_UPDATE_HINT_STREAM);
+    }
+
+  return upload_buffer;
+}
+
+static void
+return_shm_upload_buffer (CoglPixelBuffer *upload_buffer)
+{
+  int i;
+
+  for (i = 0; i < N_SHM_UPLOAD_BUFFERS; i++)
+    {
+      if (!shm_upload_buffers[i])
+        {
+          shm_upload_buffers[i] = upload_buffer;
+          return;
+        }
+    }
+
+  cogl_object_unref (upload_buffer);
+}
+
+static size_t
+get_shm_upload_layout (const cairo_rectangle_int_t *rects,
+                       int                          n_rects,
+                       int                          bpp,
+                       size_t                      *offsets)
+{
+  size_t size = 0;
+  int i;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      offsets[i] = size;
+      size += (size_t) rects[i].width * bpp * rects[i].height;
+    }
+
+  return size;
+}
+
+/*
+ * Copies the given rectangles of shm buffer contents, tightly packed one after
+ * the other at the given offsets, into the mapped staging memory. Doesn't touch
+ * any GL state, so may be called from the upload thread.
+ */
+static void
+copy_shm_rectangles (const uint8_t               *data,
+                     int32_t                      stride,
+                     int                          bpp,
+                     const cairo_rectangle_int_t *rects,
+                     int                          n_rects,
+                     const size_t                *offsets,
+                     uint8_t                     *upload_data)
+{
+  int i;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      const cairo_rectangle_int_t *rect = &rects[i];
+      const uint8_t *src = data + rect->x * bpp + rect->y * stride;
+      uint8_t *dst = upload_data + offsets[i];
+      int row_size = rect->width * bpp;
+      int y;
+
+      if (row_size == stride)
+        {
+          memcpy (dst, src, (size_t) row_size * rect->height);
+          continue;
+        }
+
+      for (y = 0; y < rect->height; y++)
+        {
+          memcpy (dst, src, row_size);
+          src += stride;
+          dst += row_size;
+        }
+    }
+}
+
+/*
+ * Copies the given rectangles of a shm buffer into a pixel buffer the texture
+ * can then be updated from without blocking on the transfer. The offset of
+ * each rectangle within the pixel buffer is returned in @offsets. The shm
+ * buffer must be accessed, and the pixel buffer handed back with
+ * return_shm_upload_buffer() once used.
+ */
+static CoglPixelBuffer *
+stage_shm_rectangles (CoglContext                 *cogl_context,
+                      struct wl_shm_buffer        *shm_buffer,
+                      int                          bpp,
+                      const cairo_rectangle_int_t *rects,
+                      int                          n_rects,
+                      size_t                      *offsets,
+                      GError                     **error)
+{
+  CoglPixelBuffer *upload_buffer;
+  uint8_t *upload_data;
+  size_t size;
+
+  size = get_shm_upload_layout (rects, n_rects, bpp, offsets);
+  upload_buffer = take_shm_upload_buffer (cogl_context, size);
+  upload_data = cogl_buffer_map_range (COGL_BUFFER (upload_buffer),
+                                       0, size,
+                                       COGL_BUFFER_ACCESS_WRITE,
+                                       COGL_BUFFER_MAP_HINT_DISCARD,
+                                       error);
+  if (!upload_data)
+    {
+      return_shm_upload_buffer (upload_buffer);
+      return NULL;
+    }
+
+  copy_shm_rectangles (wl_shm_buffer_get_data (shm_buffer),
+                       wl_shm_buffer_get_stride (shm_buffer),
+                       bpp,
+                       rects, n_rects,
+                       offsets,
+                       upload_data);
+
+  cogl_buffer_unmap (COGL_BUFFER (upload_buffer));
+
+  return upload_buffer;
+}
+
 static gboolean
 shm_buffer_attach (MetaWaylandBuffer *buffer,
                    GError           **error)
@@ -190,6 +409,7 @@ shm_buffer_attach (MetaWaylandBuffer *buffer,
   CoglTextureComponents components;
   CoglBitmap *bitmap;
   CoglTexture *texture;
+  CoglPixelBuffer *upload_buffer = NULL;
 
   if (buffer->texture)
     return TRUE;
@@ -203,11 +423,41 @@ shm_buffer_attach (MetaWaylandBuffer *buffer,
 
   shm_buffer_get_cogl_pixel_format (shm_buffer, &format, &components);
 
-  bitmap = cogl_bitmap_new_for_data (cogl_context,
-                                     width, height,
-                                     format,
-                                     stride,
-                                     wl_shm_buffer_get_data (shm_buffer));
+  bitmap = NULL;
+  if (can_stage_shm_uploads (cogl_context))
+    {
+      int bpp = _cogl_pixel_format_get_bytes_per_pixel (format);
+      cairo_rectangle_int_t rect = { 0, 0, width, height };
+      size_t offset;
+      GError *staging_error = NULL;
+
+      upload_buffer = stage_shm_rectangles (cogl_context, shm_buffer, bpp,
+                                            &rect, 1, &offset,
+                                            &staging_error);
+      if (upload_buffer)
+        {
+          bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (upload_buffer),
+                                                format,
+                                                width, height,
+                                                width * bpp,
+                                                offset);
+        }
+      else
+        {
+          meta_verbose ("Failed to stage shm buffer upload: %s\n",
+                        staging_error->message);
+          g_error_free (staging_error);
+        }
+    }
+
+  if (!bitmap)
+    {
+      bitmap = cogl_bitmap_new_for_data (cogl_context,
+                                         width, height,
+                                         format,
+                                         stride,
+                                         wl_shm_buffer_get_data (shm_buffer));
+    }
 
   texture = COGL_TEXTURE (cogl_texture_2d_new_from_bitmap (bitmap));
   cogl_texture_set_components (COGL_TEXTURE (texture), components);
@@ -217,6 +467,9 @@ shm_buffer_attach (MetaWaylandBuffer *buffer,
   if (!cogl_texture_allocate (COGL_TEXTURE (texture), error))
     g_clear_pointer (&texture, cogl_object_unref);
 
+  if (upload_buffer)
+    return_shm_upload_buffer (upload_buffer);
+
   wl_shm_buffer_end_access (shm_buffer);
 
   buffer->texture = texture;
@@ -388,49 +641,523 @@ meta_wayland_buffer_is_y_inverted (MetaWaylandBuffer *buffer)
   return buffer->is_y_inverted;
 }
 
-static gboolean
-process_shm_buffer_damage (MetaWaylandBuffer *buffer,
-                           cairo_region_t    *region,
-                           GError           **error)
+/*
+ * Returns the rectangles to upload for the damage region, coalescing them into
+ * the extents of the region when little would be uploaded needlessly.
+ */
+static cairo_rectangle_int_t *
+get_shm_damage_rectangles (cairo_region_t *region,
+                           int            *n_rects_out)
 {
-  struct wl_shm_buffer *shm_buffer;
-  int i, n_rectangles;
-  gboolean set_texture_failed = FALSE;
+  cairo_rectangle_int_t *rects;
+  cairo_rectangle_int_t extents;
+  int64_t damaged_area = 0;
+  int i, n_rects;
 
-  n_rectangles = cairo_region_num_rectangles (region);
+  n_rects = cairo_region_num_rectangles (region);
+  rects = g_new (cairo_rectangle_int_t, MAX (n_rects, 1));
 
-  shm_buffer = wl_shm_buffer_get (buffer->resource);
-  wl_shm_buffer_begin_access (shm_buffer);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_region_get_rectangle (region, i, &rects[i]);
+      damaged_area += (int64_t) rects[i].width * rects[i].height;
+    }
 
-  for (i = 0; i < n_rectangles; i++)
+  cairo_region_get_extents (region, &extents);
+  if (n_rects > 1 &&
+      (int64_t) extents.width * extents.height <=
+      damaged_area * SHM_DAMAGE_COALESCE_RATIO)
     {
-      const uint8_t *data = wl_shm_buffer_get_data (shm_buffer);
-      int32_t stride = wl_shm_buffer_get_stride (shm_buffer);
-      CoglPixelFormat format;
-      int bpp;
-      cairo_rectangle_int_t rect;
+      rects[0] = extents;
+      n_rects = 1;
+    }
 
-      shm_buffer_get_cogl_pixel_format (shm_buffer, &format, NULL);
-      bpp = _cogl_pixel_format_get_bytes_per_pixel (format);
-      cairo_region_get_rectangle (region, i, &rect);
+  *n_rects_out = n_rects;
+  return rects;
+}
+
+static gboolean
+upload_shm_rectangles (MetaWaylandBuffer           *buffer,
+                       struct wl_shm_buffer        *shm_buffer,
+                       CoglPixelFormat              format,
+                       const cairo_rectangle_int_t *rects,
+                       int                          n_rects,
+                       GError                     **error)
+{
+  const uint8_t *data = wl_shm_buffer_get_data (shm_buffer);
+  int32_t stride = wl_shm_buffer_get_stride (shm_buffer);
+  int bpp = _cogl_pixel_format_get_bytes_per_pixel (format);
+  int i;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      const cairo_rectangle_int_t *rect = &rects[i];
 
       if (!_cogl_texture_set_region (buffer->texture,
-                                     rect.width, rect.height,
+                                     rect->width, rect->height,
                                      format,
                                      stride,
-                                     data + rect.x * bpp + rect.y * stride,
-                                     rect.x, rect.y,
+                                     data + rect->x * bpp + rect->y * stride,
+                                     rect->x, rect->y,
                                      0,
                                      error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+update_texture_from_upload_buffer (CoglTexture                 *texture,
+                                   CoglPixelBuffer             *upload_buffer,
+                                   CoglPixelFormat              format,
+                                   int                          bpp,
+                                   const cairo_rectangle_int_t *rects,
+                                   int                          n_rects,
+                                   const size_t                *offsets,
+                                   GError                     **error)
+{
+  int i;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      const cairo_rectangle_int_t *rect = &rects[i];
+      CoglBitmap *bitmap;
+      gboolean set_region_succeeded;
+
+      bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (upload_buffer),
+                                            format,
+                                            rect->width, rect->height,
+                                            rect->width * bpp,
+                                            offsets[i]);
+      set_region_succeeded =
+        cogl_texture_set_region_from_bitmap (texture,
+                                             0, 0,
+                                             rect->x, rect->y,
+                                             rect->width, rect->height,
+                                             bitmap);
+      cogl_object_unref (bitmap);
+
+      if (!set_region_succeeded)
         {
-          set_texture_failed = TRUE;
-          break;
+          g_set_error (error, G_IO_ERROR,
+                       G_IO_ERROR_FAILED,
+                       "Failed to update texture from pixel buffer");
+          return FALSE;
         }
     }
 
+  return TRUE;
+}
+
+static gboolean
+upload_shm_rectangles_staged (MetaWaylandBuffer           *buffer,
+                              CoglContext                 *cogl_context,
+                              struct wl_shm_buffer        *shm_buffer,
+                              CoglPixelFormat              format,
+                              const cairo_rectangle_int_t *rects,
+                              int                          n_rects,
+                              GError                     **error)
+{
+  int bpp = _cogl_pixel_format_get_bytes_per_pixel (format);
+  CoglPixelBuffer *upload_buffer;
+  g_autofree size_t *offsets = NULL;
+  gboolean updated;
+
+  offsets = g_new (size_t, n_rects);
+  upload_buffer = stage_shm_rectangles (cogl_context, shm_buffer, bpp,
+                                        rects, n_rects, offsets,
+                                        error);
+  if (!upload_buffer)
+    return FALSE;
+
+  updated = update_texture_from_upload_buffer (buffer->texture,
+                                               upload_buffer,
+                                               format, bpp,
+                                               rects, n_rects,
+                                               offsets,
+                                               error);
+  return_shm_upload_buffer (upload_buffer);
+
+  return updated;
+}
+
+static gboolean
+should_use_shm_upload_thread (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaSettings *settings = meta_backend_get_settings (backend);
+
+  return meta_settings_is_experimental_feature_enabled (
+    settings, META_EXPERIMENTAL_FEATURE_SHM_UPLOAD_THREAD);
+}
+
+/*
+ * A client shrinking the pool of a buffer being copied from makes the upload
+ * thread fault. wl_shm_buffer_begin_access() can't protect it, as the protocol
+ * error it results in would be posted from the upload thread; the copy is
+ * abandoned instead, and the error posted once the upload is finished.
+ */
+static void
+shm_upload_sigbus_handler (int        signum,
+                           siginfo_t *info,
+                           void      *context)
+{
+  sigjmp_buf *jmp_env = g_private_get (&shm_upload_jmp_env);
+
+  if (jmp_env)
+    siglongjmp (*jmp_env, 1);
+
+  if (old_sigbus_action.sa_flags & SA_SIGINFO)
+    {
+      old_sigbus_action.sa_sigaction (signum, info, context);
+    }
+  else if (old_sigbus_action.sa_handler != SIG_DFL &&
+           old_sigbus_action.sa_handler != SIG_IGN)
+    {
+      old_sigbus_action.sa_handler (signum);
+    }
+  else
+    {
+      sigaction (SIGBUS, &old_sigbus_action, NULL);
+      raise (SIGBUS);
+    }
+}
+
+static void
+install_shm_upload_sigbus_handler (struct wl_shm_buffer *shm_buffer)
+{
+  struct sigaction act;
+
+  /* Have libwayland install its handler first, so that ours chains up to it */
+  wl_shm_buffer_begin_access (shm_buffer);
   wl_shm_buffer_end_access (shm_buffer);
 
-  return !set_texture_failed;
+  sigemptyset (&act.sa_mask);
+  act.sa_sigaction = shm_upload_sigbus_handler;
+  act.sa_flags = SA_SIGINFO | SA_NODEFER;
+  sigaction (SIGBUS, &act, &old_sigbus_action);
+}
+
+static gboolean
+copy_shm_upload_rectangles (MetaWaylandShmUpload *upload)
+{
+  sigjmp_buf jmp_env;
+
+  if (sigsetjmp (jmp_env, 1) != 0)
+    {
+      g_private_set (&shm_upload_jmp_env, NULL);
+      return FALSE;
+    }
+
+  g_private_set (&shm_upload_jmp_env, &jmp_env);
+  copy_shm_rectangles (upload->shm_data,
+                       upload->shm_stride,
+                       upload->bpp,
+                       upload->rects, upload->n_rects,
+                       upload->offsets,
+                       upload->upload_data);
+  g_private_set (&shm_upload_jmp_env, NULL);
+
+  return TRUE;
+}
+
+static gboolean
+finish_shm_upload_idle (gpointer user_data)
+{
+  MetaWaylandShmUpload *upload = user_data;
+
+  finish_shm_upload (upload->buffer);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+shm_upload_thread_func (gpointer data,
+                        gpointer user_data)
+{
+  MetaWaylandShmUpload *upload = data;
+  gboolean copied;
+
+  copied = copy_shm_upload_rectangles (upload);
+
+  /*
+   * The upload may be finished and freed as soon as it is marked as done;
+   * finishing it removes the idle, so the idle never outlives its upload.
+   */
+  g_mutex_lock (&shm_upload_mutex);
+  upload->failed = !copied;
+  upload->finish_idle_id = g_idle_add_full (G_PRIORITY_HIGH,
+                                            finish_shm_upload_idle,
+                                            upload,
+                                            NULL);
+  g_source_set_name_by_id (upload->finish_idle_id,
+                           "[mutter] finish_shm_upload_idle");
+  upload->done = TRUE;
+  g_cond_broadcast (&shm_upload_cond);
+  g_mutex_unlock (&shm_upload_mutex);
+}
+
+/*
+ * Maps a pixel buffer and leaves copying the damaged rectangles into it to the
+ * upload thread. The texture is updated, and a deferred release sent, once
+ * the copy is complete; at the latest before the next stage paint.
+ */
+static gboolean
+queue_shm_upload (MetaWaylandBuffer           *buffer,
+                  CoglContext                 *cogl_context,
+                  struct wl_shm_buffer        *shm_buffer,
+                  CoglPixelFormat              format,
+                  const cairo_rectangle_int_t *rects,
+                  int                          n_rects,
+                  GError                     **error)
+{
+  MetaWaylandShmUpload *upload;
+  size_t size;
+
+  if (!shm_upload_thread_pool)
+    {
+      shm_upload_thread_pool = g_thread_pool_new (shm_upload_thread_func,
+                                                  NULL,
+                                                  1,
+                                                  FALSE,
+                                                  error);
+      if (!shm_upload_thread_pool)
+        return FALSE;
+
+      install_shm_upload_sigbus_handler (shm_buffer);
+    }
+
+  upload = g_new0 (MetaWaylandShmUpload, 1);
+  upload->format = format;
+  upload->bpp = _cogl_pixel_format_get_bytes_per_pixel (format);
+  upload->rects = g_memdup (rects, n_rects * sizeof (cairo_rectangle_int_t));
+  upload->offsets = g_new (size_t, n_rects);
+  upload->n_rects = n_rects;
+
+  size = get_shm_upload_layout (rects, n_rects, upload->bpp, upload->offsets);
+  upload->upload_buffer = take_shm_upload_buffer (cogl_context, size);
+  upload->upload_data = cogl_buffer_map_range (COGL_BUFFER (upload->upload_buffer),
+                                               0, size,
+                                               COGL_BUFFER_ACCESS_WRITE,
+                                               COGL_BUFFER_MAP_HINT_DISCARD,
+                                               error);
+  if (!upload->upload_data)
+    {
+      return_shm_upload_buffer (upload->upload_buffer);
+      g_free (upload->rects);
+      g_free (upload->offsets);
+      g_free (upload);
+      return FALSE;
+    }
+
+  /* Keep the pool from being remapped by a resize while it is read from */
+  upload->shm_pool = wl_shm_buffer_ref_pool (shm_buffer);
+  upload->shm_data = wl_shm_buffer_get_data (shm_buffer);
+  upload->shm_stride = wl_shm_buffer_get_stride (shm_buffer);
+  upload->buffer = g_object_ref (buffer);
+
+  buffer->shm.upload = upload;
+  pending_shm_uploads = g_list_prepend (pending_shm_uploads, buffer);
+
+  g_thread_pool_push (shm_upload_thread_pool, upload, NULL);
+
+  return TRUE;
+}
+
+static void
+finish_shm_upload (MetaWaylandBuffer *buffer)
+{
+  MetaWaylandShmUpload *upload = buffer->shm.upload;
+  GError *error = NULL;
+
+  if (!upload)
+    return;
+
+  g_mutex_lock (&shm_upload_mutex);
+  while (!upload->done)
+    g_cond_wait (&shm_upload_cond, &shm_upload_mutex);
+  g_mutex_unlock (&shm_upload_mutex);
+
+  g_source_remove (upload->finish_idle_id);
+
+  buffer->shm.upload = NULL;
+  pending_shm_uploads = g_list_remove (pending_shm_uploads, buffer);
+
+  cogl_buffer_unmap (COGL_BUFFER (upload->upload_buffer));
+
+  if (upload->failed)
+    {
+      if (buffer->resource)
+        wl_resource_post_error (buffer->resource, WL_SHM_ERROR_INVALID_FD,
+                                "error accessing SHM buffer");
+    }
+  else if (!update_texture_from_upload_buffer (buffer->texture,
+                                               upload->upload_buffer,
+                                               upload->format, upload->bpp,
+                                               upload->rects, upload->n_rects,
+                                               upload->offsets,
+                                               &error))
+    {
+      g_warning ("Failed to process Wayland buffer damage: %s", error->message);
+      g_error_free (error);
+    }
+
+  return_shm_upload_buffer (upload->upload_buffer);
+  wl_shm_pool_unref (upload->shm_pool);
+
+  if (buffer->shm.release_pending)
+    {
+      buffer->shm.release_pending = FALSE;
+      if (buffer->resource)
+        wl_buffer_send_release (buffer->resource);
+    }
+
+  g_free (upload->rects);
+  g_free (upload->offsets);
+  g_free (upload);
+
+  g_object_unref (buffer);
+}
+
+/**
+ * meta_wayland_buffer_finish_shm_uploads:
+ *
+ * Completes the shm buffer uploads still being processed by the upload
+ * thread, waiting for it if needed. Called before painting, so that the stage
+ * never shows partially updated textures.
+ */
+void
+meta_wayland_buffer_finish_shm_uploads (void)
+{
+  while (pending_shm_uploads)
+    finish_shm_upload (pending_shm_uploads->data);
+}
+
+static gboolean
+process_shm_buffer_damage (MetaWaylandBuffer *buffer,
+                           cairo_region_t    *region,
+                           GError           **error)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
+  struct wl_shm_buffer *shm_buffer;
+  g_autofree cairo_rectangle_int_t *rects = NULL;
+  int n_rects;
+  CoglPixelFormat format;
+  gboolean uploaded = FALSE;
+
+  /* Updates of the same texture must be applied in order */
+  finish_shm_upload (buffer);
+
+  rects = get_shm_damage_rectangles (region, &n_rects);
+  if (n_rects == 0)
+    return TRUE;
+
+  shm_buffer = wl_shm_buffer_get (buffer->resource);
+  shm_buffer_get_cogl_pixel_format (shm_buffer, &format, NULL);
+
+  if (can_stage_shm_uploads (cogl_context))
+    {
+      GError *staging_error = NULL;
+
+      if (should_use_shm_upload_thread ())
+        {
+          uploaded = queue_shm_upload (buffer, cogl_context,
+                                       shm_buffer, format,
+                                       rects, n_rects,
+                                       &staging_error);
+        }
+      else
+        {
+          wl_shm_buffer_begin_access (shm_buffer);
+          uploaded = upload_shm_rectangles_staged (buffer, cogl_context,
+                                                   shm_buffer, format,
+                                                   rects, n_rects,
+                                                   &staging_error);
+          wl_shm_buffer_end_access (shm_buffer);
+        }
+
+      if (!uploaded)
+        {
+          meta_verbose ("Failed to stage shm buffer damage: %s\n",
+                        staging_error->message);
+          g_error_free (staging_error);
+        }
+    }
+
+  if (!uploaded)
+    {
+      wl_shm_buffer_begin_access (shm_buffer);
+      uploaded = upload_shm_rectangles (buffer, shm_buffer, format,
+                                        rects, n_rects,
+                                        error);
+      wl_shm_buffer_end_access (shm_buffer);
+    }
+
+  return uploaded;
+}
+
+/**
+ * meta_wayland_buffer_release:
+ * @buffer: a #MetaWaylandBuffer
+ *
+ * Tells the client that the compositor is done with the buffer. If its
+ * contents are still being copied by the upload thread, or if it is still
+ * being scanned out, the release is sent once that is complete.
+ */
+void
+meta_wayland_buffer_release (MetaWaylandBuffer *buffer)
+{
+  g_return_if_fail (buffer->resource);
+
+  if (buffer->scanout.use_count > 0)
+    buffer->scanout.release_pending = TRUE;
+  else if (buffer->shm.upload)
+    buffer->shm.release_pending = TRUE;
+  else
+    wl_buffer_send_release (buffer->resource);
+}
+
+/**
+ * meta_wayland_buffer_ref_scanout:
+ * @buffer: a #MetaWaylandBuffer
+ *
+ * Marks the buffer as being handed to KMS for scanout. Until the matching
+ * meta_wayland_buffer_unref_scanout(), the buffer is kept alive and any
+ * release is held back, as the display engine may still be reading from it
+ * even after the surface moved on to another buffer.
+ */
+void
+meta_wayland_buffer_ref_scanout (MetaWaylandBuffer *buffer)
+{
+  g_object_ref (buffer);
+  buffer->scanout.use_count++;
+}
+
+/**
+ * meta_wayland_buffer_unref_scanout:
+ * @buffer: a #MetaWaylandBuffer
+ *
+ * Drops a scanout reference taken with meta_wayland_buffer_ref_scanout(),
+ * sending a held back release once the buffer is no longer scanned out.
+ */
+void
+meta_wayland_buffer_unref_scanout (MetaWaylandBuffer *buffer)
+{
+  g_return_if_fail (buffer->scanout.use_count > 0);
+
+  buffer->scanout.use_count--;
+
+  if (buffer->scanout.use_count == 0 && buffer->scanout.release_pending)
+    {
+      buffer->scanout.release_pending = FALSE;
+      if (buffer->resource)
+        wl_buffer_send_release (buffer->resource);
+    }
+
+  g_object_unref (buffer);
 }
 
 void
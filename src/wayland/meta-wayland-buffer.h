@@ -33,6 +33,8 @@
 #include "meta-wayland-egl-stream.h"
 #include "meta-wayland-dma-buf.h"
 
+typedef struct _MetaWaylandShmUpload MetaWaylandShmUpload;
+
 typedef enum _MetaWaylandBufferType
 {
   META_WAYLAND_BUFFER_TYPE_UNKNOWN,
@@ -54,6 +56,11 @@ struct _MetaWaylandBuffer
 
   MetaWaylandBufferType type;
 
+  struct {
+    MetaWaylandShmUpload *upload;
+    gboolean release_pending;
+  } shm;
+
   struct {
     MetaWaylandEglStream *stream;
   } egl_stream;
@@ -61,6 +68,11 @@ struct _MetaWaylandBuffer
   struct {
     MetaWaylandDmaBufBuffer *dma_buf;
   } dma_buf;
+
+  struct {
+    int use_count;
+    gboolean release_pending;
+  } scanout;
 };
 
 #define META_TYPE_WAYLAND_BUFFER (meta_wayland_buffer_get_type ())
@@ -75,5 +87,10 @@ CoglSnippet *           meta_wayland_buffer_create_snippet      (MetaWaylandBuff
 gboolean                meta_wayland_buffer_is_y_inverted       (MetaWaylandBuffer     *buffer);
 void                    meta_wayland_buffer_process_damage      (MetaWaylandBuffer     *buffer,
                                                                  cairo_region_t        *region);
+void                    meta_wayland_buffer_release             (MetaWaylandBuffer     *buffer);
+void                    meta_wayland_buffer_ref_scanout         (MetaWaylandBuffer     *buffer);
+void                    meta_wayland_buffer_unref_scanout       (MetaWaylandBuffer     *buffer);
+
+void                    meta_wayland_buffer_finish_shm_uploads  (void);
 
 #endif /* META_WAYLAND_BUFFER_H */
@@ -39,6 +39,7 @@
 #include "wayland/meta-wayland-versions.h"
 
 #include <drm_fourcc.h>
+#include <errno.h>
 
 #include "linux-dmabuf-unstable-v1-server-protocol.h"
 
@@ -294,6 +295,96 @@ meta_wayland_dma_buf_from_buffer (MetaWaylandBuffer *buffer)
   return NULL;
 }
 
+#ifdef HAVE_NATIVE_BACKEND
+struct gbm_bo *
+meta_wayland_dma_buf_import_scanout_bo (MetaWaylandDmaBufBuffer *dma_buf,
+                                        struct gbm_device       *gbm_device,
+                                        GError                 **error)
+{
+  struct gbm_bo *bo;
+  int n_planes;
+  int i;
+
+  /* Only formats the primary plane is guaranteed to handle, and nothing
+   * that would need to be flipped on the way to the screen. */
+  if (dma_buf->drm_format != DRM_FORMAT_XRGB8888)
+    {
+      g_set_error (error, G_IO_ERROR,
+                   G_IO_ERROR_NOT_SUPPORTED,
+                   "Unsupported scanout format %d", dma_buf->drm_format);
+      return NULL;
+    }
+
+  if (!dma_buf->is_y_inverted)
+    {
+      g_set_error (error, G_IO_ERROR,
+                   G_IO_ERROR_NOT_SUPPORTED,
+                   "Can't scan out y-inverted buffers");
+      return NULL;
+    }
+
+  n_planes = 0;
+  for (i = 0; i < META_WAYLAND_DMA_BUF_MAX_FDS; i++)
+    {
+      if (dma_buf->fds[i] != -1)
+        n_planes++;
+    }
+
+  if (dma_buf->drm_modifier == DRM_FORMAT_MOD_INVALID && n_planes == 1)
+    {
+      struct gbm_import_fd_data import_data = {
+        .fd = dma_buf->fds[0],
+        .width = dma_buf->width,
+        .height = dma_buf->height,
+        .stride = dma_buf->strides[0],
+        .format = dma_buf->drm_format,
+      };
+
+      bo = gbm_bo_import (gbm_device, GBM_BO_IMPORT_FD,
+                          &import_data,
+                          GBM_BO_USE_SCANOUT);
+    }
+  else
+    {
+#ifdef GBM_BO_IMPORT_FD_MODIFIER
+      struct gbm_import_fd_modifier_data import_data = {
+        .width = dma_buf->width,
+        .height = dma_buf->height,
+        .format = dma_buf->drm_format,
+        .num_fds = n_planes,
+        .modifier = dma_buf->drm_modifier,
+      };
+
+      for (i = 0; i < n_planes; i++)
+        {
+          import_data.fds[i] = dma_buf->fds[i];
+          import_data.strides[i] = dma_buf->strides[i];
+          import_data.offsets[i] = dma_buf->offsets[i];
+        }
+
+      bo = gbm_bo_import (gbm_device, GBM_BO_IMPORT_FD_MODIFIER,
+                          &import_data,
+                          GBM_BO_USE_SCANOUT);
+#else
+      g_set_error (error, G_IO_ERROR,
+                   G_IO_ERROR_NOT_SUPPORTED,
+                   "Importing buffers with modifiers is not supported");
+      return NULL;
+#endif
+    }
+
+  if (!bo)
+    {
+      g_set_error (error, G_IO_ERROR,
+                   g_io_error_from_errno (errno),
+                   "gbm_bo_import failed: %s", g_strerror (errno));
+      return NULL;
+    }
+
+  return bo;
+}
+#endif /* HAVE_NATIVE_BACKEND */
+
 static void
 buffer_params_create_common (struct wl_client   *client,
                              struct wl_resource *params_resource,
@@ -30,6 +30,10 @@
 #include <glib.h>
 #include <glib-object.h>
 
+#ifdef HAVE_NATIVE_BACKEND
+#include <gbm.h>
+#endif
+
 #include "wayland/meta-wayland-types.h"
 
 #define META_TYPE_WAYLAND_DMA_BUF_BUFFER (meta_wayland_dma_buf_buffer_get_type ())
@@ -47,4 +51,11 @@ meta_wayland_dma_buf_buffer_attach (MetaWaylandBuffer *buffer,
 MetaWaylandDmaBufBuffer *
 meta_wayland_dma_buf_from_buffer (MetaWaylandBuffer *buffer);
 
+#ifdef HAVE_NATIVE_BACKEND
+struct gbm_bo *
+meta_wayland_dma_buf_import_scanout_bo (MetaWaylandDmaBufBuffer *dma_buf,
+                                        struct gbm_device       *gbm_device,
+                                        GError                 **error);
+#endif
+
 #endif /* META_WAYLAND_DMA_BUF_H */
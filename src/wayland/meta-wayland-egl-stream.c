@@ -198,16 +198,21 @@ meta_wayland_egl_stream_is_y_inverted (MetaWaylandEglStream *stream)
 CoglSnippet *
 meta_wayland_egl_stream_create_snippet (void)
 {
-  CoglSnippet *snippet;
+  static CoglSnippet *snippet = NULL;
 
-  snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
-                              "uniform samplerExternalOES tex_external;",
-                              NULL);
-  cogl_snippet_set_replace (snippet,
-                            "cogl_texel = texture2D (tex_external,\n"
-                            "                        cogl_tex_coord.xy);");
+  /* The snippet is the same for every stream; sharing it lets every
+   * buffer of every stream be painted with the same pipelines. */
+  if (G_UNLIKELY (snippet == NULL))
+    {
+      snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                                  "uniform samplerExternalOES tex_external;",
+                                  NULL);
+      cogl_snippet_set_replace (snippet,
+                                "cogl_texel = texture2D (tex_external,\n"
+                                "                        cogl_tex_coord.xy);");
+    }
 
-  return snippet;
+  return cogl_object_ref (snippet);
 }
 
 gboolean
@@ -227,6 +227,18 @@ sync_focus_surface (MetaWaylandPointer *pointer)
 {
   MetaDisplay *display = meta_get_display ();
 
+  /* Nothing that decides the focus changed since the last sync; repicking
+   * on every motion event would otherwise run the grab focus handler each
+   * time the pointer moves within the same surface. The default grab
+   * doesn't move the focus while buttons are held, so the number of them
+   * is part of that too.
+   */
+  if (pointer->focus_synced &&
+      pointer->focus_synced_route == (int) display->event_route &&
+      pointer->focus_synced_button_count == pointer->button_count &&
+      pointer->focus_synced_surface == pointer->focus_surface)
+    return;
+
   switch (display->event_route)
     {
     case META_EVENT_ROUTE_WINDOW_OP:
@@ -248,6 +260,10 @@ sync_focus_surface (MetaWaylandPointer *pointer)
       g_assert_not_reached ();
     }
 
+  pointer->focus_synced = TRUE;
+  pointer->focus_synced_route = display->event_route;
+  pointer->focus_synced_button_count = pointer->button_count;
+  pointer->focus_synced_surface = pointer->focus_surface;
 }
 
 static void
@@ -272,9 +288,9 @@ meta_wayland_pointer_broadcast_frame (MetaWaylandPointer *pointer)
     }
 }
 
-void
-meta_wayland_pointer_send_relative_motion (MetaWaylandPointer *pointer,
-                                           const ClutterEvent *event)
+static void
+send_relative_motion_sample (MetaWaylandPointer *pointer,
+                             const ClutterEvent *event)
 {
   struct wl_resource *resource;
   double dx, dy;
@@ -285,9 +301,6 @@ meta_wayland_pointer_send_relative_motion (MetaWaylandPointer *pointer,
   wl_fixed_t dxf, dyf;
   wl_fixed_t dx_unaccelf, dy_unaccelf;
 
-  if (!pointer->focus_client)
-    return;
-
   if (!meta_backend_get_relative_motion_deltas (meta_get_backend (),
                                                 event,
                                                 &dx, &dy,
@@ -319,6 +332,28 @@ meta_wayland_pointer_send_relative_motion (MetaWaylandPointer *pointer,
     }
 }
 
+void
+meta_wayland_pointer_send_relative_motion (MetaWaylandPointer *pointer,
+                                           const ClutterEvent *event)
+{
+  ClutterEvent **history;
+  guint n_history, i;
+
+  if (!pointer->focus_client)
+    return;
+
+  if (wl_list_empty (&pointer->focus_client->relative_pointer_resources))
+    return;
+
+  /* Relative pointer clients get every sample, including the ones the
+   * stage coalesced into this event */
+  history = clutter_event_get_motion_history (event, &n_history);
+  for (i = 0; i < n_history; i++)
+    send_relative_motion_sample (pointer, history[i]);
+
+  send_relative_motion_sample (pointer, event);
+}
+
 void
 meta_wayland_pointer_send_motion (MetaWaylandPointer *pointer,
                                   const ClutterEvent *event)
@@ -553,6 +588,11 @@ static void
 meta_wayland_pointer_set_current (MetaWaylandPointer *pointer,
                                   MetaWaylandSurface *surface)
 {
+  if (pointer->current == surface)
+    return;
+
+  pointer->focus_synced = FALSE;
+
   if (pointer->current)
     {
       g_signal_handler_disconnect (pointer->current,
@@ -934,6 +974,7 @@ meta_wayland_pointer_start_grab (MetaWaylandPointer *pointer,
   meta_wayland_pointer_cancel_grab (pointer);
 
   pointer->grab = grab;
+  pointer->focus_synced = FALSE;
   interface = pointer->grab->interface;
   grab->pointer = pointer;
 
@@ -944,6 +985,7 @@ static void
 meta_wayland_pointer_reset_grab (MetaWaylandPointer *pointer)
 {
   pointer->grab = &pointer->default_grab;
+  pointer->focus_synced = FALSE;
 }
 
 void
@@ -952,6 +994,7 @@ meta_wayland_pointer_end_grab (MetaWaylandPointer *pointer)
   const MetaWaylandPointerGrabInterface *interface;
 
   pointer->grab = &pointer->default_grab;
+  pointer->focus_synced = FALSE;
   interface = pointer->grab->interface;
   interface->focus (pointer->grab, pointer->current);
 
@@ -89,6 +89,11 @@ struct _MetaWaylandPointer
   MetaWaylandSurface *current;
   gulong current_surface_destroyed_handler_id;
 
+  gboolean focus_synced;
+  int focus_synced_route;
+  guint32 focus_synced_button_count;
+  MetaWaylandSurface *focus_synced_surface;
+
   guint32 button_count;
 };
 
@@ -72,6 +72,12 @@ struct _MetaWaylandCompositor
 
   MetaWaylandSeat *seat;
   MetaWaylandTabletManager *tablet_manager;
+
+  struct wl_listener client_created_listener;
+  struct wl_protocol_logger *protocol_logger;
+  GHashTable *client_traffic;
+  struct wl_list clients_needing_flush;
+  guint flush_idle_id;
 };
 
 #endif /* META_WAYLAND_PRIVATE_H */
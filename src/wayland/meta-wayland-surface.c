@@ -346,6 +346,14 @@ surface_process_damage (MetaWaylandSurface *surface,
   /* First update the buffer. */
   meta_wayland_buffer_process_damage (buffer, scaled_region);
 
+  /* The surface is shown by an overlay plane; redrawing the stage would
+   * only repaint what is below it. */
+  if (meta_surface_actor_wayland_is_on_overlay (META_SURFACE_ACTOR_WAYLAND (surface->surface_actor)))
+    {
+      cairo_region_destroy (scaled_region);
+      return;
+    }
+
   /* Now damage the actor. The actor expects damage in the unscaled texture
    * coordinate space, i.e. same as the buffer. */
   /* XXX: Should this be a signal / callback on MetaWaylandBuffer instead? */
@@ -447,6 +455,10 @@ meta_wayland_surface_ref_buffer_use_count (MetaWaylandSurface *surface)
   g_return_if_fail (surface->buffer_ref.buffer);
   g_warn_if_fail (surface->buffer_ref.buffer->resource);
 
+  /* A release held back while the buffer was scanned out no longer applies
+   * once it is in use again. */
+  surface->buffer_ref.buffer->scanout.release_pending = FALSE;
+
   surface->buffer_ref.use_count++;
 }
 
@@ -462,7 +474,7 @@ meta_wayland_surface_unref_buffer_use_count (MetaWaylandSurface *surface)
   g_return_if_fail (buffer);
 
   if (surface->buffer_ref.use_count == 0 && buffer->resource)
-    wl_buffer_send_release (buffer->resource);
+    meta_wayland_buffer_release (buffer);
 }
 
 static void
@@ -2181,6 +2193,10 @@ actor_surface_commit (MetaWaylandSurfaceRole  *surface_role,
 
   meta_surface_actor_wayland_sync_state (
     META_SURFACE_ACTOR_WAYLAND (surface->surface_actor));
+
+  if (pending->newly_attached)
+    meta_surface_actor_wayland_update_overlay (
+      META_SURFACE_ACTOR_WAYLAND (surface->surface_actor));
 }
 
 static void
@@ -35,6 +35,7 @@
 
 #include "meta-wayland-private.h"
 #include "meta-xwayland-private.h"
+#include "meta-wayland-buffer.h"
 #include "meta-wayland-region.h"
 #include "meta-wayland-seat.h"
 #include "meta-wayland-outputs.h"
@@ -49,6 +50,23 @@
 static MetaWaylandCompositor _meta_wayland_compositor;
 static char *_display_name_override;
 
+/* Outgoing protocol traffic of a client. Events are written to the
+ * client's connection buffer as they are posted, but only sent once the
+ * client is flushed; clients that got nothing since the last flush are
+ * left alone.
+ */
+typedef struct _MetaWaylandClientTraffic
+{
+  MetaWaylandCompositor *compositor;
+  struct wl_client *client;
+  struct wl_listener client_destroy_listener;
+
+  MetaWaylandClientStats stats;
+
+  gboolean needs_flush;
+  struct wl_list flush_link;
+} MetaWaylandClientTraffic;
+
 MetaWaylandCompositor *
 meta_wayland_compositor_get_default (void)
 {
@@ -65,12 +83,8 @@ static gboolean
 wayland_event_source_prepare (GSource *base,
                               int     *timeout)
 {
-  WaylandEventSource *source = (WaylandEventSource *)base;
-
   *timeout = -1;
 
-  wl_display_flush_clients (source->display);
-
   return FALSE;
 }
 
@@ -84,6 +98,9 @@ wayland_event_source_dispatch (GSource    *base,
 
   wl_event_loop_dispatch (loop, 0);
 
+  /* Send the replies to the requests that were just dispatched */
+  meta_wayland_compositor_flush_clients (meta_wayland_compositor_get_default ());
+
   return TRUE;
 }
 
@@ -185,6 +202,16 @@ meta_wayland_compositor_update (MetaWaylandCompositor *compositor,
     meta_wayland_seat_update (compositor->seat, event);
 }
 
+void
+meta_wayland_compositor_pre_paint (MetaWaylandCompositor *compositor)
+{
+  /* Input events of this frame have been processed by now; send them
+   * out in one go rather than after painting. */
+  meta_wayland_compositor_flush_clients (compositor);
+
+  meta_wayland_buffer_finish_shm_uploads ();
+}
+
 void
 meta_wayland_compositor_paint_finished (MetaWaylandCompositor *compositor)
 {
@@ -198,6 +225,8 @@ meta_wayland_compositor_paint_finished (MetaWaylandCompositor *compositor)
       wl_callback_send_done (callback->resource, current_time / 1000);
       wl_resource_destroy (callback->resource);
     }
+
+  meta_wayland_compositor_flush_clients (compositor);
 }
 
 /**
@@ -300,11 +329,172 @@ meta_wayland_log_func (const char *fmt,
   g_free (str);
 }
 
+static void
+client_traffic_free (MetaWaylandClientTraffic *traffic)
+{
+  wl_list_remove (&traffic->client_destroy_listener.link);
+  wl_list_remove (&traffic->flush_link);
+  g_free (traffic);
+}
+
+static void
+on_client_destroyed (struct wl_listener *listener,
+                     void               *data)
+{
+  MetaWaylandClientTraffic *traffic =
+    wl_container_of (listener, traffic, client_destroy_listener);
+
+  g_hash_table_remove (traffic->compositor->client_traffic, traffic->client);
+}
+
+static void
+on_client_created (struct wl_listener *listener,
+                   void               *data)
+{
+  MetaWaylandCompositor *compositor =
+    wl_container_of (listener, compositor, client_created_listener);
+  struct wl_client *client = data;
+  MetaWaylandClientTraffic *traffic;
+
+  traffic = g_new0 (MetaWaylandClientTraffic, 1);
+  traffic->compositor = compositor;
+  traffic->client = client;
+  wl_client_get_credentials (client, &traffic->stats.pid, NULL, NULL);
+  wl_list_init (&traffic->flush_link);
+
+  traffic->client_destroy_listener.notify = on_client_destroyed;
+  wl_client_add_destroy_listener (client, &traffic->client_destroy_listener);
+
+  g_hash_table_insert (compositor->client_traffic, client, traffic);
+}
+
+static size_t
+get_message_size (const struct wl_protocol_logger_message *message)
+{
+  const char *signature = message->message->signature;
+  size_t size = 8; /* object id, opcode and size */
+  int i = 0;
+
+  for (; *signature != '\0'; signature++)
+    {
+      const union wl_argument *arg;
+
+      if (*signature == '?' || g_ascii_isdigit (*signature))
+        continue;
+
+      if (i >= message->arguments_count)
+        break;
+
+      arg = &message->arguments[i++];
+
+      switch (*signature)
+        {
+        case 's':
+          size += 4;
+          if (arg->s)
+            size += (strlen (arg->s) + 1 + 3) & ~3;
+          break;
+        case 'a':
+          size += 4;
+          if (arg->a)
+            size += (arg->a->size + 3) & ~3;
+          break;
+        case 'h':
+          /* file descriptors are passed out of band */
+          break;
+        default:
+          size += 4;
+          break;
+        }
+    }
+
+  return size;
+}
+
+static void
+mark_client_flushed (MetaWaylandClientTraffic *traffic)
+{
+  traffic->stats.n_flushes++;
+  traffic->needs_flush = FALSE;
+  wl_list_remove (&traffic->flush_link);
+  wl_list_init (&traffic->flush_link);
+}
+
+static gboolean
+flush_all_clients_idle (gpointer user_data)
+{
+  MetaWaylandCompositor *compositor = user_data;
+  MetaWaylandClientTraffic *traffic, *next;
+
+  compositor->flush_idle_id = 0;
+
+  wl_list_for_each_safe (traffic, next,
+                         &compositor->clients_needing_flush, flush_link)
+    mark_client_flushed (traffic);
+
+  wl_display_flush_clients (compositor->wayland_display);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Clients are normally flushed at fixed points, but events can also be
+ * posted from elsewhere, e.g. timeouts or D-Bus calls, and a client whose
+ * socket is full can only be waited on by wl_display_flush_clients(). So
+ * once the main loop goes idle, everything left over is flushed. This is
+ * cheap for clients that have nothing queued, as they are skipped without
+ * a syscall.
+ */
+static void
+queue_flush_all_clients (MetaWaylandCompositor *compositor)
+{
+  if (compositor->flush_idle_id)
+    return;
+
+  compositor->flush_idle_id =
+    g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                     flush_all_clients_idle, compositor, NULL);
+  g_source_set_name_by_id (compositor->flush_idle_id,
+                           "[mutter] flush_all_clients_idle");
+}
+
+static void
+protocol_logger_func (void                                    *user_data,
+                      enum wl_protocol_logger_type             type,
+                      const struct wl_protocol_logger_message *message)
+{
+  MetaWaylandCompositor *compositor = user_data;
+  MetaWaylandClientTraffic *traffic;
+
+  if (type != WL_PROTOCOL_LOGGER_EVENT)
+    return;
+
+  queue_flush_all_clients (compositor);
+
+  traffic = g_hash_table_lookup (compositor->client_traffic,
+                                 wl_resource_get_client (message->resource));
+  if (!traffic)
+    return;
+
+  traffic->stats.n_messages++;
+  traffic->stats.n_bytes += get_message_size (message);
+
+  if (!traffic->needs_flush)
+    {
+      traffic->needs_flush = TRUE;
+      wl_list_insert (compositor->clients_needing_flush.prev,
+                      &traffic->flush_link);
+    }
+}
+
 static void
 meta_wayland_compositor_init (MetaWaylandCompositor *compositor)
 {
   memset (compositor, 0, sizeof (MetaWaylandCompositor));
   wl_list_init (&compositor->frame_callbacks);
+  wl_list_init (&compositor->clients_needing_flush);
+  compositor->client_traffic =
+    g_hash_table_new_full (NULL, NULL,
+                           NULL, (GDestroyNotify) client_traffic_free);
 }
 
 void
@@ -320,6 +510,15 @@ meta_wayland_pre_clutter_init (void)
   if (compositor->wayland_display == NULL)
     g_error ("Failed to create the global wl_display");
 
+  compositor->client_created_listener.notify = on_client_created;
+  wl_display_add_client_created_listener (compositor->wayland_display,
+                                          &compositor->client_created_listener);
+
+  compositor->protocol_logger =
+    wl_display_add_protocol_logger (compositor->wayland_display,
+                                    protocol_logger_func,
+                                    compositor);
+
   clutter_wayland_set_compositor_display (compositor->wayland_display);
 }
 
@@ -475,8 +674,56 @@ meta_wayland_compositor_is_shortcuts_inhibited (MetaWaylandCompositor *composito
   return FALSE;
 }
 
+static void
+flush_dirty_clients (MetaWaylandCompositor *compositor)
+{
+  MetaWaylandClientTraffic *traffic, *next;
+  COGL_TRACE_BEGIN_SCOPED (MetaWaylandFlushClients, "Wayland client flush");
+
+  wl_list_for_each_safe (traffic, next,
+                         &compositor->clients_needing_flush, flush_link)
+    {
+      mark_client_flushed (traffic);
+      wl_client_flush (traffic->client);
+    }
+}
+
+/*
+ * meta_wayland_compositor_flush_clients:
+ * @compositor: the #MetaWaylandCompositor
+ *
+ * Sends what was queued for clients since they were last flushed, only
+ * touching the clients that got any events. Traffic is flushed after
+ * client requests have been dispatched, once the input events of a frame
+ * have been processed, and after frame callbacks have been emitted.
+ */
 void
 meta_wayland_compositor_flush_clients (MetaWaylandCompositor *compositor)
 {
-  wl_display_flush_clients (compositor->wayland_display);
+  if (wl_list_empty (&compositor->clients_needing_flush))
+    return;
+
+  flush_dirty_clients (compositor);
+}
+
+/**
+ * meta_wayland_compositor_foreach_client_stats:
+ * @compositor: the #MetaWaylandCompositor
+ * @func: (scope call): function to call for each client
+ * @user_data: user data for @func
+ *
+ * Calls @func with the outgoing traffic counters of each connected
+ * client, for profiling.
+ */
+void
+meta_wayland_compositor_foreach_client_stats (MetaWaylandCompositor      *compositor,
+                                              MetaWaylandClientStatsFunc  func,
+                                              gpointer                    user_data)
+{
+  GHashTableIter iter;
+  MetaWaylandClientTraffic *traffic;
+
+  g_hash_table_iter_init (&iter, compositor->client_traffic);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &traffic))
+    func (&traffic->stats, user_data);
 }
@@ -23,10 +23,24 @@
 #ifndef META_WAYLAND_H
 #define META_WAYLAND_H
 
+#include <sys/types.h>
+#include <stdint.h>
+
 #include <clutter/clutter.h>
 #include <meta/types.h>
 #include "meta-wayland-types.h"
 
+typedef struct _MetaWaylandClientStats
+{
+  pid_t pid;
+  uint64_t n_flushes;
+  uint64_t n_messages;
+  uint64_t n_bytes;
+} MetaWaylandClientStats;
+
+typedef void (* MetaWaylandClientStatsFunc) (const MetaWaylandClientStats *stats,
+                                             gpointer                      user_data);
+
 void                    meta_wayland_override_display_name (char *display_name);
 
 void                    meta_wayland_pre_clutter_init           (void);
@@ -50,6 +64,8 @@ void                    meta_wayland_compositor_repick          (MetaWaylandComp
 void                    meta_wayland_compositor_set_input_focus (MetaWaylandCompositor *compositor,
                                                                  MetaWindow            *window);
 
+void                    meta_wayland_compositor_pre_paint       (MetaWaylandCompositor *compositor);
+
 void                    meta_wayland_compositor_paint_finished  (MetaWaylandCompositor *compositor);
 
 void                    meta_wayland_compositor_destroy_frame_callbacks (MetaWaylandCompositor *compositor,
@@ -65,5 +81,9 @@ gboolean                meta_wayland_compositor_is_shortcuts_inhibited (MetaWayl
 
 void                    meta_wayland_compositor_flush_clients (MetaWaylandCompositor *compositor);
 
+void                    meta_wayland_compositor_foreach_client_stats (MetaWaylandCompositor      *compositor,
+                                                                      MetaWaylandClientStatsFunc  func,
+                                                                      gpointer                    user_data);
+
 #endif
 